@@ -1,13 +1,16 @@
 #version 460
 
-const int MAX_POINT_LIGHTS  = 4;
-const int MAX_SPOT_LIGHTS  = 4;
+// Permutations : COLOR_TEX, NORMAL_TEX, SPECULAR_TEX, VIRTUAL_COLOR_TEX, SHADOWS are injected by ProgramVariants
+
+// Keep in sync with Defines.h
+const uint MAX_LIGHTS_PER_CLUSTER = 128;
 
 in vec2 vTexCoord0;
 in vec3 vNormal;
 in vec3 vWorldPos;
 in vec4 vLightSpacePos;
 in mat3 vTBN;
+flat in uint vMaterialIndex;
 
 out vec4 FragColor;
 
@@ -19,79 +22,125 @@ struct DirLight
 	float AmbientIntensity;
 };
 
-struct Attenuation
+// Point and spot lights, see LightCullCS.glsl
+struct Light
 {
- float Constant;
- float Linear;
- float Exp;
+	vec4 PositionRange;
+	vec4 ColorIntensity;
+	vec4 Attenuation;
+	vec4 DirectionCutoff;
+	vec4 ShadowParams;
 };
 
-struct PointLight
+struct SpotShadow
 {
-	float Intensity;
-	vec3 Color;
-	vec3 Position;
-	Attenuation Atten;
-};
-
-struct SpotLight
-{
-	PointLight PL;
-	vec3 Dir;
-	float Cutoff;
+	mat4 ViewProj;
+	vec4 AtlasRect;		// Offset and scale in the atlas
 };
 
+// Keep in sync with MaterialTable::Record
 struct Material
 {
-	vec3 Ambient;
-	vec3 Diffuse;
-	vec3 Specular;
-	float SpecularExponent;
+	vec4 Ambient;
+	vec4 DiffuseExponent;	// Diffuse color, specular exponent
+	vec4 Specular;
+	ivec4 Textures;			// Color, normal, specular : array << 16 | layer, -1 when bound to its own unit
+	ivec4 VirtualTexture;	// Page table offset, width, height, level count (0 while cooking)
 };
 
-uniform bool uColorTexAvailable;
-uniform bool uNormalTexAvailable;
-uniform bool uSpecularTexAvailable;
-uniform bool uShadowEnabled;
-
 uniform vec3 uCameraWorldPos;
 
 uniform DirLight uDirLight;
-uniform PointLight uPointLight[MAX_POINT_LIGHTS];
-uniform SpotLight uSpotLight[MAX_SPOT_LIGHTS];
 uniform int uDirLightNum;
-uniform int uPointLightNum;
-uniform int uSpotLightNum;
 
-uniform Material uMaterial;
+layout (std430, binding = 0) readonly buffer Lights
+{
+	Light uLights[];
+};
+
+layout (std430, binding = 2) readonly buffer ClusterLightGrid
+{
+	uint uClusterLightCount[];
+};
+
+layout (std430, binding = 3) readonly buffer ClusterLightIndices
+{
+	uint uClusterLightIndices[];
+};
+
+layout (std430, binding = 4) readonly buffer SpotShadows
+{
+	SpotShadow uSpotShadows[];
+};
+
+layout (std430, binding = 7) readonly buffer VirtualShadowPageTable
+{
+	uint uVirtualShadowPageTable[];
+};
+
+uniform mat4 uView;
+uniform uvec3 uClusterGrid;
+uniform vec2 uClusterTileSize;
+uniform vec2 uClusterZParams;	// Slice = log(ViewDepth) * x - y
+
+layout (std430, binding = 10) readonly buffer MaterialTable
+{
+	Material uMaterials[];
+};
+
+// Indexed by the draw base instance
+Material CurrentMaterial;
 
 uniform sampler2D uColorTex;
 uniform sampler2D uSpecularExponentTex;
 uniform sampler2D uNormalTex;
-uniform sampler2D uShadowMap0;
+uniform sampler2DArray uTextureArrays[8];		// Keep in sync with TEXTURE_ARRAY_COUNT
+uniform sampler2DShadow uShadowMap0;
+uniform sampler2D uShadowMoments0;
+uniform int uShadowFilterMode;		// Keep in sync with ShadowPass::EShadowFilter
+uniform vec2 uEVSMExponents;
+uniform bool uVirtualShadowEnabled;
+uniform sampler2DShadow uVirtualShadowPool;
+uniform mat4 uVirtualShadowViewProj;
+uniform vec2 uVirtualShadowLevelParams;	// World size of a level 0 texel, world size of a pixel at unit distance
+uniform samplerCubeArray uPointShadowMaps;
+uniform sampler2D uSpotShadowAtlas;
+
+uniform sampler2D uVirtualTextureCache;
+
+layout (std430, binding = 9) readonly buffer VirtualTexturePageTable
+{
+	uint uVirtualTexturePageTable[];
+};
 
 // Function Definitions for Directional, Point and Spot Lights
 vec4 DirectionalLightContribution(DirLight iDirLight, vec3 iNormal);
-vec4 PointLightContribution(PointLight iPointLight, vec3 iNormal);
-vec4 SpotLightContribution(SpotLight iSpotLight, vec3 iNormal);
+vec4 LocalLightContribution(Light iLight, vec3 iNormal);
 vec4 LightFunc(vec3 iColor, float iAmbientIntensity, vec3 iLightDir, vec3 iNormal);
 
 // Shadow Function
 float ShadowFactor();
+float PointShadowFactor(Light iLight, vec3 iLightToPixel, float iDistance);
+float SpotShadowFactor(Light iLight);
+
+uint ClusterIndex();
+
+vec4 SampleMaterialTexture(int iLocation, sampler2D iUnpacked, vec2 iUVs);
+vec4 SampleVirtualTexture(vec2 iUVs);
 
 void main()
 {
+	CurrentMaterial = uMaterials[vMaterialIndex];
+
 	vec3 wNormal = vec3(0.f, 0.f, 0.f);
-	if(uNormalTexAvailable)
-	{
-		wNormal = texture(uNormalTex, vTexCoord0).rgb;
-		wNormal = normalize(wNormal * 2.0 - 1.0);
-		wNormal = normalize(vTBN * wNormal);
-	}
-	else
-	{
-		wNormal = normalize(vNormal);
-	}
+	#ifdef NORMAL_TEX
+	// Normal maps are cooked to two channels (BC5), Z is rebuilt
+	wNormal.xy = SampleMaterialTexture(CurrentMaterial.Textures.y, uNormalTex, vTexCoord0).rg * 2.0 - 1.0;
+	wNormal.z = sqrt(max(1.0 - dot(wNormal.xy, wNormal.xy), 0.0));
+	wNormal = normalize(vTBN * wNormal);
+	#else
+	wNormal = normalize(vNormal);
+	#endif
 	
 	vec4 DirLightColor= vec4(0.f, 0.f, 0.f, 0.f);
 	if(uDirLightNum > 0)
@@ -101,37 +150,30 @@ void main()
 		clamp(DirLightColor, 0.0, 1.0);
 	}
 	
-	vec4 PointLightColor = vec4(0.f, 0.f, 0.f, 0.f);
+	// Only walk the lights assigned to this pixel's cluster
+	vec4 LocalLightColor = vec4(0.f, 0.f, 0.f, 0.f);
+	uint Cluster = ClusterIndex();
+	uint ClusterLightCount = uClusterLightCount[Cluster];
 
-	for(int i=0; i < uPointLightNum; i++)
+	for(uint i = 0; i < ClusterLightCount; i++)
 	{
-		PointLightColor += PointLightContribution(uPointLight[i], wNormal);
-		PointLightColor *= uPointLight[i].Intensity;
-		clamp(PointLightColor, 0.0, 1.0);
+		Light wLight = uLights[uClusterLightIndices[Cluster * MAX_LIGHTS_PER_CLUSTER + i]];
+		LocalLightColor += LocalLightContribution(wLight, wNormal) * wLight.ColorIntensity.w;
 	}
 
-	vec4 SpotLightColor = vec4(0.f, 0.f, 0.f, 0.f);
-
-	for(int i=0; i < uSpotLightNum; i++)
-	{
-		SpotLightColor += SpotLightContribution(uSpotLight[i], wNormal);
-		SpotLightColor *= uSpotLight[i].PL.Intensity;
-		clamp(SpotLightColor, 0.0, 1.0);
-
-	}
-
-	vec4 LightColor = clamp(DirLightColor + PointLightColor + SpotLightColor, 0.f, 1.f);
+	vec4 LightColor = clamp(DirLightColor + LocalLightColor, 0.f, 1.f);
 	
-	if(uShadowEnabled)
-	{
-		LightColor *= ShadowFactor();
-	}
+	#ifdef SHADOWS
+	LightColor *= ShadowFactor();
+	#endif
 
 	vec4 ColorTex = vec4(1.f, 1.f, 1.f, 1.f);
-	if(uColorTexAvailable)
-	{
-		ColorTex = texture2D(uColorTex, vTexCoord0);
-	}
+	#ifdef COLOR_TEX
+	ColorTex = SampleMaterialTexture(CurrentMaterial.Textures.x, uColorTex, vTexCoord0);
+	#endif
+	#ifdef VIRTUAL_COLOR_TEX
+	ColorTex = SampleVirtualTexture(vTexCoord0);
+	#endif
 
 	FragColor = ColorTex * LightColor;
 }
@@ -141,39 +183,42 @@ vec4 DirectionalLightContribution(DirLight iDirLight, vec3 iNormal)
 	return LightFunc(iDirLight.Color, iDirLight.AmbientIntensity, iDirLight.Dir, iNormal);
 }
 
-vec4 PointLightContribution(PointLight iPointLight, vec3 iNormal)
+vec4 LocalLightContribution(Light iLight, vec3 iNormal)
 {
-	vec3 LightDir = vWorldPos - iPointLight.Position;
+	vec3 LightDir = vWorldPos - iLight.PositionRange.xyz;
 	float Distance = length(LightDir);
-	LightDir = normalize(LightDir);
-	vec4 Result = LightFunc(iPointLight.Color, 0.f, LightDir, iNormal);
-
-	float Attenuation = iPointLight.Atten.Constant +
-						iPointLight.Atten.Linear * Distance +
-						iPointLight.Atten.Exp * Distance * Distance;
-
-	return Result / Attenuation;
-}
+	if(Distance > iLight.PositionRange.w)
+	{
+		return vec4(0.0f, 0.0f, 0.0f, 0.0f);
+	}
 
-vec4 SpotLightContribution(SpotLight iSpotLight, vec3 iNormal)
-{
-	vec3 LightToPixel = normalize(vWorldPos - iSpotLight.PL.Position);
-	float SpotFactor = dot(LightToPixel, iSpotLight.Dir);
+	LightDir = LightDir / Distance;
 
-	if(SpotFactor > iSpotLight.Cutoff)
+	float SpotFactor = 1.f;
+	float Cutoff = iLight.DirectionCutoff.w;
+	if(Cutoff >= -1.f)
 	{
-		vec4 Color = PointLightContribution(iSpotLight.PL, iNormal);
-		SpotFactor = 1.f - ((1.f - SpotFactor) / (1.f - iSpotLight.Cutoff));
-		return Color * SpotFactor;
+		SpotFactor = dot(LightDir, iLight.DirectionCutoff.xyz);
+		if(SpotFactor <= Cutoff)
+		{
+			return vec4(0.0f, 0.0f, 0.0f, 0.0f);
+		}
+		SpotFactor = 1.f - ((1.f - SpotFactor) / (1.f - Cutoff));
 	}
 
-	return vec4(0.0f, 0.0f, 0.0f, 0.0f);
+	vec4 Result = LightFunc(iLight.ColorIntensity.rgb, 0.f, LightDir, iNormal);
+
+	float Attenuation = iLight.Attenuation.x +
+						iLight.Attenuation.y * Distance +
+						iLight.Attenuation.z * Distance * Distance;
+
+	return Result / Attenuation * SpotFactor * PointShadowFactor(iLight, LightDir, Distance) * SpotShadowFactor(iLight);
 }
 
 vec4 LightFunc(vec3 iColor, float iAmbientIntensity, vec3 iLightDir, vec3 iNormal)
 {
 	// Ambient Contribution
-	vec4 Ambient = vec4(uMaterial.Ambient, 1.0f) *
+	vec4 Ambient = vec4(CurrentMaterial.Ambient.rgb, 1.0f) *
 						vec4(iColor, 1.0f) *
 						iAmbientIntensity;
     clamp(Ambient, 0.f, 1.f);
@@ -185,7 +230,7 @@ vec4 LightFunc(vec3 iColor, float iAmbientIntensity, vec3 iLightDir, vec3 iNorma
 	if(DiffuseFactor > 0 )
 	{
 		Diffuse = vec4(iColor, 1.0f) *
-						vec4(uMaterial.Diffuse, 1.0f) *
+						vec4(CurrentMaterial.DiffuseExponent.rgb, 1.0f) *
 						DiffuseFactor;
 		clamp(Diffuse, 0.f, 1.f);
 	}
@@ -198,15 +243,14 @@ vec4 LightFunc(vec3 iColor, float iAmbientIntensity, vec3 iLightDir, vec3 iNorma
 
 	if(SpecularFactor > 0)
 	{
-		float SpecularExponent = uMaterial.SpecularExponent;
-		if(uSpecularTexAvailable)
-		{
-			SpecularExponent = texture2D(uSpecularExponentTex, vTexCoord0).r * 255.0;
-		}
+		float SpecularExponent = CurrentMaterial.DiffuseExponent.w;
+		#ifdef SPECULAR_TEX
+		SpecularExponent = SampleMaterialTexture(CurrentMaterial.Textures.z, uSpecularExponentTex, vTexCoord0).r * 255.0;
+		#endif
 
 		SpecularFactor = pow(SpecularFactor, SpecularExponent);
 		Specular = vec4(iColor, 1.0f) *
-						vec4(uMaterial.Specular, 1.0f) *
+						vec4(CurrentMaterial.Specular.rgb, 1.0f) *
 						SpecularFactor;
 
 		clamp(Specular, 0.f, 1.f);
@@ -215,24 +259,231 @@ vec4 LightFunc(vec3 iColor, float iAmbientIntensity, vec3 iLightDir, vec3 iNorma
 	return Ambient + Diffuse + Specular;
 }
 
-float ShadowFactor()
+const int SHADOW_FILTER_HARDWARE_PCF = 0;
+const int SHADOW_FILTER_POISSON_PCF = 1;
+const int SHADOW_FILTER_EVSM = 2;
+
+const vec2 POISSON_DISK[12] = vec2[](
+	vec2(-0.326, -0.406), vec2(-0.840, -0.074), vec2(-0.696, 0.457),
+	vec2(-0.203, 0.621), vec2(0.962, -0.195), vec2(0.473, -0.480),
+	vec2(0.519, 0.767), vec2(0.185, -0.893), vec2(0.507, 0.064),
+	vec2(0.896, 0.412), vec2(-0.322, -0.933), vec2(-0.792, -0.598));
+
+// Each tap is itself a bilinear 2x2 hardware comparison, a rotated disk hides the banding
+float PoissonPCF(vec2 iUVs, float iDepth)
 {
-	vec3 ProjCoord = vLightSpacePos.xyz / vLightSpacePos.w; // Get [-1, 1] coords
-	vec2 UVs;
-	UVs.x = 0.5 * ProjCoord.x + 0.5;
-	UVs.y = 0.5 * ProjCoord.y + 0.5;
+	float Noise = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+	float Angle = Noise * 6.2831853;
+	mat2 Rotation = mat2(cos(Angle), sin(Angle), -sin(Angle), cos(Angle));
+	vec2 Radius = 1.5 / vec2(textureSize(uShadowMap0, 0));
+
+	float Lit = 0.0;
+	for(int i = 0; i < 12; i++)
+	{
+		Lit += texture(uShadowMap0, vec3(iUVs + Rotation * POISSON_DISK[i] * Radius, iDepth));
+	}
+	return Lit / 12.0;
+}
+
+float ChebyshevUpperBound(vec2 iMoments, float iMean, float iMinVariance)
+{
+	if(iMean <= iMoments.x)
+	{
+		return 1.0;
+	}
+
+	float Variance = max(iMoments.y - iMoments.x * iMoments.x, iMinVariance);
+	float Delta = iMean - iMoments.x;
+	float PMax = Variance / (Variance + Delta * Delta);
+
+	// Light bleeding reduction
+	return clamp((PMax - 0.2) / 0.8, 0.0, 1.0);
+}
+
+float EVSM(vec2 iUVs, float iDepth)
+{
+	vec4 Moments = texture(uShadowMoments0, iUVs);
+	float Depth = 2.0 * iDepth - 1.0;
+	float Pos = exp(uEVSMExponents.x * Depth);
+	float Neg = -exp(-uEVSMExponents.y * Depth);
+
+	vec2 DepthScale = 0.0001 * uEVSMExponents * vec2(Pos, -Neg);
+	float PosLit = ChebyshevUpperBound(Moments.xy, Pos, DepthScale.x * DepthScale.x);
+	float NegLit = ChebyshevUpperBound(Moments.zw, Neg, DepthScale.y * DepthScale.y);
+	return min(PosLit, NegLit);
+}
+
+float ShadowVisibility(vec4 iLightSpacePos)
+{
+	vec3 ProjCoord = iLightSpacePos.xyz / iLightSpacePos.w; // Get [-1, 1] coords
+	vec2 UVs = 0.5 * ProjCoord.xy + 0.5;
 	float z = 0.5 * ProjCoord.z + 0.5;
-	float Depth = texture2D(uShadowMap0, UVs).x;
 
 	float Bias = 0.001;
 
-	if(Depth + Bias < z)
+	if(uShadowFilterMode == SHADOW_FILTER_EVSM)
 	{
-		return 0.5;
+		return EVSM(UVs, z);
+	}
+	else if(uShadowFilterMode == SHADOW_FILTER_POISSON_PCF)
+	{
+		return PoissonPCF(UVs, z - Bias);
 	}
+	return texture(uShadowMap0, vec3(UVs, z - Bias));
+}
+
+// Keep in sync with VirtualShadowMap
+const uint VSM_LEVEL_COUNT = 5u;
+const uint VSM_PAGES_PER_SIDE = 128u;
+const uint VSM_POOL_PAGES_PER_SIDE = 32u;
+const float VSM_PAGE_SIZE = 128.0;
+const uint VSM_LEVEL_OFFSETS[5] = uint[](0u, 16384u, 20480u, 21504u, 21760u);
 
-	else
+// Same level selection as VirtualShadowMarkCS.glsl, the coarser levels back the pages not rendered yet
+float VirtualShadowVisibility(vec3 iWorldPos)
+{
+	vec4 LightSpacePos = uVirtualShadowViewProj * vec4(iWorldPos, 1.0);
+	vec3 ProjCoord = LightSpacePos.xyz / LightSpacePos.w;
+	vec2 UVs = 0.5 * ProjCoord.xy + 0.5;
+	float z = 0.5 * ProjCoord.z + 0.5;
+	if(any(lessThan(UVs, vec2(0.0))) || any(greaterThanEqual(UVs, vec2(1.0))))
 	{
 		return 1.0;
 	}
-}
\ No newline at end of file
+
+	float PixelSize = distance(iWorldPos, uCameraWorldPos) * uVirtualShadowLevelParams.y;
+	uint Level = uint(clamp(floor(log2(max(PixelSize / uVirtualShadowLevelParams.x, 1.0))), 0.0, float(VSM_LEVEL_COUNT - 1u)));
+	for(; Level < VSM_LEVEL_COUNT; Level++)
+	{
+		uint PagesPerSide = VSM_PAGES_PER_SIDE >> Level;
+		vec2 PageCoord = UVs * float(PagesPerSide);
+		uvec2 Page = min(uvec2(PageCoord), uvec2(PagesPerSide - 1u));
+		uint Entry = uVirtualShadowPageTable[VSM_LEVEL_OFFSETS[Level] + Page.y * PagesPerSide + Page.x];
+		if(Entry != 0u)
+		{
+			// Half a texel inside the page, its neighbours in the pool are unrelated pages
+			uint PhysicalPage = Entry - 1u;
+			vec2 InPage = clamp(PageCoord - vec2(Page), vec2(0.5 / VSM_PAGE_SIZE), vec2(1.0 - 0.5 / VSM_PAGE_SIZE));
+			vec2 PoolUVs = (vec2(PhysicalPage % VSM_POOL_PAGES_PER_SIDE, PhysicalPage / VSM_POOL_PAGES_PER_SIDE) + InPage) / float(VSM_POOL_PAGES_PER_SIDE);
+			return texture(uVirtualShadowPool, vec3(PoolUVs, z - 0.001));
+		}
+	}
+	return 1.0;
+}
+
+float ShadowFactor()
+{
+	// Shadowed areas keep half of the light
+	if(uVirtualShadowEnabled)
+	{
+		return mix(0.5, 1.0, VirtualShadowVisibility(vWorldPos));
+	}
+	return mix(0.5, 1.0, ShadowVisibility(vLightSpacePos));
+}
+
+uint ClusterIndex()
+{
+	float ViewDepth = -(uView * vec4(vWorldPos, 1.0)).z;
+	uint Slice = uint(max(log(ViewDepth) * uClusterZParams.x - uClusterZParams.y, 0.0));
+	uvec3 Cluster = min(uvec3(uvec2(gl_FragCoord.xy / uClusterTileSize), Slice), uClusterGrid - uvec3(1));
+	return Cluster.x + uClusterGrid.x * (Cluster.y + uClusterGrid.y * Cluster.z);
+}
+
+float PointShadowFactor(Light iLight, vec3 iLightToPixel, float iDistance)
+{
+	if(iLight.ShadowParams.x < 0.f)
+	{
+		return 1.f;
+	}
+
+	// The cube map stores the light to occluder distance divided by the shadow far plane
+	float Occluder = texture(uPointShadowMaps, vec4(iLightToPixel, iLight.ShadowParams.x)).r * iLight.ShadowParams.y;
+	float Bias = 0.05;
+
+	if(Occluder + Bias < iDistance)
+	{
+		return 0.5;
+	}
+	return 1.f;
+}
+
+float SpotShadowFactor(Light iLight)
+{
+	if(iLight.ShadowParams.z < 0.f)
+	{
+		return 1.f;
+	}
+
+	SpotShadow Shadow = uSpotShadows[uint(iLight.ShadowParams.z)];
+	vec4 LightSpacePos = Shadow.ViewProj * vec4(vWorldPos, 1.0);
+	vec3 ProjCoord = LightSpacePos.xyz / LightSpacePos.w * 0.5 + 0.5;
+	if(any(lessThan(ProjCoord.xy, vec2(0.0))) || any(greaterThan(ProjCoord.xy, vec2(1.0))))
+	{
+		return 1.f;
+	}
+
+	// Remap the tile UVs into the atlas
+	vec2 UVs = Shadow.AtlasRect.xy + ProjCoord.xy * Shadow.AtlasRect.zw;
+	float Depth = texture(uSpotShadowAtlas, UVs).r;
+
+	float Bias = 0.0005;
+	if(Depth + Bias < ProjCoord.z)
+	{
+		return 0.5;
+	}
+	return 1.f;
+}
+
+// Packed textures are read from their array layer, the location is the same for the whole draw
+vec4 SampleMaterialTexture(int iLocation, sampler2D iUnpacked, vec2 iUVs)
+{
+	if(iLocation < 0)
+	{
+		return texture(iUnpacked, iUVs);
+	}
+	return texture(uTextureArrays[iLocation >> 16], vec3(iUVs, float(iLocation & 0xFFFF)));
+}
+
+// Keep in sync with VirtualTextureCache
+const int VT_TILE_SIZE = 128;
+const float VT_TILE_BORDER = 4.0;
+const uint VT_CACHE_TILES_PER_SIDE = 32u;
+const float VT_CACHE_SIZE = 4352.0;
+
+// Level picked from the UV derivatives like hardware mip selection, then the first resident tile
+// walking towards the coarsest level, which is always resident
+vec4 SampleVirtualTexture(vec2 iUVs)
+{
+	if(CurrentMaterial.VirtualTexture.w == 0)
+	{
+		return vec4(1.0);
+	}
+
+	vec2 TexelDx = dFdx(iUVs) * vec2(CurrentMaterial.VirtualTexture.yz);
+	vec2 TexelDy = dFdy(iUVs) * vec2(CurrentMaterial.VirtualTexture.yz);
+	float Lod = 0.5 * log2(max(max(dot(TexelDx, TexelDx), dot(TexelDy, TexelDy)), 1e-8));
+	int Level = clamp(int(floor(Lod)), 0, CurrentMaterial.VirtualTexture.w - 1);
+
+	vec2 UVs = fract(iUVs);
+	int Page = CurrentMaterial.VirtualTexture.x;
+	for(int i = 0; i < CurrentMaterial.VirtualTexture.w; i++)
+	{
+		ivec2 LevelSize = max(CurrentMaterial.VirtualTexture.yz >> i, ivec2(1));
+		ivec2 Tiles = (LevelSize + VT_TILE_SIZE - 1) / VT_TILE_SIZE;
+		if(i >= Level)
+		{
+			vec2 TexelCoord = UVs * vec2(LevelSize);
+			ivec2 Tile = min(ivec2(TexelCoord) / VT_TILE_SIZE, Tiles - 1);
+			uint Entry = uVirtualTexturePageTable[Page + Tile.y * Tiles.x + Tile.x];
+			if(Entry != 0u)
+			{
+				uint Slot = Entry - 1u;
+				vec2 InTile = TexelCoord - vec2(Tile * VT_TILE_SIZE) + VT_TILE_BORDER;
+				vec2 SlotOrigin = vec2(Slot % VT_CACHE_TILES_PER_SIDE, Slot / VT_CACHE_TILES_PER_SIDE) * (float(VT_TILE_SIZE) + 2.0 * VT_TILE_BORDER);
+				return textureLod(uVirtualTextureCache, (SlotOrigin + InTile) / VT_CACHE_SIZE, 0.0);
+			}
+		}
+		Page += Tiles.x * Tiles.y;
+	}
+	return vec4(1.0);
+}
@@ -16,6 +16,10 @@ out vec3 vNormal;
 out vec3 vWorldPos;
 out vec4 vLightSpacePos;
 out mat3 vTBN;
+flat out uint vMaterialIndex;		// Row of the material table, see MaterialTable
+
+// Must match DepthPrepassVS bit for bit, depth is tested with GL_EQUAL after a prepass
+invariant gl_Position;
 
 void main()
 {
@@ -37,4 +41,6 @@ void main()
 	vWorldPos = vec3(WorldPos);
 
 	vLightSpacePos = uLightMVP * vec4(Pos, 1.0);
+
+	vMaterialIndex = uint(gl_BaseInstance);
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#version 460
+
+// Builds the view space AABB of every cluster, only dispatched when the projection changes
+
+layout (local_size_x = 64) in;
+
+struct ClusterAABB
+{
+	vec4 Min;
+	vec4 Max;
+};
+
+layout (std430, binding = 1) writeonly buffer ClusterAABBs
+{
+	ClusterAABB uClusters[];
+};
+
+uniform uvec3 uClusterGrid;
+uniform vec2 uScreenSize;
+uniform float uNear;
+uniform float uFar;
+uniform mat4 uInvProjection;
+
+// Point of the near plane under a screen pixel, in view space
+vec3 ScreenToView(vec2 iScreenPos)
+{
+	vec2 NDC = iScreenPos / uScreenSize * 2.0 - 1.0;
+	vec4 ViewPos = uInvProjection * vec4(NDC, -1.0, 1.0);
+	return ViewPos.xyz / ViewPos.w;
+}
+
+// Intersection of the ray going from the eye through iPoint with the plane z = iZ
+vec3 EyeRayToZPlane(vec3 iPoint, float iZ)
+{
+	return iPoint * (iZ / iPoint.z);
+}
+
+void main()
+{
+	uint ClusterIndex = gl_GlobalInvocationID.x;
+	uint ClusterCount = uClusterGrid.x * uClusterGrid.y * uClusterGrid.z;
+	if(ClusterIndex >= ClusterCount)
+	{
+		return;
+	}
+
+	uvec3 Cluster = uvec3(ClusterIndex % uClusterGrid.x,
+						  (ClusterIndex / uClusterGrid.x) % uClusterGrid.y,
+						  ClusterIndex / (uClusterGrid.x * uClusterGrid.y));
+
+	vec2 TileSize = uScreenSize / vec2(uClusterGrid.xy);
+	vec3 MinPoint = ScreenToView(vec2(Cluster.xy) * TileSize);
+	vec3 MaxPoint = ScreenToView(vec2(Cluster.xy + 1) * TileSize);
+
+	// Logarithmic slices, view space looks down -Z
+	float SliceNear = -uNear * pow(uFar / uNear, float(Cluster.z) / float(uClusterGrid.z));
+	float SliceFar = -uNear * pow(uFar / uNear, float(Cluster.z + 1) / float(uClusterGrid.z));
+
+	vec3 MinNear = EyeRayToZPlane(MinPoint, SliceNear);
+	vec3 MinFar = EyeRayToZPlane(MinPoint, SliceFar);
+	vec3 MaxNear = EyeRayToZPlane(MaxPoint, SliceNear);
+	vec3 MaxFar = EyeRayToZPlane(MaxPoint, SliceFar);
+
+	uClusters[ClusterIndex].Min = vec4(min(min(MinNear, MinFar), min(MaxNear, MaxFar)), 0.0);
+	uClusters[ClusterIndex].Max = vec4(max(max(MinNear, MinFar), max(MaxNear, MaxFar)), 0.0);
+}
@@ -0,0 +1,233 @@
+#version 460
+
+// Deferred directional light, fullscreen
+
+out vec4 FragColor;
+
+struct DirLight
+{
+	float Intensity;
+	vec3 Color;
+	vec3 Dir;
+	float AmbientIntensity;
+};
+
+uniform DirLight uDirLight;
+uniform bool uShadowEnabled;
+uniform mat4 uLightViewProj;
+uniform sampler2DShadow uShadowMap0;
+uniform sampler2D uShadowMoments0;
+uniform int uShadowFilterMode;		// Keep in sync with ShadowPass::EShadowFilter
+uniform vec2 uEVSMExponents;
+uniform bool uVirtualShadowEnabled;
+uniform sampler2DShadow uVirtualShadowPool;
+uniform mat4 uVirtualShadowViewProj;
+uniform vec2 uVirtualShadowLevelParams;	// World size of a level 0 texel, world size of a pixel at unit distance
+
+layout (std430, binding = 7) readonly buffer VirtualShadowPageTable
+{
+	uint uVirtualShadowPageTable[];
+};
+
+uniform sampler2D uGAlbedo;
+uniform sampler2D uGNormal;
+uniform sampler2D uGSpecular;
+uniform sampler2D uGDepth;
+
+uniform mat4 uInvViewProj;
+uniform vec2 uScreenSize;
+uniform vec3 uCameraWorldPos;
+
+// Keep in sync with GBufferFBO::kMaxSpecularExponent
+const float MAX_SPECULAR_EXPONENT = 1024.0;
+
+struct Surface
+{
+	vec3 WorldPos;
+	vec3 Normal;
+	vec3 Diffuse;
+	vec3 Specular;
+	float SpecularExponent;
+};
+
+// Returns false for background pixels
+bool FetchSurface(out Surface oSurface)
+{
+	vec2 UV = gl_FragCoord.xy / uScreenSize;
+	float Depth = texture(uGDepth, UV).r;
+	if(Depth >= 1.0)
+	{
+		return false;
+	}
+
+	vec4 WorldPos = uInvViewProj * vec4(vec3(UV, Depth) * 2.0 - 1.0, 1.0);
+	oSurface.WorldPos = WorldPos.xyz / WorldPos.w;
+	oSurface.Normal = normalize(texture(uGNormal, UV).rgb * 2.0 - 1.0);
+	oSurface.Diffuse = texture(uGAlbedo, UV).rgb;
+
+	vec4 Specular = texture(uGSpecular, UV);
+	oSurface.Specular = Specular.rgb;
+	oSurface.SpecularExponent = Specular.a * MAX_SPECULAR_EXPONENT;
+	return true;
+}
+
+// Diffuse and specular terms of BlinnPhongFS.glsl, the ambient term is written by the geometry pass
+vec3 LightFunc(Surface iSurface, vec3 iColor, vec3 iLightDir)
+{
+	vec3 Diffuse = vec3(0.f);
+	float DiffuseFactor = dot(iSurface.Normal, -iLightDir);
+	if(DiffuseFactor > 0)
+	{
+		Diffuse = iColor * iSurface.Diffuse * DiffuseFactor;
+	}
+
+	vec3 Specular = vec3(0.f);
+	vec3 PixelToCamera = normalize(uCameraWorldPos - iSurface.WorldPos);
+	vec3 Halfway = normalize(-iLightDir + PixelToCamera);
+	float SpecularFactor = dot(iSurface.Normal, Halfway);
+	if(SpecularFactor > 0)
+	{
+		Specular = iColor * iSurface.Specular * pow(SpecularFactor, iSurface.SpecularExponent);
+	}
+
+	return Diffuse + Specular;
+}
+
+const int SHADOW_FILTER_HARDWARE_PCF = 0;
+const int SHADOW_FILTER_POISSON_PCF = 1;
+const int SHADOW_FILTER_EVSM = 2;
+
+const vec2 POISSON_DISK[12] = vec2[](
+	vec2(-0.326, -0.406), vec2(-0.840, -0.074), vec2(-0.696, 0.457),
+	vec2(-0.203, 0.621), vec2(0.962, -0.195), vec2(0.473, -0.480),
+	vec2(0.519, 0.767), vec2(0.185, -0.893), vec2(0.507, 0.064),
+	vec2(0.896, 0.412), vec2(-0.322, -0.933), vec2(-0.792, -0.598));
+
+// Each tap is itself a bilinear 2x2 hardware comparison, a rotated disk hides the banding
+float PoissonPCF(vec2 iUVs, float iDepth)
+{
+	float Noise = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+	float Angle = Noise * 6.2831853;
+	mat2 Rotation = mat2(cos(Angle), sin(Angle), -sin(Angle), cos(Angle));
+	vec2 Radius = 1.5 / vec2(textureSize(uShadowMap0, 0));
+
+	float Lit = 0.0;
+	for(int i = 0; i < 12; i++)
+	{
+		Lit += texture(uShadowMap0, vec3(iUVs + Rotation * POISSON_DISK[i] * Radius, iDepth));
+	}
+	return Lit / 12.0;
+}
+
+float ChebyshevUpperBound(vec2 iMoments, float iMean, float iMinVariance)
+{
+	if(iMean <= iMoments.x)
+	{
+		return 1.0;
+	}
+
+	float Variance = max(iMoments.y - iMoments.x * iMoments.x, iMinVariance);
+	float Delta = iMean - iMoments.x;
+	float PMax = Variance / (Variance + Delta * Delta);
+
+	// Light bleeding reduction
+	return clamp((PMax - 0.2) / 0.8, 0.0, 1.0);
+}
+
+float EVSM(vec2 iUVs, float iDepth)
+{
+	vec4 Moments = texture(uShadowMoments0, iUVs);
+	float Depth = 2.0 * iDepth - 1.0;
+	float Pos = exp(uEVSMExponents.x * Depth);
+	float Neg = -exp(-uEVSMExponents.y * Depth);
+
+	vec2 DepthScale = 0.0001 * uEVSMExponents * vec2(Pos, -Neg);
+	float PosLit = ChebyshevUpperBound(Moments.xy, Pos, DepthScale.x * DepthScale.x);
+	float NegLit = ChebyshevUpperBound(Moments.zw, Neg, DepthScale.y * DepthScale.y);
+	return min(PosLit, NegLit);
+}
+
+float ShadowVisibility(vec4 iLightSpacePos)
+{
+	vec3 ProjCoord = iLightSpacePos.xyz / iLightSpacePos.w; // Get [-1, 1] coords
+	vec2 UVs = 0.5 * ProjCoord.xy + 0.5;
+	float z = 0.5 * ProjCoord.z + 0.5;
+
+	float Bias = 0.001;
+
+	if(uShadowFilterMode == SHADOW_FILTER_EVSM)
+	{
+		return EVSM(UVs, z);
+	}
+	else if(uShadowFilterMode == SHADOW_FILTER_POISSON_PCF)
+	{
+		return PoissonPCF(UVs, z - Bias);
+	}
+	return texture(uShadowMap0, vec3(UVs, z - Bias));
+}
+
+// Keep in sync with VirtualShadowMap
+const uint VSM_LEVEL_COUNT = 5u;
+const uint VSM_PAGES_PER_SIDE = 128u;
+const uint VSM_POOL_PAGES_PER_SIDE = 32u;
+const float VSM_PAGE_SIZE = 128.0;
+const uint VSM_LEVEL_OFFSETS[5] = uint[](0u, 16384u, 20480u, 21504u, 21760u);
+
+// Same level selection as VirtualShadowMarkCS.glsl, the coarser levels back the pages not rendered yet
+float VirtualShadowVisibility(vec3 iWorldPos)
+{
+	vec4 LightSpacePos = uVirtualShadowViewProj * vec4(iWorldPos, 1.0);
+	vec3 ProjCoord = LightSpacePos.xyz / LightSpacePos.w;
+	vec2 UVs = 0.5 * ProjCoord.xy + 0.5;
+	float z = 0.5 * ProjCoord.z + 0.5;
+	if(any(lessThan(UVs, vec2(0.0))) || any(greaterThanEqual(UVs, vec2(1.0))))
+	{
+		return 1.0;
+	}
+
+	float PixelSize = distance(iWorldPos, uCameraWorldPos) * uVirtualShadowLevelParams.y;
+	uint Level = uint(clamp(floor(log2(max(PixelSize / uVirtualShadowLevelParams.x, 1.0))), 0.0, float(VSM_LEVEL_COUNT - 1u)));
+	for(; Level < VSM_LEVEL_COUNT; Level++)
+	{
+		uint PagesPerSide = VSM_PAGES_PER_SIDE >> Level;
+		vec2 PageCoord = UVs * float(PagesPerSide);
+		uvec2 Page = min(uvec2(PageCoord), uvec2(PagesPerSide - 1u));
+		uint Entry = uVirtualShadowPageTable[VSM_LEVEL_OFFSETS[Level] + Page.y * PagesPerSide + Page.x];
+		if(Entry != 0u)
+		{
+			// Half a texel inside the page, its neighbours in the pool are unrelated pages
+			uint PhysicalPage = Entry - 1u;
+			vec2 InPage = clamp(PageCoord - vec2(Page), vec2(0.5 / VSM_PAGE_SIZE), vec2(1.0 - 0.5 / VSM_PAGE_SIZE));
+			vec2 PoolUVs = (vec2(PhysicalPage % VSM_POOL_PAGES_PER_SIDE, PhysicalPage / VSM_POOL_PAGES_PER_SIDE) + InPage) / float(VSM_POOL_PAGES_PER_SIDE);
+			return texture(uVirtualShadowPool, vec3(PoolUVs, z - 0.001));
+		}
+	}
+	return 1.0;
+}
+
+float ShadowFactor(vec3 iWorldPos)
+{
+	if(uVirtualShadowEnabled)
+	{
+		return mix(0.5, 1.0, VirtualShadowVisibility(iWorldPos));
+	}
+	return mix(0.5, 1.0, ShadowVisibility(uLightViewProj * vec4(iWorldPos, 1.0)));
+}
+
+void main()
+{
+	Surface wSurface;
+	if(!FetchSurface(wSurface))
+	{
+		discard;
+	}
+
+	vec3 Color = LightFunc(wSurface, uDirLight.Color, normalize(uDirLight.Dir)) * uDirLight.Intensity;
+
+	if(uShadowEnabled)
+	{
+		Color *= ShadowFactor(wSurface.WorldPos);
+	}
+
+	FragColor = vec4(Color, 1.0);
+}
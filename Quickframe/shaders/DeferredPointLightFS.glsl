@@ -0,0 +1,142 @@
+#version 460
+
+// Deferred point or spot light, drawn as a stencil tested sphere volume or fullscreen
+
+out vec4 FragColor;
+
+struct LocalLight
+{
+	float Intensity;
+	vec3 Color;
+	vec3 Position;
+	float Range;
+	vec3 Atten;			// Constant, Linear, Exp
+	vec3 Dir;
+	float Cutoff;		// < -1 for point lights
+	float ShadowSlot;	// Cube map array layer, < 0 without shadow
+	float ShadowFar;
+};
+
+uniform LocalLight uLight;
+
+uniform sampler2D uGAlbedo;
+uniform sampler2D uGNormal;
+uniform sampler2D uGSpecular;
+uniform sampler2D uGDepth;
+uniform samplerCubeArray uPointShadowMaps;
+uniform sampler2D uSpotShadowAtlas;
+uniform mat4 uSpotShadowViewProj;
+uniform vec4 uSpotShadowRect;		// Offset and scale in the atlas, zero size without shadow
+
+uniform mat4 uInvViewProj;
+uniform vec2 uScreenSize;
+uniform vec3 uCameraWorldPos;
+
+// Keep in sync with GBufferFBO::kMaxSpecularExponent
+const float MAX_SPECULAR_EXPONENT = 1024.0;
+
+struct Surface
+{
+	vec3 WorldPos;
+	vec3 Normal;
+	vec3 Diffuse;
+	vec3 Specular;
+	float SpecularExponent;
+};
+
+// Returns false for background pixels
+bool FetchSurface(out Surface oSurface)
+{
+	vec2 UV = gl_FragCoord.xy / uScreenSize;
+	float Depth = texture(uGDepth, UV).r;
+	if(Depth >= 1.0)
+	{
+		return false;
+	}
+
+	vec4 WorldPos = uInvViewProj * vec4(vec3(UV, Depth) * 2.0 - 1.0, 1.0);
+	oSurface.WorldPos = WorldPos.xyz / WorldPos.w;
+	oSurface.Normal = normalize(texture(uGNormal, UV).rgb * 2.0 - 1.0);
+	oSurface.Diffuse = texture(uGAlbedo, UV).rgb;
+
+	vec4 Specular = texture(uGSpecular, UV);
+	oSurface.Specular = Specular.rgb;
+	oSurface.SpecularExponent = Specular.a * MAX_SPECULAR_EXPONENT;
+	return true;
+}
+
+// Diffuse and specular terms of BlinnPhongFS.glsl, the ambient term is written by the geometry pass
+vec3 LightFunc(Surface iSurface, vec3 iColor, vec3 iLightDir)
+{
+	vec3 Diffuse = vec3(0.f);
+	float DiffuseFactor = dot(iSurface.Normal, -iLightDir);
+	if(DiffuseFactor > 0)
+	{
+		Diffuse = iColor * iSurface.Diffuse * DiffuseFactor;
+	}
+
+	vec3 Specular = vec3(0.f);
+	vec3 PixelToCamera = normalize(uCameraWorldPos - iSurface.WorldPos);
+	vec3 Halfway = normalize(-iLightDir + PixelToCamera);
+	float SpecularFactor = dot(iSurface.Normal, Halfway);
+	if(SpecularFactor > 0)
+	{
+		Specular = iColor * iSurface.Specular * pow(SpecularFactor, iSurface.SpecularExponent);
+	}
+
+	return Diffuse + Specular;
+}
+
+void main()
+{
+	Surface wSurface;
+	if(!FetchSurface(wSurface))
+	{
+		discard;
+	}
+
+	vec3 LightDir = wSurface.WorldPos - uLight.Position;
+	float Distance = length(LightDir);
+	if(Distance > uLight.Range)
+	{
+		discard;
+	}
+	LightDir = LightDir / Distance;
+
+	float SpotFactor = 1.f;
+	if(uLight.Cutoff >= -1.f)
+	{
+		SpotFactor = dot(LightDir, uLight.Dir);
+		if(SpotFactor <= uLight.Cutoff)
+		{
+			discard;
+		}
+		SpotFactor = 1.f - ((1.f - SpotFactor) / (1.f - uLight.Cutoff));
+	}
+
+	if(uLight.ShadowSlot >= 0.0)
+	{
+		// Same distance comparison as the forward path, see PointShadowFS.glsl
+		float Occluder = texture(uPointShadowMaps, vec4(LightDir, uLight.ShadowSlot)).r * uLight.ShadowFar;
+		if(Occluder + 0.05 < Distance)
+		{
+			SpotFactor *= 0.5;
+		}
+	}
+
+	if(uSpotShadowRect.z > 0.0)
+	{
+		vec4 LightSpacePos = uSpotShadowViewProj * vec4(wSurface.WorldPos, 1.0);
+		vec3 ProjCoord = LightSpacePos.xyz / LightSpacePos.w * 0.5 + 0.5;
+		vec2 UVs = uSpotShadowRect.xy + clamp(ProjCoord.xy, 0.0, 1.0) * uSpotShadowRect.zw;
+		if(texture(uSpotShadowAtlas, UVs).r + 0.0005 < ProjCoord.z)
+		{
+			SpotFactor *= 0.5;
+		}
+	}
+
+	float Attenuation = uLight.Atten.x + uLight.Atten.y * Distance + uLight.Atten.z * Distance * Distance;
+
+	vec3 Color = LightFunc(wSurface, uLight.Color, LightDir) * uLight.Intensity * SpotFactor / Attenuation;
+	FragColor = vec4(Color, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 460
+
+layout (location = 0) in vec3 Pos;
+
+uniform mat4 uMVP;
+
+// Must match BlinnPhongVS bit for bit, the lit pass tests depth with GL_EQUAL
+invariant gl_Position;
+
+void main()
+{
+	gl_Position = uMVP * vec4(Pos, 1.0);
+}
@@ -0,0 +1,35 @@
+#version 460
+
+// Separable gaussian blur of the EVSM moments, run once per direction
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D uInput;
+uniform bool uHorizontal;
+
+layout (rgba32f, binding = 0) writeonly uniform image2D uOutput;
+
+const int RADIUS = 4;
+const float WEIGHTS[RADIUS + 1] = float[](0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216);
+
+void main()
+{
+	ivec2 Texel = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 Size = imageSize(uOutput);
+	if(any(greaterThanEqual(Texel, Size)))
+	{
+		return;
+	}
+
+	ivec2 Direction = uHorizontal ? ivec2(1, 0) : ivec2(0, 1);
+
+	vec4 Sum = texelFetch(uInput, Texel, 0) * WEIGHTS[0];
+	for(int i = 1; i <= RADIUS; i++)
+	{
+		ivec2 Offset = Direction * i;
+		Sum += texelFetch(uInput, clamp(Texel + Offset, ivec2(0), Size - 1), 0) * WEIGHTS[i];
+		Sum += texelFetch(uInput, clamp(Texel - Offset, ivec2(0), Size - 1), 0) * WEIGHTS[i];
+	}
+
+	imageStore(uOutput, Texel, Sum);
+}
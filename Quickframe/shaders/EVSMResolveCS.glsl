@@ -0,0 +1,37 @@
+#version 460
+
+// Exponential variance shadow map : warps the shadow depth into moments at half resolution
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// Bound with a sampler without depth comparison
+uniform sampler2D uShadowMap0;
+uniform vec2 uEVSMExponents;	// Positive, negative
+
+layout (rgba32f, binding = 0) writeonly uniform image2D uMoments;
+
+vec4 WarpDepth(float iDepth)
+{
+	float Depth = 2.0 * iDepth - 1.0;
+	float Pos = exp(uEVSMExponents.x * Depth);
+	float Neg = -exp(-uEVSMExponents.y * Depth);
+	return vec4(Pos, Pos * Pos, Neg, Neg * Neg);
+}
+
+void main()
+{
+	ivec2 Texel = ivec2(gl_GlobalInvocationID.xy);
+	if(any(greaterThanEqual(Texel, imageSize(uMoments))))
+	{
+		return;
+	}
+
+	// Moments are linear, the 2x2 footprint can be averaged
+	ivec2 Src = Texel * 2;
+	vec4 Moments = WarpDepth(texelFetch(uShadowMap0, Src, 0).r) +
+				   WarpDepth(texelFetch(uShadowMap0, Src + ivec2(1, 0), 0).r) +
+				   WarpDepth(texelFetch(uShadowMap0, Src + ivec2(0, 1), 0).r) +
+				   WarpDepth(texelFetch(uShadowMap0, Src + ivec2(1, 1), 0).r);
+
+	imageStore(uMoments, Texel, Moments * 0.25);
+}
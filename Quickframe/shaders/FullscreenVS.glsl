@@ -0,0 +1,9 @@
+#version 460
+
+// Fullscreen triangle generated from gl_VertexID, draw 3 vertices with an empty VAO
+
+void main()
+{
+	vec2 Pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	gl_Position = vec4(Pos * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,144 @@
+#version 460
+
+// Permutations : COLOR_TEX, NORMAL_TEX, SPECULAR_TEX, VIRTUAL_COLOR_TEX are injected by ProgramVariants
+
+// Deferred geometry pass, vertex stage is BlinnPhongVS.glsl
+
+in vec2 vTexCoord0;
+in vec3 vNormal;
+in vec3 vWorldPos;
+in vec4 vLightSpacePos;
+in mat3 vTBN;
+flat in uint vMaterialIndex;
+
+layout (location = 0) out vec4 oAlbedo;
+layout (location = 1) out vec4 oNormal;
+layout (location = 2) out vec4 oSpecular;
+layout (location = 3) out vec4 oLight;
+
+// Keep in sync with GBufferFBO::kMaxSpecularExponent
+const float MAX_SPECULAR_EXPONENT = 1024.0;
+
+// Keep in sync with MaterialTable::Record
+struct Material
+{
+	vec4 Ambient;
+	vec4 DiffuseExponent;	// Diffuse color, specular exponent
+	vec4 Specular;
+	ivec4 Textures;			// Color, normal, specular : array << 16 | layer, -1 when bound to its own unit
+	ivec4 VirtualTexture;	// Page table offset, width, height, level count (0 while cooking)
+};
+
+layout (std430, binding = 10) readonly buffer MaterialTable
+{
+	Material uMaterials[];
+};
+
+// Indexed by the draw base instance
+Material CurrentMaterial;
+
+// Directional light color * intensity * ambient intensity
+uniform vec3 uAmbientLight;
+
+uniform sampler2D uColorTex;
+uniform sampler2D uSpecularExponentTex;
+uniform sampler2D uNormalTex;
+uniform sampler2DArray uTextureArrays[8];		// Keep in sync with TEXTURE_ARRAY_COUNT
+
+uniform sampler2D uVirtualTextureCache;
+
+layout (std430, binding = 9) readonly buffer VirtualTexturePageTable
+{
+	uint uVirtualTexturePageTable[];
+};
+
+vec4 SampleMaterialTexture(int iLocation, sampler2D iUnpacked, vec2 iUVs);
+vec4 SampleVirtualTexture(vec2 iUVs);
+
+void main()
+{
+	CurrentMaterial = uMaterials[vMaterialIndex];
+
+	vec3 wNormal = vec3(0.f, 0.f, 0.f);
+	#ifdef NORMAL_TEX
+	// Normal maps are cooked to two channels (BC5), Z is rebuilt
+	wNormal.xy = SampleMaterialTexture(CurrentMaterial.Textures.y, uNormalTex, vTexCoord0).rg * 2.0 - 1.0;
+	wNormal.z = sqrt(max(1.0 - dot(wNormal.xy, wNormal.xy), 0.0));
+	wNormal = normalize(vTBN * wNormal);
+	#else
+	wNormal = normalize(vNormal);
+	#endif
+
+	vec3 ColorTex = vec3(1.f, 1.f, 1.f);
+	#ifdef COLOR_TEX
+	ColorTex = SampleMaterialTexture(CurrentMaterial.Textures.x, uColorTex, vTexCoord0).rgb;
+	#endif
+	#ifdef VIRTUAL_COLOR_TEX
+	ColorTex = SampleVirtualTexture(vTexCoord0).rgb;
+	#endif
+
+	float SpecularExponent = CurrentMaterial.DiffuseExponent.w;
+	#ifdef SPECULAR_TEX
+	SpecularExponent = SampleMaterialTexture(CurrentMaterial.Textures.z, uSpecularExponentTex, vTexCoord0).r * 255.0;
+	#endif
+
+	oAlbedo = vec4(ColorTex * CurrentMaterial.DiffuseExponent.rgb, 1.0);
+	oNormal = vec4(wNormal * 0.5 + 0.5, 0.0);
+	oSpecular = vec4(ColorTex * CurrentMaterial.Specular.rgb, clamp(SpecularExponent / MAX_SPECULAR_EXPONENT, 0.0, 1.0));
+
+	// Lights are additively blended on top of the ambient term
+	oLight = vec4(ColorTex * CurrentMaterial.Ambient.rgb * uAmbientLight, 1.0);
+}
+
+// Packed textures are read from their array layer, the location is the same for the whole draw
+vec4 SampleMaterialTexture(int iLocation, sampler2D iUnpacked, vec2 iUVs)
+{
+	if(iLocation < 0)
+	{
+		return texture(iUnpacked, iUVs);
+	}
+	return texture(uTextureArrays[iLocation >> 16], vec3(iUVs, float(iLocation & 0xFFFF)));
+}
+
+// Keep in sync with VirtualTextureCache
+const int VT_TILE_SIZE = 128;
+const float VT_TILE_BORDER = 4.0;
+const uint VT_CACHE_TILES_PER_SIDE = 32u;
+const float VT_CACHE_SIZE = 4352.0;
+
+// Same lookup as BlinnPhongFS.glsl
+vec4 SampleVirtualTexture(vec2 iUVs)
+{
+	if(CurrentMaterial.VirtualTexture.w == 0)
+	{
+		return vec4(1.0);
+	}
+
+	vec2 TexelDx = dFdx(iUVs) * vec2(CurrentMaterial.VirtualTexture.yz);
+	vec2 TexelDy = dFdy(iUVs) * vec2(CurrentMaterial.VirtualTexture.yz);
+	float Lod = 0.5 * log2(max(max(dot(TexelDx, TexelDx), dot(TexelDy, TexelDy)), 1e-8));
+	int Level = clamp(int(floor(Lod)), 0, CurrentMaterial.VirtualTexture.w - 1);
+
+	vec2 UVs = fract(iUVs);
+	int Page = CurrentMaterial.VirtualTexture.x;
+	for(int i = 0; i < CurrentMaterial.VirtualTexture.w; i++)
+	{
+		ivec2 LevelSize = max(CurrentMaterial.VirtualTexture.yz >> i, ivec2(1));
+		ivec2 Tiles = (LevelSize + VT_TILE_SIZE - 1) / VT_TILE_SIZE;
+		if(i >= Level)
+		{
+			vec2 TexelCoord = UVs * vec2(LevelSize);
+			ivec2 Tile = min(ivec2(TexelCoord) / VT_TILE_SIZE, Tiles - 1);
+			uint Entry = uVirtualTexturePageTable[Page + Tile.y * Tiles.x + Tile.x];
+			if(Entry != 0u)
+			{
+				uint Slot = Entry - 1u;
+				vec2 InTile = TexelCoord - vec2(Tile * VT_TILE_SIZE) + VT_TILE_BORDER;
+				vec2 SlotOrigin = vec2(Slot % VT_CACHE_TILES_PER_SIDE, Slot / VT_CACHE_TILES_PER_SIDE) * (float(VT_TILE_SIZE) + 2.0 * VT_TILE_BORDER);
+				return textureLod(uVirtualTextureCache, (SlotOrigin + InTile) / VT_CACHE_SIZE, 0.0);
+			}
+		}
+		Page += Tiles.x * Tiles.y;
+	}
+	return vec4(1.0);
+}
@@ -0,0 +1,101 @@
+#version 460
+
+// Assigns the point and spot lights to the clusters they touch
+// Lights are streamed through shared memory in batches of the workgroup size
+
+#define BATCH_SIZE 128
+
+// Keep in sync with Defines.h
+const uint MAX_LIGHTS_PER_CLUSTER = 128;
+
+layout (local_size_x = BATCH_SIZE) in;
+
+struct Light
+{
+	vec4 PositionRange;		// World position, range
+	vec4 ColorIntensity;
+	vec4 Attenuation;		// Constant, Linear, Exp
+	vec4 DirectionCutoff;	// Spot direction, cos(cutoff). Cutoff < -1 for point lights
+	vec4 ShadowParams;		// Point shadow cube map array slot, shadow far plane, spot shadow index (< 0 without shadow)
+};
+
+struct ClusterAABB
+{
+	vec4 Min;
+	vec4 Max;
+};
+
+layout (std430, binding = 0) readonly buffer Lights
+{
+	Light uLights[];
+};
+
+layout (std430, binding = 1) readonly buffer ClusterAABBs
+{
+	ClusterAABB uClusters[];
+};
+
+layout (std430, binding = 2) writeonly buffer ClusterLightGrid
+{
+	uint uClusterLightCount[];
+};
+
+layout (std430, binding = 3) writeonly buffer ClusterLightIndices
+{
+	uint uClusterLightIndices[];
+};
+
+uniform uint uLightCount;
+uniform uint uClusterCount;
+uniform mat4 uView;
+
+shared vec4 sLightSpheres[BATCH_SIZE];
+
+bool SphereIntersectsAABB(vec4 iSphere, ClusterAABB iAABB)
+{
+	vec3 Closest = clamp(iSphere.xyz, iAABB.Min.xyz, iAABB.Max.xyz);
+	vec3 Delta = Closest - iSphere.xyz;
+	return dot(Delta, Delta) <= iSphere.w * iSphere.w;
+}
+
+void main()
+{
+	uint ClusterIndex = gl_GlobalInvocationID.x;
+	bool ValidCluster = ClusterIndex < uClusterCount;
+
+	ClusterAABB AABB;
+	if(ValidCluster)
+	{
+		AABB = uClusters[ClusterIndex];
+	}
+
+	uint LightCount = 0;
+
+	// No early out : every invocation has to reach the barriers
+	for(uint Batch = 0; Batch < uLightCount; Batch += uint(BATCH_SIZE))
+	{
+		uint LightIndex = Batch + gl_LocalInvocationIndex;
+		if(LightIndex < uLightCount)
+		{
+			vec4 PositionRange = uLights[LightIndex].PositionRange;
+			sLightSpheres[gl_LocalInvocationIndex] = vec4((uView * vec4(PositionRange.xyz, 1.0)).xyz, PositionRange.w);
+		}
+		barrier();
+
+		uint BatchCount = min(uint(BATCH_SIZE), uLightCount - Batch);
+		for(uint i = 0; ValidCluster && i < BatchCount && LightCount < MAX_LIGHTS_PER_CLUSTER; i++)
+		{
+			if(SphereIntersectsAABB(sLightSpheres[i], AABB))
+			{
+				uClusterLightIndices[ClusterIndex * MAX_LIGHTS_PER_CLUSTER + LightCount] = Batch + i;
+				LightCount++;
+			}
+		}
+		barrier();
+	}
+
+	if(ValidCluster)
+	{
+		uClusterLightCount[ClusterIndex] = LightCount;
+	}
+}
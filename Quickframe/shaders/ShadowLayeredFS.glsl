@@ -0,0 +1,14 @@
+#version 460
+
+// Omnidirectional views (LIGHT_DISTANCE_DEPTH) store the light to surface distance normalized by the far plane,
+// the others keep the rasterized depth and leave gl_FragDepth untouched so early depth testing stays on
+
+in vec3 vWorldPos;
+flat in vec4 vLightPosFar;
+
+void main()
+{
+#ifdef LIGHT_DISTANCE_DEPTH
+	gl_FragDepth = length(vWorldPos - vLightPosFar.xyz) / vLightPosFar.w;
+#endif
+}
@@ -0,0 +1,41 @@
+#version 460
+
+// Fallback when gl_Layer can't be written from the vertex shader (ARB_shader_viewport_layer_array)
+
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+// See ShadowViewBatch.h
+struct ShadowView
+{
+	mat4 ViewProj;
+	vec4 LightPosFar;
+	ivec4 LayerViewport;
+};
+
+layout (std430, binding = 5) readonly buffer ShadowViews
+{
+	ShadowView uViews[];
+};
+
+in vec3 vGSWorldPos[];
+flat in uint vGSView[];
+
+out vec3 vWorldPos;
+flat out vec4 vLightPosFar;
+
+void main()
+{
+	ShadowView View = uViews[vGSView[0]];
+
+	for(int i = 0; i < 3; i++)
+	{
+		vWorldPos = vGSWorldPos[i];
+		vLightPosFar = View.LightPosFar;
+		gl_Position = View.ViewProj * vec4(vGSWorldPos[i], 1.0);
+		gl_Layer = View.LayerViewport.x;
+		gl_ViewportIndex = View.LayerViewport.y;
+		EmitVertex();
+	}
+	EndPrimitive();
+}
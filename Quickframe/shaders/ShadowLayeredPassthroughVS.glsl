@@ -0,0 +1,23 @@
+#version 460
+
+// Layered shadow views, geometry shader path : resolves the view of the instance, see ShadowLayeredGS.glsl
+
+layout (location = 0) in vec3 Pos;
+
+uniform mat4 uWorld;
+uniform uint uViewMask;
+
+out vec3 vGSWorldPos;
+flat out uint vGSView;
+
+void main()
+{
+	uint Mask = uViewMask;
+	for(int i = 0; i < gl_InstanceID; i++)
+	{
+		Mask &= Mask - 1u;
+	}
+
+	vGSView = uint(findLSB(Mask));
+	vGSWorldPos = vec3(uWorld * vec4(Pos, 1.0));
+}
@@ -0,0 +1,44 @@
+#version 460
+#extension GL_ARB_shader_viewport_layer_array : require
+
+// Layered shadow views in one pass : each instance is routed to one of the views set in uViewMask
+
+layout (location = 0) in vec3 Pos;
+
+// See ShadowViewBatch.h
+struct ShadowView
+{
+	mat4 ViewProj;
+	vec4 LightPosFar;		// Light distance / far is stored when built with LIGHT_DISTANCE_DEPTH
+	ivec4 LayerViewport;	// Layer, viewport index
+};
+
+layout (std430, binding = 5) readonly buffer ShadowViews
+{
+	ShadowView uViews[];
+};
+
+uniform mat4 uWorld;
+uniform uint uViewMask;
+
+out vec3 vWorldPos;
+flat out vec4 vLightPosFar;
+
+void main()
+{
+	// The n-th instance draws into the n-th view of the mask
+	uint Mask = uViewMask;
+	for(int i = 0; i < gl_InstanceID; i++)
+	{
+		Mask &= Mask - 1u;
+	}
+	ShadowView View = uViews[findLSB(Mask)];
+
+	vec4 WorldPos = uWorld * vec4(Pos, 1.0);
+	vWorldPos = WorldPos.xyz;
+	vLightPosFar = View.LightPosFar;
+
+	gl_Position = View.ViewProj * WorldPos;
+	gl_Layer = View.LayerViewport.x;
+	gl_ViewportIndex = View.LayerViewport.y;
+}
@@ -0,0 +1,56 @@
+#version 460
+
+// Virtual shadow map page analysis : marks the page and level needed by each visible pixel
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout (std430, binding = 6) writeonly buffer VirtualShadowRequests
+{
+	uint uRequests[];
+};
+
+uniform sampler2D uSceneDepth;
+uniform mat4 uInvViewProj;
+uniform mat4 uLightViewProj;
+uniform vec3 uCameraWorldPos;
+uniform vec2 uLevelParams;		// World size of a level 0 texel, world size of a pixel at unit distance
+
+// Keep in sync with VirtualShadowMap
+const uint VSM_LEVEL_COUNT = 5u;
+const uint VSM_PAGES_PER_SIDE = 128u;
+const uint VSM_LEVEL_OFFSETS[5] = uint[](0u, 16384u, 20480u, 21504u, 21760u);
+
+void main()
+{
+	ivec2 Pixel = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 Size = textureSize(uSceneDepth, 0);
+	if(any(greaterThanEqual(Pixel, Size)))
+	{
+		return;
+	}
+
+	float Depth = texelFetch(uSceneDepth, Pixel, 0).r;
+	if(Depth >= 1.0)
+	{
+		return;
+	}
+
+	vec2 UV = (vec2(Pixel) + 0.5) / vec2(Size);
+	vec4 WorldPos = uInvViewProj * vec4(vec3(UV, Depth) * 2.0 - 1.0, 1.0);
+	WorldPos /= WorldPos.w;
+
+	vec4 LightSpacePos = uLightViewProj * WorldPos;
+	vec2 LightUVs = 0.5 * LightSpacePos.xy / LightSpacePos.w + 0.5;
+	if(any(lessThan(LightUVs, vec2(0.0))) || any(greaterThanEqual(LightUVs, vec2(1.0))))
+	{
+		return;
+	}
+
+	// Finest level whose texels are not smaller than the pixel footprint
+	float PixelSize = distance(WorldPos.xyz, uCameraWorldPos) * uLevelParams.y;
+	uint Level = uint(clamp(floor(log2(max(PixelSize / uLevelParams.x, 1.0))), 0.0, float(VSM_LEVEL_COUNT - 1u)));
+
+	uint PagesPerSide = VSM_PAGES_PER_SIDE >> Level;
+	uvec2 Page = min(uvec2(LightUVs * float(PagesPerSide)), uvec2(PagesPerSide - 1u));
+	uRequests[VSM_LEVEL_OFFSETS[Level] + Page.y * PagesPerSide + Page.x] = 1u;
+}
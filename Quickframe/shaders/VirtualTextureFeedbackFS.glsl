@@ -0,0 +1,51 @@
+#version 460
+
+// Marks the virtual texture tiles the visible pixels sample, read back by VirtualTextureCache
+
+// Occluded fragments must not request anything : the depth is filled by a depth only pass first,
+// and the test must run before the storage writes
+layout(early_fragment_tests) in;
+
+// Keep in sync with VirtualTextureCache
+const int VT_TILE_SIZE = 128;
+
+// Rendered at 1/8 of the screen resolution (VirtualTextureFeedbackPass::kResolutionDivisor),
+// the UV derivatives are 8 times larger than in the lit passes
+const float FEEDBACK_LOD_BIAS = -3.0;
+
+in vec2 vTexCoord0;
+
+uniform ivec4 uVirtualTexture;		// Page table offset, width, height, level count (0 while cooking)
+
+layout (std430, binding = 8) writeonly buffer VirtualTextureRequests
+{
+	uint uVirtualTextureRequests[];
+};
+
+void main()
+{
+	if(uVirtualTexture.w == 0)
+	{
+		return;
+	}
+
+	// Same level selection as SampleVirtualTexture in BlinnPhongFS.glsl
+	vec2 TexelDx = dFdx(vTexCoord0) * vec2(uVirtualTexture.yz);
+	vec2 TexelDy = dFdy(vTexCoord0) * vec2(uVirtualTexture.yz);
+	float Lod = 0.5 * log2(max(max(dot(TexelDx, TexelDx), dot(TexelDy, TexelDy)), 1e-8)) + FEEDBACK_LOD_BIAS;
+	int Level = clamp(int(floor(Lod)), 0, uVirtualTexture.w - 1);
+
+	int Page = uVirtualTexture.x;
+	for(int i = 0; i < Level; i++)
+	{
+		ivec2 Tiles = (max(uVirtualTexture.yz >> i, ivec2(1)) + VT_TILE_SIZE - 1) / VT_TILE_SIZE;
+		Page += Tiles.x * Tiles.y;
+	}
+
+	ivec2 LevelSize = max(uVirtualTexture.yz >> Level, ivec2(1));
+	ivec2 Tiles = (LevelSize + VT_TILE_SIZE - 1) / VT_TILE_SIZE;
+	ivec2 Tile = min(ivec2(fract(vTexCoord0) * vec2(LevelSize)) / VT_TILE_SIZE, Tiles - 1);
+
+	// Concurrent writes all store the same value
+	uVirtualTextureRequests[Page + Tile.y * Tiles.x + Tile.x] = 1u;
+}
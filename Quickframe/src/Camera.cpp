@@ -71,6 +71,24 @@ void Camera::SetFarPlane(float iFar)
 	wFrustum->SetFarPlane(iFar);
 }
 
+float Camera::GetFOV() const
+{
+	auto wFrustum = static_cast<PerspectiveFrustum*>(mView->GetFrustum());
+	return wFrustum->GetFOV();
+}
+
+float Camera::GetNearPlane() const
+{
+	auto wFrustum = static_cast<PerspectiveFrustum*>(mView->GetFrustum());
+	return wFrustum->GetNearPlane();
+}
+
+float Camera::GetFarPlane() const
+{
+	auto wFrustum = static_cast<PerspectiveFrustum*>(mView->GetFrustum());
+	return wFrustum->GetFarPlane();
+}
+
 void Camera::Update(double iDeltaTime)
 {
 	if (Input::GetInstance()->IsMousePressed(GLFW_MOUSE_BUTTON_RIGHT))
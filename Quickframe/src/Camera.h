@@ -56,6 +56,10 @@ public:
 	void SetNearPlane(float iNear);
 	void SetFarPlane(float iFar);
 
+	float GetFOV() const;
+	float GetNearPlane() const;
+	float GetFarPlane() const;
+
 	void Update(double iDeltaTime);
 
 	glm::mat4 ViewMatrix() const;
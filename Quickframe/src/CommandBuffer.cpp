@@ -0,0 +1,278 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "CommandBuffer.h"
+#include "GLStateCache.h"
+
+namespace
+{
+	struct CommandHeader
+	{
+		CommandBuffer::ECommandType Type;
+		uint16_t Size;	// Payload size in bytes
+	};
+
+	struct DrawInstancedCmd
+	{
+		GLsizei IndexCount;
+		GLsizei InstanceCount;
+	};
+
+	struct DrawBaseInstanceCmd
+	{
+		GLsizei IndexCount;
+		GLuint BaseInstance;
+	};
+
+	struct BindTextureCmd
+	{
+		GLenum TextureUnit;
+		GLenum Target;
+		GLuint Texture;
+	};
+
+	template<typename T>
+	struct UniformCmd
+	{
+		GLint Location;
+		T Value;
+	};
+
+	template<typename T>
+	T Read(const uint8_t* iData)
+	{
+		// Packets aren't aligned, copy them out
+		T wValue;
+		std::memcpy(&wValue, iData, sizeof(T));
+		return wValue;
+	}
+}
+
+template<typename T>
+void CommandBuffer::Push(ECommandType iType, const T& iPayload)
+{
+	CommandHeader wHeader = { iType, static_cast<uint16_t>(sizeof(T)) };
+
+	size_t wOffset = mData.size();
+	mData.resize(wOffset + sizeof(CommandHeader) + sizeof(T));
+	std::memcpy(mData.data() + wOffset, &wHeader, sizeof(CommandHeader));
+	std::memcpy(mData.data() + wOffset + sizeof(CommandHeader), &iPayload, sizeof(T));
+
+	mCommandCount++;
+}
+
+void CommandBuffer::Reset()
+{
+	mData.clear();
+	mCommandCount = 0;
+	mDrawCount = 0;
+}
+
+void CommandBuffer::BindProgram(GLuint iProgram)
+{
+	Push(ECommandType::eBindProgram, iProgram);
+}
+
+void CommandBuffer::BindVertexArray(GLuint iVertexArray)
+{
+	Push(ECommandType::eBindVertexArray, iVertexArray);
+}
+
+void CommandBuffer::BindTexture(GLenum iTextureUnit, GLenum iTarget, GLuint iTexture)
+{
+	Push(ECommandType::eBindTexture, BindTextureCmd{ iTextureUnit, iTarget, iTexture });
+}
+
+void CommandBuffer::SetUniform1i(GLint iLocation, int iValue)
+{
+	if (iLocation < 0)
+	{
+		return;
+	}
+	Push(ECommandType::eSetUniform1i, UniformCmd<int>{ iLocation, iValue });
+}
+
+void CommandBuffer::SetUniform1ui(GLint iLocation, uint32_t iValue)
+{
+	if (iLocation < 0)
+	{
+		return;
+	}
+	Push(ECommandType::eSetUniform1ui, UniformCmd<uint32_t>{ iLocation, iValue });
+}
+
+void CommandBuffer::SetUniform1f(GLint iLocation, float iValue)
+{
+	if (iLocation < 0)
+	{
+		return;
+	}
+	Push(ECommandType::eSetUniform1f, UniformCmd<float>{ iLocation, iValue });
+}
+
+void CommandBuffer::SetUniform3f(GLint iLocation, const glm::vec3& iValue)
+{
+	if (iLocation < 0)
+	{
+		return;
+	}
+	Push(ECommandType::eSetUniform3f, UniformCmd<glm::vec3>{ iLocation, iValue });
+}
+
+void CommandBuffer::SetUniform4i(GLint iLocation, const glm::ivec4& iValue)
+{
+	if (iLocation < 0)
+	{
+		return;
+	}
+	Push(ECommandType::eSetUniform4i, UniformCmd<glm::ivec4>{ iLocation, iValue });
+}
+
+void CommandBuffer::SetUniformMatrix3f(GLint iLocation, const glm::mat3& iValue)
+{
+	if (iLocation < 0)
+	{
+		return;
+	}
+	Push(ECommandType::eSetUniformMatrix3f, UniformCmd<glm::mat3>{ iLocation, iValue });
+}
+
+void CommandBuffer::SetUniformMatrix4f(GLint iLocation, const glm::mat4& iValue)
+{
+	if (iLocation < 0)
+	{
+		return;
+	}
+	Push(ECommandType::eSetUniformMatrix4f, UniformCmd<glm::mat4>{ iLocation, iValue });
+}
+
+void CommandBuffer::DrawIndexed(GLsizei iIndexCount)
+{
+	Push(ECommandType::eDrawIndexed, iIndexCount);
+	mDrawCount++;
+}
+
+void CommandBuffer::DrawIndexedInstanced(GLsizei iIndexCount, GLsizei iInstanceCount)
+{
+	Push(ECommandType::eDrawIndexedInstanced, DrawInstancedCmd{ iIndexCount, iInstanceCount });
+	mDrawCount++;
+}
+
+void CommandBuffer::DrawIndexedBaseInstance(GLsizei iIndexCount, GLuint iBaseInstance)
+{
+	Push(ECommandType::eDrawIndexedBaseInstance, DrawBaseInstanceCmd{ iIndexCount, iBaseInstance });
+	mDrawCount++;
+}
+
+void CommandBuffer::Execute() const
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+
+	const uint8_t* wCursor = mData.data();
+	const uint8_t* wEnd = wCursor + mData.size();
+
+	while (wCursor < wEnd)
+	{
+		CommandHeader wHeader = Read<CommandHeader>(wCursor);
+		const uint8_t* wPayload = wCursor + sizeof(CommandHeader);
+
+		switch (wHeader.Type)
+		{
+		case ECommandType::eBindProgram:
+			wStateCache->UseProgram(Read<GLuint>(wPayload));
+			break;
+		case ECommandType::eBindVertexArray:
+			wStateCache->BindVertexArray(Read<GLuint>(wPayload));
+			break;
+		case ECommandType::eBindTexture:
+		{
+			BindTextureCmd wCmd = Read<BindTextureCmd>(wPayload);
+			wStateCache->BindTexture(wCmd.TextureUnit, wCmd.Target, wCmd.Texture);
+			break;
+		}
+		case ECommandType::eSetUniform1i:
+		{
+			UniformCmd<int> wCmd = Read<UniformCmd<int>>(wPayload);
+			glUniform1i(wCmd.Location, wCmd.Value);
+			break;
+		}
+		case ECommandType::eSetUniform1ui:
+		{
+			UniformCmd<uint32_t> wCmd = Read<UniformCmd<uint32_t>>(wPayload);
+			glUniform1ui(wCmd.Location, wCmd.Value);
+			break;
+		}
+		case ECommandType::eSetUniform1f:
+		{
+			UniformCmd<float> wCmd = Read<UniformCmd<float>>(wPayload);
+			glUniform1f(wCmd.Location, wCmd.Value);
+			break;
+		}
+		case ECommandType::eSetUniform3f:
+		{
+			UniformCmd<glm::vec3> wCmd = Read<UniformCmd<glm::vec3>>(wPayload);
+			glUniform3fv(wCmd.Location, 1, glm::value_ptr(wCmd.Value));
+			break;
+		}
+		case ECommandType::eSetUniform4i:
+		{
+			UniformCmd<glm::ivec4> wCmd = Read<UniformCmd<glm::ivec4>>(wPayload);
+			glUniform4iv(wCmd.Location, 1, glm::value_ptr(wCmd.Value));
+			break;
+		}
+		case ECommandType::eSetUniformMatrix3f:
+		{
+			UniformCmd<glm::mat3> wCmd = Read<UniformCmd<glm::mat3>>(wPayload);
+			glUniformMatrix3fv(wCmd.Location, 1, GL_FALSE, glm::value_ptr(wCmd.Value));
+			break;
+		}
+		case ECommandType::eSetUniformMatrix4f:
+		{
+			UniformCmd<glm::mat4> wCmd = Read<UniformCmd<glm::mat4>>(wPayload);
+			glUniformMatrix4fv(wCmd.Location, 1, GL_FALSE, glm::value_ptr(wCmd.Value));
+			break;
+		}
+		case ECommandType::eDrawIndexed:
+			glDrawElements(GL_TRIANGLES, Read<GLsizei>(wPayload), GL_UNSIGNED_INT, 0);
+			break;
+		case ECommandType::eDrawIndexedInstanced:
+		{
+			DrawInstancedCmd wCmd = Read<DrawInstancedCmd>(wPayload);
+			glDrawElementsInstanced(GL_TRIANGLES, wCmd.IndexCount, GL_UNSIGNED_INT, 0, wCmd.InstanceCount);
+			break;
+		}
+		case ECommandType::eDrawIndexedBaseInstance:
+		{
+			DrawBaseInstanceCmd wCmd = Read<DrawBaseInstanceCmd>(wPayload);
+			glDrawElementsInstancedBaseInstance(GL_TRIANGLES, wCmd.IndexCount, GL_UNSIGNED_INT, 0, 1, wCmd.BaseInstance);
+			break;
+		}
+		}
+
+		wCursor = wPayload + wHeader.Size;
+	}
+}
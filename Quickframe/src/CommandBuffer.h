@@ -0,0 +1,108 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+
+/**
+ * @brief : CPU side list of compact draw packets.
+ * Recording only writes to memory and can happen on any thread, one buffer per thread.
+ * Execute() replays the packets in recording order and must be called on the GL thread.
+*/
+class CommandBuffer
+{
+public:
+	enum class ECommandType : uint8_t
+	{
+		eBindProgram,
+		eBindVertexArray,
+		eBindTexture,
+		eSetUniform1i,
+		eSetUniform1ui,
+		eSetUniform1f,
+		eSetUniform3f,
+		eSetUniform4i,
+		eSetUniformMatrix3f,
+		eSetUniformMatrix4f,
+		eDrawIndexed,
+		eDrawIndexedInstanced,
+		eDrawIndexedBaseInstance
+	};
+
+	CommandBuffer() {}
+
+	/**
+	 * @brief : Clear the recorded packets, memory is kept for the next recording
+	*/
+	void Reset();
+
+	void BindProgram(GLuint iProgram);
+	void BindVertexArray(GLuint iVertexArray);
+	void BindTexture(GLenum iTextureUnit, GLenum iTarget, GLuint iTexture);
+
+	// Uniform locations must be resolved beforehand on the GL thread
+	void SetUniform1i(GLint iLocation, int iValue);
+	void SetUniform1ui(GLint iLocation, uint32_t iValue);
+	void SetUniform1f(GLint iLocation, float iValue);
+	void SetUniform3f(GLint iLocation, const glm::vec3& iValue);
+	void SetUniform4i(GLint iLocation, const glm::ivec4& iValue);
+	void SetUniformMatrix3f(GLint iLocation, const glm::mat3& iValue);
+	void SetUniformMatrix4f(GLint iLocation, const glm::mat4& iValue);
+
+	/**
+	 * @brief : Indexed triangle list draw using the bound vertex array (32 bits indices)
+	*/
+	void DrawIndexed(GLsizei iIndexCount);
+	void DrawIndexedInstanced(GLsizei iIndexCount, GLsizei iInstanceCount);
+
+	/**
+	 * @brief : Single instance draw, iBaseInstance reaches the vertex shader as gl_BaseInstance
+	*/
+	void DrawIndexedBaseInstance(GLsizei iIndexCount, GLuint iBaseInstance);
+
+	/**
+	 * @brief : Replay all the recorded packets
+	*/
+	void Execute() const;
+
+	uint32_t GetCommandCount() const { return mCommandCount; }
+	uint32_t GetDrawCount() const { return mDrawCount; }
+	bool IsEmpty() const { return mCommandCount == 0; }
+
+private:
+	template<typename T>
+	void Push(ECommandType iType, const T& iPayload);
+
+	std::vector<uint8_t> mData;
+	uint32_t mCommandCount = 0;
+	uint32_t mDrawCount = 0;
+};
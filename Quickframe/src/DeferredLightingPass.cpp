@@ -0,0 +1,274 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Engine.h"
+#include "DeferredLightingPass.h"
+#include "GBufferPass.h"
+#include "ShadowPass.h"
+#include "PointShadowPass.h"
+#include "SpotShadowPass.h"
+#include "Scene.h"
+#include "Defines.h"
+#include "GLStateCache.h"
+
+DeferredLightingPass::DeferredLightingPass(GBufferPass* iGBufferPass, ShadowPass* iShadowPass, PointShadowPass* iPointShadowPass,
+	SpotShadowPass* iSpotShadowPass)
+	:mGBufferPass(iGBufferPass),
+	mShadowPass(iShadowPass),
+	mPointShadowPass(iPointShadowPass),
+	mSpotShadowPass(iSpotShadowPass)
+{
+	Shader wFullscreenVS("shaders/FullscreenVS.glsl", Shader::EShaderStage::eVertex);
+	Shader wVolumeVS("shaders/DepthPrepassVS.glsl", Shader::EShaderStage::eVertex);
+	Shader wNullFS("shaders/DepthPrepassFS.glsl", Shader::EShaderStage::eFragment);
+	Shader wDirLightFS("shaders/DeferredDirLightFS.glsl", Shader::EShaderStage::eFragment);
+	Shader wPointLightFS("shaders/DeferredPointLightFS.glsl", Shader::EShaderStage::eFragment);
+
+	mProgram = std::make_unique<Program>(std::vector<Shader>{ wFullscreenVS, wDirLightFS });
+	mStencilProgram = std::make_unique<Program>(std::vector<Shader>{ wVolumeVS, wNullFS });
+	mLightVolumeProgram = std::make_unique<Program>(std::vector<Shader>{ wVolumeVS, wPointLightFS });
+	mLightFullscreenProgram = std::make_unique<Program>(std::vector<Shader>{ wFullscreenVS, wPointLightFS });
+
+	for (Program* wProgram : { mProgram.get(), mLightVolumeProgram.get(), mLightFullscreenProgram.get() })
+	{
+		wProgram->Bind();
+		wProgram->SetUniform1i(GBUFFER_ALBEDO_TEXTURE_UNIFORM, GBUFFER_ALBEDO_TEXTURE_UNIFORM_IDX);
+		wProgram->SetUniform1i(GBUFFER_NORMAL_TEXTURE_UNIFORM, GBUFFER_NORMAL_TEXTURE_UNIFORM_IDX);
+		wProgram->SetUniform1i(GBUFFER_SPECULAR_TEXTURE_UNIFORM, GBUFFER_SPECULAR_TEXTURE_UNIFORM_IDX);
+		wProgram->SetUniform1i(GBUFFER_DEPTH_TEXTURE_UNIFORM, GBUFFER_DEPTH_TEXTURE_UNIFORM_IDX);
+	}
+	mProgram->SetUniform1i(SHADOW_MAP_0_TEXTURE_UNIFORM, SHADOW_MAP_0_TEXTURE_UNIFORM_IDX);
+	mProgram->SetUniform1i(VIRTUAL_SHADOW_POOL_TEXTURE_UNIFORM, VIRTUAL_SHADOW_POOL_TEXTURE_UNIFORM_IDX);
+
+	for (Program* wProgram : { mLightVolumeProgram.get(), mLightFullscreenProgram.get() })
+	{
+		wProgram->Bind();
+		wProgram->SetUniform1i(POINT_SHADOW_MAPS_TEXTURE_UNIFORM, POINT_SHADOW_MAPS_TEXTURE_UNIFORM_IDX);
+		wProgram->SetUniform1i(SPOT_SHADOW_ATLAS_TEXTURE_UNIFORM, SPOT_SHADOW_ATLAS_TEXTURE_UNIFORM_IDX);
+	}
+
+	glGenVertexArrays(1, &mFullscreenVAO);
+}
+
+DeferredLightingPass::~DeferredLightingPass()
+{
+	GLStateCache::GetInstance()->OnVertexArrayDeleted(mFullscreenVAO);
+	glDeleteVertexArrays(1, &mFullscreenVAO);
+}
+
+void DeferredLightingPass::Execute(Scene* iScene)
+{
+	GBufferFBO* wGBuffer = mGBufferPass->GetGBuffer();
+	if (!wGBuffer)
+	{
+		return;
+	}
+
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	wGBuffer->BindLightingDst();
+
+	wGBuffer->BindTargetSrc(GBufferFBO::eAlbedo, GBUFFER_ALBEDO_TEXTURE_UNIT);
+	wGBuffer->BindTargetSrc(GBufferFBO::eNormal, GBUFFER_NORMAL_TEXTURE_UNIT);
+	wGBuffer->BindTargetSrc(GBufferFBO::eSpecular, GBUFFER_SPECULAR_TEXTURE_UNIT);
+	wGBuffer->BindDepthSrc(GBUFFER_DEPTH_TEXTURE_UNIT);
+
+	// Lights add up on top of the ambient term written by the geometry pass
+	wStateCache->SetDepthMask(false);
+	wStateCache->SetBlend(true);
+	wStateCache->SetBlendFunc(GL_ONE, GL_ONE);
+
+	RenderDirLight(iScene);
+
+	mPointShadowPass->BindShadowMaps(POINT_SHADOW_MAPS_TEXTURE_UNIT);
+	mSpotShadowPass->BindShadowAtlas(SPOT_SHADOW_ATLAS_TEXTURE_UNIT);
+
+	// Cleared once, every light volume resets the pixels it lit
+	glClear(GL_STENCIL_BUFFER_BIT);
+
+	for (uint32_t i = 0; i < iScene->GetPointLightCount(); i++)
+	{
+		RenderLocalLight(iScene, iScene->GetPointLight(i), glm::vec3(0.f), -2.f);
+	}
+
+	for (uint32_t i = 0; i < iScene->GetSpotLightCount(); i++)
+	{
+		const SpotLight* wSpotLight = iScene->GetSpotLight(i);
+		RenderLocalLight(iScene, wSpotLight, glm::normalize(wSpotLight->GetDirection()), wSpotLight->GetCutoff());
+	}
+
+	// Back to the renderer defaults
+	wStateCache->SetBlend(false);
+	wStateCache->SetStencilTest(false);
+	wStateCache->SetDepthTest(true);
+	wStateCache->SetDepthFunc(GL_LESS);
+	wStateCache->SetDepthMask(true);
+	wStateCache->SetColorMask(true);
+	wStateCache->SetCullFace(true);
+	wStateCache->SetCullFaceMode(GL_BACK);
+
+	wGBuffer->BlitToDefault();
+}
+
+void DeferredLightingPass::RenderDirLight(Scene* iScene)
+{
+	DirectionalLight* wDirLight = iScene->GetDirLight();
+	if (!wDirLight)
+	{
+		return;
+	}
+
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	wStateCache->SetDepthTest(false);
+	wStateCache->SetStencilTest(false);
+	wStateCache->SetCullFace(false);
+
+	mProgram->Bind();
+	SetGBufferUniforms(mProgram.get(), iScene);
+
+	mProgram->SetUniform1f("uDirLight.Intensity", wDirLight->GetIntensity());
+	mProgram->SetUniform3f("uDirLight.Color", wDirLight->GetColor());
+	mProgram->SetUniform3f("uDirLight.Dir", glm::normalize(wDirLight->GetDir()));
+	mProgram->SetUniform1i("uShadowEnabled", wDirLight->IsShadowEnabled());
+
+	if (wDirLight->IsShadowEnabled())
+	{
+		View* wLightView = wDirLight->GetView();
+		mProgram->SetUniformMatrix4f("uLightViewProj", wLightView->GetFrustum()->ProjectionMatrix() * wLightView->ViewMatrix());
+		mShadowPass->BindShadowResources(mProgram.get(), wDirLight->GetID());
+	}
+
+	wStateCache->BindVertexArray(mFullscreenVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void DeferredLightingPass::RenderLocalLight(Scene* iScene, const PointLight* iLight, const glm::vec3& iDirection, float iCutoff)
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	Camera* wCamera = iScene->GetCamera();
+
+	float wRange = iLight->GetRange();
+	if (wRange <= 0.f)
+	{
+		return;
+	}
+
+	float wVolumeRadius = wRange * kVolumeScale;
+	float wCameraDistance = glm::length(wCamera->WorldPos() - iLight->GetPos());
+
+	// A volume containing the camera or crossing the far plane loses faces to clipping,
+	// the stencil test would reject its pixels : shade those lights fullscreen instead
+	bool wFullscreen = wCameraDistance < wVolumeRadius + 2.f * wCamera->GetNearPlane() ||
+		wCameraDistance + wVolumeRadius > wCamera->GetFarPlane();
+
+	Program* wLightProgram = wFullscreen ? mLightFullscreenProgram.get() : mLightVolumeProgram.get();
+	glm::mat4 wVolumeMVP = wCamera->VPMatrix() *
+		glm::scale(glm::translate(glm::mat4(1.f), iLight->GetPos()), glm::vec3(wVolumeRadius));
+	const SubMesh& wSphere = iLight->GetSubmesh();
+
+	if (!wFullscreen)
+	{
+		// Stencil pass : count the volume faces behind the scene depth, non zero means inside
+		wStateCache->SetColorMask(false);
+		wStateCache->SetStencilTest(true);
+		wStateCache->SetDepthTest(true);
+		wStateCache->SetDepthFunc(GL_LESS);
+		wStateCache->SetCullFace(false);
+		wStateCache->SetStencilFunc(GL_ALWAYS, 0, 0);
+		wStateCache->SetStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+		wStateCache->SetStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+
+		mStencilProgram->Bind();
+		mStencilProgram->SetUniformMatrix4f("uMVP", wVolumeMVP);
+		wStateCache->BindVertexArray(wSphere.PositionVertexArrayHandle());
+		glDrawElements(GL_TRIANGLES, wSphere.IndexCount(), GL_UNSIGNED_INT, 0);
+
+		// Lighting pass : back faces only so the volume is drawn once per pixel,
+		// the lit pixels go back to zero for the next light
+		wStateCache->SetColorMask(true);
+		wStateCache->SetStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+		wStateCache->SetStencilOpSeparate(GL_FRONT_AND_BACK, GL_KEEP, GL_KEEP, GL_ZERO);
+		wStateCache->SetDepthTest(false);
+		wStateCache->SetCullFace(true);
+		wStateCache->SetCullFaceMode(GL_FRONT);
+	}
+	else
+	{
+		wStateCache->SetStencilTest(false);
+		wStateCache->SetDepthTest(false);
+		wStateCache->SetCullFace(false);
+	}
+
+	wLightProgram->Bind();
+	SetGBufferUniforms(wLightProgram, iScene);
+	wLightProgram->SetUniformMatrix4f("uMVP", wVolumeMVP);
+	wLightProgram->SetUniform1f("uLight.Intensity", iLight->GetIntensity());
+	wLightProgram->SetUniform3f("uLight.Color", iLight->GetColor());
+	wLightProgram->SetUniform3f("uLight.Position", iLight->GetPos());
+	wLightProgram->SetUniform1f("uLight.Range", wRange);
+	wLightProgram->SetUniform3f("uLight.Atten", glm::vec3(iLight->GetAttenuation().Constant,
+		iLight->GetAttenuation().Linear, iLight->GetAttenuation().Exp));
+	wLightProgram->SetUniform3f("uLight.Dir", iDirection);
+	wLightProgram->SetUniform1f("uLight.Cutoff", iCutoff);
+
+	// Only point lights have omnidirectional shadows
+	uint32_t wShadowSlot = 0;
+	float wShadowFarPlane = 0.f;
+	bool wHasShadow = iCutoff < -1.f && mPointShadowPass->GetShadowSlot(iLight->GetID(), wShadowSlot, wShadowFarPlane);
+	wLightProgram->SetUniform1f("uLight.ShadowSlot", wHasShadow ? static_cast<float>(wShadowSlot) : -1.f);
+	wLightProgram->SetUniform1f("uLight.ShadowFar", wShadowFarPlane);
+
+	// Spot lights sample their tile of the atlas, a zero sized rect disables the lookup
+	glm::mat4 wSpotShadowViewProj(1.f);
+	glm::vec4 wSpotShadowRect(0.f);
+	if (iCutoff >= -1.f)
+	{
+		mSpotShadowPass->GetShadow(iLight->GetID(), wSpotShadowViewProj, wSpotShadowRect);
+	}
+	wLightProgram->SetUniformMatrix4f("uSpotShadowViewProj", wSpotShadowViewProj);
+	wLightProgram->SetUniform4f("uSpotShadowRect", wSpotShadowRect);
+
+	if (wFullscreen)
+	{
+		wStateCache->BindVertexArray(mFullscreenVAO);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+	else
+	{
+		wStateCache->BindVertexArray(wSphere.PositionVertexArrayHandle());
+		glDrawElements(GL_TRIANGLES, wSphere.IndexCount(), GL_UNSIGNED_INT, 0);
+	}
+}
+
+void DeferredLightingPass::SetGBufferUniforms(Program* iProgram, Scene* iScene)
+{
+	GBufferFBO* wGBuffer = mGBufferPass->GetGBuffer();
+	Camera* wCamera = iScene->GetCamera();
+
+	iProgram->SetUniformMatrix4f("uInvViewProj", glm::inverse(wCamera->VPMatrix()));
+	iProgram->SetUniform2f("uScreenSize", glm::vec2(wGBuffer->GetWidth(), wGBuffer->GetHeight()));
+	iProgram->SetUniform3f("uCameraWorldPos", wCamera->WorldPos());
+}
@@ -0,0 +1,75 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Pass.h"
+
+class GBufferPass;
+class ShadowPass;
+class PointShadowPass;
+class SpotShadowPass;
+class PointLight;
+class Camera;
+
+/**
+ * @brief : Deferred shading lighting, accumulates the lights in screen space from the G-buffer.
+ * The directional light is a fullscreen pass, point and spot lights are drawn as stencil tested
+ * sphere volumes so only the pixels inside their range are shaded.
+ * The result is blitted to the default framebuffer with the depth for the forward passes.
+*/
+class DeferredLightingPass : public Pass
+{
+public:
+	DeferredLightingPass(GBufferPass* iGBufferPass, ShadowPass* iShadowPass, PointShadowPass* iPointShadowPass,
+		SpotShadowPass* iSpotShadowPass);
+	~DeferredLightingPass();
+
+	void Execute(Scene* iScene) override;
+
+private:
+	void RenderDirLight(Scene* iScene);
+
+	/**
+	 * @param iCutoff : Cosine of the spot cutoff angle, < -1 for point lights
+	*/
+	void RenderLocalLight(Scene* iScene, const PointLight* iLight, const glm::vec3& iDirection, float iCutoff);
+
+	void SetGBufferUniforms(Program* iProgram, Scene* iScene);
+
+	GBufferPass* mGBufferPass = nullptr;
+	ShadowPass* mShadowPass = nullptr;
+	PointShadowPass* mPointShadowPass = nullptr;
+	SpotShadowPass* mSpotShadowPass = nullptr;
+
+	std::unique_ptr<Program> mStencilProgram;
+	std::unique_ptr<Program> mLightVolumeProgram;
+	std::unique_ptr<Program> mLightFullscreenProgram;
+
+	// Core profile needs a VAO bound even for attribute-less draws
+	GLuint mFullscreenVAO = 0;
+
+	// The sphere mesh is tessellated, scale it up so its faces enclose the light range
+	static constexpr float kVolumeScale = 1.1f;
+};
@@ -44,4 +44,76 @@ SOFTWARE.
 
 #define CUBEMAP_0_TEXTURE_UNIT GL_TEXTURE4
 #define CUBEMAP_0_TEXTURE_UNIFORM_IDX 4
-#define CUBEMAP_0_TEXTURE_UNIFORM "uCubeMap0"
\ No newline at end of file
+#define CUBEMAP_0_TEXTURE_UNIFORM "uCubeMap0"
+// Shader storage buffer bindings, must match the layout(binding = N) in the shaders
+#define LIGHTS_SSBO_BINDING 0
+#define CLUSTER_AABB_SSBO_BINDING 1
+#define CLUSTER_LIGHT_GRID_SSBO_BINDING 2
+#define CLUSTER_LIGHT_INDICES_SSBO_BINDING 3
+
+// Clustered lighting grid : screen tiles in X/Y, logarithmic depth slices in Z
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+#define CLUSTER_COUNT (CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)
+#define MAX_LIGHTS_PER_CLUSTER 128
+
+// Deferred shading G-buffer inputs of the lighting passes
+#define GBUFFER_ALBEDO_TEXTURE_UNIT GL_TEXTURE5
+#define GBUFFER_ALBEDO_TEXTURE_UNIFORM_IDX 5
+#define GBUFFER_ALBEDO_TEXTURE_UNIFORM "uGAlbedo"
+
+#define GBUFFER_NORMAL_TEXTURE_UNIT GL_TEXTURE6
+#define GBUFFER_NORMAL_TEXTURE_UNIFORM_IDX 6
+#define GBUFFER_NORMAL_TEXTURE_UNIFORM "uGNormal"
+
+#define GBUFFER_SPECULAR_TEXTURE_UNIT GL_TEXTURE7
+#define GBUFFER_SPECULAR_TEXTURE_UNIFORM_IDX 7
+#define GBUFFER_SPECULAR_TEXTURE_UNIFORM "uGSpecular"
+
+#define GBUFFER_DEPTH_TEXTURE_UNIT GL_TEXTURE8
+#define GBUFFER_DEPTH_TEXTURE_UNIFORM_IDX 8
+#define GBUFFER_DEPTH_TEXTURE_UNIFORM "uGDepth"
+
+#define POINT_SHADOW_MAPS_TEXTURE_UNIT GL_TEXTURE9
+#define POINT_SHADOW_MAPS_TEXTURE_UNIFORM_IDX 9
+#define POINT_SHADOW_MAPS_TEXTURE_UNIFORM "uPointShadowMaps"
+
+#define SPOT_SHADOW_ATLAS_TEXTURE_UNIT GL_TEXTURE10
+#define SPOT_SHADOW_ATLAS_TEXTURE_UNIFORM_IDX 10
+#define SPOT_SHADOW_ATLAS_TEXTURE_UNIFORM "uSpotShadowAtlas"
+
+// Spot light shadow matrices and atlas rects, indexed by the light list
+#define SPOT_SHADOWS_SSBO_BINDING 4
+
+#define SHADOW_MOMENTS_0_TEXTURE_UNIT GL_TEXTURE11
+#define SHADOW_MOMENTS_0_TEXTURE_UNIFORM_IDX 11
+#define SHADOW_MOMENTS_0_TEXTURE_UNIFORM "uShadowMoments0"
+
+// Views of the layered shadow passes, see ShadowViewBatch
+#define SHADOW_VIEWS_SSBO_BINDING 5
+
+// Virtual directional shadow map, see VirtualShadowMap
+#define VIRTUAL_SHADOW_REQUESTS_SSBO_BINDING 6
+#define VIRTUAL_SHADOW_PAGE_TABLE_SSBO_BINDING 7
+
+#define VIRTUAL_SHADOW_POOL_TEXTURE_UNIT GL_TEXTURE12
+#define VIRTUAL_SHADOW_POOL_TEXTURE_UNIFORM_IDX 12
+#define VIRTUAL_SHADOW_POOL_TEXTURE_UNIFORM "uVirtualShadowPool"
+
+// Virtual texturing of the color maps, see VirtualTextureCache
+#define VIRTUAL_TEXTURE_REQUESTS_SSBO_BINDING 8
+#define VIRTUAL_TEXTURE_PAGE_TABLE_SSBO_BINDING 9
+
+#define VIRTUAL_TEXTURE_CACHE_TEXTURE_UNIT GL_TEXTURE13
+#define VIRTUAL_TEXTURE_CACHE_TEXTURE_UNIFORM_IDX 13
+#define VIRTUAL_TEXTURE_CACHE_TEXTURE_UNIFORM "uVirtualTextureCache"
+
+// Material textures packed by size and format, see TextureArrayPool
+#define TEXTURE_ARRAY_COUNT 8
+#define TEXTURE_ARRAY_0_TEXTURE_UNIT GL_TEXTURE14
+#define TEXTURE_ARRAY_0_TEXTURE_UNIFORM_IDX 14
+#define TEXTURE_ARRAYS_UNIFORM "uTextureArrays"
+
+// Material parameters indexed by the draw base instance, see MaterialTable
+#define MATERIAL_TABLE_SSBO_BINDING 10
@@ -0,0 +1,118 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Engine.h"
+#include "DepthPrepass.h"
+#include "Scene.h"
+#include "MeshNode.h"
+#include "GLStateCache.h"
+#include "ThreadPool.h"
+
+DepthPrepass::DepthPrepass()
+{
+	Shader wVertexShader("shaders/DepthPrepassVS.glsl", Shader::EShaderStage::eVertex);
+	Shader wFragmentShader("shaders/DepthPrepassFS.glsl", Shader::EShaderStage::eFragment);
+
+	std::vector<Shader> wShaders{wVertexShader, wFragmentShader};
+	mProgram = std::make_unique<Program>(wShaders);
+
+	mMVPLocation = mProgram->FindUniformLocation("uMVP");
+}
+
+void DepthPrepass::Execute(Scene* iScene)
+{
+	if (!mEnabled)
+	{
+		return;
+	}
+
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+
+	uint32_t wWidth, wHeight;
+	Engine::GetInstance()->GetWindow()->GetSize(wWidth, wHeight);
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, 0);
+	wStateCache->Viewport(0, 0, wWidth, wHeight);
+
+	wStateCache->SetColorMask(false);
+	wStateCache->SetDepthMask(true);
+	wStateCache->SetDepthFunc(GL_LESS);
+
+	mProgram->Bind();
+
+	mEntities.clear();
+	for (const auto& wEntityMap : iScene->GetEntities())
+	{
+		if (wEntityMap.second->IsDrawable())
+		{
+			mEntities.push_back(wEntityMap.second.get());
+		}
+	}
+
+	// Same matrix product as LightPass so both passes output the exact same depth
+	const glm::mat4 wViewProj = iScene->GetCamera()->VPMatrix();
+
+	ThreadPool* wThreadPool = ThreadPool::GetInstance();
+	mCommandBuffers.resize(wThreadPool->GetMaxChunkCount());
+	for (CommandBuffer& wCmdBuffer : mCommandBuffers)
+	{
+		wCmdBuffer.Reset();
+	}
+
+	wThreadPool->ParallelFor(static_cast<uint32_t>(mEntities.size()),
+		[&](uint32_t iBegin, uint32_t iEnd, uint32_t iChunk)
+		{
+			CommandBuffer& wCmdBuffer = mCommandBuffers[iChunk];
+			for (uint32_t i = iBegin; i < iEnd; i++)
+			{
+				Entity* wEntity = mEntities[i];
+				const MeshNode* wEntityRoot = wEntity->GetMesh()->GetRootNode();
+				if (wEntityRoot)
+				{
+					wCmdBuffer.SetUniformMatrix4f(mMVPLocation, wViewProj * wEntity->GetTransform()->GetWorldMatrix());
+					RecordMeshNode(*wEntityRoot, wCmdBuffer);
+				}
+			}
+		});
+
+	for (const CommandBuffer& wCmdBuffer : mCommandBuffers)
+	{
+		wCmdBuffer.Execute();
+	}
+
+	wStateCache->SetColorMask(true);
+}
+
+void DepthPrepass::RecordMeshNode(const MeshNode& iMeshNode, CommandBuffer& oCmdBuffer) const
+{
+	for (const auto& wSubMesh : iMeshNode.GetSubmeshes())
+	{
+		oCmdBuffer.BindVertexArray(wSubMesh.PositionVertexArrayHandle());
+		oCmdBuffer.DrawIndexed(wSubMesh.IndexCount());
+	}
+
+	for (auto& wChildren : iMeshNode.GetChildren())
+	{
+		RecordMeshNode(wChildren, oCmdBuffer);
+	}
+}
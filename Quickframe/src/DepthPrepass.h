@@ -0,0 +1,57 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "Pass.h"
+#include "CommandBuffer.h"
+
+class Entity;
+class MeshNode;
+
+/**
+ * @brief : Lays down the scene depth with a position only stream and no color writes,
+ * so the lit pass only shades the visible sample of each pixel (GL_EQUAL depth test).
+ * Only runs once enabled by the renderer.
+*/
+class DepthPrepass : public Pass
+{
+public:
+	DepthPrepass();
+
+	void Execute(Scene* iScene) override;
+
+	void SetEnabled(bool iEnabled) { mEnabled = iEnabled; }
+	bool IsEnabled() const { return mEnabled; }
+
+private:
+	void RecordMeshNode(const MeshNode& iMeshNode, CommandBuffer& oCmdBuffer) const;
+
+	GLint mMVPLocation = -1;
+	std::vector<CommandBuffer> mCommandBuffers;
+	std::vector<Entity*> mEntities;
+	bool mEnabled = false;
+};
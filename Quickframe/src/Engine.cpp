@@ -26,6 +26,11 @@ SOFTWARE.
 #include "Input.h"
 #include "Transform.h"
 #include "Light.h"
+#include "GLStateCache.h"
+#include "ThreadPool.h"
+#include "ProgramCache.h"
+#include "ShaderCompiler.h"
+#include "Mesh.h"
 
 Engine* Engine::mApp = nullptr;
 bool Engine::mGLFuncLoaded = false;
@@ -45,6 +50,8 @@ Engine::Engine()
 
 Engine::~Engine()
 {
+	ThreadPool::GetInstance()->Shutdown();
+	ShaderCompiler::GetInstance()->Shutdown();
 	glfwTerminate();
 }
 
@@ -63,10 +70,93 @@ void Engine::Run()
 
 		glfwPollEvents();
 		Input::GetInstance()->Update();
+
+		if (Input::GetInstance()->IsKeyReleased(GLFW_KEY_G))
+		{
+			bool wDeferred = mRenderer->GetRenderPath() == Renderer::ERenderPath::eForward;
+			mRenderer->SetRenderPath(wDeferred ? Renderer::ERenderPath::eDeferred : Renderer::ERenderPath::eForward);
+			spdlog::info("Render path : {0:s}", wDeferred ? "deferred" : "forward");
+		}
+
+		if (Input::GetInstance()->IsKeyReleased(GLFW_KEY_F))
+		{
+			static const char* kFilterNames[] = { "hardware PCF", "Poisson PCF", "EVSM" };
+			int wFilter = (static_cast<int>(mRenderer->GetShadowFilter()) + 1) % 3;
+			mRenderer->SetShadowFilter(static_cast<ShadowPass::EShadowFilter>(wFilter));
+			spdlog::info("Shadow filter : {0:s}", kFilterNames[wFilter]);
+		}
+
+		if (Input::GetInstance()->IsKeyReleased(GLFW_KEY_V))
+		{
+			bool wVirtual = !mRenderer->AreVirtualShadowsEnabled();
+			mRenderer->SetVirtualShadowsEnabled(wVirtual);
+			spdlog::info("Virtual shadow map : {0:s}", wVirtual ? "on" : "off");
+		}
+
+		if (Input::GetInstance()->IsKeyReleased(GLFW_KEY_P))
+		{
+			bool wPrepass = !mRenderer->IsDepthPrepassEnabled();
+			mRenderer->SetDepthPrepassEnabled(wPrepass);
+			spdlog::info("Depth prepass : {0:s}", wPrepass ? "on" : "off");
+		}
+
+		if (Input::GetInstance()->IsKeyReleased(GLFW_KEY_B))
+		{
+			static const char* kBenchmarkMeshes[] = { "resources/meshes/Lowpoly_tree.obj", "resources/meshes/cottage/cottage.obj" };
+			for (const char* wPath : kBenchmarkMeshes)
+			{
+				Mesh::BenchmarkImporters(wPath);
+			}
+		}
+
+		// Stream a new entity in while the scene keeps rendering
+		if (Input::GetInstance()->IsKeyReleased(GLFW_KEY_L))
+		{
+			static int wStreamedCount = 0;
+			std::shared_ptr<Entity> wEntity = std::make_shared<Entity>("Streamed_" + std::to_string(wStreamedCount));
+			wEntity->LoadMeshAsync("resources/meshes/cottage/cottage.obj");
+			wEntity->SetPos(glm::vec3(-8.f, 0.f, -16.f * (wStreamedCount + 1)));
+			wEntity->GetTransform()->SetScale(glm::vec3(0.5));
+			mSceneManager->GetActiveScene()->AddEntity(wEntity);
+			wStreamedCount++;
+		}
+
 		mSceneManager->GetActiveScene()->Update(mDeltaTime);
 
 		mRenderer->Render(mSceneManager->GetActiveScene());
 
+		// Material permutations are compiled by the first frame, report the whole startup once
+		static bool wStartupReported = false;
+		if (!wStartupReported)
+		{
+			glFinish();
+			ProgramCache::GetInstance()->LogStats("First frame");
+			spdlog::info("Startup to first frame : {0:.2f} s", glfwGetTime());
+			wStartupReported = true;
+		}
+
+		// Average frame time next to the lit pass overdraw of the active mode, only the forward path measures it
+		static const double kStatsInterval = 5.0;
+		static double wStatsElapsed = 0.0;
+		static uint32_t wStatsFrames = 0;
+		wStatsElapsed += mDeltaTime;
+		wStatsFrames++;
+		if (wStatsElapsed >= kStatsInterval)
+		{
+			const double wFrameMs = 1000.0 * wStatsElapsed / wStatsFrames;
+			if (mRenderer->GetRenderPath() == Renderer::ERenderPath::eForward)
+			{
+				spdlog::info("Frame time : {0:.2f} ms, lit pass overdraw with depth prepass {1:s} : {2:.2f} samples per pixel",
+					wFrameMs, mRenderer->IsDepthPrepassEnabled() ? "on" : "off", mRenderer->GetLightPassOverdraw());
+			}
+			else
+			{
+				spdlog::info("Frame time : {0:.2f} ms", wFrameMs);
+			}
+			wStatsElapsed = 0.0;
+			wStatsFrames = 0;
+		}
+
 		// glfw: swap buffers
 		// -------------------------------------------------------------------------------
 		glfwSwapBuffers(mWindow->GetInternal());
@@ -79,6 +169,9 @@ void Engine::Initialize()
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	// Must match the G-buffer depth/stencil format for the deferred path blit
+	glfwWindowHint(GLFW_DEPTH_BITS, 24);
+	glfwWindowHint(GLFW_STENCIL_BITS, 8);
 
 	Window::WindowInfo wWndInfo{};
 	wWndInfo.mWidth = 1920;
@@ -96,10 +189,13 @@ void Engine::Initialize()
 	}
 	PrintAdapterInfo();
 
+	ShaderCompiler::GetInstance()->Initialize(mWindow->GetInternal());
+
 	InitGLFWCallbacks();
 
 	mRenderer = std::make_unique<Renderer>();
 	mRenderer->Initialize();
+	ProgramCache::GetInstance()->LogStats("Renderer initialized");
 
 	InitSceneManager();
 }
@@ -170,7 +266,7 @@ void Engine::OnKeyboard(int iKey, int iScancode, int iAction, int iMods)
 void Engine::OnResize(int iWidth, int iHeight)
 {
 	mWindow->SetSize(iWidth, iHeight);
-	glViewport(0, 0, iWidth, iHeight);
+	GLStateCache::GetInstance()->Viewport(0, 0, iWidth, iHeight);
 	float wAR = (float)iWidth / (float)iHeight;
 
 	// Handle window minimization
@@ -25,6 +25,7 @@ SOFTWARE.
 #include <spdlog/spdlog.h>
 
 #include "Entity.h"
+#include "MeshStreamer.h"
 
 Entity::Entity(const std::string& iName)
 	:mName(iName)
@@ -32,9 +33,79 @@ Entity::Entity(const std::string& iName)
 	mTransform = std::make_unique<Transform>();
 }
 
-bool Entity::LoadMesh(const std::string& iPath)
+Entity::~Entity()
 {
+	CancelMeshLoad();
+}
+
+bool Entity::LoadMesh(const std::string& iPath, Mesh::EImporter iImporter)
+{
+	CancelMeshLoad();
+
 	spdlog::info("Loading Mesh for Entity {0:s} ...", mName.c_str());
 	mMesh = std::make_unique<Mesh>();
-	return mMesh->Load(iPath);
+	const bool wLoaded = mMesh->Load(iPath, iImporter);
+	mResidency = wLoaded ? EResidency::eResident : EResidency::eFailed;
+	mTransform->Invalidate();
+	return wLoaded;
+}
+
+void Entity::LoadMeshAsync(const std::string& iPath)
+{
+	spdlog::info("Streaming Mesh for Entity {0:s} ...", mName.c_str());
+	MeshStreamer::GetInstance()->Request(this, iPath);
+	mResidency = EResidency::eLoading;
+}
+
+void Entity::CancelMeshLoad()
+{
+	if (mResidency != EResidency::eLoading)
+	{
+		return;
+	}
+
+	MeshStreamer::GetInstance()->Cancel(this);
+	mResidency = mMesh ? EResidency::eResident : EResidency::eEmpty;
+}
+
+void Entity::OnMeshLoaded(std::unique_ptr<Mesh> iMesh)
+{
+	if (!iMesh)
+	{
+		mResidency = mMesh ? EResidency::eResident : EResidency::eFailed;
+		return;
+	}
+
+	mMesh = std::move(iMesh);
+	mResidency = EResidency::eResident;
+
+	// Cached shadows keyed on the transform version redraw with the new geometry
+	mTransform->Invalidate();
+}
+
+void Entity::LoadMesh(const std::string& iPath, const MeshData& iData)
+{
+	CancelMeshLoad();
+
+	spdlog::info("Uploading Mesh for Entity {0:s} ...", mName.c_str());
+	mMesh = std::make_unique<Mesh>();
+	mMesh->Upload(iPath, iData);
+	mResidency = EResidency::eResident;
+	mTransform->Invalidate();
+}
+
+bool Entity::GetWorldBoundingSphere(glm::vec3& oCenter, float& oRadius) const
+{
+	if (!mMesh || !mMesh->HasBounds())
+	{
+		return false;
+	}
+
+	glm::vec3 wLocalCenter = (mMesh->GetBoundsMin() + mMesh->GetBoundsMax()) * 0.5f;
+	float wLocalRadius = glm::length(mMesh->GetBoundsMax() - wLocalCenter);
+
+	glm::vec3 wScale = glm::abs(mTransform->GetScale());
+	oCenter = glm::vec3(mTransform->GetWorldMatrix() * glm::vec4(wLocalCenter, 1.f));
+	oRadius = wLocalRadius * glm::max(wScale.x, glm::max(wScale.y, wScale.z));
+	return true;
 }
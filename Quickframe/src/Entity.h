@@ -32,10 +32,46 @@ SOFTWARE.
 
 class Entity
 {
+	friend class MeshStreamer;
 public:
+	enum class EResidency
+	{
+		eEmpty,
+		eLoading,		// Importing on the workers or uploading over the next frames
+		eResident,
+		eFailed
+	};
+
 	Entity(const std::string& iName);
+	virtual ~Entity();
+
+	/**
+	 * @brief : Blocking load, parses and uploads the whole mesh before returning
+	*/
+	bool LoadMesh(const std::string& iPath, Mesh::EImporter iImporter = Mesh::EImporter::eAuto);
+
+	/**
+	 * @brief : Non blocking load, the entity stays eLoading until MeshStreamer has uploaded the mesh.
+	 * The current mesh, if any, is replaced once the new one is resident.
+	*/
+	void LoadMeshAsync(const std::string& iPath);
+
+	/**
+	 * @brief : Drop the pending async load, the entity keeps its current mesh
+	*/
+	void CancelMeshLoad();
+
+	EResidency GetResidency() const { return mResidency; }
 
-	bool LoadMesh(const std::string& iPath);
+	/**
+	 * @brief : Whether passes draw the entity, a reloading entity keeps drawing its previous mesh
+	*/
+	bool IsDrawable() const { return mMesh && mResidency != EResidency::eFailed; }
+
+	/**
+	 * @brief : Create the mesh from data already imported by Mesh::LoadData, main thread only
+	*/
+	void LoadMesh(const std::string& iPath, const MeshData& iData);
 	Mesh* GetMesh() const { return mMesh.get(); }
 	Transform* GetTransform() const { return mTransform.get(); }
 
@@ -44,8 +80,27 @@ public:
 
 	const std::string& GetName() const { return mName; }
 
+	/**
+	 * @brief : Static entities never move, their shadows are cached
+	*/
+	void SetStatic(bool iStatic) { mStatic = iStatic; }
+	bool IsStatic() const { return mStatic; }
+
+	/**
+	 * @brief : World space sphere enclosing the mesh bounds
+	 * @return false if the entity has no loaded geometry
+	*/
+	bool GetWorldBoundingSphere(glm::vec3& oCenter, float& oRadius) const;
+
 protected:
+	/**
+	 * @brief : Called by MeshStreamer once the async load is done, iMesh is nullptr when it failed
+	*/
+	void OnMeshLoaded(std::unique_ptr<Mesh> iMesh);
+
 	std::unique_ptr<Transform> mTransform;
 	std::string mName;
 	std::unique_ptr<Mesh> mMesh;
+	bool mStatic = false;
+	EResidency mResidency = EResidency::eEmpty;
 };
\ No newline at end of file
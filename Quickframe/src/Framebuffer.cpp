@@ -25,6 +25,7 @@ SOFTWARE.
 #include <spdlog/spdlog.h>
 
 #include "Framebuffer.h"
+#include "GLStateCache.h"
 
 Framebuffer::Framebuffer(const std::string& iName ,uint32_t iWidth, uint32_t iHeight)
 	:mName(iName),
@@ -35,25 +36,33 @@ Framebuffer::Framebuffer(const std::string& iName ,uint32_t iWidth, uint32_t iHe
 
 Framebuffer::~Framebuffer()
 {
-	glDeleteTextures(1, &mTextureHandle);
-	glDeleteFramebuffers(1, &mFramebufferHandle);
+	if (mTextureHandle)
+	{
+		GLStateCache::GetInstance()->OnTextureDeleted(mTextureHandle);
+		glDeleteTextures(1, &mTextureHandle);
+	}
+
+	if (mFramebufferHandle)
+	{
+		GLStateCache::GetInstance()->OnFramebufferDeleted(mFramebufferHandle);
+		glDeleteFramebuffers(1, &mFramebufferHandle);
+	}
 }
 
 void Framebuffer::BindSrc(GLenum iTextureUnit)
 {
-	glActiveTexture(iTextureUnit);
-	glBindTexture(GL_TEXTURE_2D, mTextureHandle);
+	GLStateCache::GetInstance()->BindTexture(iTextureUnit, GL_TEXTURE_2D, mTextureHandle);
 }
 
 void Framebuffer::BindDst()
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, mFramebufferHandle);
-	glViewport(0, 0, mWidth, mHeight);
+	GLStateCache::GetInstance()->BindFramebuffer(GL_FRAMEBUFFER, mFramebufferHandle);
+	GLStateCache::GetInstance()->Viewport(0, 0, mWidth, mHeight);
 }
 
 void Framebuffer::Unbind()
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLStateCache::GetInstance()->BindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 ShadowMapFBO::ShadowMapFBO(const std::string& iName, uint32_t iWidth, uint32_t iHeight)
@@ -67,17 +76,20 @@ bool ShadowMapFBO::Initialize()
 	glGenFramebuffers(1, &mFramebufferHandle);
 
 	glGenTextures(1, &mTextureHandle);
-	glBindTexture(GL_TEXTURE_2D, mTextureHandle);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, mWidth, mHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	GLStateCache::GetInstance()->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, mTextureHandle);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT16, mWidth, mHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
 	
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	// Sampled through sampler2DShadow, linear filtering gives a free 2x2 PCF
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-	float border = 1.0f;
-	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, &border);
+	float border[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, mFramebufferHandle);
+	GLStateCache::GetInstance()->BindFramebuffer(GL_FRAMEBUFFER, mFramebufferHandle);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, mTextureHandle, 0);
 
 	glDrawBuffer(GL_NONE);
@@ -91,7 +103,132 @@ bool ShadowMapFBO::Initialize()
 		return false;
 	}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLStateCache::GetInstance()->BindFramebuffer(GL_FRAMEBUFFER, 0);
 
 	return true;
 }
+
+GBufferFBO::GBufferFBO(const std::string& iName, uint32_t iWidth, uint32_t iHeight)
+	:Framebuffer(iName, iWidth, iHeight)
+{
+}
+
+GBufferFBO::~GBufferFBO()
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+
+	// The light accumulation target is mTextureHandle, released by the base class
+	for (uint32_t i = 0; i < eLightAccumulation; i++)
+	{
+		if (mTargets[i])
+		{
+			wStateCache->OnTextureDeleted(mTargets[i]);
+			glDeleteTextures(1, &mTargets[i]);
+		}
+	}
+
+	if (mDepthStencilHandle)
+	{
+		wStateCache->OnTextureDeleted(mDepthStencilHandle);
+		glDeleteTextures(1, &mDepthStencilHandle);
+	}
+
+	if (mLightingFramebufferHandle)
+	{
+		wStateCache->OnFramebufferDeleted(mLightingFramebufferHandle);
+		glDeleteFramebuffers(1, &mLightingFramebufferHandle);
+	}
+}
+
+bool GBufferFBO::Initialize()
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+
+	const GLenum wInternalFormats[eTargetCount] = { GL_RGBA8, GL_RGB10_A2, GL_RGBA8, GL_RGBA16F };
+	const GLenum wTypes[eTargetCount] = { GL_UNSIGNED_BYTE, GL_UNSIGNED_INT_2_10_10_10_REV, GL_UNSIGNED_BYTE, GL_HALF_FLOAT };
+
+	glGenTextures(eTargetCount, mTargets);
+	for (uint32_t i = 0; i < eTargetCount; i++)
+	{
+		wStateCache->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, mTargets[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, wInternalFormats[i], mWidth, mHeight, 0, GL_RGBA, wTypes[i], NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	mTextureHandle = mTargets[eLightAccumulation];
+
+	// Same format as the default framebuffer depth, required to blit it
+	glGenTextures(1, &mDepthStencilHandle);
+	wStateCache->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, mDepthStencilHandle);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, mWidth, mHeight, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	// Geometry framebuffer
+	glGenFramebuffers(1, &mFramebufferHandle);
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, mFramebufferHandle);
+
+	GLenum wDrawBuffers[eTargetCount];
+	for (uint32_t i = 0; i < eTargetCount; i++)
+	{
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, mTargets[i], 0);
+		wDrawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+	}
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, mDepthStencilHandle, 0);
+	glDrawBuffers(eTargetCount, wDrawBuffers);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		spdlog::critical("Error While Creating Framebuffer {0:s} !", mName);
+		return false;
+	}
+
+	// Lighting framebuffer
+	glGenFramebuffers(1, &mLightingFramebufferHandle);
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, mLightingFramebufferHandle);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mTargets[eLightAccumulation], 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, mDepthStencilHandle, 0);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		spdlog::critical("Error While Creating Framebuffer {0:s} (Lighting) !", mName);
+		return false;
+	}
+
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	return true;
+}
+
+void GBufferFBO::BindLightingDst()
+{
+	GLStateCache::GetInstance()->BindFramebuffer(GL_FRAMEBUFFER, mLightingFramebufferHandle);
+	GLStateCache::GetInstance()->Viewport(0, 0, mWidth, mHeight);
+}
+
+void GBufferFBO::BindTargetSrc(EGBufferTarget iTarget, GLenum iTextureUnit)
+{
+	GLStateCache::GetInstance()->BindTexture(iTextureUnit, GL_TEXTURE_2D, mTargets[iTarget]);
+}
+
+void GBufferFBO::BindDepthSrc(GLenum iTextureUnit)
+{
+	GLStateCache::GetInstance()->BindTexture(iTextureUnit, GL_TEXTURE_2D, mDepthStencilHandle);
+}
+
+void GBufferFBO::BlitToDefault()
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	wStateCache->BindFramebuffer(GL_READ_FRAMEBUFFER, mLightingFramebufferHandle);
+	wStateCache->BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+	// Depth and stencil are only copied when both sides share the same format (DEPTH24_STENCIL8)
+	glBlitFramebuffer(0, 0, mWidth, mHeight, 0, 0, mWidth, mHeight,
+		GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -31,20 +31,23 @@ class Framebuffer
 {
 public:
 	Framebuffer(const std::string& iName, uint32_t iWidth, uint32_t iHeight);
-	~Framebuffer();
+	virtual ~Framebuffer();
 
 	virtual bool Initialize() = 0;
 
 	GLuint FramebufferHandle() const { return mFramebufferHandle; }
 	GLuint TextureHandle() const { return mTextureHandle; }
 
+	uint32_t GetWidth() const { return mWidth; }
+	uint32_t GetHeight() const { return mHeight; }
+
 	void BindSrc(GLenum iTextureUnit);
 	void BindDst();
 	void Unbind();
 
 protected:
-	GLuint mFramebufferHandle;
-	GLuint mTextureHandle;
+	GLuint mFramebufferHandle = 0;
+	GLuint mTextureHandle = 0;
 
 	std::string mName;
 	GLuint mWidth;
@@ -57,4 +60,48 @@ public:
 	ShadowMapFBO(const std::string& iName, uint32_t iWidth, uint32_t iHeight);
 
 	bool Initialize() override;
+};
+
+/**
+ * @brief : Deferred shading G-buffer.
+ * The geometry pass writes every target, the lighting passes only write the light accumulation
+ * target through a second framebuffer sharing the same depth/stencil texture.
+*/
+class GBufferFBO : public Framebuffer
+{
+public:
+	enum EGBufferTarget
+	{
+		eAlbedo = 0,					// RGBA8 : Diffuse color
+		eNormal,							// RGB10_A2 : World normal * 0.5 + 0.5
+		eSpecular,						// RGBA8 : Specular color, specular exponent / kMaxSpecularExponent
+		eLightAccumulation,		// RGBA16F : Ambient then lights, additively blended
+		eTargetCount
+	};
+
+	static constexpr float kMaxSpecularExponent = 1024.f;
+
+	GBufferFBO(const std::string& iName, uint32_t iWidth, uint32_t iHeight);
+	~GBufferFBO() override;
+
+	bool Initialize() override;
+
+	/**
+	 * @brief : Bind the light accumulation target and the depth/stencil for the lighting passes
+	*/
+	void BindLightingDst();
+
+	void BindTargetSrc(EGBufferTarget iTarget, GLenum iTextureUnit);
+	void BindDepthSrc(GLenum iTextureUnit);
+
+	/**
+	 * @brief : Copy the lit image and the depth/stencil to the default framebuffer
+	 * so the forward passes (unlit, skybox) can be drawn on top
+	*/
+	void BlitToDefault();
+
+private:
+	GLuint mTargets[eTargetCount] = { 0 };
+	GLuint mDepthStencilHandle = 0;
+	GLuint mLightingFramebufferHandle = 0;
 };
\ No newline at end of file
@@ -0,0 +1,267 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Engine.h"
+#include "GBufferPass.h"
+#include "Scene.h"
+#include "Texture.h"
+#include "Defines.h"
+#include "MeshNode.h"
+#include "GLStateCache.h"
+#include "ThreadPool.h"
+#include "VirtualTextureCache.h"
+#include "MaterialTable.h"
+
+GBufferPass::GBufferPass()
+{
+	// Bit order of Material::kFeature*
+	mVariants = std::make_unique<ProgramVariants>(
+		std::vector<ProgramVariants::Stage>{
+			{ "shaders/BlinnPhongVS.glsl", Shader::EShaderStage::eVertex },
+			{ "shaders/GBufferFS.glsl", Shader::EShaderStage::eFragment } },
+		std::vector<std::string>{ "COLOR_TEX", "NORMAL_TEX", "SPECULAR_TEX", "VIRTUAL_COLOR_TEX" });
+}
+
+void GBufferPass::Execute(Scene* iScene)
+{
+	uint32_t wWidth, wHeight;
+	Engine::GetInstance()->GetWindow()->GetSize(wWidth, wHeight);
+	if (wWidth == 0 || wHeight == 0)
+	{
+		return;
+	}
+
+	if (!mGBuffer || mGBuffer->GetWidth() != wWidth || mGBuffer->GetHeight() != wHeight)
+	{
+		mGBuffer = std::make_unique<GBufferFBO>("GBuffer", wWidth, wHeight);
+		mGBuffer->Initialize();
+	}
+
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	mGBuffer->BindDst();
+	wStateCache->SetColorMask(true);
+	wStateCache->SetDepthMask(true);
+	wStateCache->SetDepthTest(true);
+	wStateCache->SetDepthFunc(GL_LESS);
+	glClearColor(0.f, 0.f, 0.f, 0.f);
+	glClearStencil(0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+	mAmbientLight = glm::vec3(0.f);
+	if (iScene->GetDirLight())
+	{
+		DirectionalLight* wDirLight = iScene->GetDirLight();
+		mAmbientLight = wDirLight->GetColor() * wDirLight->GetIntensity() * wDirLight->GetAmbientIntensity();
+	}
+
+	for (auto& wVariant : mVariantStates)
+	{
+		wVariant.second.VariantProgram->Bind();
+		wVariant.second.VariantProgram->SetUniform3f("uAmbientLight", mAmbientLight);
+	}
+
+	mEntities.clear();
+	for (const auto& wEntityMap : iScene->GetEntities())
+	{
+		if (wEntityMap.second->IsDrawable())
+		{
+			mEntities.push_back(wEntityMap.second.get());
+		}
+	}
+
+	const glm::mat4 wViewProj = iScene->GetCamera()->VPMatrix();
+
+	uint32_t wMissingKeys = RecordDraws(wViewProj);
+	if (wMissingKeys)
+	{
+		// Same as the light pass, the featureless variant is the fallback and is waited for
+		bool wRecordAgain = false;
+		for (uint32_t wKey = 0; wKey < 32; wKey++)
+		{
+			if (wMissingKeys & (1u << wKey))
+			{
+				Program* wProgram = wKey == kFallbackKey ? mVariants->Get(wKey) : mVariants->Request(wKey);
+				if (wProgram)
+				{
+					PrepareVariant(wKey, wProgram);
+					wRecordAgain = true;
+				}
+			}
+		}
+
+		if (wRecordAgain)
+		{
+			RecordDraws(wViewProj);
+		}
+	}
+
+	VirtualTextureCache::GetInstance()->BindResources();
+	MaterialTable::GetInstance()->Bind();
+
+	for (const CommandBuffer& wCmdBuffer : mCommandBuffers)
+	{
+		wCmdBuffer.Execute();
+	}
+}
+
+void GBufferPass::PrepareVariant(uint32_t iKey, Program* iProgram)
+{
+	Variant& wVariant = mVariantStates[iKey];
+	wVariant.Key = iKey;
+	wVariant.VariantProgram = iProgram;
+	wVariant.Uniforms.MVP = iProgram->FindUniformLocation("uMVP");
+	wVariant.Uniforms.World = iProgram->FindUniformLocation("uWorld");
+	wVariant.Uniforms.NormalMatrix = iProgram->FindUniformLocation("uNormalMatrix");
+
+	iProgram->Bind();
+	iProgram->SetUniform1i(COLOR_TEXTURE_UNIFORM, COLOR_TEXTURE_UNIFORM_IDX);
+	iProgram->SetUniform1i(NORMAL_TEXTURE_UNIFORM, NORMAL_TEXTURE_UNIFORM_IDX);
+	iProgram->SetUniform1i(SPECULAR_EXPONENT_TEXTURE_UNIFORM, SPECULAR_EXPONENT_TEXTURE_UNIFORM_IDX);
+	iProgram->SetUniform1i(VIRTUAL_TEXTURE_CACHE_TEXTURE_UNIFORM, VIRTUAL_TEXTURE_CACHE_TEXTURE_UNIFORM_IDX);
+	for (int i = 0; i < TEXTURE_ARRAY_COUNT; i++)
+	{
+		iProgram->SetUniform1i(TEXTURE_ARRAYS_UNIFORM "[" + std::to_string(i) + "]", TEXTURE_ARRAY_0_TEXTURE_UNIFORM_IDX + i);
+	}
+	iProgram->SetUniform3f("uAmbientLight", mAmbientLight);
+}
+
+uint32_t GBufferPass::RecordDraws(const glm::mat4& iViewProj)
+{
+	ThreadPool* wThreadPool = ThreadPool::GetInstance();
+	mCommandBuffers.resize(wThreadPool->GetMaxChunkCount());
+	mChunkMissingKeys.assign(wThreadPool->GetMaxChunkCount(), 0);
+	for (CommandBuffer& wCmdBuffer : mCommandBuffers)
+	{
+		wCmdBuffer.Reset();
+	}
+
+	wThreadPool->ParallelFor(static_cast<uint32_t>(mEntities.size()),
+		[&](uint32_t iBegin, uint32_t iEnd, uint32_t iChunk)
+		{
+			CommandBuffer& wCmdBuffer = mCommandBuffers[iChunk];
+			RecordState wState;
+			for (uint32_t i = iBegin; i < iEnd; i++)
+			{
+				RecordEntity(mEntities[i], iViewProj, wState, wCmdBuffer);
+			}
+			mChunkMissingKeys[iChunk] = wState.MissingKeys;
+		});
+
+	uint32_t wMissingKeys = 0;
+	for (uint32_t wChunkKeys : mChunkMissingKeys)
+	{
+		wMissingKeys |= wChunkKeys;
+	}
+	return wMissingKeys;
+}
+
+void GBufferPass::RecordEntity(Entity* iEntity, const glm::mat4& iViewProj, RecordState& ioState, CommandBuffer& oCmdBuffer) const
+{
+	const MeshNode* wEntityRoot = iEntity->GetMesh()->GetRootNode();
+	if (!wEntityRoot)
+	{
+		return;
+	}
+
+	EntityUniforms wEntityUniforms;
+	wEntityUniforms.World = iEntity->GetTransform()->GetWorldMatrix();
+	wEntityUniforms.MVP = iViewProj * wEntityUniforms.World;
+	wEntityUniforms.NormalMatrix = glm::transpose(glm::inverse(glm::mat3(wEntityUniforms.World)));
+
+	if (ioState.Current)
+	{
+		SetEntityUniforms(*ioState.Current, wEntityUniforms, oCmdBuffer);
+	}
+
+	RecordMeshNode(*wEntityRoot, wEntityUniforms, ioState, oCmdBuffer);
+}
+
+void GBufferPass::RecordMeshNode(const MeshNode& iMeshNode, const EntityUniforms& iEntityUniforms, RecordState& ioState,
+	CommandBuffer& oCmdBuffer) const
+{
+	for (const auto& wSubMesh : iMeshNode.GetSubmeshes())
+	{
+		Material* wSubMeshMaterial = wSubMesh.GetMaterial();
+
+		const uint32_t wKey = wSubMeshMaterial->GetShaderFeatures();
+		if (!ioState.Current || ioState.Current->Key != wKey)
+		{
+			auto wIt = mVariantStates.find(wKey);
+			if (wIt == mVariantStates.end())
+			{
+				// Still compiling, write the material colors only until it is ready
+				ioState.MissingKeys |= 1u << wKey;
+				wIt = mVariantStates.find(kFallbackKey);
+				if (wIt == mVariantStates.end())
+				{
+					ioState.MissingKeys |= 1u << kFallbackKey;
+					continue;
+				}
+			}
+
+			if (ioState.Current != &wIt->second)
+			{
+				ioState.Current = &wIt->second;
+				oCmdBuffer.BindProgram(ioState.Current->VariantProgram->GetHandle());
+				SetEntityUniforms(*ioState.Current, iEntityUniforms, oCmdBuffer);
+			}
+		}
+
+		oCmdBuffer.BindVertexArray(wSubMesh.VertexArrayHandle());
+
+		// Colors and packed textures come from the material table, only the textures left out of the arrays are bound
+		Texture* wDiffuseTex = wSubMeshMaterial->GetDiffuseTex();
+		Texture* wNormalTex = wSubMeshMaterial->GetNormalTex();
+		Texture* wSpecularTex = wSubMeshMaterial->GetSpecularExponentTex();
+
+		if (wDiffuseTex && !MaterialTable::IsPacked(wDiffuseTex))
+		{
+			oCmdBuffer.BindTexture(COLOR_TEXTURE_UNIT, wDiffuseTex->GetTarget(), wDiffuseTex->GetHandle());
+		}
+
+		if (wNormalTex && !MaterialTable::IsPacked(wNormalTex))
+		{
+			oCmdBuffer.BindTexture(NORMAL_TEXTURE_UNIT, wNormalTex->GetTarget(), wNormalTex->GetHandle());
+		}
+
+		if (wSpecularTex && !MaterialTable::IsPacked(wSpecularTex))
+		{
+			oCmdBuffer.BindTexture(SPECULAR_EXPONENT_TEXTURE_UNIT, wSpecularTex->GetTarget(), wSpecularTex->GetHandle());
+		}
+
+		oCmdBuffer.DrawIndexedBaseInstance(wSubMesh.IndexCount(), wSubMeshMaterial->GetTableIndex());
+	}
+
+	for (auto& wChildren : iMeshNode.GetChildren())
+	{
+		RecordMeshNode(wChildren, iEntityUniforms, ioState, oCmdBuffer);
+	}
+}
+
+void GBufferPass::SetEntityUniforms(const Variant& iVariant, const EntityUniforms& iEntityUniforms, CommandBuffer& oCmdBuffer) const
+{
+	oCmdBuffer.SetUniformMatrix4f(iVariant.Uniforms.MVP, iEntityUniforms.MVP);
+	oCmdBuffer.SetUniformMatrix4f(iVariant.Uniforms.World, iEntityUniforms.World);
+	oCmdBuffer.SetUniformMatrix3f(iVariant.Uniforms.NormalMatrix, iEntityUniforms.NormalMatrix);
+}
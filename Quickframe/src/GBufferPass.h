@@ -0,0 +1,104 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "Pass.h"
+#include "Framebuffer.h"
+#include "CommandBuffer.h"
+#include "ProgramVariants.h"
+
+class Entity;
+class MeshNode;
+
+/**
+ * @brief : Deferred shading geometry pass, writes the material attributes of the visible surfaces
+ * to the G-buffer. The G-buffer follows the window size.
+*/
+class GBufferPass : public Pass
+{
+	struct DrawUniforms
+	{
+		GLint MVP = -1;
+		GLint World = -1;
+		GLint NormalMatrix = -1;
+	};
+
+	struct Variant
+	{
+		uint32_t Key = 0;
+		Program* VariantProgram = nullptr;
+		DrawUniforms Uniforms;
+	};
+
+	struct EntityUniforms
+	{
+		glm::mat4 MVP;
+		glm::mat4 World;
+		glm::mat3 NormalMatrix;
+	};
+
+	struct RecordState
+	{
+		const Variant* Current = nullptr;
+		uint32_t MissingKeys = 0;
+	};
+
+public:
+	GBufferPass();
+
+	void Execute(Scene* iScene) override;
+
+	GBufferFBO* GetGBuffer() const { return mGBuffer.get(); }
+
+private:
+	/**
+	 * @brief : Register a compiled variant for drawing
+	*/
+	void PrepareVariant(uint32_t iKey, Program* iProgram);
+
+	/**
+	 * @return the mask of the variant keys that were needed but not ready, their draws use the fallback variant
+	*/
+	uint32_t RecordDraws(const glm::mat4& iViewProj);
+	void RecordEntity(Entity* iEntity, const glm::mat4& iViewProj, RecordState& ioState, CommandBuffer& oCmdBuffer) const;
+	void RecordMeshNode(const MeshNode& iMeshNode, const EntityUniforms& iEntityUniforms, RecordState& ioState,
+		CommandBuffer& oCmdBuffer) const;
+	void SetEntityUniforms(const Variant& iVariant, const EntityUniforms& iEntityUniforms, CommandBuffer& oCmdBuffer) const;
+
+	std::unique_ptr<GBufferFBO> mGBuffer;
+
+	// Keyed by the material features, see LightPass
+	static constexpr uint32_t kFallbackKey = 0;		// No texture, drawn while the material variants compile
+	std::unique_ptr<ProgramVariants> mVariants;
+	std::unordered_map<uint32_t, Variant> mVariantStates;
+	glm::vec3 mAmbientLight{ 0.f };
+
+	std::vector<CommandBuffer> mCommandBuffers;
+	std::vector<uint32_t> mChunkMissingKeys;
+	std::vector<Entity*> mEntities;
+};
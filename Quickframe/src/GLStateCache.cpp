@@ -0,0 +1,610 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "GLStateCache.h"
+
+GLStateCache* GLStateCache::mStateCache = nullptr;
+
+GLStateCache* GLStateCache::GetInstance()
+{
+	if (!mStateCache)
+	{
+		mStateCache = new GLStateCache();
+	}
+
+	return mStateCache;
+}
+
+GLStateCache::GLStateCache()
+{
+}
+
+void GLStateCache::Reset()
+{
+	mProgram = 0;
+	mVertexArray = 0;
+	mDrawFramebuffer = 0;
+	mReadFramebuffer = 0;
+	mActiveTextureUnit = 0;
+	for (uint32_t wUnit = 0; wUnit < kMaxTextureUnits; wUnit++)
+	{
+		for (uint32_t wSlot = 0; wSlot < kTextureTargetCount; wSlot++)
+		{
+			mTextures[wUnit][wSlot] = 0;
+		}
+		mSamplers[wUnit] = 0;
+	}
+	for (uint32_t i = 0; i < kBufferTargetCount; i++)
+	{
+		mBuffers[i] = 0;
+	}
+	for (uint32_t i = 0; i < kMaxIndexedBindings; i++)
+	{
+		mUniformBufferBases[i] = 0;
+		mStorageBufferBases[i] = 0;
+	}
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		mViewport[i] = -1;
+		mScissor[i] = -1;
+	}
+	mScissorTest = false;
+	mDepthTest = false;
+	mDepthFunc = GL_LESS;
+	mDepthMask = true;
+	mCullFace = false;
+	mCullFaceMode = GL_BACK;
+	mFrontFace = GL_CCW;
+	mBlend = false;
+	mBlendSrc = GL_ONE;
+	mBlendDst = GL_ZERO;
+	mColorMask = true;
+	mStencilTest = false;
+	mStencilFunc = GL_ALWAYS;
+	mStencilRef = 0;
+	mStencilFuncMask = 0xFFFFFFFF;
+	for (uint32_t wFace = 0; wFace < 2; wFace++)
+	{
+		for (uint32_t wOp = 0; wOp < 3; wOp++)
+		{
+			mStencilOps[wFace][wOp] = GL_KEEP;
+		}
+	}
+
+	// Push the defaults so the driver matches the shadow state
+	glUseProgram(0);
+	glBindVertexArray(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glDisable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	glDisable(GL_CULL_FACE);
+	glCullFace(GL_BACK);
+	glFrontFace(GL_CCW);
+	glDisable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ZERO);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glDisable(GL_STENCIL_TEST);
+	glDisable(GL_SCISSOR_TEST);
+	glStencilFunc(GL_ALWAYS, 0, 0xFFFFFFFF);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+}
+
+bool GLStateCache::Filter(bool iRedundant)
+{
+	if (iRedundant)
+	{
+		++mFrameStats.FilteredCalls;
+		++mTotalStats.FilteredCalls;
+		return true;
+	}
+
+	++mFrameStats.IssuedCalls;
+	++mTotalStats.IssuedCalls;
+	return false;
+}
+
+void GLStateCache::UseProgram(GLuint iProgram)
+{
+	if (Filter(mProgram == iProgram))
+	{
+		return;
+	}
+
+	mProgram = iProgram;
+	glUseProgram(iProgram);
+}
+
+void GLStateCache::BindVertexArray(GLuint iVertexArray)
+{
+	if (Filter(mVertexArray == iVertexArray))
+	{
+		return;
+	}
+
+	mVertexArray = iVertexArray;
+	glBindVertexArray(iVertexArray);
+}
+
+void GLStateCache::BindFramebuffer(GLenum iTarget, GLuint iFramebuffer)
+{
+	bool wRedundant = false;
+	switch (iTarget)
+	{
+	case GL_FRAMEBUFFER:
+		wRedundant = mDrawFramebuffer == iFramebuffer && mReadFramebuffer == iFramebuffer;
+		mDrawFramebuffer = iFramebuffer;
+		mReadFramebuffer = iFramebuffer;
+		break;
+	case GL_DRAW_FRAMEBUFFER:
+		wRedundant = mDrawFramebuffer == iFramebuffer;
+		mDrawFramebuffer = iFramebuffer;
+		break;
+	case GL_READ_FRAMEBUFFER:
+		wRedundant = mReadFramebuffer == iFramebuffer;
+		mReadFramebuffer = iFramebuffer;
+		break;
+	}
+
+	if (Filter(wRedundant))
+	{
+		return;
+	}
+
+	glBindFramebuffer(iTarget, iFramebuffer);
+}
+
+void GLStateCache::BindBuffer(GLenum iTarget, GLuint iBuffer)
+{
+	int wSlot = BufferTargetSlot(iTarget);
+	if (wSlot < 0)
+	{
+		Filter(false);
+		glBindBuffer(iTarget, iBuffer);
+		return;
+	}
+
+	if (Filter(mBuffers[wSlot] == iBuffer))
+	{
+		return;
+	}
+
+	mBuffers[wSlot] = iBuffer;
+	glBindBuffer(iTarget, iBuffer);
+}
+
+void GLStateCache::BindBufferBase(GLenum iTarget, GLuint iIndex, GLuint iBuffer)
+{
+	GLuint* wBases = nullptr;
+	if (iTarget == GL_UNIFORM_BUFFER)
+	{
+		wBases = mUniformBufferBases;
+	}
+	else if (iTarget == GL_SHADER_STORAGE_BUFFER)
+	{
+		wBases = mStorageBufferBases;
+	}
+
+	// glBindBufferBase also binds the generic binding point
+	int wSlot = BufferTargetSlot(iTarget);
+
+	if (!wBases || iIndex >= kMaxIndexedBindings)
+	{
+		Filter(false);
+		if (wSlot >= 0)
+		{
+			mBuffers[wSlot] = iBuffer;
+		}
+		glBindBufferBase(iTarget, iIndex, iBuffer);
+		return;
+	}
+
+	if (Filter(wBases[iIndex] == iBuffer && (wSlot < 0 || mBuffers[wSlot] == iBuffer)))
+	{
+		return;
+	}
+
+	wBases[iIndex] = iBuffer;
+	if (wSlot >= 0)
+	{
+		mBuffers[wSlot] = iBuffer;
+	}
+	glBindBufferBase(iTarget, iIndex, iBuffer);
+}
+
+void GLStateCache::ActiveTexture(GLuint iUnitIndex)
+{
+	if (mActiveTextureUnit != iUnitIndex)
+	{
+		mActiveTextureUnit = iUnitIndex;
+		glActiveTexture(GL_TEXTURE0 + iUnitIndex);
+	}
+}
+
+void GLStateCache::BindTexture(GLenum iTextureUnit, GLenum iTarget, GLuint iTexture)
+{
+	GLuint wUnitIndex = iTextureUnit - GL_TEXTURE0;
+	int wSlot = TextureTargetSlot(iTarget);
+
+	if (wUnitIndex >= kMaxTextureUnits || wSlot < 0)
+	{
+		Filter(false);
+		if (wUnitIndex < kMaxTextureUnits)
+		{
+			ActiveTexture(wUnitIndex);
+		}
+		else
+		{
+			mActiveTextureUnit = wUnitIndex;
+			glActiveTexture(iTextureUnit);
+		}
+		glBindTexture(iTarget, iTexture);
+		return;
+	}
+
+	if (Filter(mTextures[wUnitIndex][wSlot] == iTexture))
+	{
+		return;
+	}
+
+	ActiveTexture(wUnitIndex);
+	mTextures[wUnitIndex][wSlot] = iTexture;
+	glBindTexture(iTarget, iTexture);
+}
+
+void GLStateCache::BindSampler(GLenum iTextureUnit, GLuint iSampler)
+{
+	GLuint wUnitIndex = iTextureUnit - GL_TEXTURE0;
+	if (wUnitIndex >= kMaxTextureUnits)
+	{
+		Filter(false);
+		glBindSampler(wUnitIndex, iSampler);
+		return;
+	}
+
+	if (Filter(mSamplers[wUnitIndex] == iSampler))
+	{
+		return;
+	}
+
+	mSamplers[wUnitIndex] = iSampler;
+	glBindSampler(wUnitIndex, iSampler);
+}
+
+void GLStateCache::Viewport(GLint iX, GLint iY, GLsizei iWidth, GLsizei iHeight)
+{
+	if (Filter(mViewport[0] == iX && mViewport[1] == iY && mViewport[2] == iWidth && mViewport[3] == iHeight))
+	{
+		return;
+	}
+
+	mViewport[0] = iX;
+	mViewport[1] = iY;
+	mViewport[2] = iWidth;
+	mViewport[3] = iHeight;
+	glViewport(iX, iY, iWidth, iHeight);
+}
+
+void GLStateCache::ViewportArray(GLuint iFirst, GLsizei iCount, const GLfloat* iViewports)
+{
+	// Never filtered, only viewport 0 is shadowed
+	Filter(false);
+	if (iFirst == 0 && iCount > 0)
+	{
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			mViewport[i] = static_cast<GLint>(iViewports[i]);
+		}
+	}
+	glViewportArrayv(iFirst, iCount, iViewports);
+}
+
+void GLStateCache::Scissor(GLint iX, GLint iY, GLsizei iWidth, GLsizei iHeight)
+{
+	if (Filter(mScissor[0] == iX && mScissor[1] == iY && mScissor[2] == iWidth && mScissor[3] == iHeight))
+	{
+		return;
+	}
+
+	mScissor[0] = iX;
+	mScissor[1] = iY;
+	mScissor[2] = iWidth;
+	mScissor[3] = iHeight;
+	glScissor(iX, iY, iWidth, iHeight);
+}
+
+void GLStateCache::SetScissorTest(bool iEnable)
+{
+	SetCapability(GL_SCISSOR_TEST, iEnable, mScissorTest);
+}
+
+void GLStateCache::SetCapability(GLenum iCapability, bool iEnable, bool& ioState)
+{
+	if (Filter(ioState == iEnable))
+	{
+		return;
+	}
+
+	ioState = iEnable;
+	if (iEnable)
+	{
+		glEnable(iCapability);
+	}
+	else
+	{
+		glDisable(iCapability);
+	}
+}
+
+void GLStateCache::SetDepthTest(bool iEnable)
+{
+	SetCapability(GL_DEPTH_TEST, iEnable, mDepthTest);
+}
+
+void GLStateCache::SetDepthFunc(GLenum iFunc)
+{
+	if (Filter(mDepthFunc == iFunc))
+	{
+		return;
+	}
+
+	mDepthFunc = iFunc;
+	glDepthFunc(iFunc);
+}
+
+void GLStateCache::SetDepthMask(bool iEnable)
+{
+	if (Filter(mDepthMask == iEnable))
+	{
+		return;
+	}
+
+	mDepthMask = iEnable;
+	glDepthMask(iEnable ? GL_TRUE : GL_FALSE);
+}
+
+void GLStateCache::SetCullFace(bool iEnable)
+{
+	SetCapability(GL_CULL_FACE, iEnable, mCullFace);
+}
+
+void GLStateCache::SetCullFaceMode(GLenum iMode)
+{
+	if (Filter(mCullFaceMode == iMode))
+	{
+		return;
+	}
+
+	mCullFaceMode = iMode;
+	glCullFace(iMode);
+}
+
+void GLStateCache::SetFrontFace(GLenum iMode)
+{
+	if (Filter(mFrontFace == iMode))
+	{
+		return;
+	}
+
+	mFrontFace = iMode;
+	glFrontFace(iMode);
+}
+
+void GLStateCache::SetBlend(bool iEnable)
+{
+	SetCapability(GL_BLEND, iEnable, mBlend);
+}
+
+void GLStateCache::SetBlendFunc(GLenum iSrcFactor, GLenum iDstFactor)
+{
+	if (Filter(mBlendSrc == iSrcFactor && mBlendDst == iDstFactor))
+	{
+		return;
+	}
+
+	mBlendSrc = iSrcFactor;
+	mBlendDst = iDstFactor;
+	glBlendFunc(iSrcFactor, iDstFactor);
+}
+
+void GLStateCache::SetColorMask(bool iEnable)
+{
+	if (Filter(mColorMask == iEnable))
+	{
+		return;
+	}
+
+	mColorMask = iEnable;
+	GLboolean wMask = iEnable ? GL_TRUE : GL_FALSE;
+	glColorMask(wMask, wMask, wMask, wMask);
+}
+
+void GLStateCache::SetStencilTest(bool iEnable)
+{
+	SetCapability(GL_STENCIL_TEST, iEnable, mStencilTest);
+}
+
+void GLStateCache::SetStencilFunc(GLenum iFunc, GLint iRef, GLuint iMask)
+{
+	if (Filter(mStencilFunc == iFunc && mStencilRef == iRef && mStencilFuncMask == iMask))
+	{
+		return;
+	}
+
+	mStencilFunc = iFunc;
+	mStencilRef = iRef;
+	mStencilFuncMask = iMask;
+	glStencilFunc(iFunc, iRef, iMask);
+}
+
+void GLStateCache::SetStencilOpSeparate(GLenum iFace, GLenum iStencilFail, GLenum iDepthFail, GLenum iDepthPass)
+{
+	bool wFront = iFace == GL_FRONT || iFace == GL_FRONT_AND_BACK;
+	bool wBack = iFace == GL_BACK || iFace == GL_FRONT_AND_BACK;
+
+	auto wMatches = [&](uint32_t iFaceIdx)
+	{
+		return mStencilOps[iFaceIdx][0] == iStencilFail &&
+			mStencilOps[iFaceIdx][1] == iDepthFail &&
+			mStencilOps[iFaceIdx][2] == iDepthPass;
+	};
+
+	if (Filter((!wFront || wMatches(0)) && (!wBack || wMatches(1))))
+	{
+		return;
+	}
+
+	for (uint32_t wFaceIdx = 0; wFaceIdx < 2; wFaceIdx++)
+	{
+		if ((wFaceIdx == 0 && wFront) || (wFaceIdx == 1 && wBack))
+		{
+			mStencilOps[wFaceIdx][0] = iStencilFail;
+			mStencilOps[wFaceIdx][1] = iDepthFail;
+			mStencilOps[wFaceIdx][2] = iDepthPass;
+		}
+	}
+	glStencilOpSeparate(iFace, iStencilFail, iDepthFail, iDepthPass);
+}
+
+void GLStateCache::OnTextureDeleted(GLuint iTexture)
+{
+	// Deleting a bound texture reverts the binding to 0
+	for (uint32_t wUnit = 0; wUnit < kMaxTextureUnits; wUnit++)
+	{
+		for (uint32_t wSlot = 0; wSlot < kTextureTargetCount; wSlot++)
+		{
+			if (mTextures[wUnit][wSlot] == iTexture)
+			{
+				mTextures[wUnit][wSlot] = 0;
+			}
+		}
+	}
+}
+
+void GLStateCache::OnBufferDeleted(GLuint iBuffer)
+{
+	for (uint32_t i = 0; i < kBufferTargetCount; i++)
+	{
+		if (mBuffers[i] == iBuffer)
+		{
+			mBuffers[i] = 0;
+		}
+	}
+
+	for (uint32_t i = 0; i < kMaxIndexedBindings; i++)
+	{
+		if (mUniformBufferBases[i] == iBuffer)
+		{
+			mUniformBufferBases[i] = 0;
+		}
+		if (mStorageBufferBases[i] == iBuffer)
+		{
+			mStorageBufferBases[i] = 0;
+		}
+	}
+}
+
+void GLStateCache::OnVertexArrayDeleted(GLuint iVertexArray)
+{
+	if (mVertexArray == iVertexArray)
+	{
+		mVertexArray = 0;
+	}
+}
+
+void GLStateCache::OnFramebufferDeleted(GLuint iFramebuffer)
+{
+	if (mDrawFramebuffer == iFramebuffer)
+	{
+		mDrawFramebuffer = 0;
+	}
+	if (mReadFramebuffer == iFramebuffer)
+	{
+		mReadFramebuffer = 0;
+	}
+}
+
+void GLStateCache::OnProgramDeleted(GLuint iProgram)
+{
+	// A program in use stays current until another one is bound, force the next bind
+	if (mProgram == iProgram)
+	{
+		mProgram = 0xFFFFFFFF;
+	}
+}
+
+void GLStateCache::OnSamplerDeleted(GLuint iSampler)
+{
+	for (uint32_t i = 0; i < kMaxTextureUnits; i++)
+	{
+		if (mSamplers[i] == iSampler)
+		{
+			mSamplers[i] = 0;
+		}
+	}
+}
+
+void GLStateCache::BeginFrame()
+{
+	mFrameStats = Stats();
+}
+
+int GLStateCache::TextureTargetSlot(GLenum iTarget)
+{
+	switch (iTarget)
+	{
+	case GL_TEXTURE_2D:
+		return 0;
+	case GL_TEXTURE_CUBE_MAP:
+		return 1;
+	case GL_TEXTURE_2D_ARRAY:
+		return 2;
+	case GL_TEXTURE_CUBE_MAP_ARRAY:
+		return 3;
+	default:
+		return -1;
+	}
+}
+
+int GLStateCache::BufferTargetSlot(GLenum iTarget)
+{
+	switch (iTarget)
+	{
+	case GL_ARRAY_BUFFER:
+		return 0;
+	case GL_UNIFORM_BUFFER:
+		return 1;
+	case GL_SHADER_STORAGE_BUFFER:
+		return 2;
+	case GL_PIXEL_UNPACK_BUFFER:
+		return 3;
+	case GL_PIXEL_PACK_BUFFER:
+		return 4;
+	case GL_DRAW_INDIRECT_BUFFER:
+		return 5;
+	default:
+		return -1;
+	}
+}
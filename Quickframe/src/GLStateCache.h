@@ -0,0 +1,180 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h>
+
+/**
+ * @brief : Singleton shadowing the OpenGL context state.
+ * Every state change of the renderer goes through it, so redundant calls are dropped
+ * and the current state can be read back without querying the driver (glGet* stalls).
+ * Must only be used from the thread owning the GL context.
+*/
+class GLStateCache
+{
+public:
+	struct Stats
+	{
+		uint64_t IssuedCalls = 0;		// State calls forwarded to the driver
+		uint64_t FilteredCalls = 0;	// Redundant state calls dropped by the cache
+	};
+
+	GLStateCache(GLStateCache& iOther) = delete;
+	void operator=(const GLStateCache&) = delete;
+
+	static GLStateCache* GetInstance();
+
+	/**
+	 * @brief : Forget everything and resynchronize the shadow state with the GL defaults
+	 * Use it after code that changed the GL state without going through the cache
+	*/
+	void Reset();
+
+	// Objects bindings
+	void UseProgram(GLuint iProgram);
+	void BindVertexArray(GLuint iVertexArray);
+	void BindFramebuffer(GLenum iTarget, GLuint iFramebuffer);
+	void BindBuffer(GLenum iTarget, GLuint iBuffer);
+	void BindBufferBase(GLenum iTarget, GLuint iIndex, GLuint iBuffer);
+
+	/**
+	 * @brief : Bind a texture object to a texture unit
+	 * @param iTextureUnit : Texture unit as GL_TEXTUREi
+	 * @param iTarget : Texture target (GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP ...)
+	 * @param iTexture : Texture handle
+	*/
+	void BindTexture(GLenum iTextureUnit, GLenum iTarget, GLuint iTexture);
+	void BindSampler(GLenum iTextureUnit, GLuint iSampler);
+
+	// Fixed function states
+	void Viewport(GLint iX, GLint iY, GLsizei iWidth, GLsizei iHeight);
+	void Scissor(GLint iX, GLint iY, GLsizei iWidth, GLsizei iHeight);
+
+	/**
+	 * @brief : glViewportArrayv, iViewports holds x, y, width, height per viewport. Viewport 0 is shadowed by Viewport()
+	*/
+	void ViewportArray(GLuint iFirst, GLsizei iCount, const GLfloat* iViewports);
+	void SetScissorTest(bool iEnable);
+	void SetDepthTest(bool iEnable);
+	void SetDepthFunc(GLenum iFunc);
+	void SetDepthMask(bool iEnable);
+	void SetCullFace(bool iEnable);
+	void SetCullFaceMode(GLenum iMode);
+	void SetFrontFace(GLenum iMode);
+	void SetBlend(bool iEnable);
+	void SetBlendFunc(GLenum iSrcFactor, GLenum iDstFactor);
+	void SetColorMask(bool iEnable);
+	void SetStencilTest(bool iEnable);
+	void SetStencilFunc(GLenum iFunc, GLint iRef, GLuint iMask);
+
+	/**
+	 * @brief : glStencilOpSeparate, iFace is GL_FRONT, GL_BACK or GL_FRONT_AND_BACK
+	*/
+	void SetStencilOpSeparate(GLenum iFace, GLenum iStencilFail, GLenum iDepthFail, GLenum iDepthPass);
+
+	// Shadowed state getters, never query the driver
+	GLuint GetProgram() const { return mProgram; }
+	GLuint GetVertexArray() const { return mVertexArray; }
+	GLuint GetDrawFramebuffer() const { return mDrawFramebuffer; }
+	GLenum GetDepthFunc() const { return mDepthFunc; }
+	GLenum GetCullFaceMode() const { return mCullFaceMode; }
+	bool IsDepthMaskEnabled() const { return mDepthMask; }
+
+	// Must be called when a GL object is deleted, as handles are recycled by the driver
+	void OnTextureDeleted(GLuint iTexture);
+	void OnBufferDeleted(GLuint iBuffer);
+	void OnVertexArrayDeleted(GLuint iVertexArray);
+	void OnFramebufferDeleted(GLuint iFramebuffer);
+	void OnProgramDeleted(GLuint iProgram);
+	void OnSamplerDeleted(GLuint iSampler);
+
+	/**
+	 * @brief : Reset the per frame counters, called once at the beginning of a frame
+	*/
+	void BeginFrame();
+
+	const Stats& GetFrameStats() const { return mFrameStats; }
+	const Stats& GetTotalStats() const { return mTotalStats; }
+
+private:
+	GLStateCache();
+
+	/**
+	 * @brief : Returns the slot of a texture target in mTextures, or -1 if the target isn't shadowed
+	*/
+	static int TextureTargetSlot(GLenum iTarget);
+
+	/**
+	 * @brief : Returns the slot of a buffer target in mBuffers, or -1 if the target isn't shadowed
+	 * GL_ELEMENT_ARRAY_BUFFER is part of the VAO state and is never shadowed
+	*/
+	static int BufferTargetSlot(GLenum iTarget);
+
+	void SetCapability(GLenum iCapability, bool iEnable, bool& ioState);
+	void ActiveTexture(GLuint iUnitIndex);
+
+	bool Filter(bool iRedundant);
+
+	static GLStateCache* mStateCache;
+
+	static constexpr uint32_t kMaxTextureUnits = 32;
+	static constexpr uint32_t kTextureTargetCount = 4;
+	static constexpr uint32_t kBufferTargetCount = 6;
+	static constexpr uint32_t kMaxIndexedBindings = 16;
+
+	GLuint mProgram = 0;
+	GLuint mVertexArray = 0;
+	GLuint mDrawFramebuffer = 0;
+	GLuint mReadFramebuffer = 0;
+	GLuint mActiveTextureUnit = 0;
+	GLuint mTextures[kMaxTextureUnits][kTextureTargetCount] = { {0} };
+	GLuint mSamplers[kMaxTextureUnits] = { 0 };
+	GLuint mBuffers[kBufferTargetCount] = { 0 };
+	GLuint mUniformBufferBases[kMaxIndexedBindings] = { 0 };
+	GLuint mStorageBufferBases[kMaxIndexedBindings] = { 0 };
+
+	GLint mViewport[4] = { -1, -1, -1, -1 };
+	GLint mScissor[4] = { -1, -1, -1, -1 };
+	bool mScissorTest = false;
+	bool mDepthTest = false;
+	GLenum mDepthFunc = GL_LESS;
+	bool mDepthMask = true;
+	bool mCullFace = false;
+	GLenum mCullFaceMode = GL_BACK;
+	GLenum mFrontFace = GL_CCW;
+	bool mBlend = false;
+	GLenum mBlendSrc = GL_ONE;
+	GLenum mBlendDst = GL_ZERO;
+	bool mColorMask = true;
+	bool mStencilTest = false;
+	GLenum mStencilFunc = GL_ALWAYS;
+	GLint mStencilRef = 0;
+	GLuint mStencilFuncMask = 0xFFFFFFFF;
+	GLenum mStencilOps[2][3] = { { GL_KEEP, GL_KEEP, GL_KEEP }, { GL_KEEP, GL_KEEP, GL_KEEP } };	// Front, Back
+
+	Stats mFrameStats;
+	Stats mTotalStats;
+};
@@ -0,0 +1,85 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "GPUBuffer.h"
+#include "GLStateCache.h"
+
+GPUBuffer::GPUBuffer(GLenum iTarget, GLenum iUsage)
+	:mTarget(iTarget),
+	mUsage(iUsage)
+{
+	glGenBuffers(1, &mBufferHandle);
+}
+
+GPUBuffer::~GPUBuffer()
+{
+	if (mBufferHandle)
+	{
+		GLStateCache::GetInstance()->OnBufferDeleted(mBufferHandle);
+		glDeleteBuffers(1, &mBufferHandle);
+	}
+}
+
+void GPUBuffer::Allocate(GLsizeiptr iSize, const void* iData)
+{
+	Bind();
+	glBufferData(mTarget, iSize, iData, mUsage);
+	mSize = iSize;
+}
+
+void GPUBuffer::Upload(const void* iData, GLsizeiptr iSize, GLintptr iOffset)
+{
+	if (iSize <= 0)
+	{
+		return;
+	}
+
+	if (iOffset + iSize > mSize)
+	{
+		// Grow by half to amortize reallocations
+		GLsizeiptr wNewSize = iOffset + iSize;
+		wNewSize += wNewSize / 2;
+		Allocate(wNewSize);
+	}
+
+	Bind();
+	glBufferSubData(mTarget, iOffset, iSize, iData);
+}
+
+void GPUBuffer::Clear()
+{
+	Bind();
+	GLuint wZero = 0;
+	glClearBufferData(mTarget, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &wZero);
+}
+
+void GPUBuffer::BindBase(GLuint iIndex)
+{
+	GLStateCache::GetInstance()->BindBufferBase(mTarget, iIndex, mBufferHandle);
+}
+
+void GPUBuffer::Bind()
+{
+	GLStateCache::GetInstance()->BindBuffer(mTarget, mBufferHandle);
+}
@@ -0,0 +1,73 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <glad/glad.h>
+
+/**
+ * @brief : Generic GPU buffer object (SSBO, UBO, draw indirect ...)
+ * Storage is mutable and grows on upload when the data doesn't fit.
+*/
+class GPUBuffer
+{
+public:
+	GPUBuffer(GLenum iTarget, GLenum iUsage = GL_DYNAMIC_DRAW);
+	~GPUBuffer();
+
+	GPUBuffer(const GPUBuffer&) = delete;
+	GPUBuffer& operator=(const GPUBuffer&) = delete;
+
+	/**
+	 * @brief : (Re)allocate the buffer storage, previous content is lost
+	 * @param iData : Initial content, can be null
+	*/
+	void Allocate(GLsizeiptr iSize, const void* iData = nullptr);
+
+	/**
+	 * @brief : Write iSize bytes at iOffset, the storage is reallocated if too small
+	*/
+	void Upload(const void* iData, GLsizeiptr iSize, GLintptr iOffset = 0);
+
+	/**
+	 * @brief : Fill the whole buffer with zeros
+	*/
+	void Clear();
+
+	/**
+	 * @brief : Bind the buffer to an indexed binding point (layout(binding = iIndex) in shaders)
+	*/
+	void BindBase(GLuint iIndex);
+
+	void Bind();
+
+	GLuint GetHandle() const { return mBufferHandle; }
+	GLsizeiptr GetSize() const { return mSize; }
+
+private:
+	GLuint mBufferHandle = 0;
+	GLenum mTarget;
+	GLenum mUsage;
+	GLsizeiptr mSize = 0;
+};
@@ -0,0 +1,1040 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <spdlog/spdlog.h>
+
+#include "GltfImporter.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+using namespace std::chrono;
+
+namespace
+{
+	constexpr uint32_t kGlbMagic = 0x46546C67;		// "glTF"
+	constexpr uint32_t kGlbChunkJson = 0x4E4F534A;
+	constexpr uint32_t kGlbChunkBin = 0x004E4942;
+	constexpr size_t kGlbHeaderSize = 12;
+	constexpr size_t kGlbChunkHeaderSize = 8;
+
+	enum EComponentType : uint32_t
+	{
+		eByte = 5120,
+		eUnsignedByte = 5121,
+		eShort = 5122,
+		eUnsignedShort = 5123,
+		eUnsignedInt = 5125,
+		eFloat = 5126
+	};
+
+	constexpr uint32_t kModeTriangles = 4;
+
+	uint32_t ReadU32(const uint8_t* iData)
+	{
+		uint32_t wValue;
+		std::memcpy(&wValue, iData, sizeof(wValue));
+		return wValue;
+	}
+
+	uint32_t GetComponentSize(uint32_t iComponentType)
+	{
+		switch (iComponentType)
+		{
+		case eByte:
+		case eUnsignedByte:
+			return 1;
+		case eShort:
+		case eUnsignedShort:
+			return 2;
+		case eUnsignedInt:
+		case eFloat:
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+	uint32_t GetComponentCount(const std::string& iType)
+	{
+		static const std::pair<const char*, uint32_t> kTypes[] = { { "SCALAR", 1 }, { "VEC2", 2 }, { "VEC3", 3 }, { "VEC4", 4 },
+			{ "MAT2", 4 }, { "MAT3", 9 }, { "MAT4", 16 } };
+		for (const auto& wType : kTypes)
+		{
+			if (iType == wType.first)
+			{
+				return wType.second;
+			}
+		}
+		return 0;
+	}
+
+	/**
+	 * @brief : Component as a float, normalized integers are mapped to [0, 1] or [-1, 1] as KHR_mesh_quantization specifies
+	*/
+	float ReadComponent(const uint8_t* iData, uint32_t iComponentType, bool iNormalized)
+	{
+		switch (iComponentType)
+		{
+		case eByte:
+		{
+			const float wValue = static_cast<float>(static_cast<int8_t>(*iData));
+			return iNormalized ? std::max(wValue / 127.f, -1.f) : wValue;
+		}
+		case eUnsignedByte:
+			return iNormalized ? *iData / 255.f : static_cast<float>(*iData);
+		case eShort:
+		{
+			int16_t wValue;
+			std::memcpy(&wValue, iData, sizeof(wValue));
+			return iNormalized ? std::max(wValue / 32767.f, -1.f) : static_cast<float>(wValue);
+		}
+		case eUnsignedShort:
+		{
+			uint16_t wValue;
+			std::memcpy(&wValue, iData, sizeof(wValue));
+			return iNormalized ? wValue / 65535.f : static_cast<float>(wValue);
+		}
+		case eUnsignedInt:
+			return static_cast<float>(ReadU32(iData));
+		default:
+		{
+			float wValue;
+			std::memcpy(&wValue, iData, sizeof(wValue));
+			return wValue;
+		}
+		}
+	}
+
+	uint32_t ReadIndex(const uint8_t* iData, uint32_t iComponentType)
+	{
+		switch (iComponentType)
+		{
+		case eUnsignedByte:
+			return *iData;
+		case eUnsignedShort:
+		{
+			uint16_t wValue;
+			std::memcpy(&wValue, iData, sizeof(wValue));
+			return wValue;
+		}
+		default:
+			return ReadU32(iData);
+		}
+	}
+
+	std::string GetDirectory(const std::string& iPath)
+	{
+		const size_t wSlash = iPath.find_last_of("/\\");
+		return wSlash == std::string::npos ? std::string(".") : iPath.substr(0, wSlash);
+	}
+
+	/**
+	 * @brief : Uris are percent encoded, spaces in file names come as %20
+	*/
+	std::string DecodeUri(const std::string& iUri)
+	{
+		std::string wDecoded;
+		wDecoded.reserve(iUri.size());
+		for (size_t i = 0; i < iUri.size(); i++)
+		{
+			if (iUri[i] == '%' && i + 2 < iUri.size() && std::isxdigit(static_cast<unsigned char>(iUri[i + 1])) &&
+				std::isxdigit(static_cast<unsigned char>(iUri[i + 2])))
+			{
+				wDecoded += static_cast<char>(std::stoi(iUri.substr(i + 1, 2), nullptr, 16));
+				i += 2;
+			}
+			else
+			{
+				wDecoded += iUri[i];
+			}
+		}
+		return wDecoded;
+	}
+
+	/**
+	 * @return Bytes written to oData, which must hold 3/4 of the input
+	*/
+	size_t DecodeBase64(const char* iText, size_t iSize, uint8_t* oData)
+	{
+		uint32_t wBits = 0;
+		uint32_t wBitCount = 0;
+		size_t wSize = 0;
+		for (size_t i = 0; i < iSize; i++)
+		{
+			const char wChar = iText[i];
+			uint32_t wValue = 0;
+			if (wChar >= 'A' && wChar <= 'Z')
+			{
+				wValue = wChar - 'A';
+			}
+			else if (wChar >= 'a' && wChar <= 'z')
+			{
+				wValue = wChar - 'a' + 26;
+			}
+			else if (wChar >= '0' && wChar <= '9')
+			{
+				wValue = wChar - '0' + 52;
+			}
+			else if (wChar == '+' || wChar == '-')
+			{
+				wValue = 62;
+			}
+			else if (wChar == '/' || wChar == '_')
+			{
+				wValue = 63;
+			}
+			else
+			{
+				// Padding and line breaks
+				continue;
+			}
+
+			wBits = (wBits << 6) | wValue;
+			wBitCount += 6;
+			if (wBitCount >= 8)
+			{
+				wBitCount -= 8;
+				oData[wSize++] = static_cast<uint8_t>(wBits >> wBitCount);
+			}
+		}
+		return wSize;
+	}
+
+	glm::mat4 GetLocalTransform(const JsonValue& iNode)
+	{
+		const JsonValue& wMatrix = iNode["matrix"];
+		if (wMatrix.IsArray() && wMatrix.Size() == 16)
+		{
+			float wValues[16];
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				wValues[i] = static_cast<float>(wMatrix[i].GetNumber());
+			}
+			// Column major, like glm
+			return glm::make_mat4(wValues);
+		}
+
+		const JsonValue& wTranslation = iNode["translation"];
+		const JsonValue& wRotation = iNode["rotation"];
+		const JsonValue& wScale = iNode["scale"];
+		const glm::vec3 wT(wTranslation[size_t(0)].GetNumber(0.0), wTranslation[1].GetNumber(0.0), wTranslation[2].GetNumber(0.0));
+		const glm::quat wR(static_cast<float>(wRotation[3].GetNumber(1.0)), static_cast<float>(wRotation[size_t(0)].GetNumber(0.0)),
+			static_cast<float>(wRotation[1].GetNumber(0.0)), static_cast<float>(wRotation[2].GetNumber(0.0)));
+		const glm::vec3 wS(wScale[size_t(0)].GetNumber(1.0), wScale[1].GetNumber(1.0), wScale[2].GetNumber(1.0));
+
+		return glm::translate(glm::mat4(1.f), wT) * glm::mat4_cast(wR) * glm::scale(glm::mat4(1.f), wS);
+	}
+
+	template<typename T>
+	T* AllocateStream(std::vector<std::vector<uint8_t>>& oBuffers, size_t iCount)
+	{
+		oBuffers.emplace_back(iCount * sizeof(T));
+		return reinterpret_cast<T*>(oBuffers.back().data());
+	}
+}
+
+bool GltfImporter::Import(const std::string& iPath, MeshData& oData)
+{
+	auto wClockStart = high_resolution_clock::now();
+
+	Document wDocument;
+	if (!LoadDocument(iPath, wDocument, oData))
+	{
+		return false;
+	}
+
+	ImportMaterials(wDocument, oData);
+
+	// Scene roots, every parentless node when the file has no scene
+	const JsonValue& wNodes = wDocument.Json["nodes"];
+	std::vector<uint32_t> wRoots;
+	const JsonValue& wScene = wDocument.Json["scenes"][static_cast<size_t>(wDocument.Json["scene"].GetInt(0))];
+	if (wScene.IsObject())
+	{
+		for (const JsonValue& wNode : wScene["nodes"].GetElements())
+		{
+			if (wNode.GetInt(-1) >= 0 && wNode.GetInt(-1) < static_cast<int64_t>(wNodes.Size()))
+			{
+				wRoots.push_back(static_cast<uint32_t>(wNode.GetInt()));
+			}
+		}
+	}
+	else
+	{
+		std::vector<bool> wIsChild(wNodes.Size(), false);
+		for (const JsonValue& wNode : wNodes.GetElements())
+		{
+			for (const JsonValue& wChild : wNode["children"].GetElements())
+			{
+				if (wChild.GetInt(-1) >= 0 && wChild.GetInt(-1) < static_cast<int64_t>(wNodes.Size()))
+				{
+					wIsChild[static_cast<size_t>(wChild.GetInt())] = true;
+				}
+			}
+		}
+		for (uint32_t i = 0; i < wNodes.Size(); i++)
+		{
+			if (!wIsChild[i])
+			{
+				wRoots.push_back(i);
+			}
+		}
+	}
+
+	MeshData::Node wRoot;
+	wRoot.ChildCount = static_cast<uint32_t>(wRoots.size());
+	oData.Nodes.push_back(wRoot);
+
+	std::vector<PrimitiveJob> wJobs;
+	std::vector<bool> wVisiting(wNodes.Size(), false);
+	uint32_t wDefaultMaterial = UINT32_MAX;
+	for (uint32_t wNode : wRoots)
+	{
+		wVisiting[wNode] = true;
+		ImportNode(wDocument, wNode, glm::mat4(1.f), 1, wVisiting, oData, wJobs, wDefaultMaterial);
+		wVisiting[wNode] = false;
+	}
+
+	if (wJobs.empty())
+	{
+		spdlog::critical("\tError while parsing mesh {0:s} : no triangle primitive", iPath);
+		return false;
+	}
+
+	std::vector<std::vector<std::vector<uint8_t>>> wBuffers(wJobs.size());
+	std::vector<uint32_t> wInPlaceStreams(wJobs.size(), 0);
+	ThreadPool::GetInstance()->ParallelFor(static_cast<uint32_t>(wJobs.size()),
+		[&](uint32_t iBegin, uint32_t iEnd, uint32_t)
+		{
+			for (uint32_t i = iBegin; i < iEnd; i++)
+			{
+				BuildSubmesh(wDocument, wJobs[i], oData.Submeshes[wJobs[i].Submesh], wBuffers[i], wInPlaceStreams[i]);
+			}
+		});
+
+	// Moving the buffers keeps their storage, the stream pointers stay valid
+	uint32_t wInPlaceCount = 0;
+	for (size_t i = 0; i < wBuffers.size(); i++)
+	{
+		for (std::vector<uint8_t>& wBuffer : wBuffers[i])
+		{
+			oData.Buffers.push_back(std::move(wBuffer));
+		}
+		wInPlaceCount += wInPlaceStreams[i];
+	}
+
+	for (const MeshData::Submesh& wSubmesh : oData.Submeshes)
+	{
+		const glm::vec3* wPositions = static_cast<const glm::vec3*>(wSubmesh.Streams[SubMesh::ePosition]);
+		for (uint32_t v = 0; v < wSubmesh.VertexCount; v++)
+		{
+			oData.BoundsMin = glm::min(oData.BoundsMin, wPositions[v]);
+			oData.BoundsMax = glm::max(oData.BoundsMax, wPositions[v]);
+		}
+		oData.VertexCount += wSubmesh.VertexCount;
+		oData.IndexCount += wSubmesh.IndexCount;
+	}
+
+	auto wClockStop = high_resolution_clock::now();
+	spdlog::info("\tglTF {0:s} : {1:d} submeshes, {2:d} streams read in place, in {3:d} ms", iPath, oData.Submeshes.size(),
+		wInPlaceCount, duration_cast<milliseconds>(wClockStop - wClockStart).count());
+
+	return true;
+}
+
+bool GltfImporter::LoadDocument(const std::string& iPath, Document& oDocument, MeshData& oData)
+{
+	std::unique_ptr<MappedFile> wFile = std::make_unique<MappedFile>();
+	if (!wFile->Open(iPath))
+	{
+		spdlog::critical("\tError while parsing mesh {0:s} : can't open the file", iPath);
+		return false;
+	}
+
+	oDocument.Path = iPath;
+	const uint8_t* wData = wFile->GetData();
+	const size_t wSize = wFile->GetSize();
+	const char* wJson = reinterpret_cast<const char*>(wData);
+	size_t wJsonSize = wSize;
+	const uint8_t* wBin = nullptr;
+	size_t wBinSize = 0;
+
+	const bool wIsBinary = wSize >= kGlbHeaderSize && ReadU32(wData) == kGlbMagic;
+	if (wIsBinary)
+	{
+		// Header, JSON chunk then an optional BIN chunk, each chunk is 4 bytes aligned
+		const size_t wLength = std::min<size_t>(ReadU32(wData + 8), wSize);
+		if (ReadU32(wData + 4) != 2 || wLength < kGlbHeaderSize + kGlbChunkHeaderSize ||
+			ReadU32(wData + kGlbHeaderSize + 4) != kGlbChunkJson)
+		{
+			spdlog::critical("\tError while parsing mesh {0:s} : invalid GLB header", iPath);
+			return false;
+		}
+
+		const size_t wJsonOffset = kGlbHeaderSize + kGlbChunkHeaderSize;
+		wJsonSize = ReadU32(wData + kGlbHeaderSize);
+		if (wJsonSize > wLength - wJsonOffset)
+		{
+			spdlog::critical("\tError while parsing mesh {0:s} : truncated GLB JSON chunk", iPath);
+			return false;
+		}
+		wJson = reinterpret_cast<const char*>(wData + wJsonOffset);
+
+		const size_t wBinOffset = wJsonOffset + ((wJsonSize + 3) & ~size_t(3));
+		if (wBinOffset + kGlbChunkHeaderSize <= wLength && ReadU32(wData + wBinOffset + 4) == kGlbChunkBin)
+		{
+			wBin = wData + wBinOffset + kGlbChunkHeaderSize;
+			wBinSize = std::min<size_t>(ReadU32(wData + wBinOffset), wLength - wBinOffset - kGlbChunkHeaderSize);
+		}
+	}
+
+	std::string wError;
+	if (!JsonValue::Parse(wJson, wJsonSize, oDocument.Json, wError))
+	{
+		spdlog::critical("\tError while parsing mesh {0:s} : {1:s}", iPath, wError);
+		return false;
+	}
+
+	if (oDocument.Json["asset"]["version"].GetString().compare(0, 1, "2") != 0)
+	{
+		spdlog::critical("\tError while parsing mesh {0:s} : only glTF 2.0 is supported", iPath);
+		return false;
+	}
+
+	// Optional extensions degrade gracefully, required ones must be understood
+	for (const JsonValue& wExtension : oDocument.Json["extensionsRequired"].GetElements())
+	{
+		if (wExtension.GetString() != "KHR_mesh_quantization")
+		{
+			spdlog::critical("\tError while parsing mesh {0:s} : required extension {1:s} is not supported", iPath, wExtension.GetString());
+			return false;
+		}
+	}
+
+	if (!LoadBuffers(GetDirectory(iPath), wBin, wBinSize, oDocument, oData))
+	{
+		return false;
+	}
+
+	// The BIN chunk is referenced by the streams, the mapping lives as long as the MeshData
+	if (wIsBinary)
+	{
+		oData.Mappings.push_back(std::move(wFile));
+	}
+	return true;
+}
+
+bool GltfImporter::LoadBuffers(const std::string& iDirectory, const uint8_t* iBinChunk, size_t iBinSize, Document& ioDocument, MeshData& oData)
+{
+	const JsonValue& wBuffers = ioDocument.Json["buffers"];
+	ioDocument.Buffers.assign(wBuffers.Size(), nullptr);
+	ioDocument.BufferSizes.assign(wBuffers.Size(), 0);
+
+	for (uint32_t i = 0; i < wBuffers.Size(); i++)
+	{
+		const JsonValue& wBuffer = wBuffers[i];
+		const size_t wByteLength = static_cast<size_t>(std::max<int64_t>(0, wBuffer["byteLength"].GetInt()));
+		const std::string& wUri = wBuffer["uri"].GetString();
+
+		if (wUri.empty())
+		{
+			// The BIN chunk, or the placeholder of a meshopt fallback which is never read
+			if (i == 0 && iBinChunk && wByteLength <= iBinSize)
+			{
+				ioDocument.Buffers[i] = iBinChunk;
+				ioDocument.BufferSizes[i] = wByteLength;
+			}
+			continue;
+		}
+
+		if (wUri.compare(0, 5, "data:") == 0)
+		{
+			const size_t wPayload = wUri.find(";base64,");
+			if (wPayload == std::string::npos)
+			{
+				spdlog::critical("\tError while parsing mesh {0:s} : buffer {1:d} has an unsupported data uri", ioDocument.Path, i);
+				return false;
+			}
+
+			const size_t wEncodedSize = wUri.size() - wPayload - 8;
+			uint8_t* wDecoded = static_cast<uint8_t*>(oData.Allocate(wEncodedSize / 4 * 3 + 3));
+			const size_t wDecodedSize = DecodeBase64(wUri.data() + wPayload + 8, wEncodedSize, wDecoded);
+			if (wDecodedSize < wByteLength)
+			{
+				spdlog::critical("\tError while parsing mesh {0:s} : buffer {1:d} is truncated", ioDocument.Path, i);
+				return false;
+			}
+			ioDocument.Buffers[i] = wDecoded;
+			ioDocument.BufferSizes[i] = wByteLength;
+			continue;
+		}
+
+		std::unique_ptr<MappedFile> wFile = std::make_unique<MappedFile>();
+		const std::string wPath = iDirectory + "/" + DecodeUri(wUri);
+		if (!wFile->Open(wPath) || wFile->GetSize() < wByteLength)
+		{
+			spdlog::critical("\tError while parsing mesh {0:s} : can't read buffer {1:s}", ioDocument.Path, wPath);
+			return false;
+		}
+		ioDocument.Buffers[i] = wFile->GetData();
+		ioDocument.BufferSizes[i] = wByteLength;
+		oData.Mappings.push_back(std::move(wFile));
+	}
+
+	return true;
+}
+
+const uint8_t* GltfImporter::GetBufferView(const Document& iDocument, int64_t iView, size_t& oSize, uint32_t& oStride)
+{
+	const JsonValue& wView = iDocument.Json["bufferViews"][static_cast<size_t>(std::max<int64_t>(0, iView))];
+	if (iView < 0 || !wView.IsObject())
+	{
+		return nullptr;
+	}
+
+	const int64_t wBuffer = wView["buffer"].GetInt(-1);
+	if (wBuffer < 0 || wBuffer >= static_cast<int64_t>(iDocument.Buffers.size()))
+	{
+		return nullptr;
+	}
+
+	const uint8_t* wData = iDocument.Buffers[static_cast<size_t>(wBuffer)];
+	if (!wData)
+	{
+		if (wView["extensions"].Has("EXT_meshopt_compression"))
+		{
+			spdlog::critical("\tError while parsing mesh {0:s} : buffer view {1:d} is only available compressed with EXT_meshopt_compression",
+				iDocument.Path, iView);
+		}
+		return nullptr;
+	}
+
+	const int64_t wOffset = wView["byteOffset"].GetInt(0);
+	const int64_t wLength = wView["byteLength"].GetInt(0);
+	if (wOffset < 0 || wLength < 0 || static_cast<uint64_t>(wOffset + wLength) > iDocument.BufferSizes[static_cast<size_t>(wBuffer)])
+	{
+		return nullptr;
+	}
+
+	oSize = static_cast<size_t>(wLength);
+	oStride = static_cast<uint32_t>(std::max<int64_t>(0, wView["byteStride"].GetInt(0)));
+	return wData + wOffset;
+}
+
+bool GltfImporter::GetAccessor(const Document& iDocument, const JsonValue& iIndex, Accessor& oAccessor)
+{
+	const JsonValue& wAccessor = iDocument.Json["accessors"][static_cast<size_t>(std::max<int64_t>(0, iIndex.GetInt(-1)))];
+	if (!iIndex.IsNumber() || iIndex.GetInt(-1) < 0 || !wAccessor.IsObject())
+	{
+		return false;
+	}
+
+	const int64_t wCount = wAccessor["count"].GetInt(0);
+	oAccessor.ComponentType = static_cast<uint32_t>(wAccessor["componentType"].GetInt(0));
+	oAccessor.ComponentCount = GetComponentCount(wAccessor["type"].GetString());
+	oAccessor.Normalized = wAccessor["normalized"].GetBool(false);
+	oAccessor.Sparse = wAccessor.Has("sparse") ? &wAccessor["sparse"] : nullptr;
+	const uint32_t wElementSize = GetComponentSize(oAccessor.ComponentType) * oAccessor.ComponentCount;
+	if (wCount <= 0 || wCount > INT32_MAX || wElementSize == 0)
+	{
+		return false;
+	}
+	oAccessor.Count = static_cast<uint32_t>(wCount);
+
+	oAccessor.Data = nullptr;
+	oAccessor.Stride = wElementSize;
+	if (!wAccessor.Has("bufferView"))
+	{
+		return true;
+	}
+
+	size_t wViewSize = 0;
+	uint32_t wViewStride = 0;
+	const uint8_t* wView = GetBufferView(iDocument, wAccessor["bufferView"].GetInt(-1), wViewSize, wViewStride);
+	const int64_t wOffset = wAccessor["byteOffset"].GetInt(0);
+	oAccessor.Stride = wViewStride ? wViewStride : wElementSize;
+	if (!wView || wOffset < 0 || oAccessor.Stride < wElementSize ||
+		static_cast<uint64_t>(wOffset) + uint64_t(oAccessor.Stride) * (oAccessor.Count - 1) + wElementSize > wViewSize)
+	{
+		return false;
+	}
+
+	oAccessor.Data = wView + wOffset;
+	return true;
+}
+
+bool GltfImporter::ReadFloats(const Document& iDocument, const Accessor& iAccessor, uint32_t iComponentCount, float iFill, float* oValues)
+{
+	const uint32_t wComponentSize = GetComponentSize(iAccessor.ComponentType);
+	const uint32_t wCopied = std::min(iComponentCount, iAccessor.ComponentCount);
+
+	if (!iAccessor.Data)
+	{
+		for (uint32_t i = 0; i < iAccessor.Count; i++)
+		{
+			for (uint32_t c = 0; c < iComponentCount; c++)
+			{
+				oValues[size_t(i) * iComponentCount + c] = c < wCopied ? 0.f : iFill;
+			}
+		}
+	}
+	else if (iAccessor.ComponentType == eFloat && iAccessor.ComponentCount == iComponentCount && iAccessor.Stride == iComponentCount * sizeof(float))
+	{
+		std::memcpy(oValues, iAccessor.Data, size_t(iAccessor.Count) * iAccessor.Stride);
+	}
+	else
+	{
+		for (uint32_t i = 0; i < iAccessor.Count; i++)
+		{
+			const uint8_t* wElement = iAccessor.Data + size_t(i) * iAccessor.Stride;
+			for (uint32_t c = 0; c < iComponentCount; c++)
+			{
+				oValues[size_t(i) * iComponentCount + c] = c < wCopied ?
+					ReadComponent(wElement + c * wComponentSize, iAccessor.ComponentType, iAccessor.Normalized) : iFill;
+			}
+		}
+	}
+
+	if (!iAccessor.Sparse)
+	{
+		return true;
+	}
+
+	// Sparse elements replace the ones of the buffer view
+	const JsonValue& wSparse = *iAccessor.Sparse;
+	const int64_t wCount = wSparse["count"].GetInt(0);
+	const uint32_t wIndexType = static_cast<uint32_t>(wSparse["indices"]["componentType"].GetInt(0));
+	const uint32_t wIndexSize = GetComponentSize(wIndexType);
+	const uint32_t wElementSize = wComponentSize * iAccessor.ComponentCount;
+
+	size_t wIndicesSize = 0;
+	size_t wValuesSize = 0;
+	uint32_t wUnusedStride = 0;
+	const uint8_t* wIndices = GetBufferView(iDocument, wSparse["indices"]["bufferView"].GetInt(-1), wIndicesSize, wUnusedStride);
+	const uint8_t* wValues = GetBufferView(iDocument, wSparse["values"]["bufferView"].GetInt(-1), wValuesSize, wUnusedStride);
+	const int64_t wIndicesOffset = wSparse["indices"]["byteOffset"].GetInt(0);
+	const int64_t wValuesOffset = wSparse["values"]["byteOffset"].GetInt(0);
+	if (!wIndices || !wValues || wCount < 0 || wIndexSize == 0 || wIndexType == eByte || wIndexType == eShort || wIndicesOffset < 0 ||
+		wValuesOffset < 0 || uint64_t(wIndicesOffset) + uint64_t(wCount) * wIndexSize > wIndicesSize ||
+		uint64_t(wValuesOffset) + uint64_t(wCount) * wElementSize > wValuesSize)
+	{
+		return false;
+	}
+
+	for (int64_t i = 0; i < wCount; i++)
+	{
+		const uint32_t wTarget = ReadIndex(wIndices + wIndicesOffset + i * wIndexSize, wIndexType);
+		if (wTarget >= iAccessor.Count)
+		{
+			return false;
+		}
+
+		const uint8_t* wElement = wValues + wValuesOffset + i * wElementSize;
+		for (uint32_t c = 0; c < wCopied; c++)
+		{
+			oValues[size_t(wTarget) * iComponentCount + c] = ReadComponent(wElement + c * wComponentSize, iAccessor.ComponentType, iAccessor.Normalized);
+		}
+	}
+	return true;
+}
+
+bool GltfImporter::ReadIndices(const Accessor& iAccessor, uint32_t* oIndices)
+{
+	if (!iAccessor.Data || iAccessor.Sparse || iAccessor.ComponentCount != 1 ||
+		(iAccessor.ComponentType != eUnsignedByte && iAccessor.ComponentType != eUnsignedShort && iAccessor.ComponentType != eUnsignedInt))
+	{
+		return false;
+	}
+
+	for (uint32_t i = 0; i < iAccessor.Count; i++)
+	{
+		oIndices[i] = ReadIndex(iAccessor.Data + size_t(i) * iAccessor.Stride, iAccessor.ComponentType);
+	}
+	return true;
+}
+
+void GltfImporter::ImportNode(const Document& iDocument, uint32_t iNode, const glm::mat4& iParentTransform, uint32_t iDepth,
+	std::vector<bool>& ioVisiting, MeshData& oData, std::vector<PrimitiveJob>& oJobs, uint32_t& ioDefaultMaterial)
+{
+	const JsonValue& wNodes = iDocument.Json["nodes"];
+	const JsonValue& wNode = wNodes[iNode];
+	const glm::mat4 wTransform = iParentTransform * GetLocalTransform(wNode);
+	const bool wIdentity = wTransform == glm::mat4(1.f);
+
+	const uint32_t wNodeIndex = static_cast<uint32_t>(oData.Nodes.size());
+	MeshData::Node wDataNode;
+	wDataNode.FirstSubmesh = static_cast<uint32_t>(oData.Submeshes.size());
+	wDataNode.Depth = iDepth;
+	oData.Nodes.push_back(wDataNode);
+
+	// Submeshes of a node are contiguous, its primitives are queued before the children
+	const int64_t wMeshIndex = wNode["mesh"].GetInt(-1);
+	const JsonValue& wMesh = iDocument.Json["meshes"][static_cast<size_t>(std::max<int64_t>(0, wMeshIndex))];
+	if (wMeshIndex >= 0 && wMesh.IsObject())
+	{
+		const std::string wName = wMesh["name"].IsString() ? wMesh["name"].GetString() : "Mesh " + std::to_string(wMeshIndex);
+		const JsonValue& wPrimitives = wMesh["primitives"];
+		for (uint32_t i = 0; i < wPrimitives.Size(); i++)
+		{
+			const JsonValue& wPrimitive = wPrimitives[i];
+			if (!CheckPrimitive(iDocument, wPrimitive))
+			{
+				spdlog::warn("\tPrimitive {0:d} of {1:s} in {2:s} skipped", i, wName, iDocument.Path);
+				continue;
+			}
+
+			MeshData::Submesh wSubmesh;
+			wSubmesh.Name = wPrimitives.Size() > 1 ? wName + "_" + std::to_string(i) : wName;
+
+			const int64_t wMaterial = wPrimitive["material"].GetInt(-1);
+			if (wMaterial >= 0 && wMaterial < static_cast<int64_t>(iDocument.Json["materials"].Size()))
+			{
+				wSubmesh.Material = static_cast<uint32_t>(wMaterial);
+			}
+			else
+			{
+				if (ioDefaultMaterial == UINT32_MAX)
+				{
+					ioDefaultMaterial = static_cast<uint32_t>(oData.Materials.size());
+					oData.Materials.emplace_back();
+					oData.Materials.back().Diffuse = glm::vec3(0.6f);
+				}
+				wSubmesh.Material = ioDefaultMaterial;
+			}
+
+			oJobs.push_back({ &wPrimitive, wTransform, wIdentity, static_cast<uint32_t>(oData.Submeshes.size()) });
+			oData.Submeshes.push_back(std::move(wSubmesh));
+		}
+	}
+	oData.Nodes[wNodeIndex].SubmeshCount = static_cast<uint32_t>(oData.Submeshes.size()) - wDataNode.FirstSubmesh;
+
+	uint32_t wChildCount = 0;
+	for (const JsonValue& wChild : wNode["children"].GetElements())
+	{
+		const int64_t wChildIndex = wChild.GetInt(-1);
+		if (wChildIndex < 0 || wChildIndex >= static_cast<int64_t>(wNodes.Size()) || ioVisiting[static_cast<size_t>(wChildIndex)])
+		{
+			spdlog::warn("\tInvalid child {0:d} of node {1:d} in {2:s}", wChildIndex, iNode, iDocument.Path);
+			continue;
+		}
+
+		ioVisiting[static_cast<size_t>(wChildIndex)] = true;
+		ImportNode(iDocument, static_cast<uint32_t>(wChildIndex), wTransform, iDepth + 1, ioVisiting, oData, oJobs, ioDefaultMaterial);
+		ioVisiting[static_cast<size_t>(wChildIndex)] = false;
+		++wChildCount;
+	}
+	oData.Nodes[wNodeIndex].ChildCount = wChildCount;
+}
+
+bool GltfImporter::CheckPrimitive(const Document& iDocument, const JsonValue& iPrimitive)
+{
+	if (iPrimitive["mode"].GetInt(kModeTriangles) != kModeTriangles)
+	{
+		return false;
+	}
+
+	Accessor wPositions;
+	if (!GetAccessor(iDocument, iPrimitive["attributes"]["POSITION"], wPositions) || wPositions.ComponentCount != 3)
+	{
+		return false;
+	}
+
+	Accessor wIndices;
+	return !iPrimitive.Has("indices") || (GetAccessor(iDocument, iPrimitive["indices"], wIndices) && wIndices.Data && !wIndices.Sparse &&
+		wIndices.ComponentCount == 1 && wIndices.ComponentType != eByte && wIndices.ComponentType != eShort &&
+		wIndices.ComponentType != eFloat);
+}
+
+void GltfImporter::BuildSubmesh(const Document& iDocument, const PrimitiveJob& iJob, MeshData::Submesh& oSubmesh,
+	std::vector<std::vector<uint8_t>>& oBuffers, uint32_t& oInPlaceStreams)
+{
+	const JsonValue& wAttributes = (*iJob.Primitive)["attributes"];
+
+	// Tightly packed floats are read straight from the mapped buffer when no transform is baked
+	auto IsInPlace = [&](const Accessor& iAccessor, uint32_t iComponentCount)
+	{
+		return iJob.Identity && iAccessor.Data && !iAccessor.Sparse && iAccessor.ComponentType == eFloat &&
+			iAccessor.ComponentCount == iComponentCount && iAccessor.Stride == iComponentCount * sizeof(float) &&
+			reinterpret_cast<uintptr_t>(iAccessor.Data) % alignof(float) == 0;
+	};
+
+	// Optional attribute, skipped when it doesn't match the positions
+	auto GetAttribute = [&](const char* iName, uint32_t iMinComponents, uint32_t iVertexCount, Accessor& oAccessor)
+	{
+		if (!wAttributes.Has(iName))
+		{
+			return false;
+		}
+		if (!GetAccessor(iDocument, wAttributes[iName], oAccessor) || oAccessor.Count != iVertexCount || oAccessor.ComponentCount < iMinComponents)
+		{
+			spdlog::warn("\tInvalid {0:s} attribute in {1:s} ignored", iName, iDocument.Path);
+			return false;
+		}
+		return true;
+	};
+
+	Accessor wPositionAccessor;
+	GetAccessor(iDocument, wAttributes["POSITION"], wPositionAccessor);
+	uint32_t wVertexCount = wPositionAccessor.Count;
+
+	const glm::mat3 wLinear(iJob.Transform);
+	const glm::mat3 wNormalMatrix = glm::transpose(glm::inverse(wLinear));
+	const bool wFlipWinding = glm::determinant(wLinear) < 0.f;
+
+	const glm::vec3* wPositions = nullptr;
+	if (IsInPlace(wPositionAccessor, 3))
+	{
+		wPositions = reinterpret_cast<const glm::vec3*>(wPositionAccessor.Data);
+		++oInPlaceStreams;
+	}
+	else
+	{
+		glm::vec3* wConverted = AllocateStream<glm::vec3>(oBuffers, wVertexCount);
+		if (!ReadFloats(iDocument, wPositionAccessor, 3, 0.f, &wConverted->x))
+		{
+			spdlog::warn("\tInvalid POSITION attribute in {0:s}, submesh {1:s} left empty", iDocument.Path, oSubmesh.Name);
+			return;
+		}
+		for (uint32_t i = 0; !iJob.Identity && i < wVertexCount; i++)
+		{
+			wConverted[i] = glm::vec3(iJob.Transform * glm::vec4(wConverted[i], 1.f));
+		}
+		wPositions = wConverted;
+	}
+
+	// Indices, 32 bits ones are used in place unless the winding is flipped
+	const uint32_t* wIndices = nullptr;
+	uint32_t wIndexCount = 0;
+	Accessor wIndexAccessor;
+	if (GetAccessor(iDocument, (*iJob.Primitive)["indices"], wIndexAccessor))
+	{
+		wIndexCount = wIndexAccessor.Count - wIndexAccessor.Count % 3;
+		if (!wFlipWinding && wIndexAccessor.ComponentType == eUnsignedInt && wIndexAccessor.Stride == sizeof(uint32_t) &&
+			reinterpret_cast<uintptr_t>(wIndexAccessor.Data) % alignof(uint32_t) == 0)
+		{
+			wIndices = reinterpret_cast<const uint32_t*>(wIndexAccessor.Data);
+			++oInPlaceStreams;
+		}
+		else
+		{
+			uint32_t* wConverted = AllocateStream<uint32_t>(oBuffers, wIndexAccessor.Count);
+			ReadIndices(wIndexAccessor, wConverted);
+			wIndices = wConverted;
+		}
+	}
+	else
+	{
+		wIndexCount = wVertexCount - wVertexCount % 3;
+		uint32_t* wSequential = AllocateStream<uint32_t>(oBuffers, wIndexCount);
+		for (uint32_t i = 0; i < wIndexCount; i++)
+		{
+			wSequential[i] = i;
+		}
+		wIndices = wSequential;
+	}
+
+	for (uint32_t i = 0; i < wIndexCount; i++)
+	{
+		if (wIndices[i] >= wVertexCount)
+		{
+			spdlog::warn("\tIndex out of range in {0:s}, submesh {1:s} left empty", iDocument.Path, oSubmesh.Name);
+			return;
+		}
+	}
+
+	if (wFlipWinding)
+	{
+		uint32_t* wFlipped = const_cast<uint32_t*>(wIndices);
+		for (uint32_t i = 0; i < wIndexCount; i += 3)
+		{
+			std::swap(wFlipped[i + 1], wFlipped[i + 2]);
+		}
+	}
+
+	const void* wStreams[SubMesh::eNumAttribs] = { nullptr };
+	wStreams[SubMesh::ePosition] = wPositions;
+
+	for (uint32_t wSet = 0; wSet < 3; wSet++)
+	{
+		Accessor wUVAccessor;
+		const std::string wName = "TEXCOORD_" + std::to_string(wSet);
+		if (GetAttribute(wName.c_str(), 2, wVertexCount, wUVAccessor))
+		{
+			// Textures are loaded bottom row first, glTF uvs start at the top
+			glm::vec2* wUVs = AllocateStream<glm::vec2>(oBuffers, wVertexCount);
+			ReadFloats(iDocument, wUVAccessor, 2, 0.f, &wUVs->x);
+			for (uint32_t i = 0; i < wVertexCount; i++)
+			{
+				wUVs[i].y = 1.f - wUVs[i].y;
+			}
+			wStreams[SubMesh::eUV0 + wSet] = wUVs;
+		}
+	}
+
+	Accessor wColorAccessor;
+	if (GetAttribute("COLOR_0", 3, wVertexCount, wColorAccessor))
+	{
+		glm::vec4* wColors = AllocateStream<glm::vec4>(oBuffers, wVertexCount);
+		ReadFloats(iDocument, wColorAccessor, 4, 1.f, &wColors->x);
+		wStreams[SubMesh::eColor] = wColors;
+	}
+
+	Accessor wNormalAccessor;
+	if (GetAttribute("NORMAL", 3, wVertexCount, wNormalAccessor))
+	{
+		if (IsInPlace(wNormalAccessor, 3))
+		{
+			wStreams[SubMesh::eNormal] = wNormalAccessor.Data;
+			++oInPlaceStreams;
+		}
+		else
+		{
+			glm::vec3* wNormals = AllocateStream<glm::vec3>(oBuffers, wVertexCount);
+			ReadFloats(iDocument, wNormalAccessor, 3, 0.f, &wNormals->x);
+			for (uint32_t i = 0; !iJob.Identity && i < wVertexCount; i++)
+			{
+				const glm::vec3 wNormal = wNormalMatrix * wNormals[i];
+				const float wLength = glm::length(wNormal);
+				wNormals[i] = wLength > 0.f ? wNormal / wLength : wNormal;
+			}
+			wStreams[SubMesh::eNormal] = wNormals;
+		}
+
+		Accessor wTangentAccessor;
+		if (GetAttribute("TANGENT", 4, wVertexCount, wTangentAccessor))
+		{
+			// The handedness in w is dropped, the shaders rebuild the bitangent from the normal
+			glm::vec3* wTangents = AllocateStream<glm::vec3>(oBuffers, wVertexCount);
+			ReadFloats(iDocument, wTangentAccessor, 3, 0.f, &wTangents->x);
+			for (uint32_t i = 0; !iJob.Identity && i < wVertexCount; i++)
+			{
+				const glm::vec3 wTangent = wLinear * wTangents[i];
+				const float wLength = glm::length(wTangent);
+				wTangents[i] = wLength > 0.f ? wTangent / wLength : wTangent;
+			}
+			wStreams[SubMesh::eTangent] = wTangents;
+		}
+	}
+	else
+	{
+		// The specification asks for flat normals, the vertices are unwelded so each triangle gets its own
+		for (uint32_t s = 0; s < SubMesh::eNumAttribs; s++)
+		{
+			if (!wStreams[s])
+			{
+				continue;
+			}
+
+			const uint32_t wStride = MeshData::StreamStride(static_cast<SubMesh::EVertexAttrib>(s));
+			oBuffers.emplace_back(size_t(wIndexCount) * wStride);
+			uint8_t* wUnwelded = oBuffers.back().data();
+			const uint8_t* wSource = static_cast<const uint8_t*>(wStreams[s]);
+			for (uint32_t i = 0; i < wIndexCount; i++)
+			{
+				std::memcpy(wUnwelded + size_t(i) * wStride, wSource + size_t(wIndices[i]) * wStride, wStride);
+			}
+			wStreams[s] = wUnwelded;
+		}
+
+		wVertexCount = wIndexCount;
+		wPositions = static_cast<const glm::vec3*>(wStreams[SubMesh::ePosition]);
+		uint32_t* wSequential = AllocateStream<uint32_t>(oBuffers, wIndexCount);
+		glm::vec3* wNormals = AllocateStream<glm::vec3>(oBuffers, wVertexCount);
+		for (uint32_t i = 0; i < wIndexCount; i += 3)
+		{
+			const glm::vec3 wNormal = glm::cross(wPositions[i + 1] - wPositions[i], wPositions[i + 2] - wPositions[i]);
+			const float wLength = glm::length(wNormal);
+			wNormals[i] = wNormals[i + 1] = wNormals[i + 2] = wLength > 0.f ? wNormal / wLength : glm::vec3(0.f, 1.f, 0.f);
+			wSequential[i] = i;
+			wSequential[i + 1] = i + 1;
+			wSequential[i + 2] = i + 2;
+		}
+		wIndices = wSequential;
+		wStreams[SubMesh::eNormal] = wNormals;
+	}
+
+	if (!wStreams[SubMesh::eTangent] && wStreams[SubMesh::eUV0])
+	{
+		glm::vec3* wTangents = AllocateStream<glm::vec3>(oBuffers, wVertexCount);
+		MeshData::GenerateTangents(wPositions, static_cast<const glm::vec3*>(wStreams[SubMesh::eNormal]),
+			static_cast<const glm::vec2*>(wStreams[SubMesh::eUV0]), wVertexCount, wIndices, wIndexCount, wTangents);
+		wStreams[SubMesh::eTangent] = wTangents;
+	}
+
+	std::copy(std::begin(wStreams), std::end(wStreams), std::begin(oSubmesh.Streams));
+	oSubmesh.VertexCount = wVertexCount;
+	oSubmesh.IndexCount = wIndexCount;
+	oSubmesh.Indices = wIndices;
+}
+
+bool GltfImporter::GetImagePath(const Document& iDocument, const JsonValue& iTextureInfo, std::string& oPath)
+{
+	const JsonValue& wTexture = iDocument.Json["textures"][static_cast<size_t>(std::max<int64_t>(0, iTextureInfo["index"].GetInt(-1)))];
+	const JsonValue& wImage = iDocument.Json["images"][static_cast<size_t>(std::max<int64_t>(0, wTexture["source"].GetInt(-1)))];
+	const std::string& wUri = wImage["uri"].GetString();
+	if (wUri.empty() || wUri.compare(0, 5, "data:") == 0)
+	{
+		return false;
+	}
+
+	oPath = DecodeUri(wUri);
+	return true;
+}
+
+void GltfImporter::ImportMaterials(const Document& iDocument, MeshData& oData)
+{
+	for (const JsonValue& wMaterial : iDocument.Json["materials"].GetElements())
+	{
+		oData.Materials.emplace_back();
+		MeshData::MaterialDesc& wDesc = oData.Materials.back();
+
+		// Metallic roughness approximated with the Blinn Phong colors, rough surfaces get no highlight
+		const JsonValue& wPbr = wMaterial["pbrMetallicRoughness"];
+		const JsonValue& wBaseColor = wPbr["baseColorFactor"];
+		const glm::vec3 wBase(wBaseColor[size_t(0)].GetNumber(1.0), wBaseColor[1].GetNumber(1.0), wBaseColor[2].GetNumber(1.0));
+		const float wMetallic = static_cast<float>(wPbr["metallicFactor"].GetNumber(1.0));
+		const float wRoughness = static_cast<float>(wPbr["roughnessFactor"].GetNumber(1.0));
+		wDesc.Ambient = wBase;
+		wDesc.Diffuse = wBase;
+		wDesc.Specular = glm::mix(glm::vec3(0.5f), wBase, wMetallic) * (1.f - wRoughness);
+
+		if (wPbr.Has("baseColorTexture") && !GetImagePath(iDocument, wPbr["baseColorTexture"], wDesc.DiffuseTex))
+		{
+			spdlog::warn("\tEmbedded base color image of {0:s} not supported", iDocument.Path);
+		}
+		if (wMaterial.Has("normalTexture") && !GetImagePath(iDocument, wMaterial["normalTexture"], wDesc.NormalTex))
+		{
+			spdlog::warn("\tEmbedded normal image of {0:s} not supported", iDocument.Path);
+		}
+	}
+}
@@ -0,0 +1,133 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/mat4x4.hpp>
+
+#include "Json.h"
+#include "MeshData.h"
+
+/**
+ * @brief : glTF 2.0 importer, .gltf with external or embedded buffers and binary .glb.
+ * Buffers are memory mapped and kept by the MeshData : float positions and normals and uint32 indices
+ * are referenced in place when tightly packed, other accessors are converted to the float streams
+ * (KHR_mesh_quantization data is dequantized). Node transforms are baked in the vertices since the
+ * passes only use the entity transform. EXT_meshopt_compression is read from its fallback buffers.
+ * The hierarchy is a root node with the scene nodes below, one submesh per primitive.
+*/
+class GltfImporter
+{
+	/**
+	 * @brief : Resolved accessor, Data is nullptr for sparse accessors without buffer view (zeros)
+	*/
+	struct Accessor
+	{
+		const uint8_t* Data = nullptr;
+		uint32_t Count = 0;
+		uint32_t ComponentType = 0;
+		uint32_t ComponentCount = 0;
+		uint32_t Stride = 0;
+		bool Normalized = false;
+		const JsonValue* Sparse = nullptr;
+	};
+
+	struct Document
+	{
+		JsonValue Json;
+		std::string Path;
+		std::vector<const uint8_t*> Buffers;		// nullptr when the buffer has no data (meshopt fallback without uri)
+		std::vector<size_t> BufferSizes;
+	};
+
+	/**
+	 * @brief : Primitive queued for conversion, submeshes are built in parallel once the hierarchy is known
+	*/
+	struct PrimitiveJob
+	{
+		const JsonValue* Primitive;
+		glm::mat4 Transform;
+		bool Identity;
+		uint32_t Submesh;
+	};
+
+public:
+	/**
+	 * @brief : Blocking, converts the primitives with ParallelFor
+	*/
+	static bool Import(const std::string& iPath, MeshData& oData);
+
+private:
+	/**
+	 * @brief : Parse the JSON of a .gltf or .glb and map its buffers, the mappings are kept by oData
+	*/
+	static bool LoadDocument(const std::string& iPath, Document& oDocument, MeshData& oData);
+
+	static bool LoadBuffers(const std::string& iDirectory, const uint8_t* iBinChunk, size_t iBinSize, Document& ioDocument, MeshData& oData);
+
+	/**
+	 * @brief : Bytes of a buffer view, nullptr when it's out of bounds or its buffer has no data
+	*/
+	static const uint8_t* GetBufferView(const Document& iDocument, int64_t iView, size_t& oSize, uint32_t& oStride);
+
+	/**
+	 * @return false if the accessor is missing or its data is out of bounds
+	*/
+	static bool GetAccessor(const Document& iDocument, const JsonValue& iIndex, Accessor& oAccessor);
+
+	/**
+	 * @brief : Every element as iComponentCount floats, normalized integers are dequantized, missing components are iFill
+	*/
+	static bool ReadFloats(const Document& iDocument, const Accessor& iAccessor, uint32_t iComponentCount, float iFill, float* oValues);
+
+	static bool ReadIndices(const Accessor& iAccessor, uint32_t* oIndices);
+
+	/**
+	 * @brief : Append the node and its subtree depth first, queue its primitives
+	*/
+	static void ImportNode(const Document& iDocument, uint32_t iNode, const glm::mat4& iParentTransform, uint32_t iDepth,
+		std::vector<bool>& ioVisiting, MeshData& oData, std::vector<PrimitiveJob>& oJobs, uint32_t& ioDefaultMaterial);
+
+	/**
+	 * @return false if the primitive can't be drawn as a triangle list
+	*/
+	static bool CheckPrimitive(const Document& iDocument, const JsonValue& iPrimitive);
+
+	/**
+	 * @param oInPlaceStreams : Streams referencing the mapped buffers without conversion, indices included
+	*/
+	static void BuildSubmesh(const Document& iDocument, const PrimitiveJob& iJob, MeshData::Submesh& oSubmesh,
+		std::vector<std::vector<uint8_t>>& oBuffers, uint32_t& oInPlaceStreams);
+
+	/**
+	 * @brief : Path of the image of a texture, relative to the mesh directory
+	 * @return false for images stored in a buffer view or a data uri
+	*/
+	static bool GetImagePath(const Document& iDocument, const JsonValue& iTextureInfo, std::string& oPath);
+
+	static void ImportMaterials(const Document& iDocument, MeshData& oData);
+};
@@ -0,0 +1,389 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstdlib>
+#include <cstring>
+
+#include "Json.h"
+
+namespace
+{
+	// Nesting limit, guards the recursion against hostile files
+	constexpr uint32_t kMaxDepth = 128;
+
+	const JsonValue kNullValue;
+}
+
+class JsonValue::Parser
+{
+public:
+	Parser(const char* iText, size_t iSize)
+		:mIt(iText),
+		mBegin(iText),
+		mEnd(iText + iSize)
+	{
+	}
+
+	bool ParseDocument(JsonValue& oValue, std::string& oError)
+	{
+		if (!ParseValue(oValue, 0))
+		{
+			oError = mError + " at offset " + std::to_string(mIt - mBegin);
+			return false;
+		}
+
+		SkipSpaces();
+		if (mIt != mEnd)
+		{
+			oError = "Trailing characters at offset " + std::to_string(mIt - mBegin);
+			return false;
+		}
+		return true;
+	}
+
+private:
+	void SkipSpaces()
+	{
+		while (mIt < mEnd && (*mIt == ' ' || *mIt == '\t' || *mIt == '\n' || *mIt == '\r'))
+		{
+			++mIt;
+		}
+	}
+
+	bool Fail(const char* iMessage)
+	{
+		mError = iMessage;
+		return false;
+	}
+
+	bool Consume(const char* iLiteral)
+	{
+		const size_t wLength = std::strlen(iLiteral);
+		if (static_cast<size_t>(mEnd - mIt) < wLength || std::strncmp(mIt, iLiteral, wLength) != 0)
+		{
+			return false;
+		}
+		mIt += wLength;
+		return true;
+	}
+
+	bool ParseValue(JsonValue& oValue, uint32_t iDepth)
+	{
+		if (iDepth > kMaxDepth)
+		{
+			return Fail("Nesting too deep");
+		}
+
+		SkipSpaces();
+		if (mIt >= mEnd)
+		{
+			return Fail("Unexpected end");
+		}
+
+		switch (*mIt)
+		{
+		case '{':
+			return ParseObject(oValue, iDepth);
+		case '[':
+			return ParseArray(oValue, iDepth);
+		case '"':
+			oValue.mType = EType::eString;
+			return ParseString(oValue.mString);
+		case 't':
+			oValue.mType = EType::eBool;
+			oValue.mBool = true;
+			return Consume("true") || Fail("Invalid literal");
+		case 'f':
+			oValue.mType = EType::eBool;
+			oValue.mBool = false;
+			return Consume("false") || Fail("Invalid literal");
+		case 'n':
+			oValue.mType = EType::eNull;
+			return Consume("null") || Fail("Invalid literal");
+		default:
+			oValue.mType = EType::eNumber;
+			return ParseNumber(oValue.mNumber);
+		}
+	}
+
+	bool ParseObject(JsonValue& oValue, uint32_t iDepth)
+	{
+		oValue.mType = EType::eObject;
+		++mIt;
+		SkipSpaces();
+		if (mIt < mEnd && *mIt == '}')
+		{
+			++mIt;
+			return true;
+		}
+
+		while (true)
+		{
+			SkipSpaces();
+			std::string wKey;
+			if (mIt >= mEnd || *mIt != '"' || !ParseString(wKey))
+			{
+				return mError.empty() ? Fail("Expected a member name") : false;
+			}
+
+			SkipSpaces();
+			if (mIt >= mEnd || *mIt != ':')
+			{
+				return Fail("Expected ':'");
+			}
+			++mIt;
+
+			oValue.mMembers.emplace_back(std::move(wKey), JsonValue());
+			if (!ParseValue(oValue.mMembers.back().second, iDepth + 1))
+			{
+				return false;
+			}
+
+			SkipSpaces();
+			if (mIt < mEnd && *mIt == ',')
+			{
+				++mIt;
+				continue;
+			}
+			if (mIt < mEnd && *mIt == '}')
+			{
+				++mIt;
+				return true;
+			}
+			return Fail("Expected ',' or '}'");
+		}
+	}
+
+	bool ParseArray(JsonValue& oValue, uint32_t iDepth)
+	{
+		oValue.mType = EType::eArray;
+		++mIt;
+		SkipSpaces();
+		if (mIt < mEnd && *mIt == ']')
+		{
+			++mIt;
+			return true;
+		}
+
+		while (true)
+		{
+			oValue.mElements.emplace_back();
+			if (!ParseValue(oValue.mElements.back(), iDepth + 1))
+			{
+				return false;
+			}
+
+			SkipSpaces();
+			if (mIt < mEnd && *mIt == ',')
+			{
+				++mIt;
+				continue;
+			}
+			if (mIt < mEnd && *mIt == ']')
+			{
+				++mIt;
+				return true;
+			}
+			return Fail("Expected ',' or ']'");
+		}
+	}
+
+	bool ParseHex(uint32_t& oCode)
+	{
+		if (mEnd - mIt < 4)
+		{
+			return Fail("Truncated escape");
+		}
+
+		oCode = 0;
+		for (uint32_t i = 0; i < 4; i++, ++mIt)
+		{
+			const char wChar = *mIt;
+			uint32_t wDigit = 0;
+			if (wChar >= '0' && wChar <= '9')
+			{
+				wDigit = wChar - '0';
+			}
+			else if (wChar >= 'a' && wChar <= 'f')
+			{
+				wDigit = wChar - 'a' + 10;
+			}
+			else if (wChar >= 'A' && wChar <= 'F')
+			{
+				wDigit = wChar - 'A' + 10;
+			}
+			else
+			{
+				return Fail("Invalid escape");
+			}
+			oCode = (oCode << 4) | wDigit;
+		}
+		return true;
+	}
+
+	static void AppendUtf8(uint32_t iCode, std::string& oString)
+	{
+		if (iCode < 0x80)
+		{
+			oString += static_cast<char>(iCode);
+		}
+		else if (iCode < 0x800)
+		{
+			oString += static_cast<char>(0xC0 | (iCode >> 6));
+			oString += static_cast<char>(0x80 | (iCode & 0x3F));
+		}
+		else if (iCode < 0x10000)
+		{
+			oString += static_cast<char>(0xE0 | (iCode >> 12));
+			oString += static_cast<char>(0x80 | ((iCode >> 6) & 0x3F));
+			oString += static_cast<char>(0x80 | (iCode & 0x3F));
+		}
+		else
+		{
+			oString += static_cast<char>(0xF0 | (iCode >> 18));
+			oString += static_cast<char>(0x80 | ((iCode >> 12) & 0x3F));
+			oString += static_cast<char>(0x80 | ((iCode >> 6) & 0x3F));
+			oString += static_cast<char>(0x80 | (iCode & 0x3F));
+		}
+	}
+
+	bool ParseString(std::string& oString)
+	{
+		++mIt;
+		while (mIt < mEnd)
+		{
+			const char wChar = *mIt++;
+			if (wChar == '"')
+			{
+				return true;
+			}
+
+			if (wChar != '\\')
+			{
+				oString += wChar;
+				continue;
+			}
+
+			if (mIt >= mEnd)
+			{
+				break;
+			}
+
+			const char wEscape = *mIt++;
+			switch (wEscape)
+			{
+			case '"': oString += '"'; break;
+			case '\\': oString += '\\'; break;
+			case '/': oString += '/'; break;
+			case 'b': oString += '\b'; break;
+			case 'f': oString += '\f'; break;
+			case 'n': oString += '\n'; break;
+			case 'r': oString += '\r'; break;
+			case 't': oString += '\t'; break;
+			case 'u':
+			{
+				uint32_t wCode = 0;
+				if (!ParseHex(wCode))
+				{
+					return false;
+				}
+
+				// Characters outside the BMP come as a surrogate pair
+				if (wCode >= 0xD800 && wCode < 0xDC00)
+				{
+					uint32_t wLow = 0;
+					if (!Consume("\\u") || !ParseHex(wLow) || wLow < 0xDC00 || wLow >= 0xE000)
+					{
+						return mError.empty() ? Fail("Invalid surrogate pair") : false;
+					}
+					wCode = 0x10000 + ((wCode - 0xD800) << 10) + (wLow - 0xDC00);
+				}
+				AppendUtf8(wCode, oString);
+				break;
+			}
+			default:
+				return Fail("Invalid escape");
+			}
+		}
+
+		return Fail("Unterminated string");
+	}
+
+	bool ParseNumber(double& oNumber)
+	{
+		const char* wStart = mIt;
+		while (mIt < mEnd && (std::strchr("+-0123456789.eE", *mIt) != nullptr))
+		{
+			++mIt;
+		}
+
+		// The text is not null terminated, numbers are short
+		char wBuffer[64];
+		const size_t wLength = static_cast<size_t>(mIt - wStart);
+		if (wLength == 0 || wLength >= sizeof(wBuffer))
+		{
+			return Fail("Invalid number");
+		}
+		std::memcpy(wBuffer, wStart, wLength);
+		wBuffer[wLength] = '\0';
+
+		char* wParsedEnd = nullptr;
+		oNumber = std::strtod(wBuffer, &wParsedEnd);
+		return wParsedEnd == wBuffer + wLength || Fail("Invalid number");
+	}
+
+	const char* mIt;
+	const char* mBegin;
+	const char* mEnd;
+	std::string mError;
+};
+
+bool JsonValue::Parse(const char* iText, size_t iSize, JsonValue& oValue, std::string& oError)
+{
+	oValue = JsonValue();
+	Parser wParser(iText, iSize);
+	return wParser.ParseDocument(oValue, oError);
+}
+
+const JsonValue& JsonValue::operator[](size_t iIndex) const
+{
+	return mType == EType::eArray && iIndex < mElements.size() ? mElements[iIndex] : kNullValue;
+}
+
+const JsonValue& JsonValue::operator[](const char* iKey) const
+{
+	if (mType != EType::eObject)
+	{
+		return kNullValue;
+	}
+
+	for (const std::pair<std::string, JsonValue>& wMember : mMembers)
+	{
+		if (wMember.first == iKey)
+		{
+			return wMember.second;
+		}
+	}
+	return kNullValue;
+}
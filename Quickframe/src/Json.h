@@ -0,0 +1,92 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief : Minimal JSON document, enough for the glTF headers.
+ * Objects keep their members in file order and are searched linearly, they are small in practice.
+ * Missing members and out of range elements return a shared null value so lookups can be chained.
+*/
+class JsonValue
+{
+public:
+	enum class EType
+	{
+		eNull,
+		eBool,
+		eNumber,
+		eString,
+		eArray,
+		eObject
+	};
+
+	/**
+	 * @return false on a syntax error, described in oError with its offset
+	*/
+	static bool Parse(const char* iText, size_t iSize, JsonValue& oValue, std::string& oError);
+
+	EType GetType() const { return mType; }
+	bool IsNull() const { return mType == EType::eNull; }
+	bool IsNumber() const { return mType == EType::eNumber; }
+	bool IsString() const { return mType == EType::eString; }
+	bool IsArray() const { return mType == EType::eArray; }
+	bool IsObject() const { return mType == EType::eObject; }
+
+	/**
+	 * @brief : Value of the member, iDefault when missing or of another type
+	*/
+	bool GetBool(bool iDefault = false) const { return mType == EType::eBool ? mBool : iDefault; }
+	double GetNumber(double iDefault = 0.0) const { return mType == EType::eNumber ? mNumber : iDefault; }
+	int64_t GetInt(int64_t iDefault = 0) const { return mType == EType::eNumber ? static_cast<int64_t>(mNumber) : iDefault; }
+	const std::string& GetString() const { return mString; }
+
+	/**
+	 * @brief : Element count of arrays, member count of objects
+	*/
+	size_t Size() const { return mType == EType::eObject ? mMembers.size() : mElements.size(); }
+
+	const JsonValue& operator[](size_t iIndex) const;
+	const JsonValue& operator[](const char* iKey) const;
+	bool Has(const char* iKey) const { return !(*this)[iKey].IsNull(); }
+
+	const std::vector<JsonValue>& GetElements() const { return mElements; }
+	const std::vector<std::pair<std::string, JsonValue>>& GetMembers() const { return mMembers; }
+
+private:
+	class Parser;
+
+	EType mType = EType::eNull;
+	bool mBool = false;
+	double mNumber = 0.0;
+	std::string mString;
+	std::vector<JsonValue> mElements;
+	std::vector<std::pair<std::string, JsonValue>> mMembers;
+};
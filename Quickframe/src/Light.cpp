@@ -22,6 +22,10 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "Light.h"
 #include "Transform.h"
 #include "PerspectiveFrustum.h"
@@ -67,6 +71,7 @@ PointLight::PointLight(float iIntensity, glm::vec3 iColor, glm::vec3 iPosition,
 {
 	mIntensity = iIntensity;
 	mColor = iColor;
+	mAttenuation = iAttenuation;
 
 	mTransform = std::make_shared<Transform>();
 	mTransform->SetWorldPos(iPosition);
@@ -99,4 +104,30 @@ void SpotLight::SetCutoff(float iCutoff)
 {
 	mCutoff = iCutoff;
 	mFrustum->SetFOV(glm::degrees(acos(mCutoff)) * 2.f);
-}
\ No newline at end of file
+}
+
+float PointLight::GetRange() const
+{
+	// Solve Intensity / (Constant + Linear * d + Exp * d^2) = kLightCutoff
+	float wMaxIntensity = mIntensity * std::max({ mColor.r, mColor.g, mColor.b });
+	float wC = mAttenuation.Constant - wMaxIntensity / kLightCutoff;
+
+	if (wC >= 0.f)
+	{
+		return 0.f;
+	}
+
+	if (mAttenuation.Exp > 0.f)
+	{
+		float wDelta = mAttenuation.Linear * mAttenuation.Linear - 4.f * mAttenuation.Exp * wC;
+		return (-mAttenuation.Linear + std::sqrt(wDelta)) / (2.f * mAttenuation.Exp);
+	}
+
+	if (mAttenuation.Linear > 0.f)
+	{
+		return -wC / mAttenuation.Linear;
+	}
+
+	// No falloff, the light reaches everything
+	return std::numeric_limits<float>::max();
+}
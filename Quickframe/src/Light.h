@@ -49,6 +49,7 @@ public:
 	uint32_t GetID() const { return mID; }
 
 	bool IsShadowEnabled() const { return mEnableShadow; }
+	void SetShadowEnabled(bool iEnable) { mEnableShadow = iEnable; }
 
 protected:
 	glm::vec3 mColor{ 1.0f, 1.0f, 1.0f };
@@ -86,6 +87,8 @@ private:
 class PointLight : public Light
 {
 public:
+	static constexpr float kLightCutoff = 1.f / 256.f;
+
 	struct Attenuation
 	{
 		float Constant = 1;
@@ -102,6 +105,13 @@ public:
 	void SetRadius(float iRadius) { mTransform->SetScale(glm::vec3(iRadius)); }
 
 	const Attenuation& GetAttenuation() const { return mAttenuation; }
+	void SetAttenuation(const Attenuation& iAttenuation) { mAttenuation = iAttenuation; }
+
+	/**
+	 * @brief : Distance beyond which the attenuated light contributes less than kLightCutoff
+	 * Used to bound the light when assigning it to clusters
+	*/
+	float GetRange() const;
 
 	Transform* GetTransform() const { return mTransform.get(); }
 
@@ -0,0 +1,194 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cmath>
+#include <glm/glm.hpp>
+
+#include "Engine.h"
+#include "LightCullingPass.h"
+#include "Scene.h"
+#include "PointShadowPass.h"
+#include "SpotShadowPass.h"
+#include "Defines.h"
+
+LightCullingPass::LightCullingPass(PointShadowPass* iPointShadowPass, SpotShadowPass* iSpotShadowPass)
+	:mPointShadowPass(iPointShadowPass),
+	mSpotShadowPass(iSpotShadowPass),
+	mLightsBuffer(GL_SHADER_STORAGE_BUFFER),
+	mClusterAABBBuffer(GL_SHADER_STORAGE_BUFFER, GL_STATIC_DRAW),
+	mClusterLightGridBuffer(GL_SHADER_STORAGE_BUFFER),
+	mClusterLightIndicesBuffer(GL_SHADER_STORAGE_BUFFER)
+{
+	Shader wCullShader("shaders/LightCullCS.glsl", Shader::EShaderStage::eCompute);
+	std::vector<Shader> wCullShaders{ wCullShader };
+	mProgram = std::make_unique<Program>(wCullShaders);
+
+	Shader wBuildShader("shaders/ClusterBuildCS.glsl", Shader::EShaderStage::eCompute);
+	std::vector<Shader> wBuildShaders{ wBuildShader };
+	mClusterBuildProgram = std::make_unique<Program>(wBuildShaders);
+
+	mClusterAABBBuffer.Allocate(CLUSTER_COUNT * 2 * sizeof(glm::vec4));
+	mClusterLightGridBuffer.Allocate(CLUSTER_COUNT * sizeof(GLuint));
+	mClusterLightIndicesBuffer.Allocate(CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER * sizeof(GLuint));
+	mLightsBuffer.Allocate(sizeof(GPULight));
+	mClusterLightGridBuffer.Clear();
+}
+
+void LightCullingPass::Execute(Scene* iScene)
+{
+	uint32_t wWidth, wHeight;
+	Engine::GetInstance()->GetWindow()->GetSize(wWidth, wHeight);
+	if (wWidth == 0 || wHeight == 0)
+	{
+		return;
+	}
+
+	Camera* wCamera = iScene->GetCamera();
+	if (mClusterProjection != wCamera->ProjectionMatrix() || mClusterWidth != wWidth || mClusterHeight != wHeight)
+	{
+		BuildClusters(iScene, wWidth, wHeight);
+	}
+
+	GatherLights(iScene);
+	mLightsBuffer.Upload(mGPULights.data(), mGPULights.size() * sizeof(GPULight));
+
+	mLightsBuffer.BindBase(LIGHTS_SSBO_BINDING);
+	mClusterAABBBuffer.BindBase(CLUSTER_AABB_SSBO_BINDING);
+	mClusterLightGridBuffer.BindBase(CLUSTER_LIGHT_GRID_SSBO_BINDING);
+	mClusterLightIndicesBuffer.BindBase(CLUSTER_LIGHT_INDICES_SSBO_BINDING);
+
+	// One invocation per cluster
+	mProgram->Bind();
+	mProgram->SetUniform1ui("uLightCount", GetLightCount());
+	mProgram->SetUniform1ui("uClusterCount", CLUSTER_COUNT);
+	mProgram->SetUniformMatrix4f("uView", wCamera->ViewMatrix());
+	glDispatchCompute((CLUSTER_COUNT + 127) / 128, 1, 1);
+
+	// The light lists are read by the fragment shaders of the lit pass
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void LightCullingPass::BindClusterResources(Program* iProgram, Scene* iScene)
+{
+	uint32_t wWidth, wHeight;
+	Engine::GetInstance()->GetWindow()->GetSize(wWidth, wHeight);
+
+	mLightsBuffer.BindBase(LIGHTS_SSBO_BINDING);
+	mClusterLightGridBuffer.BindBase(CLUSTER_LIGHT_GRID_SSBO_BINDING);
+	mClusterLightIndicesBuffer.BindBase(CLUSTER_LIGHT_INDICES_SSBO_BINDING);
+
+	// Slice = log(Depth / Near) * GridZ / log(Far / Near)
+	Camera* wCamera = iScene->GetCamera();
+	float wLogDepthRange = std::log(wCamera->GetFarPlane() / wCamera->GetNearPlane());
+	float wScale = CLUSTER_GRID_Z / wLogDepthRange;
+	float wBias = CLUSTER_GRID_Z * std::log(wCamera->GetNearPlane()) / wLogDepthRange;
+
+	iProgram->SetUniformMatrix4f("uView", wCamera->ViewMatrix());
+	iProgram->SetUniform3ui("uClusterGrid", glm::uvec3(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z));
+	iProgram->SetUniform2f("uClusterTileSize", glm::vec2(static_cast<float>(wWidth) / CLUSTER_GRID_X,
+		static_cast<float>(wHeight) / CLUSTER_GRID_Y));
+	iProgram->SetUniform2f("uClusterZParams", glm::vec2(wScale, wBias));
+
+	// Shadow slots are referenced by the light list
+	if (mPointShadowPass)
+	{
+		mPointShadowPass->BindShadowMaps(POINT_SHADOW_MAPS_TEXTURE_UNIT);
+		iProgram->SetUniform1i(POINT_SHADOW_MAPS_TEXTURE_UNIFORM, POINT_SHADOW_MAPS_TEXTURE_UNIFORM_IDX);
+	}
+
+	if (mSpotShadowPass)
+	{
+		mSpotShadowPass->BindShadowBuffer();
+		mSpotShadowPass->BindShadowAtlas(SPOT_SHADOW_ATLAS_TEXTURE_UNIT);
+		iProgram->SetUniform1i(SPOT_SHADOW_ATLAS_TEXTURE_UNIFORM, SPOT_SHADOW_ATLAS_TEXTURE_UNIFORM_IDX);
+	}
+}
+
+void LightCullingPass::GatherLights(Scene* iScene)
+{
+	mGPULights.clear();
+	mGPULights.reserve(iScene->GetPointLightCount() + iScene->GetSpotLightCount());
+
+	for (uint32_t i = 0; i < iScene->GetPointLightCount(); i++)
+	{
+		const PointLight* wPointLight = iScene->GetPointLight(i);
+		const PointLight::Attenuation& wAtten = wPointLight->GetAttenuation();
+
+		GPULight wLight;
+		wLight.PositionRange = glm::vec4(wPointLight->GetPos(), wPointLight->GetRange());
+		wLight.ColorIntensity = glm::vec4(wPointLight->GetColor(), wPointLight->GetIntensity());
+		wLight.Attenuation = glm::vec4(wAtten.Constant, wAtten.Linear, wAtten.Exp, 0.f);
+		wLight.DirectionCutoff = glm::vec4(0.f, 0.f, 0.f, -2.f);
+		wLight.ShadowParams = glm::vec4(-1.f, 0.f, -1.f, 0.f);
+
+		uint32_t wShadowSlot = 0;
+		float wShadowFarPlane = 0.f;
+		if (mPointShadowPass && mPointShadowPass->GetShadowSlot(wPointLight->GetID(), wShadowSlot, wShadowFarPlane))
+		{
+			wLight.ShadowParams = glm::vec4(static_cast<float>(wShadowSlot), wShadowFarPlane, -1.f, 0.f);
+		}
+		mGPULights.push_back(wLight);
+	}
+
+	for (uint32_t i = 0; i < iScene->GetSpotLightCount(); i++)
+	{
+		const SpotLight* wSpotLight = iScene->GetSpotLight(i);
+		const PointLight::Attenuation& wAtten = wSpotLight->GetAttenuation();
+
+		GPULight wLight;
+		wLight.PositionRange = glm::vec4(wSpotLight->GetPos(), wSpotLight->GetRange());
+		wLight.ColorIntensity = glm::vec4(wSpotLight->GetColor(), wSpotLight->GetIntensity());
+		wLight.Attenuation = glm::vec4(wAtten.Constant, wAtten.Linear, wAtten.Exp, 0.f);
+		wLight.DirectionCutoff = glm::vec4(glm::normalize(wSpotLight->GetDirection()), wSpotLight->GetCutoff());
+		wLight.ShadowParams = glm::vec4(-1.f, 0.f, -1.f, 0.f);
+
+		uint32_t wShadowIndex = 0;
+		if (mSpotShadowPass && mSpotShadowPass->GetShadowIndex(wSpotLight->GetID(), wShadowIndex))
+		{
+			wLight.ShadowParams.z = static_cast<float>(wShadowIndex);
+		}
+		mGPULights.push_back(wLight);
+	}
+}
+
+void LightCullingPass::BuildClusters(Scene* iScene, uint32_t iWidth, uint32_t iHeight)
+{
+	Camera* wCamera = iScene->GetCamera();
+
+	mClusterProjection = wCamera->ProjectionMatrix();
+	mClusterWidth = iWidth;
+	mClusterHeight = iHeight;
+
+	mClusterAABBBuffer.BindBase(CLUSTER_AABB_SSBO_BINDING);
+
+	mClusterBuildProgram->Bind();
+	mClusterBuildProgram->SetUniform3ui("uClusterGrid", glm::uvec3(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z));
+	mClusterBuildProgram->SetUniform2f("uScreenSize", glm::vec2(iWidth, iHeight));
+	mClusterBuildProgram->SetUniform1f("uNear", wCamera->GetNearPlane());
+	mClusterBuildProgram->SetUniform1f("uFar", wCamera->GetFarPlane());
+	mClusterBuildProgram->SetUniformMatrix4f("uInvProjection", glm::inverse(mClusterProjection));
+	glDispatchCompute((CLUSTER_COUNT + 63) / 64, 1, 1);
+
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
@@ -0,0 +1,88 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vector>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "Pass.h"
+#include "GPUBuffer.h"
+
+class PointShadowPass;
+class SpotShadowPass;
+
+/**
+ * @brief : Clustered forward lighting, assigns the scene point and spot lights to a 3D grid
+ * of view space clusters (screen tiles x logarithmic depth slices) with compute shaders.
+ * The lit pass then only walks the lights of the cluster a pixel falls in.
+*/
+class LightCullingPass : public Pass
+{
+	/**
+	 * @brief : std430 layout of a light, see LightCullCS.glsl
+	*/
+	struct GPULight
+	{
+		glm::vec4 PositionRange;
+		glm::vec4 ColorIntensity;
+		glm::vec4 Attenuation;
+		glm::vec4 DirectionCutoff;	// Cutoff < -1 for point lights
+		glm::vec4 ShadowParams;		// Cube map array slot, shadow far plane, spot shadow index (< 0 without shadow)
+	};
+
+public:
+	LightCullingPass(PointShadowPass* iPointShadowPass, SpotShadowPass* iSpotShadowPass);
+
+	void Execute(Scene* iScene) override;
+
+	/**
+	 * @brief : Bind the light lists and set the cluster lookup uniforms of a shading program
+	*/
+	void BindClusterResources(Program* iProgram, Scene* iScene);
+
+	uint32_t GetLightCount() const { return static_cast<uint32_t>(mGPULights.size()); }
+
+private:
+	void GatherLights(Scene* iScene);
+	void BuildClusters(Scene* iScene, uint32_t iWidth, uint32_t iHeight);
+
+	PointShadowPass* mPointShadowPass = nullptr;
+	SpotShadowPass* mSpotShadowPass = nullptr;
+
+	std::unique_ptr<Program> mClusterBuildProgram;
+
+	GPUBuffer mLightsBuffer;
+	GPUBuffer mClusterAABBBuffer;
+	GPUBuffer mClusterLightGridBuffer;
+	GPUBuffer mClusterLightIndicesBuffer;
+
+	std::vector<GPULight> mGPULights;
+
+	// Cluster AABBs only depend on the projection and the screen size
+	glm::mat4 mClusterProjection{ 0.f };
+	uint32_t mClusterWidth = 0;
+	uint32_t mClusterHeight = 0;
+};
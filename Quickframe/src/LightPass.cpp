@@ -22,6 +22,7 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <algorithm>
 #include <glm/vec3.hpp>
 
 #include "Engine.h"
@@ -31,15 +32,29 @@ SOFTWARE.
 #include "Defines.h"
 #include "MeshNode.h"
 #include "ShadowPass.h"
-
-LightPass::LightPass(ShadowPass* iShadowPass)
-	:mShadowPass(iShadowPass)
+#include "LightCullingPass.h"
+#include "GLStateCache.h"
+#include "ThreadPool.h"
+#include "VirtualTextureCache.h"
+#include "MaterialTable.h"
+
+LightPass::LightPass(ShadowPass* iShadowPass, LightCullingPass* iLightCullingPass)
+	:mShadowPass(iShadowPass),
+	mLightCullingPass(iLightCullingPass)
 {
-	Shader wTextureVertexShader("shaders/BlinnPhongVS.glsl", Shader::EShaderStage::eVertex);
-	Shader wTextureFragmentShader("shaders/BlinnPhongFS.glsl", Shader::EShaderStage::eFragment);
+	// Bit order of Material::kFeature* then kFeatureShadows
+	mVariants = std::make_unique<ProgramVariants>(
+		std::vector<ProgramVariants::Stage>{
+			{ "shaders/BlinnPhongVS.glsl", Shader::EShaderStage::eVertex },
+			{ "shaders/BlinnPhongFS.glsl", Shader::EShaderStage::eFragment } },
+		std::vector<std::string>{ "COLOR_TEX", "NORMAL_TEX", "SPECULAR_TEX", "VIRTUAL_COLOR_TEX", "SHADOWS" });
+
+	glGenQueries(2, mSamplesQueries);
+}
 
-	std::vector<Shader> wShaders{wTextureVertexShader, wTextureFragmentShader};
-	mProgram = std::make_unique<Program>(wShaders);	
+LightPass::~LightPass()
+{
+	glDeleteQueries(2, mSamplesQueries);
 }
 
 void LightPass::Execute(Scene* iScene)
@@ -47,166 +62,278 @@ void LightPass::Execute(Scene* iScene)
 
 	uint32_t wWidth, wHeight;
 	Engine::GetInstance()->GetWindow()->GetSize(wWidth, wHeight);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glViewport(0, 0, wWidth, wHeight);
-
-	// Send Uniforms
-	mProgram->Bind();
+	GLStateCache::GetInstance()->BindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLStateCache::GetInstance()->Viewport(0, 0, wWidth, wHeight);
 
-	SetLightUniforms(iScene);
-	mProgram->SetUniform3f("uCameraWorldPos", iScene->GetCamera()->WorldPos());
+	DirectionalLight* wDirLight = iScene->GetDirLight();
+	mPassFeatures = (wDirLight && wDirLight->IsShadowEnabled()) ? kFeatureShadows : 0;
 
-	for (auto wEntityMap : iScene->GetEntities())
+	// Every variant of this configuration may be drawn, they all need the frame uniforms
+	for (auto& wVariant : mVariantStates)
 	{
-		Entity* wEntity = wEntityMap.second.get();
-		glm::mat4 wTransform = iScene->GetCamera()->VPMatrix() * wEntity->GetTransform()->GetWorldMatrix();
-		glm::mat4 wWorldMatrix = wEntity->GetTransform()->GetWorldMatrix();
-		mProgram->SetUniformMatrix4f("uMVP", wTransform);
-		mProgram->SetUniformMatrix4f("uWorld", wWorldMatrix);
-		mProgram->SetUniformMatrix3f("uNormalMatrix", glm::transpose(glm::inverse(wWorldMatrix)));
-		mProgram->SetUniformMatrix4f("uLightMVP", iScene->GetDirLight()->GetView()->GetFrustum()->ProjectionMatrix() *
-			iScene->GetDirLight()->GetView()->ViewMatrix() * wWorldMatrix);
+		if ((wVariant.first & kFeatureShadows) == mPassFeatures)
+		{
+			wVariant.second.VariantProgram->Bind();
+			SetFrameUniforms(wVariant.second.VariantProgram, iScene);
+		}
+	}
 
-		const MeshNode* wEntityRoot = wEntity->GetMesh()->GetRootNode();
-		if (wEntityRoot)
+	mVisibleEntities.clear();
+	for (const auto& wEntityMap : iScene->GetEntities())
+	{
+		if (wEntityMap.second->IsDrawable())
 		{
-			RenderMeshNode(*wEntityRoot);
+			mVisibleEntities.push_back(wEntityMap.second.get());
 		}
 	}
 
-	mProgram->Unbind();
-}
+	const glm::mat4 wViewProj = iScene->GetCamera()->VPMatrix();
+	glm::mat4 wLightViewProj(1.f);
+	if (wDirLight)
+	{
+		View* wLightView = wDirLight->GetView();
+		wLightViewProj = wLightView->GetFrustum()->ProjectionMatrix() * wLightView->ViewMatrix();
+	}
 
-void LightPass::SetLightUniforms(Scene* iScene)
-{
-	mProgram->SetUniform1i("uDirLightNum", iScene->GetDirLightCount());
-	mProgram->SetUniform1i("uShadowEnabled", iScene->GetDirLight()->IsShadowEnabled());
-	
-	if (iScene->GetDirLight())
+	uint32_t wMissingKeys = RecordDraws(wViewProj, wLightViewProj);
+	if (wMissingKeys)
 	{
-		DirectionalLight* wDirLight = iScene->GetDirLight();
-		mProgram->SetUniform1f("uDirLight.Intensity", wDirLight->GetIntensity());
-		mProgram->SetUniform3f("uDirLight.Color", wDirLight->GetColor());
-		mProgram->SetUniform3f("uDirLight.Dir", glm::normalize(wDirLight->GetDir()));
-		mProgram->SetUniform1f("uDirLight.AmbientIntensity", wDirLight->GetAmbientIntensity());
+		// Material variants compile in the background and are drawn with the fallback meanwhile,
+		// the fallback itself is waited for since nothing could be drawn without it
+		bool wRecordAgain = false;
+		for (uint32_t wKey = 0; wKey < 32; wKey++)
+		{
+			if (wMissingKeys & (1u << wKey))
+			{
+				Program* wProgram = wKey == mPassFeatures ? mVariants->Get(wKey) : mVariants->Request(wKey);
+				if (wProgram)
+				{
+					PrepareVariant(wKey, wProgram, iScene);
+					wRecordAgain = true;
+				}
+			}
+		}
 
-		if (wDirLight->IsShadowEnabled())
+		if (wRecordAgain)
 		{
-			Framebuffer* wShadowMapFBO = mShadowPass->GetShadowFBOMap().at(wDirLight->GetID()).get();
-			wShadowMapFBO->BindSrc(SHADOW_MAP_0_TEXTURE_UNIT);
-			mProgram->SetUniform1i(SHADOW_MAP_0_TEXTURE_UNIFORM, SHADOW_MAP_0_TEXTURE_UNIFORM_IDX);
+			RecordDraws(wViewProj, wLightViewProj);
 		}
 	}
 
-	mProgram->SetUniform1i("uPointLightNum", iScene->GetPointLightCount());
-	for (uint32_t i = 0; i < iScene->GetPointLightCount(); i++)
+	// Depth is already laid down by the prepass, only shade the visible samples
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	if (mDepthPrepassEnabled)
 	{
-		char wUniformChar[128];
-		memset(wUniformChar, 0, sizeof(wUniformChar));
+		wStateCache->SetDepthFunc(GL_EQUAL);
+		wStateCache->SetDepthMask(false);
+	}
 
-		_snprintf_s(wUniformChar, sizeof(wUniformChar), "uPointLight[%d].Intensity", i);
-		mProgram->SetUniform1f(std::string(wUniformChar), iScene->GetPointLight(i)->GetIntensity());
+	// Read back the query issued last frame, never wait for the GPU
+	const uint32_t wPrevQuery = mQueryIndex ^ 1;
+	if (mSamplesQueryIssued[wPrevQuery])
+	{
+		GLuint wAvailable = GL_FALSE;
+		glGetQueryObjectuiv(mSamplesQueries[wPrevQuery], GL_QUERY_RESULT_AVAILABLE, &wAvailable);
+		if (wAvailable)
+		{
+			GLuint64 wSamples = 0;
+			glGetQueryObjectui64v(mSamplesQueries[wPrevQuery], GL_QUERY_RESULT, &wSamples);
+			mOverdraw = static_cast<float>(wSamples) / static_cast<float>(std::max(1u, wWidth * wHeight));
+		}
+	}
 
-		_snprintf_s(wUniformChar, sizeof(wUniformChar), "uPointLight[%d].Color", i);
-		mProgram->SetUniform3f(std::string(wUniformChar), iScene->GetPointLight(i)->GetColor());
+	VirtualTextureCache::GetInstance()->BindResources();
+	MaterialTable::GetInstance()->Bind();
 
-		_snprintf_s(wUniformChar, sizeof(wUniformChar), "uPointLight[%d].Position", i);
-		mProgram->SetUniform3f(std::string(wUniformChar), iScene->GetPointLight(i)->GetPos());
+	glBeginQuery(GL_SAMPLES_PASSED, mSamplesQueries[mQueryIndex]);
 
-		_snprintf_s(wUniformChar, sizeof(wUniformChar), "uPointLight[%d].Atten.Constant", i);
-		mProgram->SetUniform1f(std::string(wUniformChar), iScene->GetPointLight(i)->GetAttenuation().Constant);
+	// Chunks are contiguous ranges, replaying them in order keeps the original draw order
+	for (const CommandBuffer& wCmdBuffer : mCommandBuffers)
+	{
+		wCmdBuffer.Execute();
+	}
 
-		_snprintf_s(wUniformChar, sizeof(wUniformChar), "uPointLight[%d].Atten.Linear", i);
-		mProgram->SetUniform1f(std::string(wUniformChar), iScene->GetPointLight(i)->GetAttenuation().Linear);
+	glEndQuery(GL_SAMPLES_PASSED);
+	mSamplesQueryIssued[mQueryIndex] = true;
+	mQueryIndex ^= 1;
 
-		_snprintf_s(wUniformChar, sizeof(wUniformChar), "uPointLight[%d].Atten.Exp", i);
-		mProgram->SetUniform1f(std::string(wUniformChar), iScene->GetPointLight(i)->GetAttenuation().Linear);
+	if (mDepthPrepassEnabled)
+	{
+		wStateCache->SetDepthFunc(GL_LESS);
+		wStateCache->SetDepthMask(true);
 	}
+}
 
-	mProgram->SetUniform1i("uSpotLightNum", iScene->GetSpotLightCount());
-	for (uint32_t i = 0; i < iScene->GetSpotLightCount(); i++)
+void LightPass::PrepareVariant(uint32_t iKey, Program* iProgram, Scene* iScene)
+{
+	Variant& wVariant = mVariantStates[iKey];
+	wVariant.Key = iKey;
+	wVariant.VariantProgram = iProgram;
+	wVariant.Uniforms.MVP = iProgram->FindUniformLocation("uMVP");
+	wVariant.Uniforms.World = iProgram->FindUniformLocation("uWorld");
+	wVariant.Uniforms.NormalMatrix = iProgram->FindUniformLocation("uNormalMatrix");
+	wVariant.Uniforms.LightMVP = iProgram->FindUniformLocation("uLightMVP");
+
+	// Samplers never move between texture units
+	iProgram->Bind();
+	iProgram->SetUniform1i(COLOR_TEXTURE_UNIFORM, COLOR_TEXTURE_UNIFORM_IDX);
+	iProgram->SetUniform1i(NORMAL_TEXTURE_UNIFORM, NORMAL_TEXTURE_UNIFORM_IDX);
+	iProgram->SetUniform1i(SPECULAR_EXPONENT_TEXTURE_UNIFORM, SPECULAR_EXPONENT_TEXTURE_UNIFORM_IDX);
+	iProgram->SetUniform1i(VIRTUAL_TEXTURE_CACHE_TEXTURE_UNIFORM, VIRTUAL_TEXTURE_CACHE_TEXTURE_UNIFORM_IDX);
+	for (int i = 0; i < TEXTURE_ARRAY_COUNT; i++)
 	{
-		const SpotLight* wSpotLight = iScene->GetSpotLight(i);
-		char wUniformChar[128];
-		memset(wUniformChar, 0, sizeof(wUniformChar));
+		iProgram->SetUniform1i(TEXTURE_ARRAYS_UNIFORM "[" + std::to_string(i) + "]", TEXTURE_ARRAY_0_TEXTURE_UNIFORM_IDX + i);
+	}
+	iProgram->SetUniform1i(SHADOW_MAP_0_TEXTURE_UNIFORM, SHADOW_MAP_0_TEXTURE_UNIFORM_IDX);
+	iProgram->SetUniform1i(VIRTUAL_SHADOW_POOL_TEXTURE_UNIFORM, VIRTUAL_SHADOW_POOL_TEXTURE_UNIFORM_IDX);
+
+	SetFrameUniforms(iProgram, iScene);
+}
 
-		_snprintf_s(wUniformChar, sizeof(wUniformChar), "uSpotLight[%d].PL.Intensity", i);
-		mProgram->SetUniform1f(std::string(wUniformChar), wSpotLight->GetIntensity());
+void LightPass::SetFrameUniforms(Program* iProgram, Scene* iScene)
+{
+	iProgram->SetUniform1i("uDirLightNum", iScene->GetDirLightCount());
+	iProgram->SetUniform3f("uCameraWorldPos", iScene->GetCamera()->WorldPos());
+	
+	if (iScene->GetDirLight())
+	{
+		DirectionalLight* wDirLight = iScene->GetDirLight();
+		iProgram->SetUniform1f("uDirLight.Intensity", wDirLight->GetIntensity());
+		iProgram->SetUniform3f("uDirLight.Color", wDirLight->GetColor());
+		iProgram->SetUniform3f("uDirLight.Dir", glm::normalize(wDirLight->GetDir()));
+		iProgram->SetUniform1f("uDirLight.AmbientIntensity", wDirLight->GetAmbientIntensity());
 
-		_snprintf_s(wUniformChar, sizeof(wUniformChar), "uSpotLight[%d].PL.Color", i);
-		mProgram->SetUniform3f(std::string(wUniformChar), wSpotLight->GetColor());
+		if (wDirLight->IsShadowEnabled())
+		{
+			mShadowPass->BindShadowResources(iProgram, wDirLight->GetID());
+		}
+	}
 
-		_snprintf_s(wUniformChar, sizeof(wUniformChar), "uSpotLight[%d].PL.Position", i);
-		mProgram->SetUniform3f(std::string(wUniformChar), wSpotLight->GetPos());
+	// Point and spot lights are read from the cluster light lists
+	mLightCullingPass->BindClusterResources(iProgram, iScene);
+}
 
-		_snprintf_s(wUniformChar, sizeof(wUniformChar), "uSpotLight[%d].PL.Atten.Constant", i);
-		mProgram->SetUniform1f(std::string(wUniformChar), wSpotLight->GetAttenuation().Constant);
+uint32_t LightPass::RecordDraws(const glm::mat4& iViewProj, const glm::mat4& iLightViewProj)
+{
+	// Build the draw list on all cores, each chunk into its own command buffer
+	ThreadPool* wThreadPool = ThreadPool::GetInstance();
+	mCommandBuffers.resize(wThreadPool->GetMaxChunkCount());
+	mChunkMissingKeys.assign(wThreadPool->GetMaxChunkCount(), 0);
+	for (CommandBuffer& wCmdBuffer : mCommandBuffers)
+	{
+		wCmdBuffer.Reset();
+	}
 
-		_snprintf_s(wUniformChar, sizeof(wUniformChar), "uSpotLight[%d].PL.Atten.Linear", i);
-		mProgram->SetUniform1f(std::string(wUniformChar), wSpotLight->GetAttenuation().Linear);
+	wThreadPool->ParallelFor(static_cast<uint32_t>(mVisibleEntities.size()),
+		[&](uint32_t iBegin, uint32_t iEnd, uint32_t iChunk)
+		{
+			CommandBuffer& wCmdBuffer = mCommandBuffers[iChunk];
+			RecordState wState;
+			for (uint32_t i = iBegin; i < iEnd; i++)
+			{
+				RecordEntity(mVisibleEntities[i], iViewProj, iLightViewProj, wState, wCmdBuffer);
+			}
+			mChunkMissingKeys[iChunk] = wState.MissingKeys;
+		});
+
+	uint32_t wMissingKeys = 0;
+	for (uint32_t wChunkKeys : mChunkMissingKeys)
+	{
+		wMissingKeys |= wChunkKeys;
+	}
+	return wMissingKeys;
+}
 
-		_snprintf_s(wUniformChar, sizeof(wUniformChar), "uSpotLight[%d].PL.Atten.Exp", i);
-		mProgram->SetUniform1f(std::string(wUniformChar), wSpotLight->GetAttenuation().Linear);
+void LightPass::RecordEntity(Entity* iEntity, const glm::mat4& iViewProj, const glm::mat4& iLightViewProj, RecordState& ioState,
+	CommandBuffer& oCmdBuffer) const
+{
+	const MeshNode* wEntityRoot = iEntity->GetMesh()->GetRootNode();
+	if (!wEntityRoot)
+	{
+		return;
+	}
 
-		_snprintf_s(wUniformChar, sizeof(wUniformChar), "uSpotLight[%d].Cutoff", i);
-		mProgram->SetUniform1f(std::string(wUniformChar), wSpotLight->GetCutoff());
+	EntityUniforms wEntityUniforms;
+	wEntityUniforms.World = iEntity->GetTransform()->GetWorldMatrix();
+	wEntityUniforms.MVP = iViewProj * wEntityUniforms.World;
+	wEntityUniforms.NormalMatrix = glm::transpose(glm::inverse(glm::mat3(wEntityUniforms.World)));
+	wEntityUniforms.LightMVP = iLightViewProj * wEntityUniforms.World;
 
-		_snprintf_s(wUniformChar, sizeof(wUniformChar), "uSpotLight[%d].Dir", i);
-		mProgram->SetUniform3f(std::string(wUniformChar), wSpotLight->GetDirection());
+	if (ioState.Current)
+	{
+		SetEntityUniforms(*ioState.Current, wEntityUniforms, oCmdBuffer);
 	}
+
+	RecordMeshNode(*wEntityRoot, wEntityUniforms, ioState, oCmdBuffer);
 }
 
-void LightPass::RenderMeshNode(const MeshNode& iMeshNode)
+void LightPass::RecordMeshNode(const MeshNode& iMeshNode, const EntityUniforms& iEntityUniforms, RecordState& ioState,
+	CommandBuffer& oCmdBuffer) const
 {
 	for (const auto& wSubMesh : iMeshNode.GetSubmeshes())
 	{
-		glBindVertexArray(wSubMesh.VertexArrayHandle());
-		glEnableVertexAttribArray(SubMesh::EVertexAttrib::ePosition);
-		glEnableVertexAttribArray(SubMesh::EVertexAttrib::eNormal);
+		Material* wSubMeshMaterial = wSubMesh.GetMaterial();
 
-		mProgram->SetUniform1i("uColorTexAvailable", 0);
-		mProgram->SetUniform1i("uSpecularTexAvailable", 0);
-		mProgram->SetUniform1i("uNormalTexAvailable", 0);
-
-		if (wSubMesh.GetMaterial()->GetDiffuseTex())
+		// Submeshes sharing a material configuration share the program, switch only on change
+		const uint32_t wKey = wSubMeshMaterial->GetShaderFeatures() | mPassFeatures;
+		if (!ioState.Current || ioState.Current->Key != wKey)
 		{
-			mProgram->SetUniform1i("uColorTexAvailable", 1);
-			glEnableVertexAttribArray(SubMesh::EVertexAttrib::eUV0);
-			Material* wSubMeshMaterial = wSubMesh.GetMaterial();
-			wSubMeshMaterial->GetDiffuseTex()->Bind(COLOR_TEXTURE_UNIT);
-			mProgram->SetUniform1i(COLOR_TEXTURE_UNIFORM, COLOR_TEXTURE_UNIFORM_IDX);
+			auto wIt = mVariantStates.find(wKey);
+			if (wIt == mVariantStates.end())
+			{
+				// Still compiling, draw without the material textures until it is ready
+				ioState.MissingKeys |= 1u << wKey;
+				wIt = mVariantStates.find(mPassFeatures);
+				if (wIt == mVariantStates.end())
+				{
+					ioState.MissingKeys |= 1u << mPassFeatures;
+					continue;
+				}
+			}
+
+			if (ioState.Current != &wIt->second)
+			{
+				ioState.Current = &wIt->second;
+				oCmdBuffer.BindProgram(ioState.Current->VariantProgram->GetHandle());
+				SetEntityUniforms(*ioState.Current, iEntityUniforms, oCmdBuffer);
+			}
 		}
 
-		if (wSubMesh.GetMaterial()->GetNormalTex())
+		oCmdBuffer.BindVertexArray(wSubMesh.VertexArrayHandle());
+
+		// Colors and packed textures come from the material table, only the textures left out of the arrays are bound
+		Texture* wDiffuseTex = wSubMeshMaterial->GetDiffuseTex();
+		Texture* wNormalTex = wSubMeshMaterial->GetNormalTex();
+		Texture* wSpecularTex = wSubMeshMaterial->GetSpecularExponentTex();
+
+		if (wDiffuseTex && !MaterialTable::IsPacked(wDiffuseTex))
 		{
-			mProgram->SetUniform1i("uNormalTexAvailable", 1);
-			glEnableVertexAttribArray(SubMesh::EVertexAttrib::eTangent);
-			Material* wSubMeshMaterial = wSubMesh.GetMaterial();
-			wSubMeshMaterial->GetNormalTex()->Bind(NORMAL_TEXTURE_UNIT);
-			mProgram->SetUniform1i(NORMAL_TEXTURE_UNIFORM, NORMAL_TEXTURE_UNIFORM_IDX);
+			oCmdBuffer.BindTexture(COLOR_TEXTURE_UNIT, wDiffuseTex->GetTarget(), wDiffuseTex->GetHandle());
 		}
 
-		if (wSubMesh.GetMaterial()->GetSpecularExponentTex())
+		if (wNormalTex && !MaterialTable::IsPacked(wNormalTex))
 		{
-			mProgram->SetUniform1i("uSpecularTexAvailable", 1);
-			Material* wSubMeshMaterial = wSubMesh.GetMaterial();
-			wSubMeshMaterial->GetDiffuseTex()->Bind(SPECULAR_EXPONENT_TEXTURE_UNIT);
-			mProgram->SetUniform1i(SPECULAR_EXPONENT_TEXTURE_UNIFORM, SPECULAR_EXPONENT_TEXTURE_UNIFORM_IDX);
+			oCmdBuffer.BindTexture(NORMAL_TEXTURE_UNIT, wNormalTex->GetTarget(), wNormalTex->GetHandle());
 		}
 
-		mProgram->SetUniform3f("uMaterial.Ambient", wSubMesh.GetMaterial()->GetAmbientColor());
-		mProgram->SetUniform3f("uMaterial.Diffuse", wSubMesh.GetMaterial()->GetDiffuseColor());
-		mProgram->SetUniform3f("uMaterial.Specular", wSubMesh.GetMaterial()->GetSpecularColor());
-		mProgram->SetUniform1f("uMaterial.SpecularExponent", wSubMesh.GetMaterial()->GetSpecularExponent());
-
-		glDrawElements(GL_TRIANGLES, wSubMesh.IndexCount(), GL_UNSIGNED_INT, 0);
-		glDisableVertexAttribArray(SubMesh::EVertexAttrib::ePosition);
-		glDisableVertexAttribArray(SubMesh::EVertexAttrib::eUV0);
+		if (wSpecularTex && !MaterialTable::IsPacked(wSpecularTex))
+		{
+			oCmdBuffer.BindTexture(SPECULAR_EXPONENT_TEXTURE_UNIT, wSpecularTex->GetTarget(), wSpecularTex->GetHandle());
+		}
 
+		oCmdBuffer.DrawIndexedBaseInstance(wSubMesh.IndexCount(), wSubMeshMaterial->GetTableIndex());
 	}
 
 	for (auto& wChildren : iMeshNode.GetChildren())
 	{
-		RenderMeshNode(wChildren);
+		RecordMeshNode(wChildren, iEntityUniforms, ioState, oCmdBuffer);
 	}
 }
+
+void LightPass::SetEntityUniforms(const Variant& iVariant, const EntityUniforms& iEntityUniforms, CommandBuffer& oCmdBuffer) const
+{
+	oCmdBuffer.SetUniformMatrix4f(iVariant.Uniforms.MVP, iEntityUniforms.MVP);
+	oCmdBuffer.SetUniformMatrix4f(iVariant.Uniforms.World, iEntityUniforms.World);
+	oCmdBuffer.SetUniformMatrix3f(iVariant.Uniforms.NormalMatrix, iEntityUniforms.NormalMatrix);
+	oCmdBuffer.SetUniformMatrix4f(iVariant.Uniforms.LightMVP, iEntityUniforms.LightMVP);
+}
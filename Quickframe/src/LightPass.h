@@ -24,20 +24,117 @@ SOFTWARE.
 
 #pragma once
 
+#include <unordered_map>
+#include <vector>
+
 #include "Pass.h"
+#include "CommandBuffer.h"
+#include "ProgramVariants.h"
+#include "Material.h"
 
+class Entity;
 class MeshNode;
 class ShadowPass;
+class LightCullingPass;
 
 class LightPass : public Pass
 {
+	/**
+	 * @brief : Per draw uniform locations, resolved once so recording threads never touch GL
+	*/
+	struct DrawUniforms
+	{
+		GLint MVP = -1;
+		GLint World = -1;
+		GLint NormalMatrix = -1;
+		GLint LightMVP = -1;
+	};
+
+	struct Variant
+	{
+		uint32_t Key = 0;
+		Program* VariantProgram = nullptr;
+		DrawUniforms Uniforms;
+	};
+
+	/**
+	 * @brief : Entity uniforms, set again whenever the program changes inside the entity
+	*/
+	struct EntityUniforms
+	{
+		glm::mat4 MVP;
+		glm::mat4 World;
+		glm::mat3 NormalMatrix;
+		glm::mat4 LightMVP;
+	};
+
+	/**
+	 * @brief : Recording state of one command buffer
+	*/
+	struct RecordState
+	{
+		const Variant* Current = nullptr;
+		uint32_t MissingKeys = 0;		// Bit per variant key that isn't ready yet
+	};
+
 public:
-	LightPass(ShadowPass* iShadowPass);
+	// Pass level permutation bit, after the material ones
+	static constexpr uint32_t kFeatureShadows = 1 << Material::kFeatureCount;
+
+	LightPass(ShadowPass* iShadowPass, LightCullingPass* iLightCullingPass);
+	~LightPass();
 
 	void Execute(Scene* iScene) override;
 
+	/**
+	 * @brief : Average number of shaded samples per pixel, measured a frame late to avoid stalls
+	 * 1.0 means every visible pixel was shaded exactly once
+	*/
+	float GetOverdraw() const { return mOverdraw; }
+
+	/**
+	 * @brief : Shade only the samples matching the depth laid down by the DepthPrepass
+	*/
+	void SetDepthPrepassEnabled(bool iEnabled) { mDepthPrepassEnabled = iEnabled; }
+
 private:
-	void SetLightUniforms(Scene* iScene);
-	void RenderMeshNode(const MeshNode& iMeshNode);
+	/**
+	 * @brief : Register a compiled variant for drawing and give it the frame uniforms
+	*/
+	void PrepareVariant(uint32_t iKey, Program* iProgram, Scene* iScene);
+	void SetFrameUniforms(Program* iProgram, Scene* iScene);
+
+	/**
+	 * @return the mask of the variant keys that were needed but not ready, their draws use the pass fallback variant
+	*/
+	uint32_t RecordDraws(const glm::mat4& iViewProj, const glm::mat4& iLightViewProj);
+
+	/**
+	 * @brief : Record the draws of an entity, called from worker threads
+	*/
+	void RecordEntity(Entity* iEntity, const glm::mat4& iViewProj, const glm::mat4& iLightViewProj, RecordState& ioState,
+		CommandBuffer& oCmdBuffer) const;
+	void RecordMeshNode(const MeshNode& iMeshNode, const EntityUniforms& iEntityUniforms, RecordState& ioState,
+		CommandBuffer& oCmdBuffer) const;
+	void SetEntityUniforms(const Variant& iVariant, const EntityUniforms& iEntityUniforms, CommandBuffer& oCmdBuffer) const;
+
 	ShadowPass* mShadowPass = nullptr;
+	LightCullingPass* mLightCullingPass = nullptr;
+
+	// Keyed by material features | pass features, materials pick their key once at load
+	std::unique_ptr<ProgramVariants> mVariants;
+	std::unordered_map<uint32_t, Variant> mVariantStates;
+	uint32_t mPassFeatures = 0;
+	std::vector<uint32_t> mChunkMissingKeys;
+
+	// One command buffer per ParallelFor chunk, replayed in chunk order
+	std::vector<CommandBuffer> mCommandBuffers;
+	std::vector<Entity*> mVisibleEntities;
+
+	// GL_SAMPLES_PASSED queries, double buffered
+	GLuint mSamplesQueries[2] = { 0 };
+	bool mSamplesQueryIssued[2] = { false };
+	uint32_t mQueryIndex = 0;
+	float mOverdraw = 0.f;
+	bool mDepthPrepassEnabled = false;
 };
\ No newline at end of file
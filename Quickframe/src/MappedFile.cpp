@@ -0,0 +1,143 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& iPath)
+{
+	Close();
+
+	HANDLE wFile = CreateFileA(iPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (wFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER wSize;
+	if (!GetFileSizeEx(wFile, &wSize) || wSize.QuadPart == 0)
+	{
+		CloseHandle(wFile);
+		return false;
+	}
+
+	HANDLE wMapping = CreateFileMappingA(wFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!wMapping)
+	{
+		CloseHandle(wFile);
+		return false;
+	}
+
+	const void* wView = MapViewOfFile(wMapping, FILE_MAP_READ, 0, 0, 0);
+	if (!wView)
+	{
+		CloseHandle(wMapping);
+		CloseHandle(wFile);
+		return false;
+	}
+
+	mFileHandle = wFile;
+	mMappingHandle = wMapping;
+	mData = static_cast<const uint8_t*>(wView);
+	mSize = static_cast<size_t>(wSize.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (mData)
+	{
+		UnmapViewOfFile(mData);
+		CloseHandle(mMappingHandle);
+		CloseHandle(mFileHandle);
+	}
+
+	mData = nullptr;
+	mSize = 0;
+	mFileHandle = nullptr;
+	mMappingHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& iPath)
+{
+	Close();
+
+	int wFile = open(iPath.c_str(), O_RDONLY);
+	if (wFile < 0)
+	{
+		return false;
+	}
+
+	struct stat wStat;
+	if (fstat(wFile, &wStat) != 0 || wStat.st_size == 0)
+	{
+		close(wFile);
+		return false;
+	}
+
+	// The mapping keeps its own reference to the file
+	void* wView = mmap(nullptr, static_cast<size_t>(wStat.st_size), PROT_READ, MAP_PRIVATE, wFile, 0);
+	close(wFile);
+	if (wView == MAP_FAILED)
+	{
+		return false;
+	}
+
+	mData = static_cast<const uint8_t*>(wView);
+	mSize = static_cast<size_t>(wStat.st_size);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (mData)
+	{
+		munmap(const_cast<uint8_t*>(mData), mSize);
+	}
+
+	mData = nullptr;
+	mSize = 0;
+}
+
+#endif
@@ -26,20 +26,53 @@ SOFTWARE.
 
 #include "Material.h"
 #include "TextureManager.h"
+#include "VirtualTextureCache.h"
+#include "MaterialTable.h"
+
+Material::Material()
+{
+	mTableIndex = MaterialTable::GetInstance()->Register(this);
+}
+
+Material::~Material()
+{
+	MaterialTable::GetInstance()->Unregister(mTableIndex);
+
+	TextureManager* wTextureManager = TextureManager::GetInstance();
+	wTextureManager->ReleaseTexture(mDiffuseTex);
+	wTextureManager->ReleaseTexture(mNormalTex);
+	wTextureManager->ReleaseTexture(mSpecularExponentTex);
+}
 
 void Material::LoadDiffuseTex(const std::string& iPath)
 {
+	VirtualTextureCache* wVirtualTextures = VirtualTextureCache::GetInstance();
+	if (wVirtualTextures->IsEnabled())
+	{
+		// Streamed by tiles, never loaded as a whole
+		mVirtualColorTex = wVirtualTextures->Register(iPath);
+		const bool wValid = mVirtualColorTex != VirtualTextureCache::kInvalidId;
+		mShaderFeatures = wValid ? (mShaderFeatures | kFeatureVirtualColorTex) : (mShaderFeatures & ~kFeatureVirtualColorTex);
+		return;
+	}
+
+	TextureManager::GetInstance()->ReleaseTexture(mDiffuseTex);
 	mDiffuseTex = TextureManager::GetInstance()->GetTexture(GL_TEXTURE_2D, iPath);
+	mShaderFeatures = mDiffuseTex ? (mShaderFeatures | kFeatureColorTex) : (mShaderFeatures & ~kFeatureColorTex);
 }
 
 void Material::LoadNormalTex(const std::string& iPath)
 {
-	mNormalTex = TextureManager::GetInstance()->GetTexture(GL_TEXTURE_2D, iPath);
+	TextureManager::GetInstance()->ReleaseTexture(mNormalTex);
+	mNormalTex = TextureManager::GetInstance()->GetTexture(GL_TEXTURE_2D, iPath, Texture::EUsage::eNormal);
+	mShaderFeatures = mNormalTex ? (mShaderFeatures | kFeatureNormalTex) : (mShaderFeatures & ~kFeatureNormalTex);
 }
 
 void Material::LoadSpecularExponentTex(const std::string& iPath)
 {
-	mSpecularExponentTex = TextureManager::GetInstance()->GetTexture(GL_TEXTURE_2D, iPath);
+	TextureManager::GetInstance()->ReleaseTexture(mSpecularExponentTex);
+	mSpecularExponentTex = TextureManager::GetInstance()->GetTexture(GL_TEXTURE_2D, iPath, Texture::EUsage::eScalar);
+	mShaderFeatures = mSpecularExponentTex ? (mShaderFeatures | kFeatureSpecularTex) : (mShaderFeatures & ~kFeatureSpecularTex);
 }
 
 Texture* Material::GetDiffuseTex() const
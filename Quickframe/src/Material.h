@@ -25,6 +25,7 @@ SOFTWARE.
 #pragma once
 
 #include <glm/vec3.hpp>
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -33,8 +34,22 @@ class Texture;
 struct Material
 {
 public:
-	Material(){}
-	
+	// Shader permutation bits, the defines are listed by the passes in the same order
+	static constexpr uint32_t kFeatureColorTex = 1 << 0;
+	static constexpr uint32_t kFeatureNormalTex = 1 << 1;
+	static constexpr uint32_t kFeatureSpecularTex = 1 << 2;
+	static constexpr uint32_t kFeatureVirtualColorTex = 1 << 3;
+	static constexpr uint32_t kFeatureCount = 4;
+
+	Material();
+	Material(const Material& iOther) = delete;
+	void operator=(const Material&) = delete;
+
+	/**
+	 * @brief : Releases the textures taken from TextureManager
+	*/
+	~Material();
+
 	void LoadDiffuseTex(const std::string& iPath);
 	void LoadNormalTex(const std::string& iPath);
 	void LoadSpecularExponentTex(const std::string& iPath);
@@ -42,6 +57,16 @@ public:
 	Texture* GetDiffuseTex() const;
 	Texture* GetNormalTex() const;
 	Texture* GetSpecularExponentTex() const;
+
+	/**
+	 * @brief : Id of the color map in VirtualTextureCache, used instead of GetDiffuseTex when virtual texturing is enabled
+	*/
+	uint32_t GetVirtualColorTex() const { return mVirtualColorTex; }
+
+	/**
+	 * @brief : Record of the material in MaterialTable, passed to the shaders as the draw base instance
+	*/
+	uint32_t GetTableIndex() const { return mTableIndex; }
 	
 	void SetAmbientColor(const glm::vec3 iAmbientColor) 
 	{
@@ -75,13 +100,22 @@ public:
 
 	float GetSpecularExponent() const { return mSpecularExponent; }
 
+	/**
+	 * @brief : Variant key of the material, fixed once its textures are loaded
+	*/
+	uint32_t GetShaderFeatures() const { return mShaderFeatures; }
+
 private:
 	Texture* mDiffuseTex = nullptr;
 	Texture* mNormalTex = nullptr;
 	Texture* mSpecularExponentTex = nullptr;
+	uint32_t mVirtualColorTex = UINT32_MAX;		// VirtualTextureCache::kInvalidId
 
 	glm::vec3 mAmbientColor{0.f, 0.f, 0.f};
 	glm::vec3 mDiffuseColor{0.f, 0.f, 0.f};
 	glm::vec3 mSpecularColor{0.f, 0.f, 0.f};
 	float mSpecularExponent = 16.f;
+
+	uint32_t mShaderFeatures = 0;
+	uint32_t mTableIndex = UINT32_MAX;			// MaterialTable::kInvalidIndex
 };
\ No newline at end of file
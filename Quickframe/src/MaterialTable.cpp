@@ -0,0 +1,141 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstring>
+
+#include "MaterialTable.h"
+#include "Material.h"
+#include "Texture.h"
+#include "TextureArrayPool.h"
+#include "VirtualTextureCache.h"
+#include "Defines.h"
+
+MaterialTable* MaterialTable::mMaterialTable = nullptr;
+
+MaterialTable* MaterialTable::GetInstance()
+{
+	if (!mMaterialTable)
+	{
+		mMaterialTable = new MaterialTable();
+	}
+
+	return mMaterialTable;
+}
+
+uint32_t MaterialTable::Register(const Material* iMaterial)
+{
+	std::lock_guard<std::mutex> wLock(mMutex);
+	if (!mFreeIndices.empty())
+	{
+		const uint32_t wIndex = mFreeIndices.back();
+		mFreeIndices.pop_back();
+		mMaterials[wIndex] = iMaterial;
+		return wIndex;
+	}
+
+	mMaterials.push_back(iMaterial);
+	return static_cast<uint32_t>(mMaterials.size() - 1);
+}
+
+void MaterialTable::Unregister(uint32_t iIndex)
+{
+	if (iIndex == kInvalidIndex)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> wLock(mMutex);
+	mMaterials[iIndex] = nullptr;
+	mFreeIndices.push_back(iIndex);
+}
+
+int MaterialTable::PackedLocation(const Texture* iTexture)
+{
+	if (!IsPacked(iTexture))
+	{
+		return -1;
+	}
+
+	return (iTexture->GetArrayIndex() << 16) | iTexture->GetArrayLayer();
+}
+
+bool MaterialTable::IsPacked(const Texture* iTexture)
+{
+	return iTexture && iTexture->GetArrayIndex() >= 0;
+}
+
+void MaterialTable::Update()
+{
+	VirtualTextureCache* wVirtualTextures = VirtualTextureCache::GetInstance();
+	{
+		std::lock_guard<std::mutex> wLock(mMutex);
+		mRecords.resize(mMaterials.size());
+		for (size_t i = 0; i < mMaterials.size(); i++)
+		{
+			const Material* wMaterial = mMaterials[i];
+			Record& wRecord = mRecords[i];
+			if (!wMaterial)
+			{
+				std::memset(&wRecord, 0, sizeof(Record));
+				continue;
+			}
+
+			wRecord.Ambient = glm::vec4(wMaterial->GetAmbientColor(), 1.f);
+			wRecord.DiffuseExponent = glm::vec4(wMaterial->GetDiffuseColor(), wMaterial->GetSpecularExponent());
+			wRecord.Specular = glm::vec4(wMaterial->GetSpecularColor(), 1.f);
+			wRecord.Textures = glm::ivec4(PackedLocation(wMaterial->GetDiffuseTex()), PackedLocation(wMaterial->GetNormalTex()),
+				PackedLocation(wMaterial->GetSpecularExponentTex()), -1);
+			wRecord.VirtualTexture = wVirtualTextures->GetShaderParams(wMaterial->GetVirtualColorTex());
+		}
+	}
+
+	if (mRecords.empty())
+	{
+		return;
+	}
+
+	if (mRecords.size() == mUploadedRecords.size() &&
+		std::memcmp(mRecords.data(), mUploadedRecords.data(), mRecords.size() * sizeof(Record)) == 0)
+	{
+		return;
+	}
+
+	if (!mBuffer)
+	{
+		mBuffer = std::make_unique<GPUBuffer>(GL_SHADER_STORAGE_BUFFER);
+	}
+
+	mBuffer->Upload(mRecords.data(), mRecords.size() * sizeof(Record));
+	mUploadedRecords = mRecords;
+}
+
+void MaterialTable::Bind()
+{
+	if (mBuffer)
+	{
+		mBuffer->BindBase(MATERIAL_TABLE_SSBO_BINDING);
+	}
+
+	TextureArrayPool::GetInstance()->Bind();
+}
@@ -0,0 +1,101 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <glm/vec4.hpp>
+
+#include "GPUBuffer.h"
+
+struct Material;
+class Texture;
+
+/**
+ * @brief : Shader storage table of every live material, indexed by the base instance of the draws.
+ * A record holds the colors and, for each texture packed by TextureArrayPool, its (array, layer) pair so
+ * the lit passes only bind the vertex array between two draws of the same program.
+ * Records are rebuilt once per frame and uploaded when they changed.
+*/
+class MaterialTable
+{
+	/**
+	 * @brief : std430 layout, keep in sync with MaterialRecord in the shaders
+	*/
+	struct Record
+	{
+		glm::vec4 Ambient;
+		glm::vec4 DiffuseExponent;		// Diffuse color and specular exponent
+		glm::vec4 Specular;
+		glm::ivec4 Textures;			// Color, normal, specular : array << 16 | layer, -1 when bound per draw
+		glm::ivec4 VirtualTexture;		// VirtualTextureCache::GetShaderParams
+	};
+
+public:
+	static constexpr uint32_t kInvalidIndex = UINT32_MAX;
+
+	MaterialTable(MaterialTable& iOther) = delete;
+	void operator=(const MaterialTable&) = delete;
+
+	static MaterialTable* GetInstance();
+
+	/**
+	 * @brief : Reserve a record for a new material, safe from any thread
+	*/
+	uint32_t Register(const Material* iMaterial);
+	void Unregister(uint32_t iIndex);
+
+	/**
+	 * @brief : Rebuild the records and upload them if they changed, once per frame on the main thread
+	*/
+	void Update();
+
+	/**
+	 * @brief : Bind the table and the texture arrays it refers to
+	*/
+	void Bind();
+
+	/**
+	 * @brief : Whether the texture is sampled from its array, it doesn't have to be bound then
+	*/
+	static bool IsPacked(const Texture* iTexture);
+
+private:
+	MaterialTable() {}
+
+	static int PackedLocation(const Texture* iTexture);
+
+	static MaterialTable* mMaterialTable;
+
+	std::mutex mMutex;
+	std::vector<const Material*> mMaterials;		// nullptr for the free records
+	std::vector<uint32_t> mFreeIndices;
+
+	std::vector<Record> mRecords;
+	std::vector<Record> mUploadedRecords;
+	std::unique_ptr<GPUBuffer> mBuffer;
+};
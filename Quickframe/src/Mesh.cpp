@@ -22,7 +22,10 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <algorithm>
+#include <cctype>
 #include <chrono>
+#include <cstring>
 #include <vector>
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -33,11 +36,15 @@ SOFTWARE.
 #include <spdlog/spdlog.h>
 
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "ObjImporter.h"
+#include "GltfImporter.h"
 #include "Vertex.h"
 #include "TextureManager.h"
 #include "Transform.h"
 #include "SubMesh.h"
 #include "MeshNode.h"
+#include "GLStateCache.h"
 
 using namespace std::chrono;
 
@@ -45,238 +52,417 @@ Mesh::Mesh()
 {
 }
 
-bool Mesh::Load(const std::string& iFilename)
+bool Mesh::Load(const std::string& iFilename, EImporter iImporter)
 {
 	auto wClockStart = high_resolution_clock::now();
 
-	mDirectory = iFilename.substr(0, iFilename.find_last_of('/'));
-
-	Assimp::Importer wImporter;
-	const aiScene* wScene = wImporter.ReadFile(iFilename,
-		aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices | aiProcess_CalcTangentSpace);
-
-	if (!wScene || wScene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !wScene->mRootNode)
+	MeshData wData;
+	if (!LoadData(iFilename, wData, iImporter))
 	{
-		spdlog::critical("\tError while parsing mesh {0:s} : {1:s}", iFilename.c_str(), wImporter.GetErrorString());
 		return false;
 	}
 
-	spdlog::info("\tLoading Mesh {0:s} : ", iFilename.c_str());
-
-	mRootNode = std::make_unique<MeshNode>();
-	mRootNode->mParent = nullptr;
-
-	ProcessMeshNode(wScene->mRootNode, wScene, mRootNode.get());
+	Upload(iFilename, wData);
 
 	auto wClockStop = high_resolution_clock::now();
 	auto wDuration = duration_cast<milliseconds>(wClockStop - wClockStart);
 	spdlog::info("\tMesh {0:s} parsed ({1:d} Vertices | {2:d} Indices | {3:d} Nodes | {4:d} Submeshes) in {5:d} ms !",
-		wScene->mRootNode->mName.C_Str(), mVertexCount, mIndexCount, mNodeCount, mSubmeshCount,  wDuration.count());
+		mName, mVertexCount, mIndexCount, mNodeCount, mSubmeshCount,  wDuration.count());
 
 	return true;
 }
 
-void Mesh::ProcessMeshNode(aiNode* iNode, const aiScene* iScene, MeshNode* iMeshNode, uint32_t iNodeHierarchy)
+bool Mesh::LoadData(const std::string& iFilename, MeshData& oData, EImporter iImporter)
 {
-	++mNodeCount;
-	
-	// process all the node's meshes (if any)
-	for (unsigned int i = 0; i < iNode->mNumMeshes; i++)
+	const EImporter wImporter = iImporter == EImporter::eAuto ? GetDefaultImporter(iFilename) : iImporter;
+	if (MeshCache::Read(iFilename, oData, static_cast<uint32_t>(wImporter)))
 	{
-		iMeshNode->mSubmeshes.resize(iNode->mNumMeshes);
-		aiMesh* wMesh = iScene->mMeshes[iNode->mMeshes[i]];
-		CreateSubmesh(wMesh, iScene, iMeshNode->mSubmeshes[i], iNodeHierarchy);
-		++mSubmeshCount;
+		spdlog::info("\tMesh {0:s} read from its cache", iFilename.c_str());
+		return true;
 	}
-	
-	iMeshNode->mChildrenNode.resize(iNode->mNumChildren);
-	++iNodeHierarchy;
-	iMeshNode->mHierarchyLevel = iNodeHierarchy;
 
-	// then do the same for each of its children
-	for (unsigned int i = 0; i < iNode->mNumChildren; i++)
+	if (!Import(iFilename, oData, wImporter))
 	{
-		iMeshNode->mChildrenNode[i].mParent = iMeshNode;
-		ProcessMeshNode(iNode->mChildren[i], iScene, &iMeshNode->mChildrenNode[i], iNodeHierarchy);
+		return false;
 	}
+
+	if (!MeshCache::Write(iFilename, oData, static_cast<uint32_t>(wImporter)))
+	{
+		spdlog::warn("\tCould not write the mesh cache {0:s}", MeshCache::GetCachePath(iFilename));
+	}
+
+	return true;
 }
 
-void Mesh::CreateSubmesh(aiMesh* iMesh, const aiScene* iScene, SubMesh& oSubmesh, uint32_t iNodeHierarchy)
+void Mesh::Upload(const std::string& iFilename, const MeshData& iData)
 {
-	LoadSubmeshVertexAttribs(iMesh, iScene, oSubmesh);
+	BeginUpload(iFilename, iData);
 
-	LoadSubmeshIndices(iMesh, iScene, oSubmesh);
+	uint64_t wBudget = std::numeric_limits<uint64_t>::max();
+	ContinueUpload(iData, wBudget);
+}
 
-	LoadSubmeshMaterial(iMesh, iScene, oSubmesh);
+void Mesh::BeginUpload(const std::string& iFilename, const MeshData& iData)
+{
+	mDirectory = iFilename.substr(0, iFilename.find_last_of('/'));
+	mName = iFilename.substr(iFilename.find_last_of('/') + 1);
 
-	oSubmesh.mName = iMesh->mName.length == 0 ? std::string("No Name") : std::string(iMesh->mName.C_Str());
-	spdlog::info("{0:s}Created Submesh {1:s} with {2:d} vertices and {3:d} indices.",
-		std::string(iNodeHierarchy + 2, '\t').c_str(), oSubmesh.mName.c_str(), iMesh->mNumVertices, iMesh->mNumFaces * 3);
+	spdlog::info("\tLoading Mesh {0:s} : ", iFilename.c_str());
+
+	mRootNode = std::make_unique<MeshNode>();
+	mRootNode->mParent = nullptr;
+
+	mPendingSubmeshes.clear();
+	mPendingSubmeshes.reserve(iData.Submeshes.size());
+	mUploadedSubmeshes = 0;
+
+	uint32_t wNodeIndex = 0;
+	BuildNode(iData, wNodeIndex, mRootNode.get());
+
+	mBoundsMin = iData.BoundsMin;
+	mBoundsMax = iData.BoundsMax;
 }
 
-void Mesh::LoadSubmeshMaterial(aiMesh* iMesh, const aiScene* iScene, SubMesh& oSubmesh)
+bool Mesh::ContinueUpload(const MeshData& iData, uint64_t& ioBudget)
 {
-	// Load Material
-	const aiMaterial* wMaterial = iScene->mMaterials[iMesh->mMaterialIndex];
-	if (!wMaterial)
+	bool wFirst = true;
+	while (mUploadedSubmeshes < mPendingSubmeshes.size() && (wFirst || ioBudget > 0))
 	{
-		spdlog::critical("Undefined Material For mesh {0:s}", iMesh->mName.C_Str());
+		const PendingSubmesh& wPending = mPendingSubmeshes[mUploadedSubmeshes++];
+		const MeshData::Submesh& wSubmesh = iData.Submeshes[wPending.Source];
+		UploadSubmesh(iData, wSubmesh, *wPending.Target, wPending.Depth);
+
+		const uint64_t wBytes = MeshData::GetByteSize(wSubmesh);
+		ioBudget = wBytes < ioBudget ? ioBudget - wBytes : 0;
+		wFirst = false;
 	}
-	oSubmesh.mMaterial = new Material;
 
-	// Ambient Color
-	aiColor3D wAmbientColor{ 0.f, 0.f, 0.f };
-	if (wMaterial->Get(AI_MATKEY_COLOR_AMBIENT, wAmbientColor) == AI_SUCCESS)
+	if (mUploadedSubmeshes < mPendingSubmeshes.size())
 	{
-		oSubmesh.mMaterial->SetAmbientColor(glm::vec3(wAmbientColor.r, wAmbientColor.g, wAmbientColor.b));
+		return false;
 	}
 
-	// Diffuse Color
-	aiColor3D wDiffuseColor{ 0.f, 0.f, 0.f };
-	if (wMaterial->Get(AI_MATKEY_COLOR_DIFFUSE, wDiffuseColor) == AI_SUCCESS)
+	// The hierarchy keeps pointers to the submeshes only while uploading
+	mPendingSubmeshes.clear();
+	mPendingSubmeshes.shrink_to_fit();
+	return true;
+}
+
+bool Mesh::Import(const std::string& iFilename, MeshData& oData, EImporter iImporter)
+{
+	switch (iImporter == EImporter::eAuto ? GetDefaultImporter(iFilename) : iImporter)
 	{
-		oSubmesh.mMaterial->SetDiffuseColor(glm::vec3(wDiffuseColor.r, wDiffuseColor.g, wDiffuseColor.b));
+	case EImporter::eObj:
+		return ObjImporter::Import(iFilename, oData);
+	case EImporter::eGltf:
+		return GltfImporter::Import(iFilename, oData);
+	default:
+		return Import(iFilename, oData);
 	}
+}
+
+Mesh::EImporter Mesh::GetDefaultImporter(const std::string& iFilename)
+{
+	const size_t wExtension = iFilename.find_last_of('.');
+	std::string wSuffix = wExtension == std::string::npos ? std::string() : iFilename.substr(wExtension + 1);
+	std::transform(wSuffix.begin(), wSuffix.end(), wSuffix.begin(), [](char iChar) { return static_cast<char>(std::tolower(iChar)); });
 
-	// Specular Color
-	aiColor3D wSpecularColor{ 0.f, 0.f, 0.f };
-	if (wMaterial->Get(AI_MATKEY_COLOR_SPECULAR, wSpecularColor) == AI_SUCCESS)
+	if (wSuffix == "obj")
 	{
-		oSubmesh.mMaterial->SetSpecularColor(glm::vec3(wSpecularColor.r, wSpecularColor.g, wSpecularColor.b));
+		return EImporter::eObj;
 	}
+	return wSuffix == "gltf" || wSuffix == "glb" ? EImporter::eGltf : EImporter::eAssimp;
+}
 
-	// Diffuse Texture
-	if (wMaterial->GetTextureCount(aiTextureType_DIFFUSE) > 0)
+void Mesh::BenchmarkImporters(const std::string& iFilename, uint32_t iRunCount)
+{
+	const EImporter wImporters[] = { EImporter::eAssimp, GetDefaultImporter(iFilename) };
+	const uint32_t wImporterCount = wImporters[1] == EImporter::eAssimp ? 1 : 2;
+
+	for (uint32_t i = 0; i < wImporterCount; i++)
 	{
-		aiString wPath;
-		if (wMaterial->GetTexture(aiTextureType_DIFFUSE, 0, &wPath, NULL, NULL, NULL, NULL, NULL) == AI_SUCCESS)
+		double wTotalMs = 0.0;
+		double wBestMs = std::numeric_limits<double>::max();
+		uint32_t wVertexCount = 0;
+		uint32_t wIndexCount = 0;
+		for (uint32_t wRun = 0; wRun < iRunCount; wRun++)
 		{
-			std::string FullPath = mDirectory + "/" + wPath.data;
-			oSubmesh.mMaterial->LoadDiffuseTex(FullPath);
+			auto wClockStart = high_resolution_clock::now();
+			MeshData wData;
+			if (!Import(iFilename, wData, wImporters[i]))
+			{
+				return;
+			}
+			const double wMs = duration_cast<microseconds>(high_resolution_clock::now() - wClockStart).count() / 1000.0;
+			wTotalMs += wMs;
+			wBestMs = std::min(wBestMs, wMs);
+			wVertexCount = wData.VertexCount;
+			wIndexCount = wData.IndexCount;
 		}
+
+		const char* wName = wImporters[i] == EImporter::eObj ? "ObjImporter" : wImporters[i] == EImporter::eGltf ? "GltfImporter" : "Assimp";
+		spdlog::info("Import benchmark {0:s} with {1:s} : best {2:.2f} ms | average {3:.2f} ms ({4:d} Vertices | {5:d} Indices)",
+			iFilename, wName, wBestMs, wTotalMs / std::max(1u, iRunCount), wVertexCount, wIndexCount);
 	}
+}
+
+bool Mesh::Import(const std::string& iFilename, MeshData& oData)
+{
+	Assimp::Importer wImporter;
+	const aiScene* wScene = wImporter.ReadFile(iFilename,
+		aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices | aiProcess_CalcTangentSpace);
 
-	// Normal Texture
-	if (wMaterial->GetTextureCount(aiTextureType_DISPLACEMENT) > 0)
+	if (!wScene || wScene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !wScene->mRootNode)
 	{
-		aiString wPath;
-		if (wMaterial->GetTexture(aiTextureType_DISPLACEMENT, 0, &wPath, NULL, NULL, NULL, NULL, NULL) == AI_SUCCESS)
-		{
-			std::string FullPath = mDirectory + "/" + wPath.data;
-			oSubmesh.mMaterial->LoadNormalTex(FullPath);
-		}
+		spdlog::critical("\tError while parsing mesh {0:s} : {1:s}", iFilename.c_str(), wImporter.GetErrorString());
+		return false;
+	}
+
+	ImportMaterials(wScene, oData);
+	ImportNode(wScene->mRootNode, wScene, oData, 0);
+
+	return true;
+}
+
+void Mesh::ImportNode(const aiNode* iNode, const aiScene* iScene, MeshData& oData, uint32_t iDepth)
+{
+	MeshData::Node wNode;
+	wNode.ChildCount = iNode->mNumChildren;
+	wNode.FirstSubmesh = static_cast<uint32_t>(oData.Submeshes.size());
+	wNode.SubmeshCount = iNode->mNumMeshes;
+	wNode.Depth = iDepth;
+	oData.Nodes.push_back(wNode);
+
+	// process all the node's meshes (if any)
+	for (unsigned int i = 0; i < iNode->mNumMeshes; i++)
+	{
+		ImportSubmesh(iScene->mMeshes[iNode->mMeshes[i]], oData);
 	}
 
-	if (wMaterial->GetTextureCount(aiTextureType_SHININESS) > 0)
+	// then do the same for each of its children, right after it
+	for (unsigned int i = 0; i < iNode->mNumChildren; i++)
 	{
-		aiString wPath;
-		if (wMaterial->GetTexture(aiTextureType_SHININESS, 0, &wPath, NULL, NULL, NULL, NULL, NULL) == AI_SUCCESS)
-		{
-			std::string FullPath = mDirectory + "/" + wPath.data;
-			oSubmesh.mMaterial->LoadSpecularExponentTex(FullPath);
-		}
+		ImportNode(iNode->mChildren[i], iScene, oData, iDepth + 1);
 	}
 }
 
-void Mesh::LoadSubmeshVertexAttribs(aiMesh* iMesh, const aiScene* iScene, SubMesh& oSubmesh)
+void Mesh::ImportSubmesh(const aiMesh* iMesh, MeshData& oData)
 {
-	oSubmesh.mVertexCount = iMesh->mNumVertices;
+	oData.Submeshes.emplace_back();
+	MeshData::Submesh& wSubmesh = oData.Submeshes.back();
+	wSubmesh.Name = iMesh->mName.length == 0 ? std::string("No Name") : std::string(iMesh->mName.C_Str());
+	wSubmesh.Material = iMesh->mMaterialIndex;
+	wSubmesh.VertexCount = iMesh->mNumVertices;
+	wSubmesh.IndexCount = iMesh->mNumFaces * 3;
+
+	const size_t wVec3Bytes = iMesh->mNumVertices * sizeof(glm::vec3);
+	static_assert(sizeof(aiVector3D) == sizeof(glm::vec3), "Assimp vectors are copied as packed floats");
 
 	// Load Pos
-	if (iMesh->mNumVertices > 0)
-	{
-		oSubmesh.mVertexAttribs[SubMesh::EVertexAttrib::ePosition] = true;
-	}
-	std::vector<glm::vec3> wVertices;
-	wVertices.reserve(iMesh->mNumVertices);
+	glm::vec3* wPositions = static_cast<glm::vec3*>(oData.Allocate(wVec3Bytes));
+	std::memcpy(wPositions, iMesh->mVertices, wVec3Bytes);
 	for (unsigned int wVertexID = 0; wVertexID < iMesh->mNumVertices; wVertexID++)
 	{
-		const aiVector3D& wPos = iMesh->mVertices[wVertexID];
-		wVertices.emplace_back(glm::vec3(wPos.x, wPos.y, wPos.z));
+		oData.BoundsMin = glm::min(oData.BoundsMin, wPositions[wVertexID]);
+		oData.BoundsMax = glm::max(oData.BoundsMax, wPositions[wVertexID]);
 	}
-
-	glGenVertexArrays(1, &oSubmesh.mVAO);
-	glBindVertexArray(oSubmesh.mVAO);
-	glGenBuffers(1, &oSubmesh.mVBO[SubMesh::EVertexAttrib::ePosition]);
-	glBindBuffer(GL_ARRAY_BUFFER, oSubmesh.mVBO[SubMesh::EVertexAttrib::ePosition]);
-	glBufferData(GL_ARRAY_BUFFER, wVertices.size() * sizeof(glm::vec3), wVertices.data(), GL_STATIC_DRAW);
-	glEnableVertexAttribArray(SubMesh::EVertexAttrib::ePosition);
-	glVertexAttribPointer(SubMesh::EVertexAttrib::ePosition, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 0);
+	wSubmesh.Streams[SubMesh::ePosition] = wPositions;
 
 	// Load Normals
 	if (iMesh->mNormals)
 	{
-		oSubmesh.mVertexAttribs[SubMesh::EVertexAttrib::eNormal] = true;
-		std::vector<glm::vec3> wNormals;
-		wNormals.reserve(iMesh->mNumVertices);
-		for (unsigned int wVertexID = 0; wVertexID < iMesh->mNumVertices; wVertexID++)
-		{
-			const aiVector3D& wNormal = iMesh->mNormals[wVertexID];
-			wNormals.emplace_back(glm::vec3(wNormal.x, wNormal.y, wNormal.z));
-		}
-		glGenBuffers(1, &oSubmesh.mVBO[SubMesh::EVertexAttrib::eNormal]);
-		glBindBuffer(GL_ARRAY_BUFFER, oSubmesh.mVBO[SubMesh::EVertexAttrib::eNormal]);
-		glBufferData(GL_ARRAY_BUFFER, wNormals.size() * sizeof(glm::vec3), wNormals.data(), GL_STATIC_DRAW);
-		glEnableVertexAttribArray(SubMesh::EVertexAttrib::eNormal);
-		glVertexAttribPointer(SubMesh::EVertexAttrib::eNormal, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 0);
+		void* wNormals = oData.Allocate(wVec3Bytes);
+		std::memcpy(wNormals, iMesh->mNormals, wVec3Bytes);
+		wSubmesh.Streams[SubMesh::eNormal] = wNormals;
 	}
 
 	// Load UV0
 	if (iMesh->HasTextureCoords(0))
 	{
-		oSubmesh.mVertexAttribs[SubMesh::EVertexAttrib::eUV0] = true;
-		std::vector<glm::vec2> wUVs0;
-		wUVs0.reserve(iMesh->mNumVertices);
+		glm::vec2* wUVs0 = static_cast<glm::vec2*>(oData.Allocate(iMesh->mNumVertices * sizeof(glm::vec2)));
 		for (unsigned int wVertexID = 0; wVertexID < iMesh->mNumVertices; wVertexID++)
 		{
 			const aiVector3D& wUV0 = iMesh->mTextureCoords[0][wVertexID];
-			wUVs0.emplace_back(glm::vec2(wUV0.x, wUV0.y));
+			wUVs0[wVertexID] = glm::vec2(wUV0.x, wUV0.y);
 		}
-		glGenBuffers(1, &oSubmesh.mVBO[SubMesh::EVertexAttrib::eNormal]);
-		glBindBuffer(GL_ARRAY_BUFFER, oSubmesh.mVBO[SubMesh::EVertexAttrib::eNormal]);
-		glBufferData(GL_ARRAY_BUFFER, wUVs0.size() * sizeof(glm::vec2), wUVs0.data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(SubMesh::EVertexAttrib::eUV0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), 0);
+		wSubmesh.Streams[SubMesh::eUV0] = wUVs0;
 	}
 
 	// Load Tangent
-	if (oSubmesh.IsVertexAttribAvailable(SubMesh::eUV0) && oSubmesh.IsVertexAttribAvailable(SubMesh::eNormal))
+	if (wSubmesh.Streams[SubMesh::eUV0] && wSubmesh.Streams[SubMesh::eNormal] && iMesh->mTangents)
 	{
-		oSubmesh.mVertexAttribs[SubMesh::EVertexAttrib::eTangent] = true;
-		std::vector<glm::vec3> wTangents;
-		wTangents.reserve(iMesh->mNumVertices);
-		for (unsigned int wVertexID = 0; wVertexID < iMesh->mNumVertices; wVertexID++)
+		void* wTangents = oData.Allocate(wVec3Bytes);
+		std::memcpy(wTangents, iMesh->mTangents, wVec3Bytes);
+		wSubmesh.Streams[SubMesh::eTangent] = wTangents;
+	}
+
+	// Load Indices
+	uint32_t* wIndices = static_cast<uint32_t*>(oData.Allocate(wSubmesh.IndexCount * sizeof(uint32_t)));
+	for (unsigned int wFaceID = 0; wFaceID < iMesh->mNumFaces; wFaceID++)
+	{
+		assert(iMesh->mFaces[wFaceID].mNumIndices == 3);
+		wIndices[wFaceID * 3 + 0] = iMesh->mFaces[wFaceID].mIndices[0];
+		wIndices[wFaceID * 3 + 1] = iMesh->mFaces[wFaceID].mIndices[1];
+		wIndices[wFaceID * 3 + 2] = iMesh->mFaces[wFaceID].mIndices[2];
+	}
+	wSubmesh.Indices = wIndices;
+
+	oData.VertexCount += wSubmesh.VertexCount;
+	oData.IndexCount += wSubmesh.IndexCount;
+}
+
+void Mesh::ImportMaterials(const aiScene* iScene, MeshData& oData)
+{
+	oData.Materials.resize(iScene->mNumMaterials);
+	for (unsigned int i = 0; i < iScene->mNumMaterials; i++)
+	{
+		const aiMaterial* wMaterial = iScene->mMaterials[i];
+		MeshData::MaterialDesc& wDesc = oData.Materials[i];
+		if (!wMaterial)
+		{
+			spdlog::critical("Undefined Material {0:d}", i);
+			continue;
+		}
+
+		// Ambient Color
+		aiColor3D wAmbientColor{ 0.f, 0.f, 0.f };
+		if (wMaterial->Get(AI_MATKEY_COLOR_AMBIENT, wAmbientColor) == AI_SUCCESS)
+		{
+			wDesc.Ambient = glm::vec3(wAmbientColor.r, wAmbientColor.g, wAmbientColor.b);
+		}
+
+		// Diffuse Color
+		aiColor3D wDiffuseColor{ 0.f, 0.f, 0.f };
+		if (wMaterial->Get(AI_MATKEY_COLOR_DIFFUSE, wDiffuseColor) == AI_SUCCESS)
+		{
+			wDesc.Diffuse = glm::vec3(wDiffuseColor.r, wDiffuseColor.g, wDiffuseColor.b);
+		}
+
+		// Specular Color
+		aiColor3D wSpecularColor{ 0.f, 0.f, 0.f };
+		if (wMaterial->Get(AI_MATKEY_COLOR_SPECULAR, wSpecularColor) == AI_SUCCESS)
+		{
+			wDesc.Specular = glm::vec3(wSpecularColor.r, wSpecularColor.g, wSpecularColor.b);
+		}
+
+		// Diffuse, normal and specular exponent textures
+		aiString wPath;
+		if (wMaterial->GetTextureCount(aiTextureType_DIFFUSE) > 0 &&
+			wMaterial->GetTexture(aiTextureType_DIFFUSE, 0, &wPath, NULL, NULL, NULL, NULL, NULL) == AI_SUCCESS)
+		{
+			wDesc.DiffuseTex = wPath.data;
+		}
+
+		if (wMaterial->GetTextureCount(aiTextureType_DISPLACEMENT) > 0 &&
+			wMaterial->GetTexture(aiTextureType_DISPLACEMENT, 0, &wPath, NULL, NULL, NULL, NULL, NULL) == AI_SUCCESS)
+		{
+			wDesc.NormalTex = wPath.data;
+		}
+
+		if (wMaterial->GetTextureCount(aiTextureType_SHININESS) > 0 &&
+			wMaterial->GetTexture(aiTextureType_SHININESS, 0, &wPath, NULL, NULL, NULL, NULL, NULL) == AI_SUCCESS)
 		{
-			const aiVector3D& wTangent = iMesh->mTangents[wVertexID];
-			wTangents.emplace_back(glm::vec3(wTangent.x, wTangent.y, wTangent.z));
+			wDesc.SpecularTex = wPath.data;
 		}
-		glGenBuffers(1, &oSubmesh.mVBO[SubMesh::EVertexAttrib::eTangent]);
-		glBindBuffer(GL_ARRAY_BUFFER, oSubmesh.mVBO[SubMesh::EVertexAttrib::eTangent]);
-		glBufferData(GL_ARRAY_BUFFER, wTangents.size() * sizeof(glm::vec3), wTangents.data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(SubMesh::EVertexAttrib::eTangent, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 0);
+	}
+}
+
+void Mesh::BuildNode(const MeshData& iData, uint32_t& ioNodeIndex, MeshNode* iMeshNode)
+{
+	const MeshData::Node& wNode = iData.Nodes[ioNodeIndex++];
+	++mNodeCount;
+
+	// Sized once, the queued submesh pointers stay valid
+	iMeshNode->mSubmeshes.resize(wNode.SubmeshCount);
+	for (uint32_t i = 0; i < wNode.SubmeshCount; i++)
+	{
+		mPendingSubmeshes.push_back({ &iMeshNode->mSubmeshes[i], wNode.FirstSubmesh + i, wNode.Depth });
+		++mSubmeshCount;
 	}
 
-	mVertexCount += static_cast<uint32_t>(wVertices.size());
+	iMeshNode->mChildrenNode.resize(wNode.ChildCount);
+	iMeshNode->mHierarchyLevel = wNode.Depth + 1;
+
+	for (uint32_t i = 0; i < wNode.ChildCount; i++)
+	{
+		iMeshNode->mChildrenNode[i].mParent = iMeshNode;
+		BuildNode(iData, ioNodeIndex, &iMeshNode->mChildrenNode[i]);
+	}
 }
 
-void Mesh::LoadSubmeshIndices(aiMesh* iMesh, const aiScene* iScene, SubMesh& oSubmesh)
+void Mesh::UploadSubmesh(const MeshData& iData, const MeshData::Submesh& iSubmesh, SubMesh& oSubmesh, uint32_t iDepth)
 {
-	oSubmesh.mIndexCount = iMesh->mNumFaces * 3;
+	oSubmesh.mName = iSubmesh.Name;
+	oSubmesh.mVertexCount = iSubmesh.VertexCount;
+	oSubmesh.mIndexCount = iSubmesh.IndexCount;
 
-	// Load Indices
-	std::vector<GLuint> wIndices;
-	wIndices.reserve(iMesh->mNumFaces * 3);
-	for (unsigned int wFaceID = 0; wFaceID < iMesh->mNumFaces; wFaceID++)
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+
+	// Vertex attribs arrays are VAO state : they are enabled once here, not per draw
+	glGenVertexArrays(1, &oSubmesh.mVAO);
+	wStateCache->BindVertexArray(oSubmesh.mVAO);
+	for (uint32_t i = 0; i < SubMesh::eNumAttribs; i++)
 	{
-		assert(iMesh->mFaces[wFaceID].mNumIndices == 3);
-		wIndices.push_back(iMesh->mFaces[wFaceID].mIndices[0]);
-		wIndices.push_back(iMesh->mFaces[wFaceID].mIndices[1]);
-		wIndices.push_back(iMesh->mFaces[wFaceID].mIndices[2]);
+		if (!iSubmesh.Streams[i])
+		{
+			continue;
+		}
+
+		// Straight from the importer buffers or the cache mapping, no intermediate copy
+		const SubMesh::EVertexAttrib wAttrib = static_cast<SubMesh::EVertexAttrib>(i);
+		const GLsizei wStride = MeshData::StreamStride(wAttrib);
+		oSubmesh.mVertexAttribs[wAttrib] = true;
+		glGenBuffers(1, &oSubmesh.mVBO[wAttrib]);
+		wStateCache->BindBuffer(GL_ARRAY_BUFFER, oSubmesh.mVBO[wAttrib]);
+		glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(iSubmesh.VertexCount) * wStride, iSubmesh.Streams[i], GL_STATIC_DRAW);
+		glEnableVertexAttribArray(wAttrib);
+		glVertexAttribPointer(wAttrib, wStride / sizeof(float), GL_FLOAT, GL_FALSE, wStride, 0);
 	}
 
 	glGenBuffers(1, &oSubmesh.mIBO);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, oSubmesh.mIBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, oSubmesh.mIndexCount * sizeof(GLuint), wIndices.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(iSubmesh.IndexCount) * sizeof(GLuint), iSubmesh.Indices, GL_STATIC_DRAW);
 
-	mIndexCount += static_cast<uint32_t>(wIndices.size());
-	glBindVertexArray(0);
+	// Position only stream shared with the full VAO, depth only passes fetch 12 bytes per vertex
+	glGenVertexArrays(1, &oSubmesh.mPositionVAO);
+	wStateCache->BindVertexArray(oSubmesh.mPositionVAO);
+	wStateCache->BindBuffer(GL_ARRAY_BUFFER, oSubmesh.mVBO[SubMesh::EVertexAttrib::ePosition]);
+	glEnableVertexAttribArray(SubMesh::EVertexAttrib::ePosition);
+	glVertexAttribPointer(SubMesh::EVertexAttrib::ePosition, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, oSubmesh.mIBO);
+
+	wStateCache->BindVertexArray(0);
+
+	// Each submesh owns its material, textures are shared through the TextureManager
+	oSubmesh.mMaterial = new Material;
+	if (iSubmesh.Material < iData.Materials.size())
+	{
+		const MeshData::MaterialDesc& wDesc = iData.Materials[iSubmesh.Material];
+		oSubmesh.mMaterial->SetAmbientColor(wDesc.Ambient);
+		oSubmesh.mMaterial->SetDiffuseColor(wDesc.Diffuse);
+		oSubmesh.mMaterial->SetSpecularColor(wDesc.Specular);
+
+		if (!wDesc.DiffuseTex.empty())
+		{
+			oSubmesh.mMaterial->LoadDiffuseTex(mDirectory + "/" + wDesc.DiffuseTex);
+		}
+		if (!wDesc.NormalTex.empty())
+		{
+			oSubmesh.mMaterial->LoadNormalTex(mDirectory + "/" + wDesc.NormalTex);
+		}
+		if (!wDesc.SpecularTex.empty())
+		{
+			oSubmesh.mMaterial->LoadSpecularExponentTex(mDirectory + "/" + wDesc.SpecularTex);
+		}
+	}
+	else
+	{
+		spdlog::critical("Undefined Material For mesh {0:s}", iSubmesh.Name);
+	}
+
+	mVertexCount += iSubmesh.VertexCount;
+	mIndexCount += iSubmesh.IndexCount;
+
+	spdlog::info("{0:s}Created Submesh {1:s} with {2:d} vertices and {3:d} indices.",
+		std::string(iDepth + 2, '\t').c_str(), oSubmesh.mName.c_str(), iSubmesh.VertexCount, iSubmesh.IndexCount);
 }
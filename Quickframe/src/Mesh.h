@@ -25,6 +25,9 @@ SOFTWARE.
 #pragma once
 
 #include <memory>
+#include <limits>
+#include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/vec3.hpp>
@@ -32,6 +35,7 @@ SOFTWARE.
 #include <glm/glm.hpp>
 
 #include "MeshNode.h"
+#include "MeshData.h"
 
 class Transform;
 
@@ -48,39 +52,111 @@ struct aiNode;
 class Mesh
 {
 public:
+	/**
+	 * @brief : Parser used when the mesh cache is missing or stale
+	*/
+	enum class EImporter
+	{
+		eAuto,			// ObjImporter for .obj files, GltfImporter for .gltf and .glb files, Assimp otherwise
+		eAssimp,
+		eObj,
+		eGltf
+	};
+
 	Mesh();
 
 	void Free() {}
 
 	~Mesh() {}
 
-	bool Load(const std::string& iFilename);
+	bool Load(const std::string& iFilename, EImporter iImporter = EImporter::eAuto);
+
+	/**
+	 * @brief : CPU phase of Load, maps the mesh cache or imports the source and writes the cache.
+	 * Never touches GL, safe to run on the thread pool for distinct files.
+	*/
+	static bool LoadData(const std::string& iFilename, MeshData& oData, EImporter iImporter = EImporter::eAuto);
+
+	/**
+	 * @brief : Time Assimp and the native importer of a source file, bypassing the cache, and log the results
+	*/
+	static void BenchmarkImporters(const std::string& iFilename, uint32_t iRunCount = 5);
+
+	/**
+	 * @brief : GL phase of Load, creates the buffers and materials from data returned by LoadData
+	*/
+	void Upload(const std::string& iFilename, const MeshData& iData);
+
+	/**
+	 * @brief : Time sliced Upload, builds the hierarchy without any GL object.
+	 * The submeshes are then created by ContinueUpload, iData must outlive the upload.
+	*/
+	void BeginUpload(const std::string& iFilename, const MeshData& iData);
+
+	/**
+	 * @brief : Upload the next submeshes in hierarchy order until ioBudget bytes are consumed, at least one per call
+	 * @return true once every submesh is uploaded
+	*/
+	bool ContinueUpload(const MeshData& iData, uint64_t& ioBudget);
 
 	const MeshNode* GetRootNode() const { return mRootNode.get(); }
 
+	/**
+	 * @brief : Object space axis aligned bounds of all the submeshes
+	*/
+	const glm::vec3& GetBoundsMin() const { return mBoundsMin; }
+	const glm::vec3& GetBoundsMax() const { return mBoundsMax; }
+	bool HasBounds() const { return mVertexCount > 0; }
+
 private:
 	/**
-	 * @brief 
+	 * @brief : Read a source file with Assimp into oData, CPU only
+	*/
+	static bool Import(const std::string& iFilename, MeshData& oData);
+
+	static bool Import(const std::string& iFilename, MeshData& oData, EImporter iImporter);
+
+	/**
+	 * @brief : Importer picked by eAuto for a file extension
+	*/
+	static EImporter GetDefaultImporter(const std::string& iFilename);
+
+	/**
 	 * @param iNode : Assimp Node Object
 	 * @param iScene : Assimp Scene Object
-	 * @param iMeshNode : MeshNode Object 
-	 * @param iHierarchyLevel 
+	 * @param iDepth : Hierarchy level of the node, the root is 0
 	*/
-	void ProcessMeshNode(aiNode* iNode, const aiScene* iScene, MeshNode* iMeshNode, uint32_t iHierarchyLevel = 0);
+	static void ImportNode(const aiNode* iNode, const aiScene* iScene, MeshData& oData, uint32_t iDepth);
 
-	void CreateSubmesh(aiMesh* iMesh, const aiScene* iScene, SubMesh& oSubmesh, uint32_t iNodeHierarchy);
+	static void ImportSubmesh(const aiMesh* iMesh, MeshData& oData);
 
-	void LoadSubmeshMaterial(aiMesh* iMesh, const aiScene* iScene, SubMesh& oSubmesh);
+	static void ImportMaterials(const aiScene* iScene, MeshData& oData);
 
-	void LoadSubmeshVertexAttribs(aiMesh* iMesh, const aiScene* iScene, SubMesh& oSubmesh);
+	/**
+	 * @brief : Create the node hierarchy and queue its submeshes for ContinueUpload
+	 * @param ioNodeIndex : Index of the node in the depth first array, moved past its subtree
+	*/
+	void BuildNode(const MeshData& iData, uint32_t& ioNodeIndex, MeshNode* iMeshNode);
 
-	void LoadSubmeshIndices(aiMesh* iMesh, const aiScene* iScene, SubMesh& oSubmesh);
+	void UploadSubmesh(const MeshData& iData, const MeshData::Submesh& iSubmesh, SubMesh& oSubmesh, uint32_t iDepth);
+
+	struct PendingSubmesh
+	{
+		SubMesh* Target;
+		uint32_t Source;			// Index in MeshData::Submeshes
+		uint32_t Depth;
+	};
 
 	std::unique_ptr<MeshNode> mRootNode = nullptr;
+	std::vector<PendingSubmesh> mPendingSubmeshes;
+	uint32_t mUploadedSubmeshes = 0;
 	std::string mDirectory;
 	std::string mName;
 	uint32_t mNodeCount = 0;
 	uint32_t mIndexCount = 0;
 	uint32_t mVertexCount = 0;
 	uint32_t mSubmeshCount = 0;
+
+	glm::vec3 mBoundsMin{ std::numeric_limits<float>::max() };
+	glm::vec3 mBoundsMax{ -std::numeric_limits<float>::max() };
 };
\ No newline at end of file
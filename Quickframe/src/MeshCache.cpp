@@ -0,0 +1,408 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+#include "MeshCache.h"
+
+namespace
+{
+	constexpr uint32_t kMeshFileMagic = 0x534D4651;		// "QFMS"
+	constexpr uint32_t kMeshFileVersion = 2;				// Bump whenever the import processing changes
+	constexpr uint64_t kStreamAlignment = 16;
+	constexpr uint32_t kNoString = UINT32_MAX;
+
+	/**
+	 * @brief : Followed by the nodes, submeshes, materials, the string table then the streams
+	*/
+	struct MeshFileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t Importer;				// Importers do not process meshes identically
+		uint32_t NodeCount;
+		uint32_t SubmeshCount;
+		uint32_t MaterialCount;
+		uint32_t StringBytes;
+		float BoundsMin[3];
+		float BoundsMax[3];
+		uint64_t FileSize;				// Detects truncated writes
+	};
+
+	struct MeshFileSubmesh
+	{
+		uint32_t Name;					// Offset in the string table
+		uint32_t Material;
+		uint32_t VertexCount;
+		uint32_t IndexCount;
+		uint64_t Streams[SubMesh::eNumAttribs];		// File offsets, 0 when missing
+		uint64_t Indices;
+	};
+
+	struct MeshFileMaterial
+	{
+		float Ambient[3];
+		float Diffuse[3];
+		float Specular[3];
+		uint32_t Textures[3];			// Diffuse, normal, specular in the string table, kNoString when unused
+	};
+
+	uint64_t Align(uint64_t iOffset)
+	{
+		return (iOffset + kStreamAlignment - 1) & ~(kStreamAlignment - 1);
+	}
+
+	uint32_t AddString(const std::string& iString, std::vector<char>& ioStrings)
+	{
+		const uint32_t wOffset = static_cast<uint32_t>(ioStrings.size());
+		ioStrings.insert(ioStrings.end(), iString.begin(), iString.end());
+		ioStrings.push_back('\0');
+		return wOffset;
+	}
+
+	const char* GetString(uint32_t iOffset, const char* iStrings, uint32_t iStringBytes)
+	{
+		return iOffset < iStringBytes ? iStrings + iOffset : nullptr;
+	}
+
+	/**
+	 * @brief : The nodes must form a single depth first tree, Mesh::BuildNode recurses on ChildCount
+	*/
+	bool IsValidHierarchy(const std::vector<MeshData::Node>& iNodes)
+	{
+		uint64_t wChildSum = 0;
+		for (const MeshData::Node& wNode : iNodes)
+		{
+			wChildSum += wNode.ChildCount;
+		}
+		if (iNodes.empty() || wChildSum != iNodes.size() - 1 || iNodes[0].Depth != 0)
+		{
+			return false;
+		}
+
+		// Children left to visit at each level of the current branch
+		std::vector<uint32_t> wRemaining{ iNodes[0].ChildCount };
+		size_t wNext = 1;
+		while (!wRemaining.empty())
+		{
+			if (wRemaining.back() == 0)
+			{
+				wRemaining.pop_back();
+				continue;
+			}
+
+			--wRemaining.back();
+			if (wNext >= iNodes.size() || iNodes[wNext].Depth != wRemaining.size())
+			{
+				return false;
+			}
+			wRemaining.push_back(iNodes[wNext++].ChildCount);
+		}
+		return wNext == iNodes.size();
+	}
+
+	/**
+	 * @brief : Move iFrom over iTo in one step, a mapping of the old iTo keeps reading the old file
+	*/
+	bool ReplaceCacheFile(const std::string& iFrom, const std::string& iTo)
+	{
+#ifdef _WIN32
+		return MoveFileExA(iFrom.c_str(), iTo.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		return std::rename(iFrom.c_str(), iTo.c_str()) == 0;
+#endif
+	}
+}
+
+bool MeshCache::IsUpToDate(const std::string& iCachePath, const std::string& iSourcePath)
+{
+	struct stat wStat;
+	struct stat wSourceStat;
+	if (stat(iCachePath.c_str(), &wStat) != 0 || stat(iSourcePath.c_str(), &wSourceStat) != 0)
+	{
+		return false;
+	}
+	return wStat.st_mtime >= wSourceStat.st_mtime;
+}
+
+bool MeshCache::Read(const std::string& iSourcePath, MeshData& oData, uint32_t iImporter)
+{
+	const std::string wCachePath = GetCachePath(iSourcePath);
+	if (!IsUpToDate(wCachePath, iSourcePath))
+	{
+		return false;
+	}
+
+	std::unique_ptr<MappedFile> wMapping = std::make_unique<MappedFile>();
+	if (!wMapping->Open(wCachePath))
+	{
+		return false;
+	}
+
+	const uint8_t* wData = wMapping->GetData();
+	const uint64_t wSize = wMapping->GetSize();
+	if (wSize < sizeof(MeshFileHeader))
+	{
+		return false;
+	}
+
+	MeshFileHeader wHeader;
+	std::memcpy(&wHeader, wData, sizeof(MeshFileHeader));
+	if (wHeader.Magic != kMeshFileMagic || wHeader.Version != kMeshFileVersion || wHeader.Importer != iImporter || wHeader.FileSize != wSize)
+	{
+		spdlog::info("Mesh cache {0:s} is outdated, the source will be imported again", wCachePath);
+		return false;
+	}
+
+	const uint64_t wNodesOffset = sizeof(MeshFileHeader);
+	const uint64_t wSubmeshesOffset = wNodesOffset + uint64_t(wHeader.NodeCount) * sizeof(MeshData::Node);
+	const uint64_t wMaterialsOffset = wSubmeshesOffset + uint64_t(wHeader.SubmeshCount) * sizeof(MeshFileSubmesh);
+	const uint64_t wStringsOffset = wMaterialsOffset + uint64_t(wHeader.MaterialCount) * sizeof(MeshFileMaterial);
+	if (wHeader.NodeCount == 0 || wStringsOffset + wHeader.StringBytes > wSize ||
+		(wHeader.StringBytes > 0 && wData[wStringsOffset + wHeader.StringBytes - 1] != '\0'))
+	{
+		return false;
+	}
+	const char* wStrings = reinterpret_cast<const char*>(wData + wStringsOffset);
+
+	// Filled aside, a rejected cache must leave oData empty for the importer
+	MeshData wResult;
+
+	wResult.Nodes.resize(wHeader.NodeCount);
+	std::memcpy(wResult.Nodes.data(), wData + wNodesOffset, wHeader.NodeCount * sizeof(MeshData::Node));
+	for (const MeshData::Node& wNode : wResult.Nodes)
+	{
+		if (uint64_t(wNode.FirstSubmesh) + wNode.SubmeshCount > wHeader.SubmeshCount)
+		{
+			return false;
+		}
+	}
+
+	if (!IsValidHierarchy(wResult.Nodes))
+	{
+		spdlog::warn("Mesh cache {0:s} has an invalid node hierarchy, the source will be imported again", wCachePath);
+		return false;
+	}
+
+	wResult.Materials.resize(wHeader.MaterialCount);
+	for (uint32_t i = 0; i < wHeader.MaterialCount; i++)
+	{
+		MeshFileMaterial wFileMaterial;
+		std::memcpy(&wFileMaterial, wData + wMaterialsOffset + i * sizeof(MeshFileMaterial), sizeof(MeshFileMaterial));
+
+		MeshData::MaterialDesc& wMaterial = wResult.Materials[i];
+		wMaterial.Ambient = glm::vec3(wFileMaterial.Ambient[0], wFileMaterial.Ambient[1], wFileMaterial.Ambient[2]);
+		wMaterial.Diffuse = glm::vec3(wFileMaterial.Diffuse[0], wFileMaterial.Diffuse[1], wFileMaterial.Diffuse[2]);
+		wMaterial.Specular = glm::vec3(wFileMaterial.Specular[0], wFileMaterial.Specular[1], wFileMaterial.Specular[2]);
+
+		std::string* wTextures[3] = { &wMaterial.DiffuseTex, &wMaterial.NormalTex, &wMaterial.SpecularTex };
+		for (uint32_t t = 0; t < 3; t++)
+		{
+			const char* wPath = GetString(wFileMaterial.Textures[t], wStrings, wHeader.StringBytes);
+			if (wPath)
+			{
+				*wTextures[t] = wPath;
+			}
+		}
+	}
+
+	wResult.Submeshes.resize(wHeader.SubmeshCount);
+	wResult.VertexCount = 0;
+	wResult.IndexCount = 0;
+	for (uint32_t i = 0; i < wHeader.SubmeshCount; i++)
+	{
+		MeshFileSubmesh wFileSubmesh;
+		std::memcpy(&wFileSubmesh, wData + wSubmeshesOffset + i * sizeof(MeshFileSubmesh), sizeof(MeshFileSubmesh));
+
+		MeshData::Submesh& wSubmesh = wResult.Submeshes[i];
+		const char* wName = GetString(wFileSubmesh.Name, wStrings, wHeader.StringBytes);
+		wSubmesh.Name = wName ? wName : "No Name";
+		wSubmesh.Material = wFileSubmesh.Material;
+		wSubmesh.VertexCount = wFileSubmesh.VertexCount;
+		wSubmesh.IndexCount = wFileSubmesh.IndexCount;
+		if (wSubmesh.Material >= wHeader.MaterialCount)
+		{
+			return false;
+		}
+
+		for (uint32_t a = 0; a < SubMesh::eNumAttribs; a++)
+		{
+			const uint64_t wOffset = wFileSubmesh.Streams[a];
+			const uint64_t wBytes = uint64_t(wSubmesh.VertexCount) * MeshData::StreamStride(static_cast<SubMesh::EVertexAttrib>(a));
+			if (wOffset == 0)
+			{
+				continue;
+			}
+			if (wOffset + wBytes > wSize)
+			{
+				return false;
+			}
+			wSubmesh.Streams[a] = wData + wOffset;
+		}
+
+		if (!wSubmesh.Streams[SubMesh::ePosition] || wFileSubmesh.Indices == 0 ||
+			wFileSubmesh.Indices + uint64_t(wSubmesh.IndexCount) * sizeof(uint32_t) > wSize)
+		{
+			return false;
+		}
+		wSubmesh.Indices = reinterpret_cast<const uint32_t*>(wData + wFileSubmesh.Indices);
+
+		wResult.VertexCount += wSubmesh.VertexCount;
+		wResult.IndexCount += wSubmesh.IndexCount;
+	}
+
+	wResult.BoundsMin = glm::vec3(wHeader.BoundsMin[0], wHeader.BoundsMin[1], wHeader.BoundsMin[2]);
+	wResult.BoundsMax = glm::vec3(wHeader.BoundsMax[0], wHeader.BoundsMax[1], wHeader.BoundsMax[2]);
+	wResult.Mappings.push_back(std::move(wMapping));
+	oData = std::move(wResult);
+	return true;
+}
+
+bool MeshCache::Write(const std::string& iSourcePath, const MeshData& iData, uint32_t iImporter)
+{
+	MeshFileHeader wHeader = {};
+	wHeader.Magic = kMeshFileMagic;
+	wHeader.Version = kMeshFileVersion;
+	wHeader.Importer = iImporter;
+	wHeader.NodeCount = static_cast<uint32_t>(iData.Nodes.size());
+	wHeader.SubmeshCount = static_cast<uint32_t>(iData.Submeshes.size());
+	wHeader.MaterialCount = static_cast<uint32_t>(iData.Materials.size());
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		wHeader.BoundsMin[i] = iData.BoundsMin[i];
+		wHeader.BoundsMax[i] = iData.BoundsMax[i];
+	}
+
+	std::vector<char> wStrings;
+	std::vector<MeshFileMaterial> wFileMaterials(iData.Materials.size());
+	for (size_t i = 0; i < iData.Materials.size(); i++)
+	{
+		const MeshData::MaterialDesc& wMaterial = iData.Materials[i];
+		MeshFileMaterial& wFileMaterial = wFileMaterials[i];
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			wFileMaterial.Ambient[c] = wMaterial.Ambient[c];
+			wFileMaterial.Diffuse[c] = wMaterial.Diffuse[c];
+			wFileMaterial.Specular[c] = wMaterial.Specular[c];
+		}
+
+		const std::string* wTextures[3] = { &wMaterial.DiffuseTex, &wMaterial.NormalTex, &wMaterial.SpecularTex };
+		for (uint32_t t = 0; t < 3; t++)
+		{
+			wFileMaterial.Textures[t] = wTextures[t]->empty() ? kNoString : AddString(*wTextures[t], wStrings);
+		}
+	}
+
+	std::vector<MeshFileSubmesh> wFileSubmeshes(iData.Submeshes.size());
+	for (size_t i = 0; i < iData.Submeshes.size(); i++)
+	{
+		wFileSubmeshes[i].Name = AddString(iData.Submeshes[i].Name, wStrings);
+	}
+	wHeader.StringBytes = static_cast<uint32_t>(wStrings.size());
+
+	// Streams go after the tables, each aligned for the mapped reads
+	uint64_t wOffset = Align(sizeof(MeshFileHeader) + iData.Nodes.size() * sizeof(MeshData::Node) +
+		wFileSubmeshes.size() * sizeof(MeshFileSubmesh) + wFileMaterials.size() * sizeof(MeshFileMaterial) + wStrings.size());
+	for (size_t i = 0; i < iData.Submeshes.size(); i++)
+	{
+		const MeshData::Submesh& wSubmesh = iData.Submeshes[i];
+		MeshFileSubmesh& wFileSubmesh = wFileSubmeshes[i];
+		wFileSubmesh.Material = wSubmesh.Material;
+		wFileSubmesh.VertexCount = wSubmesh.VertexCount;
+		wFileSubmesh.IndexCount = wSubmesh.IndexCount;
+
+		for (uint32_t a = 0; a < SubMesh::eNumAttribs; a++)
+		{
+			wFileSubmesh.Streams[a] = 0;
+			if (wSubmesh.Streams[a])
+			{
+				wFileSubmesh.Streams[a] = wOffset;
+				wOffset = Align(wOffset + uint64_t(wSubmesh.VertexCount) * MeshData::StreamStride(static_cast<SubMesh::EVertexAttrib>(a)));
+			}
+		}
+
+		wFileSubmesh.Indices = wOffset;
+		wOffset = Align(wOffset + uint64_t(wSubmesh.IndexCount) * sizeof(uint32_t));
+	}
+	wHeader.FileSize = wOffset;
+
+	// Written aside then renamed, meshes still streaming from the current cache keep their mapping intact
+	const std::string wCachePath = GetCachePath(iSourcePath);
+	const std::string wTempPath = wCachePath + ".tmp";
+	std::ofstream wFile(wTempPath, std::ios::binary | std::ios::trunc);
+	if (!wFile)
+	{
+		return false;
+	}
+
+	wFile.write(reinterpret_cast<const char*>(&wHeader), sizeof(MeshFileHeader));
+	wFile.write(reinterpret_cast<const char*>(iData.Nodes.data()), iData.Nodes.size() * sizeof(MeshData::Node));
+	wFile.write(reinterpret_cast<const char*>(wFileSubmeshes.data()), wFileSubmeshes.size() * sizeof(MeshFileSubmesh));
+	wFile.write(reinterpret_cast<const char*>(wFileMaterials.data()), wFileMaterials.size() * sizeof(MeshFileMaterial));
+	wFile.write(wStrings.data(), wStrings.size());
+
+	const char kPadding[kStreamAlignment] = { 0 };
+	auto PadTo = [&](uint64_t iOffset)
+	{
+		const uint64_t wPosition = static_cast<uint64_t>(wFile.tellp());
+		wFile.write(kPadding, iOffset - wPosition);
+	};
+
+	for (size_t i = 0; i < iData.Submeshes.size(); i++)
+	{
+		const MeshData::Submesh& wSubmesh = iData.Submeshes[i];
+		const MeshFileSubmesh& wFileSubmesh = wFileSubmeshes[i];
+		for (uint32_t a = 0; a < SubMesh::eNumAttribs; a++)
+		{
+			if (wSubmesh.Streams[a])
+			{
+				PadTo(wFileSubmesh.Streams[a]);
+				wFile.write(static_cast<const char*>(wSubmesh.Streams[a]),
+					uint64_t(wSubmesh.VertexCount) * MeshData::StreamStride(static_cast<SubMesh::EVertexAttrib>(a)));
+			}
+		}
+
+		PadTo(wFileSubmesh.Indices);
+		wFile.write(reinterpret_cast<const char*>(wSubmesh.Indices), uint64_t(wSubmesh.IndexCount) * sizeof(uint32_t));
+	}
+	PadTo(wHeader.FileSize);
+
+	wFile.close();
+	if (!wFile || !ReplaceCacheFile(wTempPath, wCachePath))
+	{
+		std::remove(wTempPath.c_str());
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,53 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+
+#include "MeshData.h"
+
+/**
+ * @brief : Binary cache of the imported meshes, a versioned .qfmesh file written next to the source on
+ * first import. It holds the processed node hierarchy, submeshes, materials, bounds and the vertex and index
+ * streams laid out exactly as they are uploaded, so a cached load is a memory mapping and the GL uploads
+ * read straight from it. The file is reused while it is newer than the source and was written by the same importer.
+*/
+class MeshCache
+{
+public:
+	static std::string GetCachePath(const std::string& iSourcePath) { return iSourcePath + ".qfmesh"; }
+
+	/**
+	 * @brief : Map the cache of a source file, the streams of oData point into the mapping
+	 * @param iImporter : Id of the importer the caller would use, a cache written by another one is stale
+	 * @return false if the cache is missing, stale or invalid
+	*/
+	static bool Read(const std::string& iSourcePath, MeshData& oData, uint32_t iImporter);
+
+	static bool Write(const std::string& iSourcePath, const MeshData& iData, uint32_t iImporter);
+
+private:
+	static bool IsUpToDate(const std::string& iCachePath, const std::string& iSourcePath);
+};
@@ -0,0 +1,68 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+#include "MeshData.h"
+
+void MeshData::GenerateTangents(const glm::vec3* iPositions, const glm::vec3* iNormals, const glm::vec2* iUVs, uint32_t iVertexCount,
+	const uint32_t* iIndices, uint32_t iIndexCount, glm::vec3* oTangents)
+{
+	std::fill(oTangents, oTangents + iVertexCount, glm::vec3(0.f));
+	for (uint32_t i = 0; i + 2 < iIndexCount; i += 3)
+	{
+		const uint32_t wA = iIndices[i];
+		const uint32_t wB = iIndices[i + 1];
+		const uint32_t wC = iIndices[i + 2];
+		const glm::vec3 wEdge1 = iPositions[wB] - iPositions[wA];
+		const glm::vec3 wEdge2 = iPositions[wC] - iPositions[wA];
+		const glm::vec2 wDeltaUV1 = iUVs[wB] - iUVs[wA];
+		const glm::vec2 wDeltaUV2 = iUVs[wC] - iUVs[wA];
+
+		const float wDeterminant = wDeltaUV1.x * wDeltaUV2.y - wDeltaUV2.x * wDeltaUV1.y;
+		if (std::abs(wDeterminant) < 1e-12f)
+		{
+			continue;
+		}
+
+		const glm::vec3 wTangent = (wEdge1 * wDeltaUV2.y - wEdge2 * wDeltaUV1.y) / wDeterminant;
+		oTangents[wA] += wTangent;
+		oTangents[wB] += wTangent;
+		oTangents[wC] += wTangent;
+	}
+
+	for (uint32_t i = 0; i < iVertexCount; i++)
+	{
+		const glm::vec3& wNormal = iNormals[i];
+		glm::vec3 wTangent = oTangents[i] - wNormal * glm::dot(wNormal, oTangents[i]);
+		if (glm::dot(wTangent, wTangent) < 1e-12f)
+		{
+			// Degenerate uvs, any direction perpendicular to the normal
+			wTangent = glm::cross(wNormal, std::abs(wNormal.x) < 0.9f ? glm::vec3(1.f, 0.f, 0.f) : glm::vec3(0.f, 1.f, 0.f));
+		}
+		oTangents[i] = glm::normalize(wTangent);
+	}
+}
@@ -0,0 +1,138 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include "SubMesh.h"
+#include "MappedFile.h"
+
+/**
+ * @brief : CPU side mesh, output of the importers and content of the mesh cache files.
+ * It never touches GL so it can be built on any thread, Mesh uploads it on the main thread.
+ * Streams point to memory owned by the MeshData : its own buffers or mapped files (cache, glTF buffers).
+*/
+struct MeshData
+{
+	/**
+	 * @brief : Nodes are stored depth first, the children of a node follow it
+	*/
+	struct Node
+	{
+		uint32_t ChildCount = 0;
+		uint32_t FirstSubmesh = 0;
+		uint32_t SubmeshCount = 0;
+		uint32_t Depth = 0;
+	};
+
+	struct Submesh
+	{
+		std::string Name;
+		uint32_t Material = 0;
+		uint32_t VertexCount = 0;
+		uint32_t IndexCount = 0;
+		const void* Streams[SubMesh::eNumAttribs] = { nullptr };		// Tightly packed, nullptr when missing
+		const uint32_t* Indices = nullptr;								// Triangle list
+	};
+
+	struct MaterialDesc
+	{
+		glm::vec3 Ambient{ 0.f };
+		glm::vec3 Diffuse{ 0.f };
+		glm::vec3 Specular{ 0.f };
+
+		// Relative to the mesh directory, empty when unused
+		std::string DiffuseTex;
+		std::string NormalTex;
+		std::string SpecularTex;
+	};
+
+	/**
+	 * @brief : Bytes per vertex of a stream, floats only
+	*/
+	static uint32_t StreamStride(SubMesh::EVertexAttrib iAttrib)
+	{
+		switch (iAttrib)
+		{
+		case SubMesh::eColor:
+			return 4 * sizeof(float);
+		case SubMesh::eUV0:
+		case SubMesh::eUV1:
+		case SubMesh::eUV2:
+			return 2 * sizeof(float);
+		default:
+			return 3 * sizeof(float);
+		}
+	}
+
+	/**
+	 * @brief : Bytes uploaded for a submesh, vertex streams and indices
+	*/
+	static uint64_t GetByteSize(const Submesh& iSubmesh)
+	{
+		uint64_t wBytes = uint64_t(iSubmesh.IndexCount) * sizeof(uint32_t);
+		for (uint32_t i = 0; i < SubMesh::eNumAttribs; i++)
+		{
+			if (iSubmesh.Streams[i])
+			{
+				wBytes += uint64_t(iSubmesh.VertexCount) * StreamStride(static_cast<SubMesh::EVertexAttrib>(i));
+			}
+		}
+		return wBytes;
+	}
+
+	/**
+	 * @brief : Per vertex tangents from the uv gradients of the triangles, orthogonalized against the normals
+	*/
+	static void GenerateTangents(const glm::vec3* iPositions, const glm::vec3* iNormals, const glm::vec2* iUVs, uint32_t iVertexCount,
+		const uint32_t* iIndices, uint32_t iIndexCount, glm::vec3* oTangents);
+
+	/**
+	 * @brief : Owned zero filled buffer for the streams of an importer
+	*/
+	void* Allocate(size_t iSize)
+	{
+		Buffers.emplace_back(iSize);
+		return Buffers.back().data();
+	}
+
+	std::vector<Node> Nodes;
+	std::vector<Submesh> Submeshes;
+	std::vector<MaterialDesc> Materials;
+
+	glm::vec3 BoundsMin{ std::numeric_limits<float>::max() };
+	glm::vec3 BoundsMax{ -std::numeric_limits<float>::max() };
+	uint32_t VertexCount = 0;
+	uint32_t IndexCount = 0;
+
+	std::vector<std::vector<uint8_t>> Buffers;
+	std::vector<std::unique_ptr<MappedFile>> Mappings;
+};
@@ -0,0 +1,187 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+#include "MeshStreamer.h"
+#include "Entity.h"
+#include "Camera.h"
+#include "ThreadPool.h"
+
+using namespace std::chrono;
+
+MeshStreamer* MeshStreamer::mMeshStreamer = nullptr;
+
+MeshStreamer* MeshStreamer::GetInstance()
+{
+	if (!mMeshStreamer)
+	{
+		mMeshStreamer = new MeshStreamer();
+	}
+
+	return mMeshStreamer;
+}
+
+void MeshStreamer::Request(Entity* iEntity, const std::string& iPath)
+{
+	Cancel(iEntity);
+
+	std::unique_ptr<Stream> wStream = std::make_unique<Stream>();
+	wStream->Target = iEntity;
+	wStream->Path = iPath;
+	wStream->Data = std::make_unique<MeshData>();
+	wStream->Start = high_resolution_clock::now();
+	mStreams.push_back(std::move(wStream));
+}
+
+void MeshStreamer::Cancel(Entity* iEntity)
+{
+	for (std::unique_ptr<Stream>& wStream : mStreams)
+	{
+		if (wStream->Target == iEntity)
+		{
+			wStream->Target = nullptr;
+			wStream->Cancelled = true;
+		}
+	}
+}
+
+void MeshStreamer::StartLoad(Stream& ioStream)
+{
+	// The stream outlives the job : it is only dropped once the future is ready
+	Stream* wStream = &ioStream;
+	ioStream.Load = ThreadPool::GetInstance()->SubmitBackground([wStream]()
+		{
+			if (wStream->Cancelled)
+			{
+				return false;
+			}
+			return Mesh::LoadData(wStream->Path, *wStream->Data);
+		});
+}
+
+void MeshStreamer::Update(const Camera* iCamera)
+{
+	if (mStreams.empty())
+	{
+		return;
+	}
+
+	// Cancelled streams are dropped once their import is over, a partial upload is freed with its mesh
+	mStreams.erase(std::remove_if(mStreams.begin(), mStreams.end(), [](const std::unique_ptr<Stream>& iStream)
+		{
+			return !iStream->Target && (!iStream->Load.valid() || iStream->Load.wait_for(seconds(0)) == std::future_status::ready);
+		}), mStreams.end());
+
+	if (iCamera)
+	{
+		for (std::unique_ptr<Stream>& wStream : mStreams)
+		{
+			if (wStream->Target)
+			{
+				wStream->Distance = glm::length(wStream->Target->GetTransform()->GetPos() - iCamera->WorldPos());
+			}
+		}
+
+		std::stable_sort(mStreams.begin(), mStreams.end(), [](const std::unique_ptr<Stream>& iA, const std::unique_ptr<Stream>& iB)
+			{
+				return iA->Distance < iB->Distance;
+			});
+	}
+
+	// Finished imports start uploading, failed ones give up
+	uint32_t wLoadsInFlight = 0;
+	for (std::unique_ptr<Stream>& wStream : mStreams)
+	{
+		if (!wStream->Load.valid())
+		{
+			continue;
+		}
+
+		if (wStream->Load.wait_for(seconds(0)) != std::future_status::ready)
+		{
+			++wLoadsInFlight;
+			continue;
+		}
+
+		const bool wLoaded = wStream->Load.get();
+		if (!wStream->Target)
+		{
+			wStream->Done = true;
+			continue;
+		}
+
+		if (!wLoaded)
+		{
+			spdlog::critical("Could not stream the mesh {0:s}", wStream->Path);
+			wStream->Target->OnMeshLoaded(nullptr);
+			wStream->Done = true;
+			continue;
+		}
+
+		wStream->Result = std::make_unique<Mesh>();
+		wStream->Result->BeginUpload(wStream->Path, *wStream->Data);
+	}
+
+	// Closest requests first, one import per worker so a far request never delays a close one for long
+	const uint32_t wMaxLoadsInFlight = std::max(1u, ThreadPool::GetInstance()->GetWorkerCount());
+	for (std::unique_ptr<Stream>& wStream : mStreams)
+	{
+		if (wLoadsInFlight >= wMaxLoadsInFlight)
+		{
+			break;
+		}
+
+		if (wStream->Target && !wStream->Done && !wStream->Load.valid() && !wStream->Result)
+		{
+			StartLoad(*wStream);
+			++wLoadsInFlight;
+		}
+	}
+
+	uint64_t wBudget = kUploadBudget;
+	for (std::unique_ptr<Stream>& wStream : mStreams)
+	{
+		if (wBudget == 0)
+		{
+			break;
+		}
+
+		if (!wStream->Target || !wStream->Result || !wStream->Result->ContinueUpload(*wStream->Data, wBudget))
+		{
+			continue;
+		}
+
+		spdlog::info("Mesh {0:s} of Entity {1:s} resident in {2:d} ms", wStream->Path, wStream->Target->GetName(),
+			duration_cast<milliseconds>(high_resolution_clock::now() - wStream->Start).count());
+		wStream->Target->OnMeshLoaded(std::move(wStream->Result));
+		wStream->Done = true;
+	}
+
+	mStreams.erase(std::remove_if(mStreams.begin(), mStreams.end(), [](const std::unique_ptr<Stream>& iStream)
+		{
+			return iStream->Done;
+		}), mStreams.end());
+}
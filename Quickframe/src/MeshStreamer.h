@@ -0,0 +1,96 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+#include "MeshData.h"
+
+class Entity;
+class Camera;
+
+/**
+ * @brief : Loads entity meshes without blocking a frame.
+ * Requests are imported on the thread pool (cache read or Assimp import), closest to the camera first
+ * and at most one per worker at a time, then uploaded a few submeshes per frame within kUploadBudget bytes.
+ * The entity gets its mesh once the last submesh is uploaded.
+*/
+class MeshStreamer
+{
+	struct Stream
+	{
+		Entity* Target = nullptr;				// nullptr once cancelled
+		std::string Path;
+		std::unique_ptr<MeshData> Data;
+		std::future<bool> Load;					// Valid while the import runs
+		std::atomic<bool> Cancelled{ false };	// Read by the import job
+		std::unique_ptr<Mesh> Result;			// Created once imported, uploading
+		float Distance = 0.f;
+		bool Done = false;
+		std::chrono::high_resolution_clock::time_point Start;
+	};
+
+public:
+	static constexpr uint64_t kUploadBudget = 8 * 1024 * 1024;
+
+	MeshStreamer(MeshStreamer& iOther) = delete;
+	void operator=(const MeshStreamer&) = delete;
+
+	static MeshStreamer* GetInstance();
+
+	/**
+	 * @brief : Queue the load of iPath for iEntity, replacing its pending request if any
+	*/
+	void Request(Entity* iEntity, const std::string& iPath);
+
+	/**
+	 * @brief : Forget the request of iEntity, a running import finishes in the background and is dropped
+	*/
+	void Cancel(Entity* iEntity);
+
+	/**
+	 * @brief : Reprioritize, start imports and upload, once per frame on the main thread
+	 * @param iCamera : Requests are ordered by distance to it, can be nullptr
+	*/
+	void Update(const Camera* iCamera);
+
+	uint32_t GetPendingCount() const { return static_cast<uint32_t>(mStreams.size()); }
+
+private:
+	MeshStreamer() {}
+
+	void StartLoad(Stream& ioStream);
+
+	static MeshStreamer* mMeshStreamer;
+
+	std::vector<std::unique_ptr<Stream>> mStreams;
+};
@@ -0,0 +1,782 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <spdlog/spdlog.h>
+
+#include "ObjImporter.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+using namespace std::chrono;
+
+namespace
+{
+	bool IsSpace(char iChar)
+	{
+		return iChar == ' ' || iChar == '\t' || iChar == '\r';
+	}
+
+	bool IsDigit(char iChar)
+	{
+		return static_cast<unsigned char>(iChar - '0') < 10;
+	}
+
+	const char* SkipSpaces(const char* iIt, const char* iEnd)
+	{
+		while (iIt < iEnd && IsSpace(*iIt))
+		{
+			++iIt;
+		}
+		return iIt;
+	}
+
+	/**
+	 * @brief : memchr is vectorized by the C runtime, it does the bulk of the scanning
+	*/
+	const char* FindLineEnd(const char* iIt, const char* iEnd)
+	{
+		const void* wNewLine = std::memchr(iIt, '\n', static_cast<size_t>(iEnd - iIt));
+		return wNewLine ? static_cast<const char*>(wNewLine) : iEnd;
+	}
+
+	/**
+	 * @brief : Rest of the line without the surrounding spaces
+	*/
+	std::string ReadName(const char* iIt, const char* iEnd)
+	{
+		iIt = SkipSpaces(iIt, iEnd);
+		while (iEnd > iIt && IsSpace(iEnd[-1]))
+		{
+			--iEnd;
+		}
+		return std::string(iIt, iEnd);
+	}
+
+	/**
+	 * @brief : Last token of the line, texture statements put their options first
+	*/
+	std::string ReadLastToken(const char* iIt, const char* iEnd)
+	{
+		while (iEnd > iIt && IsSpace(iEnd[-1]))
+		{
+			--iEnd;
+		}
+		const char* wBegin = iEnd;
+		while (wBegin > iIt && !IsSpace(wBegin[-1]))
+		{
+			--wBegin;
+		}
+		return std::string(wBegin, iEnd);
+	}
+
+	const char* ParseInt(const char* iIt, const char* iEnd, int64_t& oValue)
+	{
+		bool wNegative = false;
+		if (iIt < iEnd && (*iIt == '-' || *iIt == '+'))
+		{
+			wNegative = *iIt == '-';
+			++iIt;
+		}
+
+		int64_t wValue = 0;
+		while (iIt < iEnd && IsDigit(*iIt))
+		{
+			wValue = wValue * 10 + (*iIt - '0');
+			++iIt;
+		}
+		oValue = wNegative ? -wValue : wValue;
+		return iIt;
+	}
+
+	/**
+	 * @brief : Locale independent, at most 19 significant digits are accumulated in an integer and
+	 * scaled once by a power of ten, exact for the 6 decimals written by the exporters
+	*/
+	const char* ParseFloat(const char* iIt, const char* iEnd, float& oValue)
+	{
+		static const double kPow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+			1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+		iIt = SkipSpaces(iIt, iEnd);
+		bool wNegative = false;
+		if (iIt < iEnd && (*iIt == '-' || *iIt == '+'))
+		{
+			wNegative = *iIt == '-';
+			++iIt;
+		}
+
+		uint64_t wMantissa = 0;
+		int wDigits = 0;
+		int wExponent = 0;
+		while (iIt < iEnd && IsDigit(*iIt))
+		{
+			if (wDigits < 19)
+			{
+				wMantissa = wMantissa * 10 + (*iIt - '0');
+				wDigits += wMantissa != 0;
+			}
+			else
+			{
+				++wExponent;
+			}
+			++iIt;
+		}
+
+		if (iIt < iEnd && *iIt == '.')
+		{
+			++iIt;
+			while (iIt < iEnd && IsDigit(*iIt))
+			{
+				if (wDigits < 19)
+				{
+					wMantissa = wMantissa * 10 + (*iIt - '0');
+					wDigits += wMantissa != 0;
+					--wExponent;
+				}
+				++iIt;
+			}
+		}
+
+		if (iIt < iEnd && (*iIt == 'e' || *iIt == 'E'))
+		{
+			int64_t wExplicitExponent = 0;
+			iIt = ParseInt(iIt + 1, iEnd, wExplicitExponent);
+			wExponent += static_cast<int>(std::max<int64_t>(-400, std::min<int64_t>(400, wExplicitExponent)));
+		}
+
+		double wValue = static_cast<double>(wMantissa);
+		if (wExponent >= 0)
+		{
+			wValue *= wExponent <= 22 ? kPow10[wExponent] : std::pow(10.0, wExponent);
+		}
+		else
+		{
+			wValue /= -wExponent <= 22 ? kPow10[-wExponent] : std::pow(10.0, -wExponent);
+		}
+
+		oValue = static_cast<float>(wNegative ? -wValue : wValue);
+		return iIt;
+	}
+
+	/**
+	 * @brief : Absolute 0 based index, or the signed offset from the chunk start for negative (relative)
+	 * indices, biased by half the flag so that indices reaching back into previous chunks stay unsigned
+	 * @param iCount : Elements of this kind already parsed in the chunk
+	*/
+	uint32_t EncodeIndex(int64_t iIndex, size_t iCount, uint32_t iChunkRelative)
+	{
+		if (iIndex > 0)
+		{
+			return iIndex - 1 < iChunkRelative ? static_cast<uint32_t>(iIndex - 1) : UINT32_MAX;
+		}
+
+		const int64_t wBias = iChunkRelative >> 1;
+		const int64_t wBiased = static_cast<int64_t>(iCount) + iIndex + wBias;
+		if (iIndex == 0 || wBiased < 0 || wBiased >= iChunkRelative - 1)
+		{
+			return UINT32_MAX;
+		}
+		return static_cast<uint32_t>(wBiased) | iChunkRelative;
+	}
+
+	/**
+	 * @brief : Global index once the chunk offsets are known, UINT32_MAX if it falls outside the file
+	*/
+	uint32_t ResolveIndex(uint32_t iIndex, uint32_t iChunkOffset, uint32_t iCount, uint32_t iChunkRelative)
+	{
+		if (iIndex == UINT32_MAX)
+		{
+			return UINT32_MAX;
+		}
+
+		const int64_t wBias = iChunkRelative >> 1;
+		const int64_t wIndex = (iIndex & iChunkRelative) ? static_cast<int64_t>(iChunkOffset) + (iIndex & ~iChunkRelative) - wBias : iIndex;
+		return wIndex >= 0 && wIndex < iCount ? static_cast<uint32_t>(wIndex) : UINT32_MAX;
+	}
+
+	template<typename T>
+	T* AllocateStream(std::vector<std::vector<uint8_t>>& oBuffers, size_t iCount)
+	{
+		oBuffers.emplace_back(iCount * sizeof(T));
+		return reinterpret_cast<T*>(oBuffers.back().data());
+	}
+}
+
+size_t ObjImporter::CornerHash::operator()(const Corner& iCorner) const
+{
+	uint64_t wHash = iCorner.Position * 0x9E3779B97F4A7C15ull;
+	wHash ^= iCorner.UV * 0xC2B2AE3D27D4EB4Full;
+	wHash ^= iCorner.Normal * 0x165667B19E3779F9ull;
+	return static_cast<size_t>(wHash ^ (wHash >> 29));
+}
+
+bool ObjImporter::Import(const std::string& iPath, MeshData& oData)
+{
+	auto wClockStart = high_resolution_clock::now();
+
+	MappedFile wFile;
+	if (!wFile.Open(iPath))
+	{
+		spdlog::critical("\tError while parsing mesh {0:s} : can't open the file", iPath);
+		return false;
+	}
+
+	const char* wText = reinterpret_cast<const char*>(wFile.GetData());
+	const char* wTextEnd = wText + wFile.GetSize();
+
+	// Line aligned chunks, a few per thread to balance uneven content (vertices are cheaper than faces)
+	ThreadPool* wThreadPool = ThreadPool::GetInstance();
+	const size_t wMaxChunks = static_cast<size_t>(wThreadPool->GetMaxChunkCount()) * 4;
+	const size_t wChunkCount = std::max<size_t>(1, std::min(wMaxChunks, wFile.GetSize() / kMinChunkBytes));
+	std::vector<const char*> wBounds(wChunkCount + 1, wTextEnd);
+	wBounds[0] = wText;
+	for (size_t i = 1; i < wChunkCount; i++)
+	{
+		const char* wSplit = std::max(wBounds[i - 1], wText + wFile.GetSize() * i / wChunkCount);
+		const char* wLineEnd = FindLineEnd(wSplit, wTextEnd);
+		wBounds[i] = wLineEnd < wTextEnd ? wLineEnd + 1 : wTextEnd;
+	}
+
+	std::vector<Chunk> wChunks(wChunkCount);
+	wThreadPool->ParallelFor(static_cast<uint32_t>(wChunkCount),
+		[&](uint32_t iBegin, uint32_t iEnd, uint32_t)
+		{
+			for (uint32_t i = iBegin; i < iEnd; i++)
+			{
+				ParseChunk(wBounds[i], wBounds[i + 1], wChunks[i]);
+			}
+		});
+	auto wParseStop = high_resolution_clock::now();
+
+	// Attributes are concatenated in file order, chunk relative indices get the offset of their chunk
+	std::vector<uint32_t> wPositionOffsets(wChunkCount);
+	std::vector<uint32_t> wUVOffsets(wChunkCount);
+	std::vector<uint32_t> wNormalOffsets(wChunkCount);
+	size_t wPositionCount = 0;
+	size_t wUVCount = 0;
+	size_t wNormalCount = 0;
+	for (size_t i = 0; i < wChunkCount; i++)
+	{
+		wPositionOffsets[i] = static_cast<uint32_t>(wPositionCount);
+		wUVOffsets[i] = static_cast<uint32_t>(wUVCount);
+		wNormalOffsets[i] = static_cast<uint32_t>(wNormalCount);
+		wPositionCount += wChunks[i].Positions.size();
+		wUVCount += wChunks[i].UVs.size();
+		wNormalCount += wChunks[i].Normals.size();
+	}
+
+	if (wPositionCount >= kChunkRelative)
+	{
+		spdlog::critical("\tError while parsing mesh {0:s} : too many vertices", iPath);
+		return false;
+	}
+
+	std::vector<glm::vec3> wPositions;
+	std::vector<glm::vec2> wUVs;
+	std::vector<glm::vec3> wNormals;
+	wPositions.reserve(wPositionCount);
+	wUVs.reserve(wUVCount);
+	wNormals.reserve(wNormalCount);
+	for (const Chunk& wChunk : wChunks)
+	{
+		wPositions.insert(wPositions.end(), wChunk.Positions.begin(), wChunk.Positions.end());
+		wUVs.insert(wUVs.end(), wChunk.UVs.begin(), wChunk.UVs.end());
+		wNormals.insert(wNormals.end(), wChunk.Normals.begin(), wChunk.Normals.end());
+	}
+
+	wThreadPool->ParallelFor(static_cast<uint32_t>(wChunkCount),
+		[&](uint32_t iBegin, uint32_t iEnd, uint32_t)
+		{
+			for (uint32_t i = iBegin; i < iEnd; i++)
+			{
+				for (Corner& wCorner : wChunks[i].Corners)
+				{
+					wCorner.Position = ResolveIndex(wCorner.Position, wPositionOffsets[i], static_cast<uint32_t>(wPositionCount), kChunkRelative);
+					wCorner.UV = ResolveIndex(wCorner.UV, wUVOffsets[i], static_cast<uint32_t>(wUVCount), kChunkRelative);
+					wCorner.Normal = ResolveIndex(wCorner.Normal, wNormalOffsets[i], static_cast<uint32_t>(wNormalCount), kChunkRelative);
+				}
+			}
+		});
+
+	// Materials of every library, in declaration order
+	const std::string wDirectory = iPath.substr(0, iPath.find_last_of('/'));
+	std::unordered_map<std::string, uint32_t> wMaterialIds;
+	std::vector<std::string> wParsedLibs;
+	for (const Chunk& wChunk : wChunks)
+	{
+		for (const std::string& wLib : wChunk.MaterialLibs)
+		{
+			if (std::find(wParsedLibs.begin(), wParsedLibs.end(), wLib) == wParsedLibs.end())
+			{
+				wParsedLibs.push_back(wLib);
+				if (ParseMaterialLib(wDirectory, wLib, oData.Materials, wMaterialIds))
+				{
+					continue;
+				}
+
+				// Like Assimp, a missing library falls back to the one named after the mesh
+				const size_t wNameBegin = iPath.find_last_of('/') + 1;
+				const std::string wFallback = iPath.substr(wNameBegin, iPath.find_last_of('.') - wNameBegin) + ".mtl";
+				if (std::find(wParsedLibs.begin(), wParsedLibs.end(), wFallback) == wParsedLibs.end() &&
+					ParseMaterialLib(wDirectory, wFallback, oData.Materials, wMaterialIds))
+				{
+					wParsedLibs.push_back(wFallback);
+					continue;
+				}
+				spdlog::warn("\tMaterial library {0:s} of {1:s} not found", wLib, iPath);
+			}
+		}
+	}
+
+	// Corners before any usemtl, or with an unknown material, share a default material
+	uint32_t wDefaultMaterial = kNoIndex;
+	auto GetDefaultMaterial = [&]()
+	{
+		if (wDefaultMaterial == kNoIndex)
+		{
+			wDefaultMaterial = static_cast<uint32_t>(oData.Materials.size());
+			oData.Materials.emplace_back();
+			oData.Materials.back().Diffuse = glm::vec3(0.6f);
+		}
+		return wDefaultMaterial;
+	};
+
+	// Walk the statements in file order, the ranges between them go to the current object and material
+	std::vector<Object> wObjects;
+	std::vector<SubmeshSource> wSources;
+	uint32_t wMaterial = kNoIndex;
+	bool wNewObject = true;
+	std::string wObjectName = iPath.substr(iPath.find_last_of('/') + 1);
+	auto AddRange = [&](uint32_t iChunk, uint32_t iBegin, uint32_t iEnd)
+	{
+		if (iBegin >= iEnd)
+		{
+			return;
+		}
+
+		if (wNewObject)
+		{
+			wObjects.emplace_back();
+			wObjects.back().Name = wObjectName;
+			wNewObject = false;
+		}
+
+		const uint32_t wMaterialId = wMaterial == kNoIndex ? GetDefaultMaterial() : wMaterial;
+		Object& wObject = wObjects.back();
+		for (uint32_t wSourceId : wObject.Submeshes)
+		{
+			if (wSources[wSourceId].Material == wMaterialId)
+			{
+				wSources[wSourceId].Ranges.push_back({ iChunk, iBegin, iEnd });
+				return;
+			}
+		}
+
+		wObject.Submeshes.push_back(static_cast<uint32_t>(wSources.size()));
+		wSources.emplace_back();
+		wSources.back().Name = wObject.Name;
+		wSources.back().Material = wMaterialId;
+		wSources.back().Ranges.push_back({ iChunk, iBegin, iEnd });
+	};
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(wChunkCount); i++)
+	{
+		const Chunk& wChunk = wChunks[i];
+		uint32_t wBegin = 0;
+		for (const Statement& wStatement : wChunk.Statements)
+		{
+			AddRange(i, wBegin, wStatement.FirstCorner);
+			wBegin = wStatement.FirstCorner;
+
+			if (wStatement.Type == Statement::eObject)
+			{
+				wObjectName = wStatement.Name.empty() ? std::string("No Name") : wStatement.Name;
+				wNewObject = true;
+			}
+			else
+			{
+				auto wIt = wMaterialIds.find(wStatement.Name);
+				wMaterial = wIt != wMaterialIds.end() ? wIt->second : GetDefaultMaterial();
+			}
+		}
+		AddRange(i, wBegin, static_cast<uint32_t>(wChunk.Corners.size()));
+	}
+
+	if (wSources.empty())
+	{
+		spdlog::critical("\tError while parsing mesh {0:s} : no face", iPath);
+		return false;
+	}
+
+	// Root node, then one node per object with its submeshes
+	MeshData::Node wRoot;
+	wRoot.ChildCount = static_cast<uint32_t>(wObjects.size());
+	oData.Nodes.push_back(wRoot);
+
+	std::vector<uint32_t> wSourceOrder;
+	wSourceOrder.reserve(wSources.size());
+	for (const Object& wObject : wObjects)
+	{
+		MeshData::Node wNode;
+		wNode.FirstSubmesh = static_cast<uint32_t>(wSourceOrder.size());
+		wNode.SubmeshCount = static_cast<uint32_t>(wObject.Submeshes.size());
+		wNode.Depth = 1;
+		oData.Nodes.push_back(wNode);
+		wSourceOrder.insert(wSourceOrder.end(), wObject.Submeshes.begin(), wObject.Submeshes.end());
+	}
+
+	oData.Submeshes.resize(wSourceOrder.size());
+	std::vector<std::vector<std::vector<uint8_t>>> wBuffers(wSourceOrder.size());
+	wThreadPool->ParallelFor(static_cast<uint32_t>(wSourceOrder.size()),
+		[&](uint32_t iBegin, uint32_t iEnd, uint32_t)
+		{
+			for (uint32_t i = iBegin; i < iEnd; i++)
+			{
+				BuildSubmesh(wSources[wSourceOrder[i]], wChunks, wPositions, wUVs, wNormals, oData.Submeshes[i], wBuffers[i]);
+			}
+		});
+
+	// Moving the buffers keeps their storage, the stream pointers stay valid
+	for (size_t i = 0; i < wBuffers.size(); i++)
+	{
+		for (std::vector<uint8_t>& wBuffer : wBuffers[i])
+		{
+			oData.Buffers.push_back(std::move(wBuffer));
+		}
+
+		const MeshData::Submesh& wSubmesh = oData.Submeshes[i];
+		const glm::vec3* wSubmeshPositions = static_cast<const glm::vec3*>(wSubmesh.Streams[SubMesh::ePosition]);
+		for (uint32_t v = 0; v < wSubmesh.VertexCount; v++)
+		{
+			oData.BoundsMin = glm::min(oData.BoundsMin, wSubmeshPositions[v]);
+			oData.BoundsMax = glm::max(oData.BoundsMax, wSubmeshPositions[v]);
+		}
+		oData.VertexCount += wSubmesh.VertexCount;
+		oData.IndexCount += wSubmesh.IndexCount;
+	}
+
+	auto wClockStop = high_resolution_clock::now();
+	spdlog::info("\tOBJ {0:s} : {1:d} chunks parsed in {2:d} ms, {3:d} submeshes built in {4:d} ms", iPath, wChunkCount,
+		duration_cast<milliseconds>(wParseStop - wClockStart).count(), oData.Submeshes.size(),
+		duration_cast<milliseconds>(wClockStop - wParseStop).count());
+
+	return true;
+}
+
+void ObjImporter::ParseChunk(const char* iBegin, const char* iEnd, Chunk& oChunk)
+{
+	const char* wIt = iBegin;
+	while (wIt < iEnd)
+	{
+		const char* wLineEnd = FindLineEnd(wIt, iEnd);
+		const char* wLine = SkipSpaces(wIt, wLineEnd);
+		const size_t wLength = static_cast<size_t>(wLineEnd - wLine);
+		wIt = wLineEnd + 1;
+
+		if (wLength < 2)
+		{
+			continue;
+		}
+
+		const char wKey0 = wLine[0];
+		const char wKey1 = wLine[1];
+		if (wKey0 == 'v' && IsSpace(wKey1))
+		{
+			glm::vec3 wPosition;
+			const char* wValue = ParseFloat(wLine + 2, wLineEnd, wPosition.x);
+			wValue = ParseFloat(wValue, wLineEnd, wPosition.y);
+			ParseFloat(wValue, wLineEnd, wPosition.z);
+			oChunk.Positions.push_back(wPosition);
+		}
+		else if (wKey0 == 'v' && wKey1 == 't' && wLength > 2 && IsSpace(wLine[2]))
+		{
+			glm::vec2 wUV;
+			const char* wValue = ParseFloat(wLine + 3, wLineEnd, wUV.x);
+			ParseFloat(wValue, wLineEnd, wUV.y);
+			oChunk.UVs.push_back(wUV);
+		}
+		else if (wKey0 == 'v' && wKey1 == 'n' && wLength > 2 && IsSpace(wLine[2]))
+		{
+			glm::vec3 wNormal;
+			const char* wValue = ParseFloat(wLine + 3, wLineEnd, wNormal.x);
+			wValue = ParseFloat(wValue, wLineEnd, wNormal.y);
+			ParseFloat(wValue, wLineEnd, wNormal.z);
+			oChunk.Normals.push_back(wNormal);
+		}
+		else if (wKey0 == 'f' && IsSpace(wKey1))
+		{
+			ParseFace(wLine + 2, wLineEnd, oChunk);
+		}
+		else if ((wKey0 == 'o' || wKey0 == 'g') && IsSpace(wKey1))
+		{
+			oChunk.Statements.push_back({ Statement::eObject, ReadName(wLine + 2, wLineEnd), static_cast<uint32_t>(oChunk.Corners.size()) });
+		}
+		else if (wLength > 7 && std::strncmp(wLine, "usemtl", 6) == 0 && IsSpace(wLine[6]))
+		{
+			oChunk.Statements.push_back({ Statement::eMaterial, ReadName(wLine + 7, wLineEnd), static_cast<uint32_t>(oChunk.Corners.size()) });
+		}
+		else if (wLength > 7 && std::strncmp(wLine, "mtllib", 6) == 0 && IsSpace(wLine[6]))
+		{
+			oChunk.MaterialLibs.push_back(ReadName(wLine + 7, wLineEnd));
+		}
+	}
+}
+
+void ObjImporter::ParseFace(const char* iIt, const char* iEnd, Chunk& ioChunk)
+{
+	Corner wFirst;
+	Corner wPrevious;
+	uint32_t wCornerCount = 0;
+
+	iIt = SkipSpaces(iIt, iEnd);
+	while (iIt < iEnd)
+	{
+		// v, v/vt, v//vn or v/vt/vn
+		Corner wCorner = { kNoIndex, kNoIndex, kNoIndex };
+		int64_t wIndex = 0;
+		iIt = ParseInt(iIt, iEnd, wIndex);
+		wCorner.Position = EncodeIndex(wIndex, ioChunk.Positions.size(), kChunkRelative);
+		if (iIt < iEnd && *iIt == '/')
+		{
+			++iIt;
+			if (iIt < iEnd && *iIt != '/')
+			{
+				iIt = ParseInt(iIt, iEnd, wIndex);
+				wCorner.UV = EncodeIndex(wIndex, ioChunk.UVs.size(), kChunkRelative);
+			}
+			if (iIt < iEnd && *iIt == '/')
+			{
+				iIt = ParseInt(iIt + 1, iEnd, wIndex);
+				wCorner.Normal = EncodeIndex(wIndex, ioChunk.Normals.size(), kChunkRelative);
+			}
+		}
+
+		// Anything else than a separator ends the face (comments, garbage)
+		if (iIt < iEnd && !IsSpace(*iIt))
+		{
+			break;
+		}
+		iIt = SkipSpaces(iIt, iEnd);
+
+		// Polygons are fanned around their first corner
+		if (wCornerCount >= 2)
+		{
+			ioChunk.Corners.push_back(wFirst);
+			ioChunk.Corners.push_back(wPrevious);
+			ioChunk.Corners.push_back(wCorner);
+		}
+		else if (wCornerCount == 0)
+		{
+			wFirst = wCorner;
+		}
+		wPrevious = wCorner;
+		++wCornerCount;
+	}
+}
+
+bool ObjImporter::ParseMaterialLib(const std::string& iDirectory, const std::string& iLib, std::vector<MeshData::MaterialDesc>& ioMaterials,
+	std::unordered_map<std::string, uint32_t>& ioMaterialIds)
+{
+	MappedFile wFile;
+	if (!wFile.Open(iDirectory + "/" + iLib))
+	{
+		return false;
+	}
+
+	// Textures are relative to the library
+	const size_t wLibDirEnd = iLib.find_last_of('/');
+	const std::string wPrefix = wLibDirEnd == std::string::npos ? std::string() : iLib.substr(0, wLibDirEnd + 1);
+
+	const char* wIt = reinterpret_cast<const char*>(wFile.GetData());
+	const char* wEnd = wIt + wFile.GetSize();
+	MeshData::MaterialDesc* wMaterial = nullptr;
+	while (wIt < wEnd)
+	{
+		const char* wLineEnd = FindLineEnd(wIt, wEnd);
+		const char* wLine = SkipSpaces(wIt, wLineEnd);
+		wIt = wLineEnd + 1;
+
+		const char* wKeyEnd = wLine;
+		while (wKeyEnd < wLineEnd && !IsSpace(*wKeyEnd))
+		{
+			++wKeyEnd;
+		}
+		const std::string wKey(wLine, wKeyEnd);
+
+		if (wKey == "newmtl")
+		{
+			const std::string wName = ReadName(wKeyEnd, wLineEnd);
+			ioMaterialIds[wName] = static_cast<uint32_t>(ioMaterials.size());
+			ioMaterials.emplace_back();
+			wMaterial = &ioMaterials.back();
+			continue;
+		}
+
+		if (!wMaterial)
+		{
+			continue;
+		}
+
+		// Same channels as the Assimp import : map_Disp holds our normal maps, map_Ns the specular exponent
+		glm::vec3* wColor = wKey == "Ka" ? &wMaterial->Ambient : wKey == "Kd" ? &wMaterial->Diffuse :
+			wKey == "Ks" ? &wMaterial->Specular : nullptr;
+		if (wColor)
+		{
+			const char* wValue = ParseFloat(wKeyEnd, wLineEnd, wColor->x);
+			wValue = ParseFloat(wValue, wLineEnd, wColor->y);
+			ParseFloat(wValue, wLineEnd, wColor->z);
+		}
+		else if (wKey == "map_Kd")
+		{
+			wMaterial->DiffuseTex = wPrefix + ReadLastToken(wKeyEnd, wLineEnd);
+		}
+		else if (wKey == "map_Disp" || wKey == "disp")
+		{
+			wMaterial->NormalTex = wPrefix + ReadLastToken(wKeyEnd, wLineEnd);
+		}
+		else if (wKey == "map_Ns")
+		{
+			wMaterial->SpecularTex = wPrefix + ReadLastToken(wKeyEnd, wLineEnd);
+		}
+	}
+
+	return true;
+}
+
+void ObjImporter::BuildSubmesh(const SubmeshSource& iSource, const std::vector<Chunk>& iChunks, const std::vector<glm::vec3>& iPositions,
+	const std::vector<glm::vec2>& iUVs, const std::vector<glm::vec3>& iNormals, MeshData::Submesh& oSubmesh,
+	std::vector<std::vector<uint8_t>>& oBuffers)
+{
+	// Uvs when any corner has one, normals are generated unless every corner has one
+	size_t wCornerCount = 0;
+	bool wHasUVs = false;
+	bool wHasNormals = true;
+	for (const CornerRange& wRange : iSource.Ranges)
+	{
+		wCornerCount += wRange.End - wRange.Begin;
+		for (uint32_t i = wRange.Begin; i < wRange.End; i++)
+		{
+			const Corner& wCorner = iChunks[wRange.Chunk].Corners[i];
+			wHasUVs |= wCorner.UV != kNoIndex;
+			wHasNormals &= wCorner.Normal != kNoIndex;
+		}
+	}
+
+	std::unordered_map<Corner, uint32_t, CornerHash> wVertexIds;
+	wVertexIds.reserve(wCornerCount);
+	std::vector<Corner> wVertices;
+	std::vector<uint32_t> wIndices;
+	wVertices.reserve(wCornerCount);
+	wIndices.reserve(wCornerCount);
+
+	for (const CornerRange& wRange : iSource.Ranges)
+	{
+		const std::vector<Corner>& wCorners = iChunks[wRange.Chunk].Corners;
+		for (uint32_t i = wRange.Begin; i + 2 < wRange.End; i += 3)
+		{
+			if (wCorners[i].Position == kNoIndex || wCorners[i + 1].Position == kNoIndex || wCorners[i + 2].Position == kNoIndex)
+			{
+				continue;
+			}
+
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				Corner wKey = wCorners[i + c];
+				wKey.UV = wHasUVs ? wKey.UV : kNoIndex;
+				wKey.Normal = wHasNormals ? wKey.Normal : kNoIndex;
+
+				auto wInserted = wVertexIds.emplace(wKey, static_cast<uint32_t>(wVertices.size()));
+				if (wInserted.second)
+				{
+					wVertices.push_back(wKey);
+				}
+				wIndices.push_back(wInserted.first->second);
+			}
+		}
+	}
+
+	const size_t wVertexCount = wVertices.size();
+	glm::vec3* wPositions = AllocateStream<glm::vec3>(oBuffers, wVertexCount);
+	glm::vec3* wNormals = AllocateStream<glm::vec3>(oBuffers, wVertexCount);
+	for (size_t i = 0; i < wVertexCount; i++)
+	{
+		wPositions[i] = iPositions[wVertices[i].Position];
+		wNormals[i] = wHasNormals ? iNormals[wVertices[i].Normal] : glm::vec3(0.f);
+	}
+
+	if (!wHasNormals)
+	{
+		// Smooth normals, area weighted face normals summed on the vertices sharing a position
+		std::unordered_map<uint32_t, glm::vec3> wPositionNormals;
+		for (size_t i = 0; i < wIndices.size(); i += 3)
+		{
+			const glm::vec3& wA = wPositions[wIndices[i]];
+			const glm::vec3 wFaceNormal = glm::cross(wPositions[wIndices[i + 1]] - wA, wPositions[wIndices[i + 2]] - wA);
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				wPositionNormals[wVertices[wIndices[i + c]].Position] += wFaceNormal;
+			}
+		}
+
+		for (size_t i = 0; i < wVertexCount; i++)
+		{
+			const glm::vec3& wNormal = wPositionNormals[wVertices[i].Position];
+			const float wLength = glm::length(wNormal);
+			wNormals[i] = wLength > 0.f ? wNormal / wLength : glm::vec3(0.f, 1.f, 0.f);
+		}
+	}
+
+	uint32_t* wIndexStream = AllocateStream<uint32_t>(oBuffers, wIndices.size());
+	std::memcpy(wIndexStream, wIndices.data(), wIndices.size() * sizeof(uint32_t));
+
+	oSubmesh.Name = iSource.Name;
+	oSubmesh.Material = iSource.Material;
+	oSubmesh.VertexCount = static_cast<uint32_t>(wVertexCount);
+	oSubmesh.IndexCount = static_cast<uint32_t>(wIndices.size());
+	oSubmesh.Streams[SubMesh::ePosition] = wPositions;
+	oSubmesh.Streams[SubMesh::eNormal] = wNormals;
+	oSubmesh.Indices = wIndexStream;
+
+	if (!wHasUVs)
+	{
+		return;
+	}
+
+	glm::vec2* wUVs = AllocateStream<glm::vec2>(oBuffers, wVertexCount);
+	for (size_t i = 0; i < wVertexCount; i++)
+	{
+		wUVs[i] = wVertices[i].UV != kNoIndex ? iUVs[wVertices[i].UV] : glm::vec2(0.f);
+	}
+	oSubmesh.Streams[SubMesh::eUV0] = wUVs;
+
+	glm::vec3* wTangents = AllocateStream<glm::vec3>(oBuffers, wVertexCount);
+	MeshData::GenerateTangents(wPositions, wNormals, wUVs, static_cast<uint32_t>(wVertexCount), wIndexStream,
+		static_cast<uint32_t>(wIndices.size()), wTangents);
+	oSubmesh.Streams[SubMesh::eTangent] = wTangents;
+}
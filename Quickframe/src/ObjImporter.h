@@ -0,0 +1,139 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include "MeshData.h"
+
+/**
+ * @brief : Wavefront OBJ/MTL importer, faster replacement of the Assimp path for our assets.
+ * The file is memory mapped and split in line aligned chunks parsed in parallel, the chunks are then
+ * merged and each submesh is built on its own job : vertices are deduplicated on their position,
+ * uv and normal indices, missing normals are smoothed and tangents are generated from the uvs.
+ * The hierarchy matches the Assimp import : a root node with one child per object, one submesh per
+ * material used by the object.
+*/
+class ObjImporter
+{
+	static constexpr uint32_t kNoIndex = UINT32_MAX;
+	static constexpr uint32_t kChunkRelative = 0x80000000u;		// Negative OBJ index, offset from the chunk start resolved when merging
+	static constexpr size_t kMinChunkBytes = 256 * 1024;
+
+	struct Corner
+	{
+		uint32_t Position;
+		uint32_t UV;
+		uint32_t Normal;
+
+		bool operator==(const Corner& iOther) const
+		{
+			return Position == iOther.Position && UV == iOther.UV && Normal == iOther.Normal;
+		}
+	};
+
+	struct CornerHash
+	{
+		size_t operator()(const Corner& iCorner) const;
+	};
+
+	/**
+	 * @brief : Grouping statement, applies to the corners from FirstCorner on
+	*/
+	struct Statement
+	{
+		enum EType
+		{
+			eObject,
+			eMaterial
+		};
+
+		EType Type;
+		std::string Name;
+		uint32_t FirstCorner;
+	};
+
+	struct Chunk
+	{
+		std::vector<glm::vec3> Positions;
+		std::vector<glm::vec2> UVs;
+		std::vector<glm::vec3> Normals;
+		std::vector<Corner> Corners;			// Triangle list, faces are fanned
+		std::vector<Statement> Statements;
+		std::vector<std::string> MaterialLibs;
+	};
+
+	/**
+	 * @brief : Corners of a chunk going to one submesh
+	*/
+	struct CornerRange
+	{
+		uint32_t Chunk;
+		uint32_t Begin;
+		uint32_t End;
+	};
+
+	struct SubmeshSource
+	{
+		std::string Name;
+		uint32_t Material;
+		std::vector<CornerRange> Ranges;
+	};
+
+	struct Object
+	{
+		std::string Name;
+		std::vector<uint32_t> Submeshes;		// Indices of their SubmeshSource
+	};
+
+public:
+	/**
+	 * @brief : Blocking, spreads its work with ParallelFor
+	*/
+	static bool Import(const std::string& iPath, MeshData& oData);
+
+private:
+	static void ParseChunk(const char* iBegin, const char* iEnd, Chunk& oChunk);
+
+	static void ParseFace(const char* iIt, const char* iEnd, Chunk& ioChunk);
+
+	/**
+	 * @brief : Append the materials of a library, texture paths are made relative to the mesh directory
+	*/
+	static bool ParseMaterialLib(const std::string& iDirectory, const std::string& iLib, std::vector<MeshData::MaterialDesc>& ioMaterials,
+		std::unordered_map<std::string, uint32_t>& ioMaterialIds);
+
+	/**
+	 * @brief : Deduplicated streams of a submesh, written to iBuffers which are moved to the MeshData afterwards
+	*/
+	static void BuildSubmesh(const SubmeshSource& iSource, const std::vector<Chunk>& iChunks, const std::vector<glm::vec3>& iPositions,
+		const std::vector<glm::vec2>& iUVs, const std::vector<glm::vec3>& iNormals, MeshData::Submesh& oSubmesh,
+		std::vector<std::vector<uint8_t>>& oBuffers);
+};
@@ -26,10 +26,13 @@ SOFTWARE.
 
 uint32_t Plane::sPlaneCount = 0;
 
-Plane::Plane()
+Plane::Plane(bool iLoadDefaultMesh)
 	:Entity("Plane_" + std::to_string(sPlaneCount))
 {
-	LoadMesh("resources/meshes/plane.obj");
+	if (iLoadDefaultMesh)
+	{
+		LoadMesh("resources/meshes/plane.obj");
+	}
 	sPlaneCount++;
 }
 
@@ -30,7 +30,10 @@ class Plane : public Entity
 {
 
 public:
-	Plane();
+	/**
+	 * @param iLoadDefaultMesh : false when the mesh is provided afterwards, by a batched scene load
+	*/
+	explicit Plane(bool iLoadDefaultMesh = true);
 
 	~Plane();
 
@@ -0,0 +1,340 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <functional>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <spdlog/spdlog.h>
+
+#include "PointShadowPass.h"
+#include "Scene.h"
+#include "MeshNode.h"
+#include "GLStateCache.h"
+
+namespace
+{
+	// GL_TEXTURE_CUBE_MAP_POSITIVE_X + i order
+	const glm::vec3 kFaceDirs[6] = {
+		{ 1.f, 0.f, 0.f }, { -1.f, 0.f, 0.f },
+		{ 0.f, 1.f, 0.f }, { 0.f, -1.f, 0.f },
+		{ 0.f, 0.f, 1.f }, { 0.f, 0.f, -1.f } };
+
+	const glm::vec3 kFaceUps[6] = {
+		{ 0.f, -1.f, 0.f }, { 0.f, -1.f, 0.f },
+		{ 0.f, 0.f, 1.f }, { 0.f, 0.f, -1.f },
+		{ 0.f, -1.f, 0.f }, { 0.f, -1.f, 0.f } };
+
+	constexpr float kShadowNearPlane = 0.05f;
+
+	void HashCombine(size_t& ioSeed, size_t iValue)
+	{
+		ioSeed ^= iValue + 0x9e3779b9 + (ioSeed << 6) + (ioSeed >> 2);
+	}
+}
+
+PointShadowPass::PointShadowPass()
+	:mViewBatch(ShadowViewBatch::EDepthMode::eLightDistance)
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+
+	glGenTextures(1, &mCubeMapArray);
+	wStateCache->BindTexture(GL_TEXTURE0, GL_TEXTURE_CUBE_MAP_ARRAY, mCubeMapArray);
+	glTexImage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 0, GL_DEPTH_COMPONENT24, kShadowMapSize, kShadowMapSize,
+		kMaxShadowedLights * 6, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	glGenFramebuffers(1, &mFramebufferHandle);
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, mFramebufferHandle);
+	// Layered attachment, faces are selected with gl_Layer
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, mCubeMapArray, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		spdlog::critical("Error While Creating Framebuffer Point Shadow Maps !");
+	}
+
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+PointShadowPass::~PointShadowPass()
+{
+	GLStateCache::GetInstance()->OnTextureDeleted(mCubeMapArray);
+	GLStateCache::GetInstance()->OnFramebufferDeleted(mFramebufferHandle);
+	glDeleteTextures(1, &mCubeMapArray);
+	glDeleteFramebuffers(1, &mFramebufferHandle);
+}
+
+void PointShadowPass::Execute(Scene* iScene)
+{
+	++mFrame;
+	mFacesRendered = 0;
+
+	GatherCasters(iScene);
+
+	struct PendingFace
+	{
+		LightState* Light;
+		uint32_t Face;
+		float CameraDistance;
+	};
+	std::vector<PendingFace> wPending;
+
+	const glm::vec3 wCameraPos = iScene->GetCamera()->WorldPos();
+
+	for (uint32_t i = 0; i < iScene->GetPointLightCount(); i++)
+	{
+		const PointLight* wPointLight = iScene->GetPointLight(i);
+		if (!wPointLight->IsShadowEnabled())
+		{
+			continue;
+		}
+
+		auto wIt = mLights.find(wPointLight->GetID());
+		if (wIt == mLights.end())
+		{
+			uint32_t wSlot = 0;
+			if (!AcquireSlot(wSlot))
+			{
+				continue;
+			}
+			wIt = mLights.emplace(wPointLight->GetID(), LightState{}).first;
+			wIt->second.Slot = wSlot;
+			for (FaceState& wFace : wIt->second.Faces)
+			{
+				wFace.DirtySinceFrame = mFrame;
+			}
+		}
+
+		LightState& wLight = wIt->second;
+		wLight.LastSeenFrame = mFrame;
+
+		// Moving the light or changing its reach invalidates every face
+		float wFarPlane = std::min(wPointLight->GetRange(), kMaxShadowDistance);
+		if (wLight.Pos != wPointLight->GetPos() || wLight.FarPlane != wFarPlane)
+		{
+			wLight.Pos = wPointLight->GetPos();
+			wLight.FarPlane = wFarPlane;
+			for (FaceState& wFace : wLight.Faces)
+			{
+				if (!wFace.Dirty)
+				{
+					wFace.Dirty = true;
+					wFace.DirtySinceFrame = mFrame;
+				}
+			}
+		}
+
+		for (uint32_t wFaceIdx = 0; wFaceIdx < 6; wFaceIdx++)
+		{
+			FaceState& wFace = wLight.Faces[wFaceIdx];
+			wLight.PendingSignatures[wFaceIdx] = ComputeFaceSignature(wLight.Pos, wLight.FarPlane, wFaceIdx);
+
+			if (!wFace.Dirty && wLight.PendingSignatures[wFaceIdx] != wFace.Signature)
+			{
+				wFace.Dirty = true;
+				wFace.DirtySinceFrame = mFrame;
+			}
+
+			if (wFace.Dirty)
+			{
+				wPending.push_back({ &wLight, wFaceIdx, glm::length(wLight.Pos - wCameraPos) });
+			}
+		}
+	}
+
+	// Release the slots of lights that left the scene or lost their shadow
+	for (auto wIt = mLights.begin(); wIt != mLights.end();)
+	{
+		if (wIt->second.LastSeenFrame != mFrame)
+		{
+			mSlotUsed[wIt->second.Slot] = false;
+			wIt = mLights.erase(wIt);
+		}
+		else
+		{
+			++wIt;
+		}
+	}
+
+	if (wPending.empty())
+	{
+		return;
+	}
+
+	// Stalest faces first, then the lights closest to the camera
+	std::sort(wPending.begin(), wPending.end(), [](const PendingFace& iA, const PendingFace& iB)
+		{
+			uint64_t wA = iA.Light->Faces[iA.Face].DirtySinceFrame;
+			uint64_t wB = iB.Light->Faces[iB.Face].DirtySinceFrame;
+			if (wA != wB)
+			{
+				return wA < wB;
+			}
+			return iA.CameraDistance < iB.CameraDistance;
+		});
+
+	// All the faces updated this frame are drawn in a single layered pass
+	const float wClearDepth = 1.f;
+	uint32_t wUpdateCount = std::min(static_cast<uint32_t>(wPending.size()), kFaceUpdateBudget);
+	mViewBatch.Reset();
+	mBatchFaces.clear();
+	for (uint32_t i = 0; i < wUpdateCount; i++)
+	{
+		LightState& wLight = *wPending[i].Light;
+		uint32_t wFaceIdx = wPending[i].Face;
+		GLint wLayer = wLight.Slot * 6 + wFaceIdx;
+
+		glClearTexSubImage(mCubeMapArray, 0, 0, 0, wLayer, kShadowMapSize, kShadowMapSize, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &wClearDepth);
+
+		glm::mat4 wProjection = glm::perspective(glm::radians(90.f), 1.f, kShadowNearPlane, wLight.FarPlane);
+		glm::mat4 wViewProj = wProjection * glm::lookAt(wLight.Pos, wLight.Pos + kFaceDirs[wFaceIdx], kFaceUps[wFaceIdx]);
+		mViewBatch.AddView(wViewProj, wLayer, glm::ivec4(0, 0, kShadowMapSize, kShadowMapSize), wLight.Pos, wLight.FarPlane);
+		mBatchFaces.push_back({ wLight.Pos, wLight.FarPlane, wFaceIdx });
+
+		wLight.Faces[wFaceIdx].Signature = wLight.PendingSignatures[wFaceIdx];
+		wLight.Faces[wFaceIdx].Dirty = false;
+		++mFacesRendered;
+	}
+
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, mFramebufferHandle);
+	wStateCache->SetDepthMask(true);
+	wStateCache->SetDepthTest(true);
+	wStateCache->SetDepthFunc(GL_LESS);
+
+	// Clears go through the texture, make them visible to the rasterizer
+	glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+
+	mCasterEntities.clear();
+	for (const Caster& wCaster : mCasters)
+	{
+		mCasterEntities.push_back(wCaster.Object);
+	}
+
+	// Each caster is only emitted to the faces its bounding sphere touches
+	mViewBatch.Render(mCasterEntities, [this](uint32_t iCaster, uint32_t iView)
+		{
+			const BatchFace& wFace = mBatchFaces[iView];
+			return CasterTouchesFace(mCasters[iCaster], wFace.LightPos, wFace.FarPlane, wFace.Face);
+		});
+}
+
+bool PointShadowPass::GetShadowSlot(uint32_t iLightID, uint32_t& oSlot, float& oFarPlane) const
+{
+	auto wIt = mLights.find(iLightID);
+	if (wIt == mLights.end())
+	{
+		return false;
+	}
+
+	oSlot = wIt->second.Slot;
+	oFarPlane = wIt->second.FarPlane;
+	return true;
+}
+
+void PointShadowPass::BindShadowMaps(GLenum iTextureUnit)
+{
+	GLStateCache::GetInstance()->BindTexture(iTextureUnit, GL_TEXTURE_CUBE_MAP_ARRAY, mCubeMapArray);
+}
+
+void PointShadowPass::GatherCasters(Scene* iScene)
+{
+	mCasters.clear();
+	for (const auto& wEntityMap : iScene->GetEntities())
+	{
+		Caster wCaster;
+		wCaster.Object = wEntityMap.second.get();
+		if (!wCaster.Object->IsDrawable() || !wCaster.Object->GetWorldBoundingSphere(wCaster.Center, wCaster.Radius))
+		{
+			continue;
+		}
+		wCaster.Version = wCaster.Object->GetTransform()->GetVersion();
+		mCasters.push_back(wCaster);
+	}
+}
+
+bool PointShadowPass::AcquireSlot(uint32_t& oSlot)
+{
+	for (uint32_t i = 0; i < kMaxShadowedLights; i++)
+	{
+		if (!mSlotUsed[i])
+		{
+			mSlotUsed[i] = true;
+			oSlot = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t PointShadowPass::ComputeFaceSignature(const glm::vec3& iLightPos, float iFarPlane, uint32_t iFace) const
+{
+	size_t wSignature = 0;
+	for (const Caster& wCaster : mCasters)
+	{
+		if (CasterTouchesFace(wCaster, iLightPos, iFarPlane, iFace))
+		{
+			HashCombine(wSignature, std::hash<const void*>()(wCaster.Object));
+			HashCombine(wSignature, std::hash<uint64_t>()(wCaster.Version));
+		}
+	}
+	return wSignature;
+}
+
+bool PointShadowPass::CasterTouchesFace(const Caster& iCaster, const glm::vec3& iLightPos, float iFarPlane, uint32_t iFace) const
+{
+	glm::vec3 wToCaster = iCaster.Center - iLightPos;
+	float wDistance = glm::length(wToCaster);
+	if (wDistance - iCaster.Radius > iFarPlane)
+	{
+		return false;
+	}
+
+	if (wDistance <= iCaster.Radius)
+	{
+		return true;
+	}
+
+	// The 4 side planes of a 90 degrees frustum have inward normals (Dir +- Side) / sqrt(2)
+	const glm::vec3& wDir = kFaceDirs[iFace];
+	glm::vec3 wSideA = kFaceUps[iFace];
+	glm::vec3 wSideB = glm::cross(wDir, wSideA);
+	const float wInvSqrt2 = 0.70710678f;
+
+	for (const glm::vec3& wSide : { wSideA, -wSideA, wSideB, -wSideB })
+	{
+		if (glm::dot((wDir + wSide) * wInvSqrt2, wToCaster) < -iCaster.Radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
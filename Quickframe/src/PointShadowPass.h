@@ -0,0 +1,117 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include <glm/vec3.hpp>
+
+#include "Pass.h"
+#include "ShadowViewBatch.h"
+
+class Entity;
+class PointLight;
+
+/**
+ * @brief : Omnidirectional shadows of the point lights, one cube map per light in a shared cube map array.
+ * Faces are cached across frames and only re-rendered when the light moves or when a caster touching
+ * the face changes (Transform versions). A per-frame face budget spreads the updates over frames.
+*/
+class PointShadowPass : public Pass
+{
+	struct Caster
+	{
+		Entity* Object = nullptr;
+		glm::vec3 Center{ 0.f };
+		float Radius = 0.f;
+		uint64_t Version = 0;
+	};
+
+	struct FaceState
+	{
+		size_t Signature = 0;					// Hash of the casters touching the face and their versions
+		uint64_t DirtySinceFrame = 0;
+		bool Dirty = true;
+	};
+
+	struct BatchFace
+	{
+		glm::vec3 LightPos;
+		float FarPlane;
+		uint32_t Face;
+	};
+
+	struct LightState
+	{
+		uint32_t Slot = 0;
+		glm::vec3 Pos{ 0.f };
+		float FarPlane = 0.f;
+		uint64_t LastSeenFrame = 0;
+		std::array<FaceState, 6> Faces;
+		std::array<size_t, 6> PendingSignatures{};
+	};
+
+public:
+	static constexpr uint32_t kMaxShadowedLights = 8;
+	static constexpr uint32_t kShadowMapSize = 512;
+	static constexpr uint32_t kFaceUpdateBudget = 12;		// Cube faces rendered per frame at most
+	static constexpr float kMaxShadowDistance = 200.f;
+
+	PointShadowPass();
+	~PointShadowPass();
+
+	void Execute(Scene* iScene) override;
+
+	/**
+	 * @brief : Cube map array layer of a light shadow and the distance its depth is normalized with
+	 * @return false if the light has no shadow this frame
+	*/
+	bool GetShadowSlot(uint32_t iLightID, uint32_t& oSlot, float& oFarPlane) const;
+
+	void BindShadowMaps(GLenum iTextureUnit);
+
+	uint32_t GetFacesRenderedLastFrame() const { return mFacesRendered; }
+
+private:
+	void GatherCasters(Scene* iScene);
+	bool AcquireSlot(uint32_t& oSlot);
+	size_t ComputeFaceSignature(const glm::vec3& iLightPos, float iFarPlane, uint32_t iFace) const;
+	bool CasterTouchesFace(const Caster& iCaster, const glm::vec3& iLightPos, float iFarPlane, uint32_t iFace) const;
+
+	GLuint mCubeMapArray = 0;
+	GLuint mFramebufferHandle = 0;
+
+	std::unordered_map<uint32_t, LightState> mLights;		// Light ID -> cache state
+	std::array<bool, kMaxShadowedLights> mSlotUsed{};
+	std::vector<Caster> mCasters;
+	std::vector<Entity*> mCasterEntities;
+
+	ShadowViewBatch mViewBatch;
+	std::vector<BatchFace> mBatchFaces;		// Cube face of each view of the batch
+
+	uint64_t mFrame = 0;
+	uint32_t mFacesRendered = 0;
+};
@@ -23,23 +23,25 @@ SOFTWARE.
 */
 
 #include <chrono>
+#include <thread>
 #include <spdlog/spdlog.h>
 
 #include "Program.h"
+#include "GLStateCache.h"
+#include "ProgramCache.h"
+#include "ShaderCompiler.h"
 
 using namespace std::chrono;
 
-Program::Program(const std::vector<Shader>& iShaders)
+Program::Program(const std::vector<Shader>& iShaders, bool iAsync)
 {
-	auto wClockStart = high_resolution_clock::now();
+	mBuildStart = high_resolution_clock::now();
 	mProgramHandle = glCreateProgram();
 
 	PipelineShaders wPipeline{};
 
 	for (const Shader& wShader : iShaders)
 	{
-		glAttachShader(mProgramHandle, wShader.GetShaderHandle());
-
 		switch (wShader.GetStage())
 		{
 		case Shader::EShaderStage::eVertex:
@@ -51,6 +53,11 @@ Program::Program(const std::vector<Shader>& iShaders)
 		case Shader::EShaderStage::eFragment:
 			wPipeline.FS = wShader;
 			break;
+		case Shader::EShaderStage::eCompute:
+			wPipeline.CS = wShader;
+			break;
+		default:
+			break;
 		}
 	}
 
@@ -59,18 +66,158 @@ Program::Program(const std::vector<Shader>& iShaders)
 	spdlog::info("\tProgram {0:d} VS : {1:s}", mProgramHandle, wPipeline.VS.GetFilename());
 	spdlog::info("\tProgram {0:d} GS : {1:s}", mProgramHandle, wPipeline.GS.GetFilename());
 	spdlog::info("\tProgram {0:d} FS : {1:s}", mProgramHandle, wPipeline.FS.GetFilename());
+	spdlog::info("\tProgram {0:d} CS : {1:s}", mProgramHandle, wPipeline.CS.GetFilename());
+
+	ProgramCache* wProgramCache = ProgramCache::GetInstance();
+	mCacheKey = wProgramCache->ComputeKey(iShaders);
+
+	if (wProgramCache->Load(mCacheKey, mProgramHandle))
+	{
+		mFromCache = true;
+		Finalize();
+		return;
+	}
+
+	const ShaderCompiler::EMode wMode = iAsync ? ShaderCompiler::GetInstance()->GetMode() : ShaderCompiler::EMode::eSynchronous;
+	if (wMode == ShaderCompiler::EMode::eSharedContext)
+	{
+		// The worker owns the shader objects, only the program handle is shared with it
+		mBuildState = EBuildState::eWorkerLink;
+		mWorkerDone = std::make_shared<std::atomic<bool>>(false);
+
+		GLuint wProgramHandle = mProgramHandle;
+		std::shared_ptr<std::atomic<bool>> wWorkerDone = mWorkerDone;
+		ShaderCompiler::GetInstance()->Submit([iShaders, wProgramHandle, wWorkerDone]()
+			{
+				std::vector<Shader> wShaders = iShaders;
+				SubmitLink(wProgramHandle, wShaders);
+				for (Shader& wShader : wShaders)
+				{
+					wShader.CheckCompileStatus();
+					glDetachShader(wProgramHandle, wShader.GetShaderHandle());
+					glDeleteShader(wShader.GetShaderHandle());
+				}
+
+				// Link results must be complete before the main context looks at the program
+				GLint wLinked = 0;
+				glGetProgramiv(wProgramHandle, GL_LINK_STATUS, &wLinked);
+				glFinish();
+				wWorkerDone->store(true, std::memory_order_release);
+			});
+		return;
+	}
+
+	mPendingShaders = iShaders;
+	SubmitLink(mProgramHandle, mPendingShaders);
+
+	if (wMode == ShaderCompiler::EMode::eParallelExtension)
+	{
+		mBuildState = EBuildState::eParallelLink;
+		return;
+	}
+
+	Finalize();
+}
+
+Program::~Program()
+{
+	// The shared context worker uses the handle until it signals completion
+	if (mBuildState == EBuildState::eWorkerLink)
+	{
+		while (!mWorkerDone->load(std::memory_order_acquire))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	for (Shader& wShader : mPendingShaders)
+	{
+		glDeleteShader(wShader.GetShaderHandle());
+	}
+
+	GLStateCache::GetInstance()->OnProgramDeleted(mProgramHandle);
+	glDeleteProgram(mProgramHandle);
+}
 
+bool Program::IsReady()
+{
+	switch (mBuildState)
+	{
+	case EBuildState::eParallelLink:
+	{
+		GLint wCompleted = GL_FALSE;
+		glGetProgramiv(mProgramHandle, GL_COMPLETION_STATUS_KHR, &wCompleted);
+		if (!wCompleted)
+		{
+			return false;
+		}
+		break;
+	}
+	case EBuildState::eWorkerLink:
+		if (!mWorkerDone->load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		break;
+	default:
+		return true;
+	}
+
+	Finalize();
+	return true;
+}
+
+void Program::WaitReady()
+{
+	// Status queries block until the driver is done with the parallel extension
+	if (mBuildState == EBuildState::eParallelLink)
+	{
+		Finalize();
+		return;
+	}
+
+	while (!IsReady())
+	{
+		std::this_thread::yield();
+	}
+}
+
+void Program::SubmitLink(GLuint iProgram, std::vector<Shader>& ioShaders)
+{
+	for (Shader& wShader : ioShaders)
+	{
+		wShader.SubmitCompile();
+		glAttachShader(iProgram, wShader.GetShaderHandle());
+	}
+
+	// Link is queued, querying its status is what waits for the driver
+	glProgramParameteri(iProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(iProgram);
+}
+
+void Program::Finalize()
+{
 	int wSuccess = 0;
 	char wErrorLog[1024] = { 0 };
 
-	// Link the program
-	glLinkProgram(mProgramHandle);
+	for (Shader& wShader : mPendingShaders)
+	{
+		wShader.CheckCompileStatus();
+		glDetachShader(mProgramHandle, wShader.GetShaderHandle());
+		glDeleteShader(wShader.GetShaderHandle());
+	}
+	mPendingShaders.clear();
+
 	glGetProgramiv(mProgramHandle, GL_LINK_STATUS, &wSuccess);
 	if (wSuccess == 0) 
 	{
 		glGetProgramInfoLog(mProgramHandle, sizeof(wErrorLog), NULL, wErrorLog);
 		spdlog::critical("Error Linking Program : {0:s}", wErrorLog);
 	}
+	else if (!mFromCache)
+	{
+		ProgramCache::GetInstance()->Store(mCacheKey, mProgramHandle);
+	}
 
 	// Validate the program
 	glValidateProgram(mProgramHandle);
@@ -81,19 +228,26 @@ Program::Program(const std::vector<Shader>& iShaders)
 		spdlog::critical("Error Validating Program : {0:s}", wErrorLog);
 	}
 
+	ReflectUniforms();
+
+	mBuildState = EBuildState::eReady;
+	mWorkerDone.reset();
+
+	// Background builds are measured from submission to the first poll that sees them done
 	auto wClockStop = high_resolution_clock::now();
-	auto wDuration = duration_cast<milliseconds>(wClockStop - wClockStart);
-	spdlog::info("Program {0:d} compiled in {1:d} ms !", mProgramHandle, wDuration.count());
+	const double wDurationMs = duration_cast<microseconds>(wClockStop - mBuildStart).count() / 1000.0;
+	ProgramCache::GetInstance()->RecordProgram(mFromCache, wDurationMs);
+	spdlog::info("Program {0:d} {1:s} in {2:.2f} ms !", mProgramHandle, mFromCache ? "loaded from cache" : "compiled", wDurationMs);
 }
 
 void Program::Bind()
 {
-	glUseProgram(mProgramHandle);
+	GLStateCache::GetInstance()->UseProgram(mProgramHandle);
 }
 
 void Program::Unbind()
 {
-	glUseProgram(0);
+	GLStateCache::GetInstance()->UseProgram(0);
 }
 
 void Program::SetUniform1i(const std::string& iName, int iValue)
@@ -122,6 +276,45 @@ void Program::SetUniform1f(const std::string& iName, float iValue)
 	glUniform1f(glGetUniformLocation(mProgramHandle, iName.c_str()), iValue);
 }
 
+void Program::SetUniform1ui(const std::string& iName, uint32_t iValue)
+{
+	GLuint wLoc = GetUniformLocation(iName);
+	if (wLoc != 0xFFFFFFFF)
+	{
+		glUniform1ui(wLoc, iValue);
+		return;
+	}
+
+	mUniformsMap[iName] = glGetUniformLocation(mProgramHandle, iName.c_str());
+	glUniform1ui(glGetUniformLocation(mProgramHandle, iName.c_str()), iValue);
+}
+
+void Program::SetUniform2f(const std::string& iName, glm::vec2 iValue)
+{
+	GLuint wLoc = GetUniformLocation(iName);
+	if (wLoc != 0xFFFFFFFF)
+	{
+		glUniform2fv(wLoc, 1, glm::value_ptr(iValue));
+		return;
+	}
+
+	mUniformsMap[iName] = glGetUniformLocation(mProgramHandle, iName.c_str());
+	glUniform2fv(glGetUniformLocation(mProgramHandle, iName.c_str()), 1, glm::value_ptr(iValue));
+}
+
+void Program::SetUniform3ui(const std::string& iName, glm::uvec3 iValue)
+{
+	GLuint wLoc = GetUniformLocation(iName);
+	if (wLoc != 0xFFFFFFFF)
+	{
+		glUniform3uiv(wLoc, 1, glm::value_ptr(iValue));
+		return;
+	}
+
+	mUniformsMap[iName] = glGetUniformLocation(mProgramHandle, iName.c_str());
+	glUniform3uiv(glGetUniformLocation(mProgramHandle, iName.c_str()), 1, glm::value_ptr(iValue));
+}
+
 void Program::SetUniform3f(const std::string& iName, glm::vec3 iValue)
 {
 	GLuint wLoc = GetUniformLocation(iName);
@@ -197,3 +390,52 @@ GLuint Program::GetUniformLocation(const std::string& iName)
 
 	return 0xFFFFFFFF;
 }
+
+GLint Program::FindUniformLocation(const std::string& iName) const
+{
+	auto it = mUniformsMap.find(iName);
+	if (it != mUniformsMap.end())
+	{
+		return static_cast<GLint>((*it).second);
+	}
+
+	return -1;
+}
+
+void Program::ReflectUniforms()
+{
+	GLint wUniformCount = 0;
+	glGetProgramiv(mProgramHandle, GL_ACTIVE_UNIFORMS, &wUniformCount);
+
+	char wName[256];
+	for (GLint i = 0; i < wUniformCount; i++)
+	{
+		GLsizei wLength = 0;
+		GLint wSize = 0;
+		GLenum wType = 0;
+		glGetActiveUniform(mProgramHandle, i, sizeof(wName), &wLength, &wSize, &wType, wName);
+
+		std::string wUniformName(wName, wLength);
+		GLint wLocation = glGetUniformLocation(mProgramHandle, wUniformName.c_str());
+		if (wLocation < 0)
+		{
+			// Uniform block member
+			continue;
+		}
+
+		mUniformsMap[wUniformName] = wLocation;
+
+		// Arrays of basic types are reported once as "name[0]"
+		size_t wBracket = wUniformName.rfind("[0]");
+		if (wSize > 1 && wBracket == wUniformName.size() - 3)
+		{
+			std::string wBaseName = wUniformName.substr(0, wBracket);
+			mUniformsMap[wBaseName] = wLocation;
+			for (GLint j = 1; j < wSize; j++)
+			{
+				std::string wElementName = wBaseName + "[" + std::to_string(j) + "]";
+				mUniformsMap[wElementName] = glGetUniformLocation(mProgramHandle, wElementName.c_str());
+			}
+		}
+	}
+}
@@ -24,10 +24,14 @@ SOFTWARE.
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <vector>
 #include <unordered_map>
 
 #include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
@@ -43,24 +47,87 @@ class Program
 		Shader VS;
 		Shader GS;
 		Shader FS;
+		Shader CS;
 	};
 
 public:
 
-	Program(const std::vector<Shader>& iShaders);
+	/**
+	 * @param iAsync : Compile in the background through the ShaderCompiler, the program can't be used
+	 * before IsReady returns true. Cached binaries are always loaded right away.
+	*/
+	Program(const std::vector<Shader>& iShaders, bool iAsync = false);
+
+	/**
+	 * @brief : Delete the GL program, waits for a worker still linking it
+	*/
+	~Program();
+
+	Program(Program& iOther) = delete;
+	void operator=(const Program&) = delete;
+
+	/**
+	 * @brief : Poll a background compilation without blocking, finishes the program once it is done.
+	 * Needs the GL context.
+	 * @return true when the program can be used
+	*/
+	bool IsReady();
+
+	/**
+	 * @brief : Block until the background compilation is done
+	*/
+	void WaitReady();
+
 	void Bind();
 	void Unbind();
 	void SetUniform1i(const std::string& iName, int iValue);
+	void SetUniform1ui(const std::string& iName, uint32_t iValue);
 	void SetUniform1f(const std::string& iName, float iValue);
+	void SetUniform2f(const std::string& iName, glm::vec2 iValue);
+	void SetUniform3ui(const std::string& iName, glm::uvec3 iValue);
 	void SetUniform3f(const std::string& iName, glm::vec3 iValue);
 	void SetUniform4f(const std::string& iName, glm::vec4 iValue);
 	void SetUniform4f(const std::string& iName, float iX, float iY, float iZ, float iW);
 	void SetUniformMatrix3f(const std::string& iName, const glm::mat3& iMatrix);
 	void SetUniformMatrix4f(const std::string& iName, const glm::mat4& iMatrix);
 
+	/**
+	 * @brief : Look up the location of an active uniform, reflected at link time.
+	 * Doesn't touch the GL context, so it's safe to call from any thread.
+	 * @return the location or -1 if the uniform isn't active
+	*/
+	GLint FindUniformLocation(const std::string& iName) const;
+
+	GLuint GetHandle() const { return mProgramHandle; }
+
 private:
+	enum class EBuildState
+	{
+		eReady,
+		eParallelLink,		// Polled through GL_COMPLETION_STATUS_KHR
+		eWorkerLink			// Linked by the shared context worker
+	};
+
+	/**
+	 * @brief : Start compiling the stages and link them without querying any status, used when the program cache has no binary
+	*/
+	static void SubmitLink(GLuint iProgram, std::vector<Shader>& ioShaders);
+
+	/**
+	 * @brief : Check the link, store the binary in the cache and reflect the uniforms
+	*/
+	void Finalize();
+	void ReflectUniforms();
+
 	GLuint GetUniformLocation(const std::string& iName);
 	GLuint mProgramHandle;
 
+	EBuildState mBuildState = EBuildState::eReady;
+	std::vector<Shader> mPendingShaders;
+	std::shared_ptr<std::atomic<bool>> mWorkerDone;
+	uint64_t mCacheKey = 0;
+	bool mFromCache = false;
+	std::chrono::high_resolution_clock::time_point mBuildStart;
+
 	std::unordered_map<std::string, GLuint> mUniformsMap;
 };
\ No newline at end of file
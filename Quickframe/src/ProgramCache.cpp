@@ -0,0 +1,292 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <fstream>
+#include <spdlog/spdlog.h>
+
+#include "ProgramCache.h"
+#include "Shader.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+	constexpr uint32_t kFileMagic = 0x43504651;		// "QFPC"
+	constexpr uint32_t kFileVersion = 1;
+
+	struct EntryHeader
+	{
+		uint64_t Key;
+		uint64_t DriverHash;
+		uint32_t Format;
+		uint32_t Size;
+	};
+
+	/**
+	 * @brief : Directory of the running executable with a trailing separator, empty if it can't be queried
+	*/
+	std::string GetExecutableDirectory()
+	{
+		char wPath[4096];
+#ifdef _WIN32
+		const DWORD wLength = GetModuleFileNameA(NULL, wPath, sizeof(wPath));
+		const size_t wSize = wLength < sizeof(wPath) ? static_cast<size_t>(wLength) : 0;
+#else
+		const ssize_t wLength = readlink("/proc/self/exe", wPath, sizeof(wPath) - 1);
+		const size_t wSize = wLength > 0 ? static_cast<size_t>(wLength) : 0;
+#endif
+		const std::string wExecutable(wPath, wSize);
+		const size_t wSeparator = wExecutable.find_last_of("/\\");
+		return wSeparator == std::string::npos ? std::string() : wExecutable.substr(0, wSeparator + 1);
+	}
+}
+
+ProgramCache* ProgramCache::mProgramCache = nullptr;
+
+ProgramCache* ProgramCache::GetInstance()
+{
+	if (!mProgramCache)
+	{
+		mProgramCache = new ProgramCache();
+	}
+
+	return mProgramCache;
+}
+
+ProgramCache::ProgramCache()
+	:mCachePath(GetExecutableDirectory() + kCacheFilename)
+{
+	GLint wFormatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &wFormatCount);
+	mEnabled = wFormatCount > 0;
+	if (!mEnabled)
+	{
+		spdlog::info("Program binaries are not supported by the driver, the program cache is disabled");
+		return;
+	}
+
+	// Binaries are only valid for the exact driver that produced them
+	for (GLenum wName : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+	{
+		const char* wString = reinterpret_cast<const char*>(glGetString(wName));
+		if (wString)
+		{
+			mDriverHash = HashBytes(wString, std::char_traits<char>::length(wString), mDriverHash ? mDriverHash : 14695981039346656037ull);
+		}
+	}
+
+	ReadFile();
+}
+
+uint64_t ProgramCache::HashBytes(const void* iData, size_t iSize, uint64_t iSeed)
+{
+	// FNV-1a, stable across runs and builds unlike std::hash
+	const unsigned char* wBytes = static_cast<const unsigned char*>(iData);
+	uint64_t wHash = iSeed;
+	for (size_t i = 0; i < iSize; i++)
+	{
+		wHash ^= wBytes[i];
+		wHash *= 1099511628211ull;
+	}
+	return wHash;
+}
+
+uint64_t ProgramCache::ComputeKey(const std::vector<Shader>& iShaders)
+{
+	uint64_t wKey = mDriverHash;
+	for (const Shader& wShader : iShaders)
+	{
+		const uint32_t wStage = static_cast<uint32_t>(wShader.GetStage());
+		wKey = HashBytes(&wStage, sizeof(wStage), wKey);
+		wKey = HashBytes(wShader.GetSource().data(), wShader.GetSource().size(), wKey);
+	}
+	return wKey;
+}
+
+bool ProgramCache::Load(uint64_t iKey, GLuint iProgram)
+{
+	if (!mEnabled)
+	{
+		return false;
+	}
+
+	auto wIt = mEntries.find(iKey);
+	if (wIt == mEntries.end())
+	{
+		return false;
+	}
+
+	glProgramBinary(iProgram, wIt->second.Format, wIt->second.Binary.data(), static_cast<GLsizei>(wIt->second.Binary.size()));
+
+	GLint wSuccess = 0;
+	glGetProgramiv(iProgram, GL_LINK_STATUS, &wSuccess);
+	if (!wSuccess)
+	{
+		// Rejected by the driver, drop it so it is rebuilt from sources
+		spdlog::info("Program binary {0:x} rejected by the driver, recompiling", iKey);
+		mEntries.erase(wIt);
+		RewriteFile();
+		return false;
+	}
+	return true;
+}
+
+void ProgramCache::Store(uint64_t iKey, GLuint iProgram)
+{
+	if (!mEnabled)
+	{
+		return;
+	}
+
+	GLint wLength = 0;
+	glGetProgramiv(iProgram, GL_PROGRAM_BINARY_LENGTH, &wLength);
+	if (wLength <= 0)
+	{
+		return;
+	}
+
+	Entry wEntry;
+	wEntry.Binary.resize(wLength);
+	glGetProgramBinary(iProgram, wLength, nullptr, &wEntry.Format, wEntry.Binary.data());
+
+	AppendEntry(iKey, wEntry);
+	mEntries[iKey] = std::move(wEntry);
+}
+
+void ProgramCache::RecordProgram(bool iFromCache, double iMilliseconds)
+{
+	if (iFromCache)
+	{
+		++mLoadedCount;
+		mLoadedMs += iMilliseconds;
+	}
+	else
+	{
+		++mCompiledCount;
+		mCompiledMs += iMilliseconds;
+	}
+}
+
+void ProgramCache::LogStats(const std::string& iLabel) const
+{
+	spdlog::info("{0:s} : {1:d} programs loaded from the cache in {2:.1f} ms, {3:d} compiled in {4:.1f} ms ({5:s} start)",
+		iLabel, mLoadedCount, mLoadedMs, mCompiledCount, mCompiledMs, mCompiledCount == 0 ? "warm" : "cold");
+}
+
+void ProgramCache::ReadFile()
+{
+	std::ifstream wFile(mCachePath, std::ios::binary);
+	if (!wFile)
+	{
+		return;
+	}
+
+	uint32_t wMagic = 0;
+	uint32_t wVersion = 0;
+	wFile.read(reinterpret_cast<char*>(&wMagic), sizeof(wMagic));
+	wFile.read(reinterpret_cast<char*>(&wVersion), sizeof(wVersion));
+	if (!wFile || wMagic != kFileMagic || wVersion != kFileVersion)
+	{
+		spdlog::info("{0:s} has an unknown format, it will be rebuilt", mCachePath);
+		wFile.close();
+		RewriteFile();
+		return;
+	}
+
+	bool wStale = false;
+	EntryHeader wHeader;
+	while (wFile.read(reinterpret_cast<char*>(&wHeader), sizeof(wHeader)))
+	{
+		Entry wEntry;
+		wEntry.Format = wHeader.Format;
+		wEntry.Binary.resize(wHeader.Size);
+		if (!wFile.read(wEntry.Binary.data(), wHeader.Size))
+		{
+			// Truncated by an interrupted write
+			wStale = true;
+			break;
+		}
+
+		if (wHeader.DriverHash != mDriverHash)
+		{
+			wStale = true;
+			continue;
+		}
+
+		// Later entries of the same key replace the earlier ones
+		wStale |= mEntries.count(wHeader.Key) > 0;
+		mEntries[wHeader.Key] = std::move(wEntry);
+	}
+	wFile.close();
+
+	if (wStale)
+	{
+		RewriteFile();
+	}
+}
+
+void ProgramCache::RewriteFile()
+{
+	std::ofstream wFile(mCachePath, std::ios::binary | std::ios::trunc);
+	if (!wFile)
+	{
+		spdlog::critical("Can't write the program cache {0:s} !", mCachePath);
+		return;
+	}
+
+	wFile.write(reinterpret_cast<const char*>(&kFileMagic), sizeof(kFileMagic));
+	wFile.write(reinterpret_cast<const char*>(&kFileVersion), sizeof(kFileVersion));
+	wFile.close();
+
+	for (const auto& wEntry : mEntries)
+	{
+		AppendEntry(wEntry.first, wEntry.second);
+	}
+}
+
+void ProgramCache::AppendEntry(uint64_t iKey, const Entry& iEntry)
+{
+	std::ofstream wFile(mCachePath, std::ios::binary | std::ios::app);
+	if (!wFile)
+	{
+		spdlog::critical("Can't write the program cache {0:s} !", mCachePath);
+		return;
+	}
+
+	if (wFile.tellp() == 0)
+	{
+		wFile.write(reinterpret_cast<const char*>(&kFileMagic), sizeof(kFileMagic));
+		wFile.write(reinterpret_cast<const char*>(&kFileVersion), sizeof(kFileVersion));
+	}
+
+	EntryHeader wHeader{ iKey, mDriverHash, iEntry.Format, static_cast<uint32_t>(iEntry.Binary.size()) };
+	wFile.write(reinterpret_cast<const char*>(&wHeader), sizeof(wHeader));
+	wFile.write(iEntry.Binary.data(), iEntry.Binary.size());
+}
@@ -0,0 +1,103 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Shader;
+
+/**
+ * @brief : On disk cache of linked program binaries (glGetProgramBinary), skips the GLSL
+ * compilation and link on warm starts.
+ * Entries are keyed by a hash of the stage sources (defines included) and of the driver
+ * vendor, renderer and version, a driver update simply misses the cache.
+ * All the entries live in a single append only file, rewritten when stale entries are dropped.
+*/
+class ProgramCache
+{
+	struct Entry
+	{
+		GLenum Format = 0;
+		std::vector<char> Binary;
+	};
+
+public:
+	ProgramCache(ProgramCache& iOther) = delete;
+	void operator=(const ProgramCache&) = delete;
+
+	static ProgramCache* GetInstance();
+
+	uint64_t ComputeKey(const std::vector<Shader>& iShaders);
+
+	/**
+	 * @brief : Load the cached binary of a key into iProgram
+	 * @return false if there is no entry or the driver rejected it, the program must then be linked from sources
+	*/
+	bool Load(uint64_t iKey, GLuint iProgram);
+
+	/**
+	 * @brief : Save the binary of a linked program, it must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+	*/
+	void Store(uint64_t iKey, GLuint iProgram);
+
+	/**
+	 * @brief : Time spent creating programs, split between cache hits and compilations
+	*/
+	void RecordProgram(bool iFromCache, double iMilliseconds);
+	void LogStats(const std::string& iLabel) const;
+
+	bool IsEnabled() const { return mEnabled; }
+
+	/**
+	 * @brief : The cache file sits next to the executable, whatever the working directory
+	*/
+	static constexpr const char* kCacheFilename = "ProgramCache.bin";
+	const std::string& GetCachePath() const { return mCachePath; }
+
+private:
+	ProgramCache();
+
+	static uint64_t HashBytes(const void* iData, size_t iSize, uint64_t iSeed = 14695981039346656037ull);
+
+	void ReadFile();
+	void RewriteFile();
+	void AppendEntry(uint64_t iKey, const Entry& iEntry);
+
+	static ProgramCache* mProgramCache;
+
+	std::unordered_map<uint64_t, Entry> mEntries;
+	std::string mCachePath;
+	uint64_t mDriverHash = 0;
+	bool mEnabled = false;
+
+	uint32_t mLoadedCount = 0;
+	uint32_t mCompiledCount = 0;
+	double mLoadedMs = 0.0;
+	double mCompiledMs = 0.0;
+};
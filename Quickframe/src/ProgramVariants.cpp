@@ -0,0 +1,85 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <spdlog/spdlog.h>
+
+#include "ProgramVariants.h"
+
+ProgramVariants::ProgramVariants(const std::vector<Stage>& iStages, const std::vector<std::string>& iFeatures)
+	:mStages(iStages),
+	mFeatures(iFeatures)
+{
+	if (mFeatures.size() > kMaxFeatures)
+	{
+		spdlog::critical("Too many program features : {0:d}, at most {1:d} are supported", mFeatures.size(), kMaxFeatures);
+		mFeatures.resize(kMaxFeatures);
+	}
+}
+
+Program* ProgramVariants::Get(uint32_t iKey)
+{
+	Program* wProgram = Create(iKey, false);
+	wProgram->WaitReady();
+	return wProgram;
+}
+
+Program* ProgramVariants::Request(uint32_t iKey)
+{
+	Program* wProgram = Create(iKey, true);
+	return wProgram->IsReady() ? wProgram : nullptr;
+}
+
+Program* ProgramVariants::Create(uint32_t iKey, bool iAsync)
+{
+	auto wIt = mVariants.find(iKey);
+	if (wIt != mVariants.end())
+	{
+		return wIt->second.get();
+	}
+
+	std::vector<std::string> wDefines;
+	std::string wDefinesStr;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(mFeatures.size()); i++)
+	{
+		if (iKey & (1u << i))
+		{
+			wDefines.push_back(mFeatures[i]);
+			wDefinesStr += " " + mFeatures[i];
+		}
+	}
+
+	std::vector<Shader> wShaders;
+	for (const Stage& wStage : mStages)
+	{
+		wShaders.emplace_back(wStage.Path, wStage.ShaderStage, wDefines);
+	}
+
+	std::unique_ptr<Program> wProgram = std::make_unique<Program>(wShaders, iAsync);
+	spdlog::info("Program {0:d} is variant {1:d} of {2:s} :{3:s}", wProgram->GetHandle(), iKey,
+		mStages.back().Path, wDefinesStr.empty() ? " no feature" : wDefinesStr);
+
+	Program* wResult = wProgram.get();
+	mVariants[iKey] = std::move(wProgram);
+	return wResult;
+}
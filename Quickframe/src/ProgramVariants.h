@@ -0,0 +1,71 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Program.h"
+
+/**
+ * @brief : Permutations of a program over a list of feature defines.
+ * Bit i of a key injects #define of the i-th feature in every stage, so the compiler
+ * strips the disabled paths instead of branching on uniforms at runtime.
+ * Variants are compiled on first request and cached by key, either right away or in the background
+ * so a pass can keep drawing with a fallback variant meanwhile.
+*/
+class ProgramVariants
+{
+public:
+	struct Stage
+	{
+		std::string Path;
+		Shader::EShaderStage ShaderStage;
+	};
+
+	static constexpr uint32_t kMaxFeatures = 5;		// Keys stay below 32, usable as bit indices of a mask
+
+	ProgramVariants(const std::vector<Stage>& iStages, const std::vector<std::string>& iFeatures);
+
+	/**
+	 * @brief : Variant of a key, compiled if it doesn't exist yet and waited for. Needs the GL context.
+	*/
+	Program* Get(uint32_t iKey);
+
+	/**
+	 * @brief : Start compiling the variant of a key in the background if it doesn't exist yet. Needs the GL context.
+	 * @return the variant once it is ready to be used, nullptr while it is compiling
+	*/
+	Program* Request(uint32_t iKey);
+
+private:
+	Program* Create(uint32_t iKey, bool iAsync);
+
+	std::vector<Stage> mStages;
+	std::vector<std::string> mFeatures;
+	std::unordered_map<uint32_t, std::unique_ptr<Program>> mVariants;
+};
@@ -40,33 +40,81 @@ SOFTWARE.
 #include "Scene.h"
 #include "TextureManager.h"
 #include "Defines.h"
+#include "GLStateCache.h"
+#include "VirtualTextureCache.h"
+#include "MaterialTable.h"
+#include "MeshStreamer.h"
 
 Renderer::Renderer()
 {
-	glEnable(GL_CULL_FACE);
-	glFrontFace(GL_CCW);
-	glCullFace(GL_BACK);
-	glEnable(GL_DEPTH_TEST);
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	wStateCache->Reset();
+	wStateCache->SetCullFace(true);
+	wStateCache->SetFrontFace(GL_CCW);
+	wStateCache->SetCullFaceMode(GL_BACK);
+	wStateCache->SetDepthTest(true);
 }
 
 void Renderer::Render(Scene* iScene)
 {
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	wStateCache->BeginFrame();
+
+	// Streamed meshes, textures and tiles swap in before any draw is recorded, the meshes first
+	// so the materials they create queue their textures this frame
+	MeshStreamer::GetInstance()->Update(iScene->GetCamera());
+	TextureManager::GetInstance()->Update();
+	VirtualTextureCache::GetInstance()->Update();
+	MaterialTable::GetInstance()->Update();
+
+	// Clears are affected by the bound framebuffer and the depth write mask
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, 0);
+	wStateCache->SetDepthMask(true);
 	glClearColor(0.3f, 0.3f, 0.7f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	
+
 	mShadowPass->Execute(iScene);
-	mUnlitPass->Execute(iScene);
-	mLightPass->Execute(iScene);
+	mPointShadowPass->Execute(iScene);
+	mSpotShadowPass->Execute(iScene);
+
+	if (mRenderPath == ERenderPath::eDeferred)
+	{
+		// Lighting ends with a blit of color and depth, unlit geometry and sky go on top
+		mGBufferPass->Execute(iScene);
+		mDeferredLightingPass->Execute(iScene);
+		mUnlitPass->Execute(iScene);
+	}
+	else
+	{
+		mLightCullingPass->Execute(iScene);
+		mDepthPrepass->Execute(iScene);
+		mUnlitPass->Execute(iScene);
+		mLightPass->Execute(iScene);
+	}
+
 	mSkyboxPass->Execute(iScene);
+
+	// Page requests of the virtual shadow map come from the depth of the finished frame
+	mShadowPass->CaptureSceneDepth(iScene);
+
+	// Tile requests of the virtual textures, read back a few frames later
+	mVirtualTextureFeedbackPass->Execute(iScene);
 }
 
 void Renderer::Initialize()
 {
 	mShadowPass = std::make_unique<ShadowPass>();
+	mPointShadowPass = std::make_unique<PointShadowPass>();
+	mSpotShadowPass = std::make_unique<SpotShadowPass>();
+	mDepthPrepass = std::make_unique<DepthPrepass>();
 	mUnlitPass = std::make_unique<UnlitPass>();
-	mLightPass = std::make_unique<LightPass>(mShadowPass.get());
+	mLightCullingPass = std::make_unique<LightCullingPass>(mPointShadowPass.get(), mSpotShadowPass.get());
+	mLightPass = std::make_unique<LightPass>(mShadowPass.get(), mLightCullingPass.get());
 	mSkyboxPass = std::make_unique<SkyboxPass>();
-	
+	mGBufferPass = std::make_unique<GBufferPass>();
+	mDeferredLightingPass = std::make_unique<DeferredLightingPass>(mGBufferPass.get(), mShadowPass.get(), mPointShadowPass.get(),
+		mSpotShadowPass.get());
+	mVirtualTextureFeedbackPass = std::make_unique<VirtualTextureFeedbackPass>();
 
 	TextureManager::GetInstance()->GetDefaultDiffuseTex();
 }
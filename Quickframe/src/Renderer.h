@@ -30,7 +30,14 @@ SOFTWARE.
 #include "LightPass.h"
 #include "UnlitPass.h"
 #include "ShadowPass.h"
+#include "PointShadowPass.h"
+#include "SpotShadowPass.h"
 #include "SkyboxPass.h"
+#include "DepthPrepass.h"
+#include "LightCullingPass.h"
+#include "GBufferPass.h"
+#include "DeferredLightingPass.h"
+#include "VirtualTextureFeedbackPass.h"
 
 class Mesh;
 class Camera;
@@ -41,14 +48,56 @@ class Scene;
 class Renderer
 {
 public:
+	enum class ERenderPath
+	{
+		eForward,		// Clustered forward, LightPass
+		eDeferred		// G-buffer and screen space lighting
+	};
+
 	Renderer();
 	void Render(Scene* iScene);
 	
 	void Initialize();
 
+	/**
+	 * @brief : Shaded samples per pixel of the lit pass, compare with and without the depth prepass
+	*/
+	float GetLightPassOverdraw() const { return mLightPass->GetOverdraw(); }
+
+	/**
+	 * @brief : Switch between forward and deferred shading, takes effect on the next frame
+	*/
+	void SetRenderPath(ERenderPath iRenderPath) { mRenderPath = iRenderPath; }
+	ERenderPath GetRenderPath() const { return mRenderPath; }
+
+	void SetShadowFilter(ShadowPass::EShadowFilter iFilterMode) { mShadowPass->SetFilterMode(iFilterMode); }
+	ShadowPass::EShadowFilter GetShadowFilter() const { return mShadowPass->GetFilterMode(); }
+
+	void SetVirtualShadowsEnabled(bool iEnabled) { mShadowPass->SetVirtualShadowsEnabled(iEnabled); }
+	bool AreVirtualShadowsEnabled() const { return mShadowPass->AreVirtualShadowsEnabled(); }
+
+	/**
+	 * @brief : Lay down depth before the forward lit pass, pays off when the scene has a lot of overdraw
+	*/
+	void SetDepthPrepassEnabled(bool iEnabled)
+	{
+		mDepthPrepass->SetEnabled(iEnabled);
+		mLightPass->SetDepthPrepassEnabled(iEnabled);
+	}
+	bool IsDepthPrepassEnabled() const { return mDepthPrepass->IsEnabled(); }
+
 private:
 	std::unique_ptr<ShadowPass> mShadowPass;
+	std::unique_ptr<PointShadowPass> mPointShadowPass;
+	std::unique_ptr<SpotShadowPass> mSpotShadowPass;
+	std::unique_ptr<DepthPrepass> mDepthPrepass;
+	std::unique_ptr<LightCullingPass> mLightCullingPass;
 	std::unique_ptr<LightPass> mLightPass;
 	std::unique_ptr<UnlitPass> mUnlitPass;
 	std::unique_ptr<SkyboxPass> mSkyboxPass;
+	std::unique_ptr<GBufferPass> mGBufferPass;
+	std::unique_ptr<DeferredLightingPass> mDeferredLightingPass;
+	std::unique_ptr<VirtualTextureFeedbackPass> mVirtualTextureFeedbackPass;
+
+	ERenderPath mRenderPath = ERenderPath::eForward;
 };
\ No newline at end of file
@@ -22,12 +22,18 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <spdlog/spdlog.h>
+
 #include "SceneManager.h"
 #include "Entity.h"
 #include "Light.h"
 #include "Engine.h"
 #include "Plane.h"
 #include "Sphere.h"
+#include "VirtualTextureCache.h"
+#include "ThreadPool.h"
+
+using namespace std::chrono;
 
 SceneManager::SceneManager()
 {
@@ -47,8 +53,14 @@ void SceneManager::LoadDefaultScene()
 	mActiveScene = wScene;
 	LoadDefaultCamera();
 	LoadDefaultLight();
+
+	// Color maps are streamed by tiles, decided before the materials are loaded
+	VirtualTextureCache::GetInstance()->SetEnabled(true);
+
+	// Mesh imports run on the workers while the skybox faces decode, uploads are batched at the end
 	LoadDefaultEntity();
 	LoadDefaultSkybox();
+	FinishMeshLoads();
 }
 
 void SceneManager::LoadDefaultLight()
@@ -90,25 +102,28 @@ void SceneManager::LoadDefaultCamera()
 
 void SceneManager::LoadDefaultEntity()
 {
-	std::shared_ptr<Plane> wPlane = std::make_shared<Plane>();
-	wPlane->LoadMesh("resources/plane/Plane.obj");
+	std::shared_ptr<Plane> wPlane = std::make_shared<Plane>(false);
+	QueueMeshLoad(wPlane.get(), "resources/plane/Plane.obj");
 	wPlane->SetWidth(30.f);
 	wPlane->SetHeight(30.f);
+	wPlane->SetStatic(true);
 	mSceneMap["Default"]->AddEntity(wPlane);
 
 	std::shared_ptr<Entity> wTree = std::make_shared<Entity>("Tree");
 
-	wTree->LoadMesh("resources/meshes/Lowpoly_tree.obj");
+	QueueMeshLoad(wTree.get(), "resources/meshes/Lowpoly_tree.obj");
 	wTree->SetPos(glm::vec3(8.f, 0.f, 16.f));
 	wTree->GetTransform()->SetScale(glm::vec3(0.5));
+	wTree->SetStatic(true);
 
 	mSceneMap["Default"]->AddEntity(wTree);
 
 	std::shared_ptr<Entity> wCottage = std::make_shared<Entity>("Cottage");
 
-	wCottage->LoadMesh("resources/meshes/cottage/cottage.obj");
+	QueueMeshLoad(wCottage.get(), "resources/meshes/cottage/cottage.obj");
 	wCottage->SetPos(glm::vec3(-8.f, 0.f, 0.f));
 	wCottage->GetTransform()->SetScale(glm::vec3(0.5));
+	wCottage->SetStatic(true);
 
 	mSceneMap["Default"]->AddEntity(wCottage);
 }
@@ -131,3 +146,68 @@ void SceneManager::LoadDefaultSkybox()
 
 	mSceneMap["Default"]->SetSkybox(wSkybox);
 }
+
+void SceneManager::QueueMeshLoad(Entity* iEntity, const std::string& iPath)
+{
+	if (mPendingMeshes.empty())
+	{
+		mMeshLoadStart = high_resolution_clock::now();
+	}
+
+	for (PendingMesh& wPending : mPendingMeshes)
+	{
+		if (wPending.Path == iPath)
+		{
+			wPending.Targets.push_back(iEntity);
+			return;
+		}
+	}
+
+	PendingMesh wPending;
+	wPending.Path = iPath;
+	wPending.Targets.push_back(iEntity);
+	wPending.Data = std::make_unique<MeshData>();
+
+	// The data is owned by the pending entry, its address doesn't move with the vector
+	MeshData* wData = wPending.Data.get();
+	wPending.Result = ThreadPool::GetInstance()->Submit([iPath, wData]() { return Mesh::LoadData(iPath, *wData); });
+	mPendingMeshes.push_back(std::move(wPending));
+}
+
+void SceneManager::FinishMeshLoads()
+{
+	if (mPendingMeshes.empty())
+	{
+		return;
+	}
+
+	ThreadPool* wThreadPool = ThreadPool::GetInstance();
+	for (PendingMesh& wPending : mPendingMeshes)
+	{
+		wThreadPool->Wait(wPending.Result);
+	}
+	auto wImportStop = high_resolution_clock::now();
+
+	uint32_t wLoadedCount = 0;
+	for (PendingMesh& wPending : mPendingMeshes)
+	{
+		if (!wPending.Result.get())
+		{
+			continue;
+		}
+
+		for (Entity* wEntity : wPending.Targets)
+		{
+			wEntity->LoadMesh(wPending.Path, *wPending.Data);
+		}
+		++wLoadedCount;
+	}
+
+	auto wUploadStop = high_resolution_clock::now();
+	spdlog::info("{0:d}/{1:d} meshes imported on {2:d} threads in {3:d} ms, uploaded in {4:d} ms",
+		wLoadedCount, mPendingMeshes.size(), wThreadPool->GetMaxChunkCount(),
+		duration_cast<milliseconds>(wImportStop - mMeshLoadStart).count(),
+		duration_cast<milliseconds>(wUploadStop - wImportStop).count());
+
+	mPendingMeshes.clear();
+}
@@ -24,7 +24,14 @@ SOFTWARE.
 
 #pragma once
 
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "Scene.h"
+#include "MeshData.h"
 
 class SceneManager
 {
@@ -41,9 +48,30 @@ private:
 	void LoadDefaultEntity();
 	void LoadDefaultSkybox();
 
+	/**
+	 * @brief : Start the CPU phase of a mesh load on the thread pool, entities sharing a path share the import
+	*/
+	void QueueMeshLoad(Entity* iEntity, const std::string& iPath);
+
+	/**
+	 * @brief : Wait for the queued imports, helping the workers, then upload them in queue order
+	*/
+	void FinishMeshLoads();
+
+	struct PendingMesh
+	{
+		std::string Path;
+		std::vector<Entity*> Targets;
+		std::unique_ptr<MeshData> Data;
+		std::future<bool> Result;
+	};
+
 	std::unordered_map<std::string, std::shared_ptr<Scene>> mSceneMap;
 	std::shared_ptr<Scene> mActiveScene = nullptr;
 
+	std::vector<PendingMesh> mPendingMeshes;
+	std::chrono::high_resolution_clock::time_point mMeshLoadStart;
+
 	static constexpr uint32_t sMaxPointLightCount = 4;
 	static constexpr uint32_t sMaxSpotLightCount = 4;
 };
\ No newline at end of file
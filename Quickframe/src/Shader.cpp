@@ -25,20 +25,15 @@ SOFTWARE.
 #include <spdlog/spdlog.h>
 #include <fstream>
 #include <sstream>
-#include <chrono>
+#include <algorithm>
 
 #include "Shader.h"
 
-using namespace std::chrono;
-
-Shader::Shader(const std::string& iPath, EShaderStage iShaderStage)
+Shader::Shader(const std::string& iPath, EShaderStage iShaderStage, const std::vector<std::string>& iDefines)
 	:mShaderStage(iShaderStage)
 {
-	auto wClockStart = high_resolution_clock::now();
-
 	mFilename = iPath.substr(iPath.find_last_of("/\\") + 1);
 
-	std::string wShaderCode;
 	std::ifstream wShaderFile;
 
 	// ensure ifstream objects can throw exceptions:
@@ -53,25 +48,46 @@ Shader::Shader(const std::string& iPath, EShaderStage iShaderStage)
 		// close file handlers
 		wShaderFile.close();
 		// convert stream into string
-		wShaderCode = vShaderStream.str();
+		mSource = vShaderStream.str();
 	}
 	catch (std::ifstream::failure e)
 	{
 		spdlog::critical("Shader file {0:s} not Successfully Read !", iPath);
 	}
 
-	const char* wShaderCodeStr = wShaderCode.c_str();
-	
-	int success;
-	char infoLog[512];
+	if (!iDefines.empty())
+	{
+		InjectDefines(mSource, iDefines);
+	}
+}
+
+void Shader::SubmitCompile()
+{
+	if (mShaderHandle != static_cast<GLuint>(-1))
+	{
+		return;
+	}
+
+	const char* wShaderCodeStr = mSource.c_str();
 	GLuint wShaderStage;
 	std::string wShaderStageStr;
 
-	GetShaderType(iShaderStage, wShaderStage, wShaderStageStr);
+	GetShaderType(mShaderStage, wShaderStage, wShaderStageStr);
 
 	mShaderHandle = glCreateShader(wShaderStage);
 	glShaderSource(mShaderHandle, 1, &wShaderCodeStr, NULL);
 	glCompileShader(mShaderHandle);
+}
+
+bool Shader::CheckCompileStatus()
+{
+	int success;
+	char infoLog[512];
+	GLuint wShaderStage;
+	std::string wShaderStageStr;
+
+	GetShaderType(mShaderStage, wShaderStage, wShaderStageStr);
+
 	// print compile errors if any
 	glGetShaderiv(mShaderHandle, GL_COMPILE_STATUS, &success);
 	if (!success)
@@ -80,10 +96,34 @@ Shader::Shader(const std::string& iPath, EShaderStage iShaderStage)
 		spdlog::critical("Failed to compile {0:s}. ({1:s} shader)\n{2:s}", mFilename, wShaderStageStr, infoLog);
 	};
 
-	auto wClockStop = high_resolution_clock::now();
-	auto wDuration = duration_cast<milliseconds>(wClockStop - wClockStart);
-	
-	spdlog::info("{0:s} shader parsed and compiled in {1:d} ms !", mFilename, wDuration.count());
+	return success != 0;
+}
+
+void Shader::InjectDefines(std::string& ioCode, const std::vector<std::string>& iDefines)
+{
+	// #version must stay the first directive of the source
+	size_t wInsertPos = 0;
+	uint32_t wNextLine = 1;
+	size_t wVersionPos = ioCode.find("#version");
+	if (wVersionPos != std::string::npos)
+	{
+		size_t wLineEnd = ioCode.find('\n', wVersionPos);
+		wInsertPos = wLineEnd == std::string::npos ? ioCode.size() : wLineEnd + 1;
+		wNextLine = static_cast<uint32_t>(std::count(ioCode.begin(), ioCode.begin() + wInsertPos, '\n')) + 1;
+	}
+
+	std::string wDefines;
+	for (const std::string& wDefine : iDefines)
+	{
+		wDefines += "#define " + wDefine + "\n";
+	}
+	wDefines += "#line " + std::to_string(wNextLine) + "\n";
+
+	if (wInsertPos == ioCode.size() && !ioCode.empty() && ioCode.back() != '\n')
+	{
+		wDefines.insert(wDefines.begin(), '\n');
+	}
+	ioCode.insert(wInsertPos, wDefines);
 }
 
 void Shader::GetShaderType(EShaderStage iShaderStage, GLuint& oOpenglStage, std::string& oStageString)
@@ -102,6 +142,10 @@ void Shader::GetShaderType(EShaderStage iShaderStage, GLuint& oOpenglStage, std:
 		oOpenglStage = GL_GEOMETRY_SHADER;
 		oStageString = "Geometry";
 		break;
+	case EShaderStage::eCompute:
+		oOpenglStage = GL_COMPUTE_SHADER;
+		oStageString = "Compute";
+		break;
 	default:
 		oOpenglStage = 0;
 		oStageString = "Unspecified";
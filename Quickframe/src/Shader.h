@@ -26,6 +26,7 @@ SOFTWARE.
 
 #include <glad/glad.h>
 #include <string>
+#include <vector>
 
 class Shader
 {
@@ -36,17 +37,40 @@ public:
 		eVertex,
 		eGeometry,
 		eFragment,
+		eCompute,
 		eUnspecified
 	};
 
 	Shader(){}
-	Shader(const std::string& iFile, EShaderStage iShaderStage);
+	/**
+	 * @brief : Read the source, compilation is deferred to SubmitCompile so a cached program binary can skip it
+	 * @param iDefines : Injected as #define lines right after #version, to compile a permutation of the source
+	*/
+	Shader(const std::string& iFile, EShaderStage iShaderStage, const std::vector<std::string>& iDefines = {});
+
+	/**
+	 * @brief : Create the GL shader object and start its compilation, once.
+	 * Doesn't query the result so drivers compiling in the background aren't forced to finish.
+	*/
+	void SubmitCompile();
+
+	/**
+	 * @brief : Log the compilation errors, blocks until the compilation is done
+	 * @return false on compilation errors
+	*/
+	bool CheckCompileStatus();
 
 	const GLuint GetShaderHandle() const { return mShaderHandle; }
+	const std::string& GetSource() const { return mSource; }
 	const EShaderStage GetStage() const { return mShaderStage; }
 	const std::string& GetFilename() const { return mFilename; }
 
 private:
+	/**
+	 * @brief : Insert the defines after the #version line, a #line directive keeps the error line numbers of the file
+	*/
+	static void InjectDefines(std::string& ioCode, const std::vector<std::string>& iDefines);
+
 	/**
 	 * @brief : Get OpenGL internal shader stage handle from a EShaderStage enum
 	 * @param iShaderStage : EShaderStage as defined by Quickframe
@@ -56,6 +80,7 @@ private:
 	void GetShaderType(EShaderStage iShaderStage, GLuint& oOpenglStage, std::string& oStageString);
 
 	std::string mFilename = "Unspecified";
+	std::string mSource;
 	EShaderStage mShaderStage = EShaderStage::eUnspecified;
 	GLuint mShaderHandle = -1;
 };
\ No newline at end of file
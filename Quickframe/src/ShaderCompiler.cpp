@@ -0,0 +1,137 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <spdlog/spdlog.h>
+
+#include "ShaderCompiler.h"
+
+namespace
+{
+	typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSPROC)(GLuint iCount);
+}
+
+ShaderCompiler* ShaderCompiler::mShaderCompiler = nullptr;
+
+ShaderCompiler* ShaderCompiler::GetInstance()
+{
+	if (!mShaderCompiler)
+	{
+		mShaderCompiler = new ShaderCompiler();
+	}
+
+	return mShaderCompiler;
+}
+
+void ShaderCompiler::Initialize(GLFWwindow* iMainWindow)
+{
+	PFNGLMAXSHADERCOMPILERTHREADSPROC wMaxThreads = nullptr;
+	if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+	{
+		wMaxThreads = (PFNGLMAXSHADERCOMPILERTHREADSPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+	}
+	else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+	{
+		wMaxThreads = (PFNGLMAXSHADERCOMPILERTHREADSPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+	}
+
+	if (wMaxThreads)
+	{
+		// 0xFFFFFFFF lets the driver use as many threads as it sees fit
+		wMaxThreads(0xFFFFFFFF);
+		mMode = EMode::eParallelExtension;
+		spdlog::info("Shaders compile on driver threads (parallel shader compile)");
+		return;
+	}
+
+	// Created from the main thread, made current on the worker
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	mWorkerWindow = glfwCreateWindow(1, 1, "Quickframe shader compiler", NULL, iMainWindow);
+	glfwDefaultWindowHints();
+	if (!mWorkerWindow)
+	{
+		spdlog::critical("Can't create the shader compiler shared context, shaders compile on the main thread");
+		return;
+	}
+
+	mMode = EMode::eSharedContext;
+	mWorker = std::thread(&ShaderCompiler::WorkerLoop, this);
+	spdlog::info("Shaders compile on a shared context worker");
+}
+
+void ShaderCompiler::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> wLock(mMutex);
+		mStop = true;
+		mJobs.clear();
+	}
+	mCondition.notify_all();
+
+	if (mWorker.joinable())
+	{
+		mWorker.join();
+	}
+
+	if (mWorkerWindow)
+	{
+		glfwDestroyWindow(mWorkerWindow);
+		mWorkerWindow = nullptr;
+	}
+	mMode = EMode::eSynchronous;
+}
+
+void ShaderCompiler::Submit(std::function<void()> iJob)
+{
+	{
+		std::lock_guard<std::mutex> wLock(mMutex);
+		mJobs.push_back(std::move(iJob));
+	}
+	mCondition.notify_one();
+}
+
+void ShaderCompiler::WorkerLoop()
+{
+	glfwMakeContextCurrent(mWorkerWindow);
+
+	while (true)
+	{
+		std::function<void()> wJob;
+		{
+			std::unique_lock<std::mutex> wLock(mMutex);
+			mCondition.wait(wLock, [this]() { return mStop || !mJobs.empty(); });
+
+			if (mStop)
+			{
+				break;
+			}
+
+			wJob = std::move(mJobs.front());
+			mJobs.pop_front();
+		}
+
+		wJob();
+	}
+
+	glfwMakeContextCurrent(NULL);
+}
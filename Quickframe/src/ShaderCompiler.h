@@ -0,0 +1,98 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+// GL_KHR_parallel_shader_compile, not part of the generated loader
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+/**
+ * @brief : Singleton selecting how programs are compiled in the background.
+ * GL_KHR_parallel_shader_compile (or its ARB twin) lets the driver compile on its own threads,
+ * the completion is polled with GL_COMPLETION_STATUS_KHR. Otherwise a worker thread owns a hidden
+ * window whose context shares objects with the main one and compiles the submitted jobs there.
+*/
+class ShaderCompiler
+{
+public:
+	enum class EMode
+	{
+		eSynchronous,			// Not initialized or no shared context, everything compiles on the main thread
+		eParallelExtension,		// Driver side compilation threads
+		eSharedContext			// Worker thread with a shared context
+	};
+
+	ShaderCompiler(ShaderCompiler& iOther) = delete;
+	void operator=(const ShaderCompiler&) = delete;
+
+	static ShaderCompiler* GetInstance();
+
+	/**
+	 * @brief : Pick the compilation mode, must be called from the main thread with its context current
+	*/
+	void Initialize(GLFWwindow* iMainWindow);
+
+	/**
+	 * @brief : Join the worker and destroy its context, pending jobs are discarded
+	*/
+	void Shutdown();
+
+	EMode GetMode() const { return mMode; }
+
+	/**
+	 * @brief : Queue a job for the shared context worker, only valid in eSharedContext mode.
+	 * Objects created by the job must be finished (glFinish) before the main context uses them.
+	*/
+	void Submit(std::function<void()> iJob);
+
+private:
+	ShaderCompiler() {}
+
+	void WorkerLoop();
+
+	static ShaderCompiler* mShaderCompiler;
+
+	EMode mMode = EMode::eSynchronous;
+
+	GLFWwindow* mWorkerWindow = nullptr;
+	std::thread mWorker;
+	std::deque<std::function<void()>> mJobs;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	bool mStop = false;
+};
@@ -0,0 +1,146 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+
+#include "ShadowAtlas.h"
+
+ShadowAtlas::ShadowAtlas(uint32_t iSize, uint32_t iMinTileSize)
+	:mSize(iSize),
+	mMinTileSize(iMinTileSize)
+{
+	Node wRoot;
+	wRoot.Size = iSize;
+	mNodes.push_back(wRoot);
+}
+
+ShadowAtlas::Tile ShadowAtlas::Allocate(uint32_t iSize)
+{
+	uint32_t wSize = mMinTileSize;
+	while (wSize < iSize && wSize < mSize)
+	{
+		wSize <<= 1;
+	}
+
+	Tile wTile;
+	int32_t wNode = FindFreeNode(0, wSize);
+	if (wNode < 0)
+	{
+		return wTile;
+	}
+
+	mNodes[wNode].Used = true;
+	wTile.X = mNodes[wNode].X;
+	wTile.Y = mNodes[wNode].Y;
+	wTile.Size = mNodes[wNode].Size;
+	wTile.Node = wNode;
+	return wTile;
+}
+
+void ShadowAtlas::Free(Tile& ioTile)
+{
+	if (!ioTile.IsValid())
+	{
+		return;
+	}
+
+	int32_t wNode = ioTile.Node;
+	mNodes[wNode].Used = false;
+	ioTile = Tile();
+
+	// Collapse the parents whose 4 children are free leaves
+	int32_t wParent = mNodes[wNode].Parent;
+	while (wParent >= 0)
+	{
+		int32_t wFirst = mNodes[wParent].FirstChild;
+		for (int32_t i = 0; i < 4; i++)
+		{
+			const Node& wChild = mNodes[wFirst + i];
+			if (wChild.Used || wChild.FirstChild >= 0)
+			{
+				return;
+			}
+		}
+
+		mFreeChildBlocks.push_back(wFirst);
+		mNodes[wParent].FirstChild = -1;
+		wParent = mNodes[wParent].Parent;
+	}
+}
+
+int32_t ShadowAtlas::FindFreeNode(int32_t iNode, uint32_t iSize)
+{
+	if (mNodes[iNode].Used || mNodes[iNode].Size < iSize)
+	{
+		return -1;
+	}
+
+	if (mNodes[iNode].FirstChild < 0)
+	{
+		if (mNodes[iNode].Size == iSize)
+		{
+			return iNode;
+		}
+		Split(iNode);
+	}
+
+	// Children are filled in order, keeping the big free nodes together
+	for (int32_t i = 0; i < 4; i++)
+	{
+		int32_t wFound = FindFreeNode(mNodes[iNode].FirstChild + i, iSize);
+		if (wFound >= 0)
+		{
+			return wFound;
+		}
+	}
+	return -1;
+}
+
+void ShadowAtlas::Split(int32_t iNode)
+{
+	int32_t wFirst;
+	if (!mFreeChildBlocks.empty())
+	{
+		wFirst = mFreeChildBlocks.back();
+		mFreeChildBlocks.pop_back();
+	}
+	else
+	{
+		wFirst = static_cast<int32_t>(mNodes.size());
+		mNodes.resize(mNodes.size() + 4);
+	}
+
+	const uint32_t wHalf = mNodes[iNode].Size / 2;
+	for (int32_t i = 0; i < 4; i++)
+	{
+		Node& wChild = mNodes[wFirst + i];
+		wChild.X = mNodes[iNode].X + (i & 1) * wHalf;
+		wChild.Y = mNodes[iNode].Y + (i >> 1) * wHalf;
+		wChild.Size = wHalf;
+		wChild.Parent = iNode;
+		wChild.FirstChild = -1;
+		wChild.Used = false;
+	}
+	mNodes[iNode].FirstChild = wFirst;
+}
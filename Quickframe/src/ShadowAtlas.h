@@ -0,0 +1,78 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief : Quadtree allocator of square power of two tiles inside a square atlas.
+ * Allocating splits free nodes down to the requested size, freeing merges back
+ * the four siblings once all of them are free.
+*/
+class ShadowAtlas
+{
+public:
+	struct Tile
+	{
+		uint32_t X = 0;
+		uint32_t Y = 0;
+		uint32_t Size = 0;
+		int32_t Node = -1;		// Allocator handle, -1 when the tile is invalid
+
+		bool IsValid() const { return Node >= 0; }
+	};
+
+	ShadowAtlas(uint32_t iSize, uint32_t iMinTileSize);
+
+	/**
+	 * @brief : Reserve a tile of iSize texels (rounded up to a power of two)
+	 * @return an invalid tile if no free node is large enough
+	*/
+	Tile Allocate(uint32_t iSize);
+	void Free(Tile& ioTile);
+
+	uint32_t GetSize() const { return mSize; }
+	uint32_t GetMinTileSize() const { return mMinTileSize; }
+
+private:
+	struct Node
+	{
+		uint32_t X = 0;
+		uint32_t Y = 0;
+		uint32_t Size = 0;
+		int32_t Parent = -1;
+		int32_t FirstChild = -1;		// The 4 children are contiguous
+		bool Used = false;
+	};
+
+	int32_t FindFreeNode(int32_t iNode, uint32_t iSize);
+	void Split(int32_t iNode);
+
+	std::vector<Node> mNodes;
+	std::vector<int32_t> mFreeChildBlocks;		// Recycled groups of 4 nodes
+	uint32_t mSize;
+	uint32_t mMinTileSize;
+};
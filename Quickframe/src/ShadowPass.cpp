@@ -22,9 +22,23 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <cmath>
+#include <functional>
+
 #include "ShadowPass.h"
 #include "Scene.h"
 #include "MeshNode.h"
+#include "ThreadPool.h"
+#include "GLStateCache.h"
+#include "Defines.h"
+
+namespace
+{
+	void HashCombine(size_t& ioSeed, size_t iValue)
+	{
+		ioSeed ^= iValue + 0x9e3779b9 + (ioSeed << 6) + (ioSeed >> 2);
+	}
+}
 
 ShadowPass::ShadowPass()
 {
@@ -33,6 +47,37 @@ ShadowPass::ShadowPass()
 
 	std::vector<Shader> wShaders{wVertexShader, wFragmentShader};
 	mProgram = std::make_unique<Program>(wShaders);
+
+	mMVPLocation = mProgram->FindUniformLocation("uMVP");
+
+	Shader wResolveShader("shaders/EVSMResolveCS.glsl", Shader::EShaderStage::eCompute);
+	std::vector<Shader> wResolveShaders{ wResolveShader };
+	mEVSMResolveProgram = std::make_unique<Program>(wResolveShaders);
+
+	Shader wBlurShader("shaders/EVSMBlurCS.glsl", Shader::EShaderStage::eCompute);
+	std::vector<Shader> wBlurShaders{ wBlurShader };
+	mEVSMBlurProgram = std::make_unique<Program>(wBlurShaders);
+
+	glGenSamplers(1, &mRawDepthSampler);
+	glSamplerParameteri(mRawDepthSampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glSamplerParameteri(mRawDepthSampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glSamplerParameteri(mRawDepthSampler, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+}
+
+ShadowPass::~ShadowPass()
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	for (auto& wMoments : mMomentsMap)
+	{
+		for (GLuint wTexture : wMoments.second.Textures)
+		{
+			wStateCache->OnTextureDeleted(wTexture);
+		}
+		glDeleteTextures(2, wMoments.second.Textures);
+	}
+
+	wStateCache->OnSamplerDeleted(mRawDepthSampler);
+	glDeleteSamplers(1, &mRawDepthSampler);
 }
 
 void ShadowPass::Execute(Scene* iScene)
@@ -40,68 +85,244 @@ void ShadowPass::Execute(Scene* iScene)
 	mProgram->Bind();
 	for (uint32_t i = 0; i < iScene->GetDirLightCount(); i++)
 	{
-		ShadowMapFBO* wFramebuffer = nullptr;
 		const DirectionalLight* wDirLight = iScene->GetDirLight();
 
-		if (wDirLight->IsShadowEnabled())
+		if (wDirLight->IsShadowEnabled() && mVirtualShadowsEnabled)
+		{
+			if (!mVirtualShadowMap)
+			{
+				mVirtualShadowMap = std::make_unique<VirtualShadowMap>();
+			}
+			mVirtualShadowMap->Update(iScene, wDirLight);
+			mProgram->Bind();
+		}
+		else if (wDirLight->IsShadowEnabled())
 		{
 			auto wIt = mFramebufferMap.find(wDirLight->GetID());
+			if (wIt == mFramebufferMap.end())
+			{
+				const std::string wName = "Shadow Map Light " + std::to_string(wDirLight->GetID());
+				mFramebufferMap[wDirLight->GetID()] = std::make_unique<ShadowMapFBO>(wName, 2048, 2048);
+				mFramebufferMap[wDirLight->GetID()]->Initialize();
+
+				StaticCache& wNewCache = mStaticCacheMap[wDirLight->GetID()];
+				wNewCache.Framebuffer = std::make_unique<ShadowMapFBO>(wName + " Static", 2048, 2048);
+				wNewCache.Framebuffer->Initialize();
+
+				wIt = mFramebufferMap.find(wDirLight->GetID());
+			}
+
+			ShadowMapFBO* wFramebuffer = wIt->second.get();
+			StaticCache& wCache = mStaticCacheMap[wDirLight->GetID()];
+
+			const glm::mat4 wLightViewProj = wDirLight->GetView()->GetFrustum()->ProjectionMatrix() *
+				wDirLight->GetView()->ViewMatrix();
 
-			if (wIt != mFramebufferMap.end())
+			// Split the casters, static ones are hashed to detect a change of the static set
+			size_t wStaticSignature = 0;
+			mCasters.clear();
+			mStaticCasters.clear();
+			for (const auto& wEntityMap : iScene->GetEntities())
 			{
-				wFramebuffer = mFramebufferMap[wDirLight->GetID()].get();
+				Entity* wEntity = wEntityMap.second.get();
+				if (!wEntity->IsDrawable())
+				{
+					continue;
+				}
+
+				if (wEntity->IsStatic())
+				{
+					mStaticCasters.push_back(wEntity);
+					HashCombine(wStaticSignature, std::hash<const void*>()(wEntity));
+					HashCombine(wStaticSignature, std::hash<uint64_t>()(wEntity->GetTransform()->GetVersion()));
+				}
+				else
+				{
+					mCasters.push_back(wEntity);
+				}
 			}
-			else
+
+			GLStateCache* wStateCache = GLStateCache::GetInstance();
+			wStateCache->SetDepthMask(true);
+			wStateCache->SetDepthTest(true);
+			wStateCache->SetDepthFunc(GL_LESS);
+
+			bool wStaticDirty = !wCache.Valid || wCache.ViewProj != wLightViewProj || wCache.Signature != wStaticSignature;
+			if (wStaticDirty)
 			{
-				mFramebufferMap[wDirLight->GetID()] = std::make_unique<ShadowMapFBO>(
-					"Shadow Map Light " + std::to_string(wDirLight->GetID()),
-					2048,
-					2048);
+				wCache.Framebuffer->BindDst();
+				glClear(GL_DEPTH_BUFFER_BIT);
+				DrawCasters(mStaticCasters, wLightViewProj);
 
-				wFramebuffer = mFramebufferMap[wDirLight->GetID()].get();
+				wCache.ViewProj = wLightViewProj;
+				wCache.Signature = wStaticSignature;
+				wCache.Valid = true;
+			}
 
-				wFramebuffer->Initialize();
+			// When nothing moved and there is nothing dynamic to draw, last frame shadow map is still right
+			MomentsMaps& wMoments = mMomentsMap[wDirLight->GetID()];
+			if (wStaticDirty || !mCasters.empty() || !wCache.ShadowMapMatchesCache)
+			{
+				// Start from the static depth and draw the dynamic casters on top
+				glCopyImageSubData(wCache.Framebuffer->TextureHandle(), GL_TEXTURE_2D, 0, 0, 0, 0,
+					wFramebuffer->TextureHandle(), GL_TEXTURE_2D, 0, 0, 0, 0,
+					wFramebuffer->GetWidth(), wFramebuffer->GetHeight(), 1);
+
+				if (!mCasters.empty())
+				{
+					wFramebuffer->BindDst();
+					DrawCasters(mCasters, wLightViewProj);
+				}
+				wCache.ShadowMapMatchesCache = mCasters.empty();
+				wMoments.UpToDate = false;
 			}
-			wFramebuffer->BindDst();
-			glClear(GL_DEPTH_BUFFER_BIT);
 
-			for (auto wEntityMap : iScene->GetEntities())
+			if (mFilterMode == EShadowFilter::eEVSM && !wMoments.UpToDate)
 			{
-				Entity* wEntity = wEntityMap.second.get();
+				FilterMoments(wFramebuffer, wMoments);
+				mProgram->Bind();
+			}
+		}
+	}
+}
+
+void ShadowPass::CaptureSceneDepth(Scene* iScene)
+{
+	if (mVirtualShadowsEnabled && mVirtualShadowMap)
+	{
+		mVirtualShadowMap->CaptureSceneDepth(iScene);
+	}
+}
+
+void ShadowPass::BindShadowResources(Program* iProgram, uint32_t iLightID)
+{
+	const bool wVirtual = mVirtualShadowsEnabled && mVirtualShadowMap;
+	iProgram->SetUniform1i("uVirtualShadowEnabled", wVirtual);
+	iProgram->SetUniform1i(SHADOW_MOMENTS_0_TEXTURE_UNIFORM, SHADOW_MOMENTS_0_TEXTURE_UNIFORM_IDX);
+	if (wVirtual)
+	{
+		mVirtualShadowMap->BindResources(iProgram);
+		return;
+	}
+
+	mFramebufferMap.at(iLightID)->BindSrc(SHADOW_MAP_0_TEXTURE_UNIT);
+
+	iProgram->SetUniform1i("uShadowFilterMode", static_cast<int>(mFilterMode));
+	if (mFilterMode == EShadowFilter::eEVSM)
+	{
+		GLStateCache::GetInstance()->BindTexture(SHADOW_MOMENTS_0_TEXTURE_UNIT, GL_TEXTURE_2D, mMomentsMap.at(iLightID).Textures[0]);
+		iProgram->SetUniform2f("uEVSMExponents", glm::vec2(kEVSMPositiveExponent, kEVSMNegativeExponent));
+	}
+}
+
+void ShadowPass::FilterMoments(ShadowMapFBO* iShadowMap, MomentsMaps& ioMoments)
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+
+	if (!ioMoments.Textures[0])
+	{
+		ioMoments.Size = iShadowMap->GetWidth() / 2;
 
-				glm::mat4 wTransform = wDirLight->GetView()->GetFrustum()->ProjectionMatrix() *
-					wDirLight->GetView()->ViewMatrix() *
-					wEntity->GetTransform()->GetWorldMatrix();
+		uint32_t wLevelCount = 1;
+		while ((ioMoments.Size >> wLevelCount) > 0)
+		{
+			++wLevelCount;
+		}
+
+		// Outside of the map is lit : moments of the far plane
+		const float wPos = std::exp(kEVSMPositiveExponent);
+		const float wNeg = -std::exp(-kEVSMNegativeExponent);
+		const float wBorder[4] = { wPos, wPos * wPos, wNeg, wNeg * wNeg };
+
+		glGenTextures(2, ioMoments.Textures);
+		wStateCache->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, ioMoments.Textures[0]);
+		glTexStorage2D(GL_TEXTURE_2D, wLevelCount, GL_RGBA32F, ioMoments.Size, ioMoments.Size);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, wBorder);
+
+		wStateCache->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, ioMoments.Textures[1]);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, ioMoments.Size, ioMoments.Size);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+
+	const GLuint wGroupCount = (ioMoments.Size + 7) / 8;
+
+	// Depth to moments, the depth texture is read without its comparison mode
+	mEVSMResolveProgram->Bind();
+	mEVSMResolveProgram->SetUniform1i(SHADOW_MAP_0_TEXTURE_UNIFORM, 0);
+	mEVSMResolveProgram->SetUniform2f("uEVSMExponents", glm::vec2(kEVSMPositiveExponent, kEVSMNegativeExponent));
+	iShadowMap->BindSrc(GL_TEXTURE0);
+	wStateCache->BindSampler(GL_TEXTURE0, mRawDepthSampler);
+	glBindImageTexture(0, ioMoments.Textures[0], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+	glDispatchCompute(wGroupCount, wGroupCount, 1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	wStateCache->BindSampler(GL_TEXTURE0, 0);
+
+	// Separable blur, horizontal into the ping-pong target then vertical back
+	mEVSMBlurProgram->Bind();
+	mEVSMBlurProgram->SetUniform1i("uInput", 0);
+	for (uint32_t wPass = 0; wPass < 2; wPass++)
+	{
+		mEVSMBlurProgram->SetUniform1i("uHorizontal", wPass == 0);
+		wStateCache->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, ioMoments.Textures[wPass]);
+		glBindImageTexture(0, ioMoments.Textures[1 - wPass], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+		glDispatchCompute(wGroupCount, wGroupCount, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+	}
 
-				mProgram->SetUniformMatrix4f("uMVP", wTransform);
+	// Mipmaps keep the filtering stable when the map is minified
+	wStateCache->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, ioMoments.Textures[0]);
+	glGenerateMipmap(GL_TEXTURE_2D);
 
+	ioMoments.UpToDate = true;
+}
+
+void ShadowPass::DrawCasters(const std::vector<Entity*>& iCasters, const glm::mat4& iLightViewProj)
+{
+	ThreadPool* wThreadPool = ThreadPool::GetInstance();
+	mCommandBuffers.resize(wThreadPool->GetMaxChunkCount());
+	for (CommandBuffer& wCmdBuffer : mCommandBuffers)
+	{
+		wCmdBuffer.Reset();
+	}
+
+	wThreadPool->ParallelFor(static_cast<uint32_t>(iCasters.size()),
+		[&](uint32_t iBegin, uint32_t iEnd, uint32_t iChunk)
+		{
+			CommandBuffer& wCmdBuffer = mCommandBuffers[iChunk];
+			for (uint32_t j = iBegin; j < iEnd; j++)
+			{
+				Entity* wEntity = iCasters[j];
 				const MeshNode* wEntityRoot = wEntity->GetMesh()->GetRootNode();
 				if (wEntityRoot)
 				{
-					RenderMeshNode(*wEntityRoot);
+					wCmdBuffer.SetUniformMatrix4f(mMVPLocation, iLightViewProj * wEntity->GetTransform()->GetWorldMatrix());
+					RecordMeshNode(*wEntityRoot, wCmdBuffer);
 				}
 			}
-		}
+		});
 
-		wFramebuffer->Unbind();
+	for (const CommandBuffer& wCmdBuffer : mCommandBuffers)
+	{
+		wCmdBuffer.Execute();
 	}
-	mProgram->Unbind();
 }
 
-void ShadowPass::RenderMeshNode(const MeshNode& iMeshNode)
+void ShadowPass::RecordMeshNode(const MeshNode& iMeshNode, CommandBuffer& oCmdBuffer) const
 {
 	for (const auto& wSubMesh : iMeshNode.GetSubmeshes())
 	{
-		glBindVertexArray(wSubMesh.VertexArrayHandle());
-		glEnableVertexAttribArray(SubMesh::EVertexAttrib::ePosition);
-
-		glDrawElements(GL_TRIANGLES, wSubMesh.IndexCount(), GL_UNSIGNED_INT, 0);
-		glDisableVertexAttribArray(SubMesh::EVertexAttrib::ePosition);
+		oCmdBuffer.BindVertexArray(wSubMesh.PositionVertexArrayHandle());
+		oCmdBuffer.DrawIndexed(wSubMesh.IndexCount());
 	}
 
 	for (auto& wChildren : iMeshNode.GetChildren())
 	{
-		RenderMeshNode(wChildren);
+		RecordMeshNode(wChildren, oCmdBuffer);
 	}
 }
 
@@ -24,15 +24,56 @@ SOFTWARE.
 
 #pragma once
 
+#include <vector>
+
 #include "Pass.h"
 #include "Framebuffer.h"
+#include "CommandBuffer.h"
+#include "VirtualShadowMap.h"
 
+class Entity;
 class MeshNode;
 
+/**
+ * @brief : Directional light shadow maps.
+ * Static casters are rendered once into a cached depth map, re-rendered only when the light
+ * view or the static set changes. Each frame the cache is copied and only dynamic casters are drawn.
+ * With virtual shadows on, the light renders into a VirtualShadowMap instead and no fixed size map is allocated.
+*/
 class ShadowPass : public Pass
 {
+	struct StaticCache
+	{
+		std::unique_ptr<ShadowMapFBO> Framebuffer;
+		glm::mat4 ViewProj{ 0.f };
+		size_t Signature = 0;
+		bool Valid = false;
+		bool ShadowMapMatchesCache = false;	// No dynamic caster was drawn over the last copy
+	};
+
+	/**
+	 * @brief : Half resolution EVSM moments (RGBA32F, mipmapped) and the blur ping-pong target
+	*/
+	struct MomentsMaps
+	{
+		GLuint Textures[2] = { 0, 0 };
+		uint32_t Size = 0;
+		bool UpToDate = false;
+	};
+
 public:
+	enum class EShadowFilter
+	{
+		eHardwarePCF = 0,		// Single bilinear sampler2DShadow tap
+		ePoissonPCF,				// 12 rotated Poisson taps, each a hardware 2x2 PCF
+		eEVSM						// Exponential variance shadow map, blurred and mipmapped
+	};
+
+	static constexpr float kEVSMPositiveExponent = 40.f;
+	static constexpr float kEVSMNegativeExponent = 5.f;
+
 	ShadowPass();
+	~ShadowPass();
 
 	void Execute(Scene* iScene) override;
 
@@ -40,9 +81,46 @@ public:
 	{
 		return mFramebufferMap;
 	}
+
+	void SetFilterMode(EShadowFilter iFilterMode) { mFilterMode = iFilterMode; }
+	EShadowFilter GetFilterMode() const { return mFilterMode; }
+
+	/**
+	 * @brief : Page based virtual shadow map, the filter mode only applies to the regular shadow maps
+	*/
+	void SetVirtualShadowsEnabled(bool iEnabled) { mVirtualShadowsEnabled = iEnabled; }
+	bool AreVirtualShadowsEnabled() const { return mVirtualShadowsEnabled; }
+
+	/**
+	 * @brief : Called once the frame is rendered, the virtual shadow map picks its pages from this depth
+	*/
+	void CaptureSceneDepth(Scene* iScene);
+
+	/**
+	 * @brief : Bind the shadow map (and moments in EVSM mode) of a light and set the filtering uniforms
+	*/
+	void BindShadowResources(Program* iProgram, uint32_t iLightID);
+
 private:
+	void FilterMoments(ShadowMapFBO* iShadowMap, MomentsMaps& ioMoments);
 
-	void RenderMeshNode(const MeshNode& iMeshNode);
+	void DrawCasters(const std::vector<Entity*>& iCasters, const glm::mat4& iLightViewProj);
+	void RecordMeshNode(const MeshNode& iMeshNode, CommandBuffer& oCmdBuffer) const;
 
 	std::unordered_map<uint32_t, std::unique_ptr<ShadowMapFBO>> mFramebufferMap;
+	std::unordered_map<uint32_t, StaticCache> mStaticCacheMap;
+	std::unordered_map<uint32_t, MomentsMaps> mMomentsMap;
+
+	EShadowFilter mFilterMode = EShadowFilter::eHardwarePCF;
+	std::unique_ptr<Program> mEVSMResolveProgram;
+	std::unique_ptr<Program> mEVSMBlurProgram;
+	GLuint mRawDepthSampler = 0;		// No depth comparison, to read the depth values in compute
+
+	std::unique_ptr<VirtualShadowMap> mVirtualShadowMap;
+	bool mVirtualShadowsEnabled = true;
+
+	GLint mMVPLocation = -1;
+	std::vector<CommandBuffer> mCommandBuffers;
+	std::vector<Entity*> mCasters;			// Dynamic casters
+	std::vector<Entity*> mStaticCasters;
 };
\ No newline at end of file
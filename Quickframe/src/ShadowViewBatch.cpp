@@ -0,0 +1,185 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <bitset>
+#include <cstring>
+#include <spdlog/spdlog.h>
+
+#include "ShadowViewBatch.h"
+#include "Entity.h"
+#include "MeshNode.h"
+#include "ThreadPool.h"
+#include "GLStateCache.h"
+#include "Defines.h"
+
+namespace
+{
+	bool IsExtensionSupported(const char* iName)
+	{
+		GLint wCount = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &wCount);
+		for (GLint i = 0; i < wCount; i++)
+		{
+			const char* wExtension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+			if (wExtension && std::strcmp(wExtension, iName) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+ShadowViewBatch::ShadowViewBatch(EDepthMode iDepthMode)
+	:mViewBuffer(GL_SHADER_STORAGE_BUFFER)
+{
+	mUseGeometryShader = !IsExtensionSupported("GL_ARB_shader_viewport_layer_array");
+
+	std::vector<std::string> wDefines;
+	if (iDepthMode == EDepthMode::eLightDistance)
+	{
+		wDefines.push_back("LIGHT_DISTANCE_DEPTH");
+	}
+	Shader wFragmentShader("shaders/ShadowLayeredFS.glsl", Shader::EShaderStage::eFragment, wDefines);
+	if (mUseGeometryShader)
+	{
+		Shader wVertexShader("shaders/ShadowLayeredPassthroughVS.glsl", Shader::EShaderStage::eVertex);
+		Shader wGeometryShader("shaders/ShadowLayeredGS.glsl", Shader::EShaderStage::eGeometry);
+		mProgram = std::make_unique<Program>(std::vector<Shader>{ wVertexShader, wGeometryShader, wFragmentShader });
+	}
+	else
+	{
+		Shader wVertexShader("shaders/ShadowLayeredVS.glsl", Shader::EShaderStage::eVertex);
+		mProgram = std::make_unique<Program>(std::vector<Shader>{ wVertexShader, wFragmentShader });
+	}
+
+	spdlog::info("Layered shadow views routed from the {0:s} shader", mUseGeometryShader ? "geometry" : "vertex");
+
+	mWorldLocation = mProgram->FindUniformLocation("uWorld");
+	mViewMaskLocation = mProgram->FindUniformLocation("uViewMask");
+
+	mViewBuffer.Allocate(kMaxViews * sizeof(GPUShadowView));
+	mViews.reserve(kMaxViews);
+	mViewports.reserve(kMaxViews * 4);
+}
+
+void ShadowViewBatch::Reset()
+{
+	mViews.clear();
+	mViewports.clear();
+}
+
+bool ShadowViewBatch::AddView(const glm::mat4& iViewProj, int32_t iLayer, const glm::ivec4& iViewport, const glm::vec3& iLightPos, float iFarPlane)
+{
+	if (mViews.size() >= kMaxViews)
+	{
+		return false;
+	}
+
+	GPUShadowView wView;
+	wView.ViewProj = iViewProj;
+	wView.LightPosFar = glm::vec4(iLightPos, iFarPlane);
+	wView.LayerViewport = glm::ivec4(iLayer, static_cast<int32_t>(mViews.size()), 0, 0);
+	mViews.push_back(wView);
+
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		mViewports.push_back(static_cast<GLfloat>(iViewport[i]));
+	}
+	return true;
+}
+
+void ShadowViewBatch::Render(const std::vector<Entity*>& iCasters, const std::function<bool(uint32_t, uint32_t)>& iTouchesView)
+{
+	if (mViews.empty())
+	{
+		return;
+	}
+
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	mViewBuffer.Upload(mViews.data(), mViews.size() * sizeof(GPUShadowView));
+	mViewBuffer.BindBase(SHADOW_VIEWS_SSBO_BINDING);
+	wStateCache->ViewportArray(0, static_cast<GLsizei>(mViews.size()), mViewports.data());
+	mProgram->Bind();
+
+	ThreadPool* wThreadPool = ThreadPool::GetInstance();
+	mCommandBuffers.resize(wThreadPool->GetMaxChunkCount());
+	for (CommandBuffer& wCmdBuffer : mCommandBuffers)
+	{
+		wCmdBuffer.Reset();
+	}
+
+	const uint32_t wViewCount = GetViewCount();
+	wThreadPool->ParallelFor(static_cast<uint32_t>(iCasters.size()),
+		[&](uint32_t iBegin, uint32_t iEnd, uint32_t iChunk)
+		{
+			CommandBuffer& wCmdBuffer = mCommandBuffers[iChunk];
+			for (uint32_t j = iBegin; j < iEnd; j++)
+			{
+				const Entity* wEntity = iCasters[j];
+				const MeshNode* wEntityRoot = wEntity->GetMesh()->GetRootNode();
+				if (!wEntityRoot)
+				{
+					continue;
+				}
+
+				uint32_t wViewMask = 0;
+				for (uint32_t wView = 0; wView < wViewCount; wView++)
+				{
+					if (iTouchesView(j, wView))
+					{
+						wViewMask |= 1u << wView;
+					}
+				}
+
+				if (wViewMask == 0)
+				{
+					continue;
+				}
+
+				wCmdBuffer.SetUniformMatrix4f(mWorldLocation, wEntity->GetTransform()->GetWorldMatrix());
+				wCmdBuffer.SetUniform1ui(mViewMaskLocation, wViewMask);
+				RecordMeshNode(*wEntityRoot, static_cast<GLsizei>(std::bitset<32>(wViewMask).count()), wCmdBuffer);
+			}
+		});
+
+	for (const CommandBuffer& wCmdBuffer : mCommandBuffers)
+	{
+		wCmdBuffer.Execute();
+	}
+}
+
+void ShadowViewBatch::RecordMeshNode(const MeshNode& iMeshNode, GLsizei iInstanceCount, CommandBuffer& oCmdBuffer) const
+{
+	for (const auto& wSubMesh : iMeshNode.GetSubmeshes())
+	{
+		oCmdBuffer.BindVertexArray(wSubMesh.PositionVertexArrayHandle());
+		oCmdBuffer.DrawIndexedInstanced(wSubMesh.IndexCount(), iInstanceCount);
+	}
+
+	for (auto& wChildren : iMeshNode.GetChildren())
+	{
+		RecordMeshNode(wChildren, iInstanceCount, oCmdBuffer);
+	}
+}
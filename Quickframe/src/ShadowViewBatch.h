@@ -0,0 +1,106 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "Program.h"
+#include "GPUBuffer.h"
+#include "CommandBuffer.h"
+
+class Entity;
+class MeshNode;
+
+/**
+ * @brief : Renders several shadow views in a single traversal of the casters.
+ * Each caster is drawn once, instanced over the views it touches (a view mask per draw),
+ * and every instance is routed to its layer and viewport with gl_Layer / gl_ViewportIndex.
+ * Written from the vertex shader when ARB_shader_viewport_layer_array is available,
+ * from a geometry shader otherwise.
+*/
+class ShadowViewBatch
+{
+public:
+	static constexpr uint32_t kMaxViews = 16;		// Guaranteed minimum of GL_MAX_VIEWPORTS
+
+	/**
+	 * @brief : Value stored in the depth of every view of the batch, fixed at compile time so
+	 * hardware depth views keep early depth testing (no gl_FragDepth write)
+	*/
+	enum class EDepthMode
+	{
+		eHardware,			// Rasterized depth, spot tiles and virtual shadow pages
+		eLightDistance		// Light to surface distance divided by the far plane, cube maps
+	};
+
+	explicit ShadowViewBatch(EDepthMode iDepthMode);
+
+	void Reset();
+
+	/**
+	 * @param iLayer : Layer of the bound layered depth texture
+	 * @param iViewport : x, y, width, height
+	 * @param iFarPlane : Divides the light distance in eLightDistance mode, unused otherwise
+	 * @return false if the batch is full
+	*/
+	bool AddView(const glm::mat4& iViewProj, int32_t iLayer, const glm::ivec4& iViewport, const glm::vec3& iLightPos, float iFarPlane);
+
+	uint32_t GetViewCount() const { return static_cast<uint32_t>(mViews.size()); }
+
+	/**
+	 * @brief : Draw the casters into every view, the layered framebuffer must be bound and the views cleared
+	 * @param iTouchesView : Culling test of a caster (index in iCasters) against a view, called from worker threads
+	*/
+	void Render(const std::vector<Entity*>& iCasters, const std::function<bool(uint32_t, uint32_t)>& iTouchesView);
+
+	bool UsesGeometryShader() const { return mUseGeometryShader; }
+
+private:
+	/**
+	 * @brief : std430 layout, see ShadowLayeredVS.glsl
+	*/
+	struct GPUShadowView
+	{
+		glm::mat4 ViewProj;
+		glm::vec4 LightPosFar;
+		glm::ivec4 LayerViewport;	// Layer, viewport index
+	};
+
+	void RecordMeshNode(const MeshNode& iMeshNode, GLsizei iInstanceCount, CommandBuffer& oCmdBuffer) const;
+
+	std::unique_ptr<Program> mProgram;
+	GLint mWorldLocation = -1;
+	GLint mViewMaskLocation = -1;
+	bool mUseGeometryShader = false;
+
+	GPUBuffer mViewBuffer;
+	std::vector<GPUShadowView> mViews;
+	std::vector<GLfloat> mViewports;
+	std::vector<CommandBuffer> mCommandBuffers;
+};
@@ -31,7 +31,13 @@ Skybox::Skybox()
 	mCubeEntity->LoadMesh("resources/meshes/Cube.obj");
 }
 
+Skybox::~Skybox()
+{
+	TextureManager::GetInstance()->ReleaseTexture(mCubemap);
+}
+
 void Skybox::LoadCubemap(const std::vector<std::string>& iName)
 {
+	TextureManager::GetInstance()->ReleaseTexture(mCubemap);
 	mCubemap = TextureManager::GetInstance()->GetTexture(GL_TEXTURE_CUBE_MAP, iName);
 }
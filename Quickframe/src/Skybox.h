@@ -35,6 +35,7 @@ class Skybox
 {
 public:
 	Skybox();
+	~Skybox();
 
 	void LoadCubemap(const std::vector<std::string>& iName);
 
@@ -26,6 +26,7 @@ SOFTWARE.
 #include "TextureManager.h"
 #include "Scene.h"
 #include "Defines.h"
+#include "GLStateCache.h"
 
 SkyboxPass::SkyboxPass()
 {
@@ -40,13 +41,13 @@ void SkyboxPass::Execute(Scene* iScene)
 {
 	if (Skybox* wSkybox = iScene->GetSkybox())
 	{
-		GLint wCurrentCullFaceMode;
-		glGetIntegerv(GL_CULL_FACE_MODE, &wCurrentCullFaceMode);
-		GLint wCurrentDepthFuncMode;
-		glGetIntegerv(GL_DEPTH_FUNC, &wCurrentDepthFuncMode);
+		// Read the shadowed state instead of querying the driver
+		GLStateCache* wStateCache = GLStateCache::GetInstance();
+		GLenum wCurrentCullFaceMode = wStateCache->GetCullFaceMode();
+		GLenum wCurrentDepthFuncMode = wStateCache->GetDepthFunc();
 
-		glCullFace(GL_FRONT);
-		glDepthFunc(GL_LEQUAL);
+		wStateCache->SetCullFaceMode(GL_FRONT);
+		wStateCache->SetDepthFunc(GL_LEQUAL);
 
 		mProgram->Bind();
 
@@ -58,16 +59,11 @@ void SkyboxPass::Execute(Scene* iScene)
 		mProgram->SetUniform1i(CUBEMAP_0_TEXTURE_UNIFORM, CUBEMAP_0_TEXTURE_UNIFORM_IDX);
 		
 		const SubMesh& wSubmesh = wSkybox->GetSubmesh();
-		glBindVertexArray(wSubmesh.VertexArrayHandle());
-		glEnableVertexAttribArray(SubMesh::EVertexAttrib::ePosition);
-
+		wStateCache->BindVertexArray(wSubmesh.VertexArrayHandle());
 		glDrawElements(GL_TRIANGLES, wSubmesh.IndexCount(), GL_UNSIGNED_INT, 0);
-		glDisableVertexAttribArray(SubMesh::EVertexAttrib::ePosition);
-
-		mProgram->Unbind();
 
-		glCullFace(wCurrentCullFaceMode);
-		glDepthFunc(wCurrentDepthFuncMode);
+		wStateCache->SetCullFaceMode(wCurrentCullFaceMode);
+		wStateCache->SetDepthFunc(wCurrentDepthFuncMode);
 	}
 }
 
@@ -0,0 +1,409 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <glm/glm.hpp>
+#include <spdlog/spdlog.h>
+
+#include "SpotShadowPass.h"
+#include "Scene.h"
+#include "MeshNode.h"
+#include "GLStateCache.h"
+#include "PerspectiveFrustum.h"
+#include "Defines.h"
+
+namespace
+{
+	constexpr float kShadowNearPlane = 0.1f;
+
+	void HashCombine(size_t& ioSeed, size_t iValue)
+	{
+		ioSeed ^= iValue + 0x9e3779b9 + (ioSeed << 6) + (ioSeed >> 2);
+	}
+}
+
+SpotShadowPass::SpotShadowPass()
+	:mAtlas(kAtlasSize, kMinTileSize),
+	mShadowBuffer(GL_SHADER_STORAGE_BUFFER),
+	mViewBatch(ShadowViewBatch::EDepthMode::eHardware)
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+
+	glGenTextures(1, &mAtlasTexture);
+	wStateCache->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, mAtlasTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, kAtlasSize, kAtlasSize, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenFramebuffers(1, &mFramebufferHandle);
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, mFramebufferHandle);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, mAtlasTexture, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		spdlog::critical("Error While Creating Framebuffer Spot Shadow Atlas !");
+	}
+
+	glClear(GL_DEPTH_BUFFER_BIT);
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	mShadowBuffer.Allocate(sizeof(GPUSpotShadow));
+}
+
+SpotShadowPass::~SpotShadowPass()
+{
+	GLStateCache::GetInstance()->OnTextureDeleted(mAtlasTexture);
+	GLStateCache::GetInstance()->OnFramebufferDeleted(mFramebufferHandle);
+	glDeleteTextures(1, &mAtlasTexture);
+	glDeleteFramebuffers(1, &mFramebufferHandle);
+}
+
+void SpotShadowPass::Execute(Scene* iScene)
+{
+	++mFrame;
+	mTilesRendered = 0;
+
+	GatherCasters(iScene);
+
+	std::vector<std::pair<const SpotLight*, TileState*>> wLights;
+	for (uint32_t i = 0; i < iScene->GetSpotLightCount(); i++)
+	{
+		const SpotLight* wSpotLight = iScene->GetSpotLight(i);
+		if (!wSpotLight->IsShadowEnabled())
+		{
+			continue;
+		}
+
+		TileState& wState = mTiles[wSpotLight->GetID()];
+		wState.LastSeenFrame = mFrame;
+		wState.Importance = ComputeImportance(wSpotLight, iScene);
+
+		// Grow right away, only shrink when the tile is 4 times too large to avoid flickering between sizes
+		uint32_t wDesiredSize = TileSizeFromImportance(wState.Importance);
+		if (wState.Tile.IsValid() && (wDesiredSize > wState.Tile.Size || wDesiredSize * 4 <= wState.Tile.Size))
+		{
+			mAtlas.Free(wState.Tile);
+		}
+
+		// Only the casters this light reaches can dirty its tile
+		wState.PendingSignature = ComputeCasterSignature(wSpotLight);
+
+		bool wChanged = wState.LightVersion != wSpotLight->GetTransform()->GetVersion() ||
+			wState.Direction != wSpotLight->GetDirection() ||
+			wState.Cutoff != wSpotLight->GetCutoff() ||
+			wState.Range != wSpotLight->GetRange() ||
+			wState.CasterSignature != wState.PendingSignature;
+
+		if (wChanged && !wState.Dirty)
+		{
+			wState.Dirty = true;
+			wState.DirtySinceFrame = mFrame;
+		}
+
+		wLights.push_back({ wSpotLight, &wState });
+	}
+
+	// Give back the tiles of lights that were removed or lost their shadow
+	for (auto wIt = mTiles.begin(); wIt != mTiles.end();)
+	{
+		if (wIt->second.LastSeenFrame != mFrame)
+		{
+			mAtlas.Free(wIt->second.Tile);
+			wIt = mTiles.erase(wIt);
+		}
+		else
+		{
+			++wIt;
+		}
+	}
+
+	// Most important lights get their tile first, the others fall back to smaller tiles
+	std::sort(wLights.begin(), wLights.end(), [](const auto& iA, const auto& iB)
+		{
+			return iA.second->Importance > iB.second->Importance;
+		});
+
+	for (auto& wLight : wLights)
+	{
+		TileState& wState = *wLight.second;
+		if (wState.Tile.IsValid())
+		{
+			continue;
+		}
+
+		for (uint32_t wSize = TileSizeFromImportance(wState.Importance); wSize >= kMinTileSize && !wState.Tile.IsValid(); wSize /= 2)
+		{
+			wState.Tile = mAtlas.Allocate(wSize);
+		}
+
+		wState.Rendered = false;
+		if (!wState.Dirty)
+		{
+			wState.Dirty = true;
+			wState.DirtySinceFrame = mFrame;
+		}
+	}
+
+	// Tiles without content first, then by importance weighted by how long they have been waiting
+	std::vector<std::pair<const SpotLight*, TileState*>> wPending;
+	for (auto& wLight : wLights)
+	{
+		if (wLight.second->Dirty && wLight.second->Tile.IsValid())
+		{
+			wPending.push_back(wLight);
+		}
+	}
+
+	std::sort(wPending.begin(), wPending.end(), [this](const auto& iA, const auto& iB)
+		{
+			if (iA.second->Rendered != iB.second->Rendered)
+			{
+				return !iA.second->Rendered;
+			}
+			float wPriorityA = iA.second->Importance * static_cast<float>(mFrame - iA.second->DirtySinceFrame + 1);
+			float wPriorityB = iB.second->Importance * static_cast<float>(mFrame - iB.second->DirtySinceFrame + 1);
+			return wPriorityA > wPriorityB;
+		});
+
+	// The tiles updated this frame are drawn in a single pass, one viewport per tile
+	uint32_t wUpdateCount = std::min(static_cast<uint32_t>(wPending.size()), kTileUpdateBudget);
+	if (wUpdateCount > 0)
+	{
+		mViewBatch.Reset();
+		mBatchLights.clear();
+
+		for (uint32_t i = 0; i < wUpdateCount; i++)
+		{
+			const SpotLight* wSpotLight = wPending[i].first;
+			TileState& wState = *wPending[i].second;
+
+			PrepareTile(wSpotLight, wState);
+
+			wState.LightVersion = wSpotLight->GetTransform()->GetVersion();
+			wState.Direction = wSpotLight->GetDirection();
+			wState.Cutoff = wSpotLight->GetCutoff();
+			wState.Range = wSpotLight->GetRange();
+			wState.CasterSignature = wState.PendingSignature;
+			wState.Dirty = false;
+			wState.Rendered = true;
+			++mTilesRendered;
+		}
+
+		GLStateCache* wStateCache = GLStateCache::GetInstance();
+		wStateCache->BindFramebuffer(GL_FRAMEBUFFER, mFramebufferHandle);
+		wStateCache->SetDepthMask(true);
+		wStateCache->SetDepthTest(true);
+		wStateCache->SetDepthFunc(GL_LESS);
+
+		// Tiles are cleared through the texture, make the clears visible to the rasterizer
+		glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+
+		// Casters out of the light reach can't shadow anything it lights
+		mViewBatch.Render(mCasters, [this](uint32_t iCaster, uint32_t iView)
+			{
+				const glm::vec4& wBounds = mCasterBounds[iCaster];
+				const glm::vec4& wLight = mBatchLights[iView];
+				return wBounds.w < 0.f || glm::length(glm::vec3(wBounds) - glm::vec3(wLight)) - wBounds.w <= wLight.w;
+			});
+	}
+
+	// Tiles keep the matrix they were rendered with until their next update
+	mGPUShadows.clear();
+	mShadowIndices.clear();
+	for (auto& wLight : wLights)
+	{
+		const TileState& wState = *wLight.second;
+		if (!wState.Tile.IsValid() || !wState.Rendered)
+		{
+			continue;
+		}
+
+		GPUSpotShadow wShadow;
+		wShadow.ViewProj = wState.ViewProj;
+		wShadow.AtlasRect = glm::vec4(wState.Tile.X, wState.Tile.Y, wState.Tile.Size, wState.Tile.Size) / static_cast<float>(kAtlasSize);
+
+		mShadowIndices[wLight.first->GetID()] = static_cast<uint32_t>(mGPUShadows.size());
+		mGPUShadows.push_back(wShadow);
+	}
+
+	if (!mGPUShadows.empty())
+	{
+		mShadowBuffer.Upload(mGPUShadows.data(), mGPUShadows.size() * sizeof(GPUSpotShadow));
+	}
+}
+
+bool SpotShadowPass::GetShadowIndex(uint32_t iLightID, uint32_t& oIndex) const
+{
+	auto wIt = mShadowIndices.find(iLightID);
+	if (wIt == mShadowIndices.end())
+	{
+		return false;
+	}
+
+	oIndex = wIt->second;
+	return true;
+}
+
+bool SpotShadowPass::GetShadow(uint32_t iLightID, glm::mat4& oViewProj, glm::vec4& oAtlasRect) const
+{
+	uint32_t wIndex = 0;
+	if (!GetShadowIndex(iLightID, wIndex))
+	{
+		return false;
+	}
+
+	oViewProj = mGPUShadows[wIndex].ViewProj;
+	oAtlasRect = mGPUShadows[wIndex].AtlasRect;
+	return true;
+}
+
+void SpotShadowPass::BindShadowAtlas(GLenum iTextureUnit)
+{
+	GLStateCache::GetInstance()->BindTexture(iTextureUnit, GL_TEXTURE_2D, mAtlasTexture);
+}
+
+void SpotShadowPass::BindShadowBuffer()
+{
+	mShadowBuffer.BindBase(SPOT_SHADOWS_SSBO_BINDING);
+}
+
+float SpotShadowPass::ComputeImportance(const SpotLight* iLight, Scene* iScene) const
+{
+	// Fraction of the screen height covered by the light range sphere
+	Camera* wCamera = iScene->GetCamera();
+	float wRange = iLight->GetRange();
+	glm::vec3 wToLight = iLight->GetPos() - wCamera->WorldPos();
+	float wDistance = glm::length(wToLight);
+	if (wDistance <= wRange)
+	{
+		return 1.f;
+	}
+
+	float wTanHalfFov = std::tan(glm::radians(wCamera->GetFOV()) * 0.5f);
+	float wCoverage = wRange / (wDistance * wTanHalfFov);
+
+	// Lights behind the camera only cast shadows at the edges of the view
+	if (glm::dot(wToLight, glm::normalize(wCamera->Direction())) < -wRange)
+	{
+		wCoverage *= 0.25f;
+	}
+
+	return glm::clamp(wCoverage, 0.f, 1.f);
+}
+
+uint32_t SpotShadowPass::TileSizeFromImportance(float iImportance) const
+{
+	uint32_t wSize = kMinTileSize;
+	while (wSize < kMaxTileSize && static_cast<float>(wSize) < iImportance * kMaxTileSize)
+	{
+		wSize <<= 1;
+	}
+	return wSize;
+}
+
+void SpotShadowPass::GatherCasters(Scene* iScene)
+{
+	mCasters.clear();
+	mCasterBounds.clear();
+
+	for (const auto& wEntityMap : iScene->GetEntities())
+	{
+		Entity* wEntity = wEntityMap.second.get();
+		if (!wEntity->IsDrawable())
+		{
+			continue;
+		}
+		mCasters.push_back(wEntity);
+
+		// Negative radius when the bounds are unknown, the caster is then drawn in every view
+		glm::vec3 wCenter(0.f);
+		float wRadius = -1.f;
+		if (!wEntity->GetWorldBoundingSphere(wCenter, wRadius))
+		{
+			wRadius = -1.f;
+		}
+		mCasterBounds.push_back(glm::vec4(wCenter, wRadius));
+	}
+}
+
+size_t SpotShadowPass::ComputeCasterSignature(const SpotLight* iLight) const
+{
+	size_t wSignature = 0;
+	for (size_t i = 0; i < mCasters.size(); i++)
+	{
+		if (CasterTouchesLight(mCasterBounds[i], iLight))
+		{
+			HashCombine(wSignature, std::hash<const void*>()(mCasters[i]));
+			HashCombine(wSignature, std::hash<uint64_t>()(mCasters[i]->GetTransform()->GetVersion()));
+		}
+	}
+	return wSignature;
+}
+
+bool SpotShadowPass::CasterTouchesLight(const glm::vec4& iBounds, const SpotLight* iLight) const
+{
+	if (iBounds.w < 0.f)
+	{
+		return true;
+	}
+
+	const glm::vec3 wToCaster = glm::vec3(iBounds) - iLight->GetPos();
+	const float wDistance = glm::length(wToCaster);
+	if (wDistance - iBounds.w > iLight->GetRange())
+	{
+		return false;
+	}
+
+	if (wDistance <= iBounds.w)
+	{
+		return true;
+	}
+
+	// The sphere reaches the cone when its angle to the axis, minus its angular radius, is below the cone half angle
+	const float wCosAxis = glm::dot(wToCaster / wDistance, glm::normalize(iLight->GetDirection()));
+	const float wAxisAngle = std::acos(glm::clamp(wCosAxis, -1.f, 1.f));
+	return wAxisAngle - std::asin(iBounds.w / wDistance) <= std::acos(glm::clamp(iLight->GetCutoff(), -1.f, 1.f));
+}
+
+void SpotShadowPass::PrepareTile(const SpotLight* iLight, TileState& ioState)
+{
+	// Keep the light frustum in sync with the light reach
+	PerspectiveFrustum* wFrustum = static_cast<PerspectiveFrustum*>(iLight->GetView()->GetFrustum());
+	wFrustum->SetNearPlane(kShadowNearPlane);
+	wFrustum->SetFarPlane(iLight->GetRange());
+	ioState.ViewProj = wFrustum->ProjectionMatrix() * iLight->GetView()->ViewMatrix();
+
+	const ShadowAtlas::Tile& wTile = ioState.Tile;
+	const float wClearDepth = 1.f;
+	glClearTexSubImage(mAtlasTexture, 0, wTile.X, wTile.Y, 0, wTile.Size, wTile.Size, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &wClearDepth);
+
+	mViewBatch.AddView(ioState.ViewProj, 0, glm::ivec4(wTile.X, wTile.Y, wTile.Size, wTile.Size), iLight->GetPos(), 0.f);
+	mBatchLights.push_back(glm::vec4(iLight->GetPos(), iLight->GetRange()));
+}
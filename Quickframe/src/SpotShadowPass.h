@@ -0,0 +1,139 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "Pass.h"
+#include "ShadowAtlas.h"
+#include "GPUBuffer.h"
+#include "ShadowViewBatch.h"
+
+class Entity;
+class SpotLight;
+
+/**
+ * @brief : Spot light shadows packed in a single depth atlas.
+ * Tiles are sized by the screen coverage of the light volume and allocated from a quadtree.
+ * A tile is only re-rendered when it was (re)allocated, its light changed or a caster inside its range and cone moved,
+ * and at most kTileUpdateBudget tiles are rendered per frame, most important and stalest first.
+*/
+class SpotShadowPass : public Pass
+{
+	/**
+	 * @brief : std430 layout, see BlinnPhongFS.glsl
+	*/
+	struct GPUSpotShadow
+	{
+		glm::mat4 ViewProj;
+		glm::vec4 AtlasRect;	// Offset and scale in UV space
+	};
+
+	struct TileState
+	{
+		ShadowAtlas::Tile Tile;
+		glm::mat4 ViewProj{ 1.f };
+		uint64_t LightVersion = 0;
+		glm::vec3 Direction{ 0.f };
+		float Cutoff = 0.f;
+		float Range = 0.f;
+		size_t CasterSignature = 0;				// Casters reaching the light when the tile was rendered
+		size_t PendingSignature = 0;
+		uint64_t DirtySinceFrame = 0;
+		uint64_t LastSeenFrame = 0;
+		float Importance = 0.f;
+		bool Dirty = true;
+		bool Rendered = false;		// Holds a valid depth map
+	};
+
+public:
+	static constexpr uint32_t kAtlasSize = 4096;
+	static constexpr uint32_t kMinTileSize = 128;
+	static constexpr uint32_t kMaxTileSize = 1024;
+	static constexpr uint32_t kTileUpdateBudget = 4;		// Tiles rendered per frame at most
+
+	SpotShadowPass();
+	~SpotShadowPass();
+
+	void Execute(Scene* iScene) override;
+
+	/**
+	 * @brief : Index of a spot light shadow in the shadow buffer
+	 * @return false if the light has no rendered shadow this frame
+	*/
+	bool GetShadowIndex(uint32_t iLightID, uint32_t& oIndex) const;
+
+	/**
+	 * @brief : Light space matrix and atlas UV rect of a spot shadow, for per-light shading
+	*/
+	bool GetShadow(uint32_t iLightID, glm::mat4& oViewProj, glm::vec4& oAtlasRect) const;
+
+	void BindShadowAtlas(GLenum iTextureUnit);
+	void BindShadowBuffer();
+
+	uint32_t GetTilesRenderedLastFrame() const { return mTilesRendered; }
+
+private:
+	float ComputeImportance(const SpotLight* iLight, Scene* iScene) const;
+	uint32_t TileSizeFromImportance(float iImportance) const;
+
+	/**
+	 * @brief : Collect the drawable entities and their world bounding spheres in mCasters and mCasterBounds
+	*/
+	void GatherCasters(Scene* iScene);
+
+	/**
+	 * @brief : Hash of the casters inside the light range and cone, and of their transform versions
+	*/
+	size_t ComputeCasterSignature(const SpotLight* iLight) const;
+	bool CasterTouchesLight(const glm::vec4& iBounds, const SpotLight* iLight) const;
+
+	/**
+	 * @brief : Compute the light matrix of a tile, clear it and add it to the view batch
+	*/
+	void PrepareTile(const SpotLight* iLight, TileState& ioState);
+
+	ShadowAtlas mAtlas;
+	GLuint mAtlasTexture = 0;
+	GLuint mFramebufferHandle = 0;
+
+	GPUBuffer mShadowBuffer;
+	std::vector<GPUSpotShadow> mGPUShadows;
+	std::unordered_map<uint32_t, uint32_t> mShadowIndices;	// Light ID -> mGPUShadows index
+
+	std::unordered_map<uint32_t, TileState> mTiles;			// Light ID -> atlas tile
+	std::vector<Entity*> mCasters;
+	std::vector<glm::vec4> mCasterBounds;		// World bounding sphere of each caster
+
+	ShadowViewBatch mViewBatch;
+	std::vector<glm::vec4> mBatchLights;		// Position and range of the light of each view
+
+	uint64_t mFrame = 0;
+	uint32_t mTilesRendered = 0;
+};
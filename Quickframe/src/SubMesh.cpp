@@ -23,22 +23,41 @@ SOFTWARE.
 */
 
 #include "SubMesh.h"
+#include "GLStateCache.h"
 
 void SubMesh::Free()
 {
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+
 	for (int i = 0; i < EVertexAttrib::eNumAttribs; i++)
 	{
 		if (mVBO[i])
 		{
+			wStateCache->OnBufferDeleted(mVBO[i]);
 			glDeleteBuffers(1, &mVBO[i]);
+			mVBO[i] = 0;
 		}
 	}
 
+	if (mIBO)
+	{
+		glDeleteBuffers(1, &mIBO);
+		mIBO = 0;
+	}
+
 	if (mVAO)
 	{
+		wStateCache->OnVertexArrayDeleted(mVAO);
 		glDeleteVertexArrays(1, &mVAO);
 		mVAO = 0;
 	}
 
+	if (mPositionVAO)
+	{
+		wStateCache->OnVertexArrayDeleted(mPositionVAO);
+		glDeleteVertexArrays(1, &mPositionVAO);
+		mPositionVAO = 0;
+	}
+
 	delete mMaterial;
 }
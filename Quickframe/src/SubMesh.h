@@ -65,6 +65,11 @@ public:
 	Material* GetMaterial() const { return mMaterial; }
 
 	GLuint VertexArrayHandle() const { return mVAO; }
+
+	/**
+	 * @brief : VAO sourcing only the position stream, for depth only passes
+	*/
+	GLuint PositionVertexArrayHandle() const { return mPositionVAO ? mPositionVAO : mVAO; }
 	GLuint VertexBufferHandle(EVertexAttrib iVertexAttrib ) const { return mVBO[iVertexAttrib]; }
 	GLuint IndexBufferHandle() const { return mIBO; }
 	GLuint IndexCount() const { return mIndexCount; }
@@ -75,6 +80,7 @@ private:
 	Material* mMaterial = nullptr;
 
 	GLuint mVAO = 0;
+	GLuint mPositionVAO = 0;
 	GLuint mIBO = 0;
 	GLuint mVBO[EVertexAttrib::eNumAttribs] = { 0 };
 	GLuint mIndexCount = 0;
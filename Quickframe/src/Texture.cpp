@@ -22,68 +22,156 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <algorithm>
+#include <cmath>
 #include <stb_image.h>
 #include <spdlog/spdlog.h>
 #include "Texture.h"
+#include "GLStateCache.h"
+#include "ThreadPool.h"
 
-Texture::Texture(GLenum iTextureTarget)
-	:mTextureTarget(iTextureTarget)
+Texture::Texture(GLenum iTextureTarget, EUsage iUsage)
+	:mTextureTarget(iTextureTarget),
+	mUsage(iUsage)
 {
 }
 
 Texture::~Texture()
 {
+	if (!mResident)
+	{
+		return;
+	}
+
+	GLStateCache::GetInstance()->OnTextureDeleted(mTextureHandle);
 	glDeleteTextures(1, &mTextureHandle);
 }
 
+void Texture::SetPlaceholder(const std::string& iPath, const Texture& iPlaceholder)
+{
+	mPath = iPath;
+	mPlaceholder = &iPlaceholder;
+	mResident = false;
+}
+
+void Texture::SetArrayLocation(int iArrayIndex, int iArrayLayer, GLuint iViewHandle)
+{
+	GLStateCache::GetInstance()->OnTextureDeleted(mTextureHandle);
+	glDeleteTextures(1, &mTextureHandle);
+
+	mTextureHandle = iViewHandle;
+	mArrayIndex = iArrayIndex;
+	mArrayLayer = iArrayLayer;
+}
+
+void Texture::MakeResident(GLuint iTextureHandle, int iWidth, int iHeight, int iBpp, GLenum iInternalFormat, size_t iByteSize)
+{
+	mTextureHandle = iTextureHandle;
+	mWidth = iWidth;
+	mHeight = iHeight;
+	mBpp = iBpp;
+	mInternalFormat = iInternalFormat;
+	mByteSize = iByteSize;
+	mResident = true;
+
+	spdlog::info("Texture {0:s} streamed to Device (Width : {1:d} | Height : {2:d} )",
+		mPath.c_str(), mWidth, mHeight);
+}
+
+GLenum Texture::PixelDataFormat(int iBpp)
+{
+	switch (iBpp)
+	{
+	case 1:
+		return GL_RED;
+	case 2:
+		return GL_RG;
+	case 4:
+		return GL_RGBA;
+	default:
+		return GL_RGB;
+	}
+}
+
+GLenum Texture::SizedInternalFormat(int iBpp)
+{
+	switch (iBpp)
+	{
+	case 1:
+		return GL_R8;
+	case 2:
+		return GL_RG8;
+	case 4:
+		return GL_RGBA8;
+	default:
+		return GL_RGB8;
+	}
+}
+
+GLsizei Texture::MipLevelCount(int iWidth, int iHeight)
+{
+	return static_cast<GLsizei>(std::floor(std::log2(std::max(std::max(iWidth, iHeight), 1)))) + 1;
+}
+
+size_t Texture::ComputeByteSize(int iWidth, int iHeight, GLsizei iLevelCount, int iBytesPerTexel)
+{
+	size_t wSize = 0;
+	for (GLsizei i = 0; i < iLevelCount; i++)
+	{
+		wSize += static_cast<size_t>(std::max(1, iWidth >> i)) * std::max(1, iHeight >> i) * iBytesPerTexel;
+	}
+	return wSize;
+}
+
 bool Texture::Load(const std::string& iPath)
 {
 	mPath = iPath;
 	stbi_set_flip_vertically_on_load(1);
 
-	// Load texture to Host Memory
-	unsigned char* wTextureData = stbi_load(mPath.c_str(), &mWidth, &mHeight, &mBpp, 0);
+	// Load texture to Host Memory, scalar maps keep one channel even when saved as grey RGB
+	const int wRequiredChannels = mUsage == EUsage::eScalar ? 1 : 0;
+	unsigned char* wTextureData = stbi_load(mPath.c_str(), &mWidth, &mHeight, &mBpp, wRequiredChannels);
 	if (!wTextureData)
 	{
 		spdlog::critical("Failed to load texture {0:s} : {1:s}", mPath.c_str(), stbi_failure_reason());
 		return false;
 	}
 
-	// Load Texture to Device Memory
-	glGenTextures(1, &mTextureHandle);
-	glBindTexture(mTextureTarget, mTextureHandle);
-	
-	GLuint wPixelDataFormat = GL_RGB;
-	switch (mBpp)
+	if (wRequiredChannels)
 	{
-	case 1:
-		wPixelDataFormat = GL_R8;
-		break;
-	case 2:
-		wPixelDataFormat = GL_RG;
-		break;
-	case 3:
-		wPixelDataFormat = GL_RGB;
-		break;
-	case 4:
-		wPixelDataFormat = GL_RGBA;
-		break;
+		mBpp = wRequiredChannels;
 	}
-	if (mTextureTarget == GL_TEXTURE_2D)
+
+	// Load Texture to Device Memory, one byte per source channel
+	glGenTextures(1, &mTextureHandle);
+	GLStateCache::GetInstance()->BindTexture(GL_TEXTURE0, mTextureTarget, mTextureHandle);
+
+	const GLsizei wLevelCount = MipLevelCount(mWidth, mHeight);
+	mInternalFormat = SizedInternalFormat(mBpp);
+	glTexStorage2D(mTextureTarget, wLevelCount, mInternalFormat, mWidth, mHeight);
+
+	// Rows of 1 and 3 channel images aren't 4 bytes aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(mTextureTarget, 0, 0, 0, mWidth, mHeight, PixelDataFormat(mBpp), GL_UNSIGNED_BYTE, wTextureData);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glGenerateMipmap(mTextureTarget);
+	mByteSize = ComputeByteSize(mWidth, mHeight, wLevelCount, mBpp);
+
+	// Grey color maps are stored as R8 / RG8 (grey, alpha), spread the grey to RGB when sampled
+	if (mUsage == EUsage::eColor && mBpp <= 2)
 	{
-		glTexImage2D(mTextureTarget, 0, GL_RGB, mWidth, mHeight, 0, wPixelDataFormat, GL_UNSIGNED_BYTE, wTextureData);
+		const GLint wSwizzle[4] = { GL_RED, GL_RED, GL_RED, mBpp == 2 ? GL_GREEN : GL_ONE };
+		glTexParameteriv(mTextureTarget, GL_TEXTURE_SWIZZLE_RGBA, wSwizzle);
 	}
-	
-	glGenerateMipmap(GL_TEXTURE_2D);
 
 	// Sampler Parameters
 	glTexParameteri(mTextureTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	glTexParameteri(mTextureTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(mTextureTarget, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(mTextureTarget, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	
 
-	glBindTexture(mTextureTarget, 0);	
+	GLStateCache::GetInstance()->BindTexture(GL_TEXTURE0, mTextureTarget, 0);
 
 	spdlog::info("Texture {0:s} Loaded to Device (Width : {1:d} | Height : {2:d} )",
 		mPath.c_str(), mWidth, mHeight);
@@ -96,50 +184,76 @@ bool Texture::Load(const std::string& iPath)
 bool Texture::LoadCubemap(const std::vector<std::string>& iPaths)
 {
 	mPath = iPaths[0];
-	stbi_set_flip_vertically_on_load(0);
 
-	glGenTextures(1, &mTextureHandle);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, mTextureHandle);
-
-	for (unsigned int i = 0; i < iPaths.size(); i++)
+	struct Face
 	{
-		unsigned char* wData = stbi_load(iPaths[i].c_str(), &mWidth, &mHeight, &mBpp, 0);
+		unsigned char* Data = nullptr;
+		int Width = 0;
+		int Height = 0;
+		int Bpp = 0;
+	};
 
-		if (!wData)
+	// Faces are decoded in parallel, only the uploads need the context
+	std::vector<Face> wFaces(iPaths.size());
+	ThreadPool::GetInstance()->ParallelFor(static_cast<uint32_t>(iPaths.size()),
+		[&](uint32_t iBegin, uint32_t iEnd, uint32_t)
 		{
-			spdlog::critical("Failed to load texture {0:s} : {1:s}", iPaths[i].c_str(), stbi_failure_reason());
-			return false;
-		}
+			stbi_set_flip_vertically_on_load_thread(0);
+			for (uint32_t i = iBegin; i < iEnd; i++)
+			{
+				Face& wFace = wFaces[i];
+				wFace.Data = stbi_load(iPaths[i].c_str(), &wFace.Width, &wFace.Height, &wFace.Bpp, 0);
+				if (!wFace.Data)
+				{
+					spdlog::critical("Failed to load texture {0:s} : {1:s}", iPaths[i].c_str(), stbi_failure_reason());
+				}
+			}
+		});
 
-		GLuint wPixelDataFormat = GL_RGB;
-		switch (mBpp)
+	bool wValid = true;
+	for (const Face& wFace : wFaces)
+	{
+		wValid = wValid && wFace.Data;
+	}
+
+	if (!wValid)
+	{
+		for (const Face& wFace : wFaces)
 		{
-		case 1:
-			wPixelDataFormat = GL_RED;
-		case 2:
-			wPixelDataFormat = GL_RG;
-			break;
-		case 3:
-			wPixelDataFormat = GL_RGB;
-			break;
-		case 4:
-			wPixelDataFormat = GL_RGBA;
-			break;
+			stbi_image_free(wFace.Data);
 		}
+		return false;
+	}
 
-		glTexImage2D(
+	glGenTextures(1, &mTextureHandle);
+	GLStateCache::GetInstance()->BindTexture(GL_TEXTURE0, GL_TEXTURE_CUBE_MAP, mTextureHandle);
+
+	// Every face shares the storage allocated from the first one
+	mWidth = wFaces[0].Width;
+	mHeight = wFaces[0].Height;
+	mBpp = wFaces[0].Bpp;
+	mInternalFormat = SizedInternalFormat(mBpp);
+	glTexStorage2D(GL_TEXTURE_CUBE_MAP, 1, mInternalFormat, mWidth, mHeight);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (unsigned int i = 0; i < wFaces.size(); i++)
+	{
+		glTexSubImage2D(
 			GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
 			0,
-			GL_RGB,
+			0,
+			0,
 			mWidth,
 			mHeight,
-			0,
-			wPixelDataFormat,
+			PixelDataFormat(wFaces[i].Bpp),
 			GL_UNSIGNED_BYTE,
-			wData);
+			wFaces[i].Data);
 
-		stbi_image_free(wData);
+		stbi_image_free(wFaces[i].Data);
 	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	mByteSize = ComputeByteSize(mWidth, mHeight, 1, mBpp) * iPaths.size();
 
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -155,7 +269,6 @@ bool Texture::LoadCubemap(const std::vector<std::string>& iPaths)
 
 void Texture::Bind(GLenum iTextureUnit)
 {
-	glActiveTexture(iTextureUnit);
-	glBindTexture(mTextureTarget, mTextureHandle);
+	GLStateCache::GetInstance()->BindTexture(iTextureUnit, mTextureTarget, GetHandle());
 }
 
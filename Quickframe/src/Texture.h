@@ -26,12 +26,23 @@ SOFTWARE.
 
 #include <glad/glad.h>
 #include <string>
+#include <vector>
 
 
 class Texture
 {
 public:
-	Texture(GLenum iTextureTarget);
+	/**
+	 * @brief : What the texels hold, decides the compressed format and how mips are filtered
+	*/
+	enum class EUsage
+	{
+		eColor,			// sRGB encoded color, optional alpha
+		eNormal,		// Tangent space normal, only X and Y are stored
+		eScalar			// Single channel data (specular exponent ...)
+	};
+
+	Texture(GLenum iTextureTarget, EUsage iUsage = EUsage::eColor);
 	~Texture();
 
 	/**
@@ -47,6 +58,45 @@ public:
 	*/
 	bool LoadCubemap(const std::vector<std::string>& iPath);
 
+	/**
+	 * @brief : Sample another texture until MakeResident is called, used while the file is streamed.
+	 * iPlaceholder must outlive the texture
+	*/
+	void SetPlaceholder(const std::string& iPath, const Texture& iPlaceholder);
+
+	/**
+	 * @brief : Swap the placeholder for the streamed texture, takes ownership of iTextureHandle
+	 * @param iBpp : Channels of the source image
+	 * @param iByteSize : Size of the storage, every level included
+	*/
+	void MakeResident(GLuint iTextureHandle, int iWidth, int iHeight, int iBpp, GLenum iInternalFormat, size_t iByteSize);
+
+	/**
+	 * @brief : Move the texels to a layer of a texture array, the own storage is released.
+	 * @param iViewHandle : View of the layer, sampled as a plain 2D texture, ownership is taken
+	*/
+	void SetArrayLocation(int iArrayIndex, int iArrayLayer, GLuint iViewHandle);
+
+	/**
+	 * @brief : Pixel transfer format of 8 bit images with iBpp channels
+	*/
+	static GLenum PixelDataFormat(int iBpp);
+
+	/**
+	 * @brief : Sized internal format of 8 bit images with iBpp channels, one byte per channel
+	*/
+	static GLenum SizedInternalFormat(int iBpp);
+
+	/**
+	 * @brief : Number of levels of a full mip chain
+	*/
+	static GLsizei MipLevelCount(int iWidth, int iHeight);
+
+	/**
+	 * @brief : Bytes of iLevelCount levels of an uncompressed image
+	*/
+	static size_t ComputeByteSize(int iWidth, int iHeight, GLsizei iLevelCount, int iBytesPerTexel);
+
 	/**
 	 * @brief : Bind the texture object to a specific slot in the shader
 	 * @param iTextureUnit : Slot number
@@ -54,10 +104,33 @@ public:
 	void Bind(GLenum iTextureUnit);
 
 	const std::string& GetPath() { return mPath; }
+	GLuint GetHandle() const { return mResident ? mTextureHandle : mPlaceholder->GetHandle(); }
+	GLenum GetTarget() const { return mTextureTarget; }
+	EUsage GetUsage() const { return mUsage; }
+	GLenum GetInternalFormat() const { return mInternalFormat; }
+	bool IsResident() const { return mResident; }
+
+	/**
+	 * @brief : Device memory of the texture storage, every level and face included, 0 until resident
+	*/
+	size_t GetByteSize() const { return mResident ? mByteSize : 0; }
+
+	/**
+	 * @brief : Array and layer in TextureArrayPool, -1 when the texture has its own storage
+	*/
+	int GetArrayIndex() const { return mResident ? mArrayIndex : mPlaceholder->GetArrayIndex(); }
+	int GetArrayLayer() const { return mResident ? mArrayLayer : mPlaceholder->GetArrayLayer(); }
 
 private:
 	GLuint mTextureHandle = 0;
 	GLenum mTextureTarget;
+	EUsage mUsage;
+	GLenum mInternalFormat = 0;
+	size_t mByteSize = 0;
+	bool mResident = true;			// False while the placeholder is sampled
+	const Texture* mPlaceholder = nullptr;
+	int mArrayIndex = -1;
+	int mArrayLayer = -1;
 	std::string mPath;
 	int mWidth = 0;
 	int mHeight = 0;
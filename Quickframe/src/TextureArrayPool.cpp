@@ -0,0 +1,223 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+#include "TextureArrayPool.h"
+#include "Texture.h"
+#include "GLStateCache.h"
+#include "Defines.h"
+
+TextureArrayPool* TextureArrayPool::mTextureArrayPool = nullptr;
+
+TextureArrayPool* TextureArrayPool::GetInstance()
+{
+	if (!mTextureArrayPool)
+	{
+		mTextureArrayPool = new TextureArrayPool();
+	}
+
+	return mTextureArrayPool;
+}
+
+TextureArrayPool::~TextureArrayPool()
+{
+	// The layer views keep the storage alive until their textures are deleted
+	for (TextureArray& wArray : mArrays)
+	{
+		GLStateCache::GetInstance()->OnTextureDeleted(wArray.Handle);
+		glDeleteTextures(1, &wArray.Handle);
+	}
+}
+
+bool TextureArrayPool::Add(Texture* iTexture)
+{
+	if (iTexture->GetTarget() != GL_TEXTURE_2D || !iTexture->IsResident() || iTexture->GetArrayIndex() >= 0)
+	{
+		return false;
+	}
+
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	wStateCache->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, iTexture->GetHandle());
+
+	// Views can only be made of immutable storage
+	GLint wLevelCount = 0;
+	GLint wWidth = 0;
+	GLint wHeight = 0;
+	GLint wSwizzle[4] = { 0 };
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_LEVELS, &wLevelCount);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &wWidth);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &wHeight);
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, wSwizzle);
+	if (wLevelCount == 0)
+	{
+		return false;
+	}
+
+	const GLenum wInternalFormat = iTexture->GetInternalFormat();
+	auto wArrayIter = std::find_if(mArrays.begin(), mArrays.end(), [&](const TextureArray& iArray)
+		{
+			return iArray.Width == wWidth && iArray.Height == wHeight && iArray.LevelCount == wLevelCount &&
+				iArray.InternalFormat == wInternalFormat && std::equal(wSwizzle, wSwizzle + 4, iArray.Swizzle);
+		});
+
+	if (wArrayIter == mArrays.end())
+	{
+		if (mArrays.size() >= TEXTURE_ARRAY_COUNT)
+		{
+			return false;
+		}
+
+		TextureArray wArray;
+		wArray.Width = wWidth;
+		wArray.Height = wHeight;
+		wArray.LevelCount = wLevelCount;
+		wArray.InternalFormat = wInternalFormat;
+		std::copy(wSwizzle, wSwizzle + 4, wArray.Swizzle);
+		mArrays.push_back(wArray);
+		wArrayIter = mArrays.end() - 1;
+		Resize(static_cast<uint32_t>(mArrays.size() - 1), kInitialLayerCount);
+	}
+
+	const uint32_t wArrayIndex = static_cast<uint32_t>(wArrayIter - mArrays.begin());
+	TextureArray& wArray = *wArrayIter;
+
+	auto wFreeLayer = std::find(wArray.Layers.begin(), wArray.Layers.end(), nullptr);
+	GLsizei wLayer = static_cast<GLsizei>(wFreeLayer - wArray.Layers.begin());
+	if (wFreeLayer == wArray.Layers.end())
+	{
+		if (wLayer == wArray.Capacity)
+		{
+			if (mMaxLayerCount == 0)
+			{
+				glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &mMaxLayerCount);
+			}
+
+			if (wArray.Capacity >= mMaxLayerCount)
+			{
+				return false;
+			}
+
+			Resize(wArrayIndex, std::min(wArray.Capacity * 2, mMaxLayerCount));
+		}
+		wArray.Layers.push_back(nullptr);
+	}
+
+	for (GLsizei i = 0; i < wArray.LevelCount; i++)
+	{
+		glCopyImageSubData(iTexture->GetHandle(), GL_TEXTURE_2D, i, 0, 0, 0, wArray.Handle, GL_TEXTURE_2D_ARRAY, i, 0, 0, wLayer,
+			std::max(1, wArray.Width >> i), std::max(1, wArray.Height >> i), 1);
+	}
+
+	wArray.Layers[wLayer] = iTexture;
+	CreateLayerView(wArrayIndex, wLayer);
+	mPackedCount++;
+	return true;
+}
+
+void TextureArrayPool::Remove(const Texture* iTexture)
+{
+	const int wArrayIndex = iTexture->IsResident() ? iTexture->GetArrayIndex() : -1;
+	if (wArrayIndex < 0)
+	{
+		return;
+	}
+
+	mArrays[wArrayIndex].Layers[iTexture->GetArrayLayer()] = nullptr;
+	mPackedCount--;
+}
+
+void TextureArrayPool::Bind() const
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	for (uint32_t i = 0; i < mArrays.size(); i++)
+	{
+		wStateCache->BindTexture(TEXTURE_ARRAY_0_TEXTURE_UNIT + i, GL_TEXTURE_2D_ARRAY, mArrays[i].Handle);
+	}
+}
+
+void TextureArrayPool::Resize(uint32_t iArrayIndex, GLsizei iCapacity)
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	TextureArray& wArray = mArrays[iArrayIndex];
+
+	GLuint wHandle = 0;
+	glGenTextures(1, &wHandle);
+	wStateCache->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D_ARRAY, wHandle);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, wArray.LevelCount, wArray.InternalFormat, wArray.Width, wArray.Height, iCapacity);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_RGBA, wArray.Swizzle);
+
+	if (wArray.Handle)
+	{
+		// Every layer at once, free layers included
+		const GLsizei wLayerCount = static_cast<GLsizei>(wArray.Layers.size());
+		for (GLsizei i = 0; i < wArray.LevelCount; i++)
+		{
+			glCopyImageSubData(wArray.Handle, GL_TEXTURE_2D_ARRAY, i, 0, 0, 0, wHandle, GL_TEXTURE_2D_ARRAY, i, 0, 0, 0,
+				std::max(1, wArray.Width >> i), std::max(1, wArray.Height >> i), wLayerCount);
+		}
+
+		// The old storage is released once the last view of it is replaced
+		wStateCache->OnTextureDeleted(wArray.Handle);
+		glDeleteTextures(1, &wArray.Handle);
+	}
+
+	wArray.Handle = wHandle;
+	wArray.Capacity = iCapacity;
+
+	for (GLsizei i = 0; i < static_cast<GLsizei>(wArray.Layers.size()); i++)
+	{
+		if (wArray.Layers[i])
+		{
+			CreateLayerView(iArrayIndex, i);
+		}
+	}
+
+	spdlog::info("Texture array {0:d} ({1:d} x {2:d}, format 0x{3:x}) resized to {4:d} layers",
+		iArrayIndex, wArray.Width, wArray.Height, wArray.InternalFormat, iCapacity);
+}
+
+void TextureArrayPool::CreateLayerView(uint32_t iArrayIndex, GLsizei iLayer)
+{
+	const TextureArray& wArray = mArrays[iArrayIndex];
+
+	GLuint wView = 0;
+	glGenTextures(1, &wView);
+	glTextureView(wView, GL_TEXTURE_2D, wArray.Handle, wArray.InternalFormat, 0, wArray.LevelCount, iLayer, 1);
+
+	// Views don't inherit the sampling state
+	GLStateCache::GetInstance()->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, wView);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, wArray.Swizzle);
+
+	wArray.Layers[iLayer]->SetArrayLocation(static_cast<int>(iArrayIndex), static_cast<int>(iLayer), wView);
+}
@@ -0,0 +1,101 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+
+class Texture;
+
+/**
+ * @brief : Packs the material textures into GL_TEXTURE_2D_ARRAYs, one array per size, format, level count
+ * and swizzle, so draws using different textures no longer need to rebind them.
+ * The texels are copied to a free layer and the texture keeps a view of that layer as its handle, there is no
+ * second copy in VRAM. Arrays start small and double when full, the views are recreated on the new storage.
+ * Shaders reach a layer through its (array, layer) pair, see MaterialTable.
+ * Textures that don't fit in the TEXTURE_ARRAY_COUNT arrays keep their own storage and are bound per draw.
+*/
+class TextureArrayPool
+{
+	struct TextureArray
+	{
+		GLuint Handle = 0;
+		GLsizei Width = 0;
+		GLsizei Height = 0;
+		GLsizei LevelCount = 0;
+		GLenum InternalFormat = 0;
+		GLint Swizzle[4] = { 0 };
+		GLsizei Capacity = 0;
+		std::vector<Texture*> Layers;		// nullptr for the free layers
+	};
+
+public:
+	static constexpr GLsizei kInitialLayerCount = 4;
+
+	TextureArrayPool(TextureArrayPool& iOther) = delete;
+	void operator=(const TextureArrayPool&) = delete;
+
+	static TextureArrayPool* GetInstance();
+
+	/**
+	 * @brief : Move a resident 2D texture with immutable storage to an array layer, main thread only
+	 * @return whether the texture is packed
+	*/
+	bool Add(Texture* iTexture);
+
+	/**
+	 * @brief : Free the layer of a texture about to be deleted
+	*/
+	void Remove(const Texture* iTexture);
+
+	/**
+	 * @brief : Bind every array to its unit, from TEXTURE_ARRAY_0_TEXTURE_UNIT
+	*/
+	void Bind() const;
+
+	uint32_t GetArrayCount() const { return static_cast<uint32_t>(mArrays.size()); }
+	uint32_t GetPackedCount() const { return mPackedCount; }
+
+private:
+	TextureArrayPool() {}
+	~TextureArrayPool();
+
+	/**
+	 * @brief : Reallocate an array with iCapacity layers and move the packed textures to it
+	*/
+	void Resize(uint32_t iArrayIndex, GLsizei iCapacity);
+
+	/**
+	 * @brief : New view of the layer holding a texture, given to the texture
+	*/
+	void CreateLayerView(uint32_t iArrayIndex, GLsizei iLayer);
+
+	static TextureArrayPool* mTextureArrayPool;
+
+	std::vector<TextureArray> mArrays;
+	uint32_t mPackedCount = 0;
+	GLint mMaxLayerCount = 0;
+};
@@ -0,0 +1,661 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#include <stb_image.h>
+#include <spdlog/spdlog.h>
+
+#include "TextureCooker.h"
+#include "ThreadPool.h"
+
+using namespace std::chrono;
+
+namespace
+{
+	// Written in the DDS reserved fields, other files and older cooks are recooked
+	constexpr uint32_t kCookTag = 0x4B434651;		// "QFCK"
+	constexpr uint32_t kCookVersion = 1;
+
+	constexpr uint32_t kDDSMagic = 0x20534444;		// "DDS "
+	constexpr uint32_t kDX10FourCC = 0x30315844;	// "DX10"
+
+	struct DDSPixelFormat
+	{
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t FourCC;
+		uint32_t RGBBitCount;
+		uint32_t RBitMask;
+		uint32_t GBitMask;
+		uint32_t BBitMask;
+		uint32_t ABitMask;
+	};
+
+	struct DDSHeader
+	{
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t Height;
+		uint32_t Width;
+		uint32_t PitchOrLinearSize;
+		uint32_t Depth;
+		uint32_t MipMapCount;
+		uint32_t Reserved1[11];
+		DDSPixelFormat PixelFormat;
+		uint32_t Caps;
+		uint32_t Caps2;
+		uint32_t Caps3;
+		uint32_t Caps4;
+		uint32_t Reserved2;
+	};
+
+	struct DDSHeaderDX10
+	{
+		uint32_t DXGIFormat;
+		uint32_t ResourceDimension;
+		uint32_t MiscFlag;
+		uint32_t ArraySize;
+		uint32_t MiscFlags2;
+	};
+
+	static_assert(sizeof(DDSHeader) == 124, "DDS header must be 124 bytes");
+
+	struct BlockFormat
+	{
+		GLenum InternalFormat;
+		uint32_t DXGIFormat;
+		uint32_t BlockBytes;
+	};
+
+	const BlockFormat kBlockFormats[] =
+	{
+		{ GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 71, 8 },		// BC1_UNORM
+		{ GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 77, 16 },	// BC3_UNORM
+		{ GL_COMPRESSED_RED_RGTC1, 80, 8 },				// BC4_UNORM
+		{ GL_COMPRESSED_RG_RGTC2, 83, 16 }				// BC5_UNORM
+	};
+
+	const BlockFormat* FindBlockFormat(GLenum iInternalFormat)
+	{
+		for (const BlockFormat& wFormat : kBlockFormats)
+		{
+			if (wFormat.InternalFormat == iInternalFormat)
+			{
+				return &wFormat;
+			}
+		}
+		return nullptr;
+	}
+
+	float SrgbToLinear(float iValue)
+	{
+		return iValue <= 0.04045f ? iValue / 12.92f : std::pow((iValue + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSrgb(float iValue)
+	{
+		return iValue <= 0.0031308f ? iValue * 12.92f : 1.055f * std::pow(iValue, 1.0f / 2.4f) - 0.055f;
+	}
+
+	const float* GetSrgbToLinearTable()
+	{
+		struct SrgbTable
+		{
+			SrgbTable()
+			{
+				for (int i = 0; i < 256; i++)
+				{
+					Values[i] = SrgbToLinear(i / 255.0f);
+				}
+			}
+			float Values[256];
+		};
+
+		static const SrgbTable sTable;
+		return sTable.Values;
+	}
+
+	unsigned char ToUnorm8(float iValue)
+	{
+		return static_cast<unsigned char>(std::min(std::max(iValue, 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+
+	uint16_t PackRGB565(const float iColor[3])
+	{
+		const uint32_t wR = static_cast<uint32_t>(std::min(std::max(iColor[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+		const uint32_t wG = static_cast<uint32_t>(std::min(std::max(iColor[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+		const uint32_t wB = static_cast<uint32_t>(std::min(std::max(iColor[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+		return static_cast<uint16_t>((wR << 11) | (wG << 5) | wB);
+	}
+
+	void UnpackRGB565(uint16_t iColor, int oColor[3])
+	{
+		const int wR = (iColor >> 11) & 31;
+		const int wG = (iColor >> 5) & 63;
+		const int wB = iColor & 31;
+		oColor[0] = (wR << 3) | (wR >> 2);
+		oColor[1] = (wG << 2) | (wG >> 4);
+		oColor[2] = (wB << 3) | (wB >> 2);
+	}
+
+	/**
+	 * @brief : BC1 color block, endpoints are the extremes of the colors along their principal axis
+	*/
+	void EncodeColorBlock(const unsigned char iBlock[16][4], unsigned char* oOut)
+	{
+		float wMean[3] = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				wMean[c] += iBlock[i][c] / 16.0f;
+			}
+		}
+
+		float wCovariance[6] = { 0.0f };		// xx xy xz yy yz zz
+		for (int i = 0; i < 16; i++)
+		{
+			const float wR = iBlock[i][0] - wMean[0];
+			const float wG = iBlock[i][1] - wMean[1];
+			const float wB = iBlock[i][2] - wMean[2];
+			wCovariance[0] += wR * wR;
+			wCovariance[1] += wR * wG;
+			wCovariance[2] += wR * wB;
+			wCovariance[3] += wG * wG;
+			wCovariance[4] += wG * wB;
+			wCovariance[5] += wB * wB;
+		}
+
+		// Power iteration, a few steps are enough for 16 samples
+		float wAxis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int wIteration = 0; wIteration < 4; wIteration++)
+		{
+			const float wX = wCovariance[0] * wAxis[0] + wCovariance[1] * wAxis[1] + wCovariance[2] * wAxis[2];
+			const float wY = wCovariance[1] * wAxis[0] + wCovariance[3] * wAxis[1] + wCovariance[4] * wAxis[2];
+			const float wZ = wCovariance[2] * wAxis[0] + wCovariance[4] * wAxis[1] + wCovariance[5] * wAxis[2];
+			const float wLength = std::max(std::max(std::fabs(wX), std::fabs(wY)), std::fabs(wZ));
+			if (wLength < 1e-6f)
+			{
+				break;
+			}
+			wAxis[0] = wX / wLength;
+			wAxis[1] = wY / wLength;
+			wAxis[2] = wZ / wLength;
+		}
+
+		float wMinT = 0.0f;
+		float wMaxT = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			const float wT = (iBlock[i][0] - wMean[0]) * wAxis[0] + (iBlock[i][1] - wMean[1]) * wAxis[1] + (iBlock[i][2] - wMean[2]) * wAxis[2];
+			wMinT = std::min(wMinT, wT);
+			wMaxT = std::max(wMaxT, wT);
+		}
+
+		const float wAxisLengthSq = wAxis[0] * wAxis[0] + wAxis[1] * wAxis[1] + wAxis[2] * wAxis[2];
+		float wMax[3];
+		float wMin[3];
+		for (int c = 0; c < 3; c++)
+		{
+			wMax[c] = wMean[c] + wAxis[c] * wMaxT / std::max(wAxisLengthSq, 1e-6f);
+			wMin[c] = wMean[c] + wAxis[c] * wMinT / std::max(wAxisLengthSq, 1e-6f);
+		}
+
+		uint16_t wColor0 = PackRGB565(wMax);
+		uint16_t wColor1 = PackRGB565(wMin);
+
+		// color0 > color1 selects the 4 color mode, equal endpoints use index 0 everywhere
+		uint32_t wIndices = 0;
+		if (wColor0 < wColor1)
+		{
+			std::swap(wColor0, wColor1);
+		}
+
+		if (wColor0 != wColor1)
+		{
+			int wPalette[4][3];
+			UnpackRGB565(wColor0, wPalette[0]);
+			UnpackRGB565(wColor1, wPalette[1]);
+			for (int c = 0; c < 3; c++)
+			{
+				wPalette[2][c] = (2 * wPalette[0][c] + wPalette[1][c]) / 3;
+				wPalette[3][c] = (wPalette[0][c] + 2 * wPalette[1][c]) / 3;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int wBestIndex = 0;
+				int wBestDistance = INT_MAX;
+				for (int p = 0; p < 4; p++)
+				{
+					int wDistance = 0;
+					for (int c = 0; c < 3; c++)
+					{
+						const int wDelta = iBlock[i][c] - wPalette[p][c];
+						wDistance += wDelta * wDelta;
+					}
+					if (wDistance < wBestDistance)
+					{
+						wBestDistance = wDistance;
+						wBestIndex = p;
+					}
+				}
+				wIndices |= static_cast<uint32_t>(wBestIndex) << (2 * i);
+			}
+		}
+
+		oOut[0] = wColor0 & 0xFF;
+		oOut[1] = wColor0 >> 8;
+		oOut[2] = wColor1 & 0xFF;
+		oOut[3] = wColor1 >> 8;
+		for (int i = 0; i < 4; i++)
+		{
+			oOut[4 + i] = (wIndices >> (8 * i)) & 0xFF;
+		}
+	}
+
+	/**
+	 * @brief : BC4 block (also the alpha of BC3 and each channel of BC5), 8 values between the extremes
+	*/
+	void EncodeScalarBlock(const unsigned char iValues[16], unsigned char* oOut)
+	{
+		unsigned char wMin = 255;
+		unsigned char wMax = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			wMin = std::min(wMin, iValues[i]);
+			wMax = std::max(wMax, iValues[i]);
+		}
+
+		// value0 > value1 selects the 8 values mode, index 0 is value0, 1 is value1, 2-7 interpolate from value0
+		oOut[0] = wMax;
+		oOut[1] = wMin;
+
+		uint64_t wIndices = 0;
+		if (wMax > wMin)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				const int wStep = static_cast<int>((iValues[i] - wMin) * 7.0f / (wMax - wMin) + 0.5f);
+				const uint64_t wIndex = wStep == 7 ? 0 : (wStep == 0 ? 1 : 8 - wStep);
+				wIndices |= wIndex << (3 * i);
+			}
+		}
+
+		for (int i = 0; i < 6; i++)
+		{
+			oOut[2 + i] = (wIndices >> (8 * i)) & 0xFF;
+		}
+	}
+
+	/**
+	 * @brief : Encode the block rows [iFirstRow, iEndRow[ of an RGBA8 image
+	*/
+	void EncodeBlockRows(const unsigned char* iPixels, int iWidth, int iHeight, GLenum iFormat, int iFirstRow, int iEndRow,
+		unsigned char* oBlocks)
+	{
+		const int wBlocksX = (iWidth + 3) / 4;
+		const uint32_t wBlockBytes = FindBlockFormat(iFormat)->BlockBytes;
+
+		unsigned char wBlock[16][4];
+		unsigned char wChannel[16];
+		for (int wBlockY = iFirstRow; wBlockY < iEndRow; wBlockY++)
+		{
+			for (int wBlockX = 0; wBlockX < wBlocksX; wBlockX++)
+			{
+				// Edge blocks repeat the last row and column
+				for (int i = 0; i < 16; i++)
+				{
+					const int wX = std::min(wBlockX * 4 + (i & 3), iWidth - 1);
+					const int wY = std::min(wBlockY * 4 + (i >> 2), iHeight - 1);
+					memcpy(wBlock[i], &iPixels[(static_cast<size_t>(wY) * iWidth + wX) * 4], 4);
+				}
+
+				unsigned char* wOut = oBlocks + (static_cast<size_t>(wBlockY) * wBlocksX + wBlockX) * wBlockBytes;
+				switch (iFormat)
+				{
+				case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+					EncodeColorBlock(wBlock, wOut);
+					break;
+				case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+					for (int i = 0; i < 16; i++)
+					{
+						wChannel[i] = wBlock[i][3];
+					}
+					EncodeScalarBlock(wChannel, wOut);
+					EncodeColorBlock(wBlock, wOut + 8);
+					break;
+				case GL_COMPRESSED_RED_RGTC1:
+					for (int i = 0; i < 16; i++)
+					{
+						wChannel[i] = wBlock[i][0];
+					}
+					EncodeScalarBlock(wChannel, wOut);
+					break;
+				case GL_COMPRESSED_RG_RGTC2:
+					for (int c = 0; c < 2; c++)
+					{
+						for (int i = 0; i < 16; i++)
+						{
+							wChannel[i] = wBlock[i][c];
+						}
+						EncodeScalarBlock(wChannel, wOut + 8 * c);
+					}
+					break;
+				default:
+					break;
+				}
+			}
+		}
+	}
+}
+
+bool TextureCooker::GetCooked(const std::string& iSourcePath, Texture::EUsage iUsage, CookedTexture& oTexture)
+{
+	const std::string wCookedPath = GetCookedPath(iSourcePath);
+	if (IsUpToDate(wCookedPath, iSourcePath) && ReadDDS(wCookedPath, iUsage, oTexture))
+	{
+		return true;
+	}
+
+	auto wClockStart = high_resolution_clock::now();
+
+	// GL expects the bottom row first
+	stbi_set_flip_vertically_on_load_thread(1);
+	int wWidth = 0;
+	int wHeight = 0;
+	int wChannels = 0;
+	unsigned char* wPixels = stbi_load(iSourcePath.c_str(), &wWidth, &wHeight, &wChannels, 4);
+	if (!wPixels)
+	{
+		spdlog::critical("Failed to load texture {0:s} : {1:s}", iSourcePath, stbi_failure_reason());
+		return false;
+	}
+
+	Cook(wPixels, wWidth, wHeight, wChannels, iUsage, oTexture);
+	stbi_image_free(wPixels);
+
+	if (!WriteDDS(wCookedPath, iUsage, oTexture))
+	{
+		spdlog::info("Can't write the cooked texture {0:s}, it will be cooked again next run", wCookedPath);
+	}
+
+	auto wDuration = duration_cast<milliseconds>(high_resolution_clock::now() - wClockStart);
+	spdlog::info("Texture {0:s} cooked in {1:d} ms ({2:d} levels, {3:d} KB)", iSourcePath, wDuration.count(),
+		oTexture.Levels.size(), oTexture.Data.size() / 1024);
+	return true;
+}
+
+bool TextureCooker::IsUpToDate(const std::string& iCookedPath, const std::string& iSourcePath)
+{
+	struct stat wStat;
+	struct stat wSourceStat;
+	if (stat(iCookedPath.c_str(), &wStat) != 0 || stat(iSourcePath.c_str(), &wSourceStat) != 0)
+	{
+		return false;
+	}
+	return wStat.st_mtime >= wSourceStat.st_mtime;
+}
+
+void TextureCooker::Cook(const unsigned char* iPixels, int iWidth, int iHeight, int iChannels, Texture::EUsage iUsage,
+	CookedTexture& oTexture)
+{
+	oTexture.Channels = iChannels;
+	switch (iUsage)
+	{
+	case Texture::EUsage::eNormal:
+		oTexture.InternalFormat = GL_COMPRESSED_RG_RGTC2;
+		break;
+	case Texture::EUsage::eScalar:
+		oTexture.InternalFormat = GL_COMPRESSED_RED_RGTC1;
+		break;
+	default:
+	{
+		// BC1 has no usable alpha, only pay for BC3 when the alpha is not opaque
+		bool wHasAlpha = false;
+		if (iChannels == 2 || iChannels == 4)
+		{
+			const size_t wPixelCount = static_cast<size_t>(iWidth) * iHeight;
+			for (size_t i = 0; i < wPixelCount && !wHasAlpha; i++)
+			{
+				wHasAlpha = iPixels[i * 4 + 3] < 255;
+			}
+		}
+		oTexture.InternalFormat = wHasAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		break;
+	}
+	}
+	oTexture.BlockBytes = FindBlockFormat(oTexture.InternalFormat)->BlockBytes;
+
+	// Full chain down to 1x1, sizes and offsets first so the levels can be encoded in place
+	const int wLevelCount = static_cast<int>(std::floor(std::log2(std::max(iWidth, iHeight)))) + 1;
+	oTexture.Levels.resize(wLevelCount);
+	size_t wOffset = 0;
+	for (int i = 0; i < wLevelCount; i++)
+	{
+		Level& wLevel = oTexture.Levels[i];
+		wLevel.Width = std::max(1, iWidth >> i);
+		wLevel.Height = std::max(1, iHeight >> i);
+		wLevel.Offset = wOffset;
+		wLevel.Size = static_cast<size_t>((wLevel.Width + 3) / 4) * ((wLevel.Height + 3) / 4) * oTexture.BlockBytes;
+		wOffset += wLevel.Size;
+	}
+	oTexture.Data.resize(wOffset);
+
+	std::vector<unsigned char> wLevelPixels(iPixels, iPixels + static_cast<size_t>(iWidth) * iHeight * 4);
+	std::vector<unsigned char> wNextPixels;
+	for (int i = 0; i < wLevelCount; i++)
+	{
+		const Level& wLevel = oTexture.Levels[i];
+		EncodeLevel(wLevelPixels, wLevel.Width, wLevel.Height, oTexture.InternalFormat, oTexture.Data.data() + wLevel.Offset);
+
+		if (i + 1 < wLevelCount)
+		{
+			const Level& wNext = oTexture.Levels[i + 1];
+			Downsample(wLevelPixels, wLevel.Width, wLevel.Height, iUsage, wNextPixels, wNext.Width, wNext.Height);
+			wLevelPixels.swap(wNextPixels);
+		}
+	}
+}
+
+void TextureCooker::Downsample(const std::vector<unsigned char>& iSrc, int iWidth, int iHeight, Texture::EUsage iUsage,
+	std::vector<unsigned char>& oDst, int iDstWidth, int iDstHeight)
+{
+	const float* wSrgbToLinear = GetSrgbToLinearTable();
+
+	oDst.resize(static_cast<size_t>(iDstWidth) * iDstHeight * 4);
+
+	ThreadPool::GetInstance()->ParallelFor(static_cast<uint32_t>(iDstHeight),
+		[&](uint32_t iBegin, uint32_t iEnd, uint32_t)
+		{
+			for (int y = static_cast<int>(iBegin); y < static_cast<int>(iEnd); y++)
+			{
+				const int wRows[2] = { std::min(2 * y, iHeight - 1), std::min(2 * y + 1, iHeight - 1) };
+				for (int x = 0; x < iDstWidth; x++)
+				{
+					const int wColumns[2] = { std::min(2 * x, iWidth - 1), std::min(2 * x + 1, iWidth - 1) };
+
+					float wSum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+					for (int wRow : wRows)
+					{
+						for (int wColumn : wColumns)
+						{
+							const unsigned char* wTexel = &iSrc[(static_cast<size_t>(wRow) * iWidth + wColumn) * 4];
+							for (int c = 0; c < 4; c++)
+							{
+								if (iUsage == Texture::EUsage::eColor && c < 3)
+								{
+									wSum[c] += wSrgbToLinear[wTexel[c]];
+								}
+								else if (iUsage == Texture::EUsage::eNormal && c < 3)
+								{
+									wSum[c] += wTexel[c] / 127.5f - 1.0f;
+								}
+								else
+								{
+									wSum[c] += wTexel[c] / 255.0f;
+								}
+							}
+						}
+					}
+
+					unsigned char* wDst = &oDst[(static_cast<size_t>(y) * iDstWidth + x) * 4];
+					if (iUsage == Texture::EUsage::eNormal)
+					{
+						const float wLength = std::sqrt(wSum[0] * wSum[0] + wSum[1] * wSum[1] + wSum[2] * wSum[2]);
+						const float wNormal[3] = { wLength > 1e-6f ? wSum[0] / wLength : 0.0f,
+							wLength > 1e-6f ? wSum[1] / wLength : 0.0f, wLength > 1e-6f ? wSum[2] / wLength : 1.0f };
+						for (int c = 0; c < 3; c++)
+						{
+							wDst[c] = ToUnorm8(wNormal[c] * 0.5f + 0.5f);
+						}
+					}
+					else
+					{
+						for (int c = 0; c < 3; c++)
+						{
+							wDst[c] = ToUnorm8(iUsage == Texture::EUsage::eColor ? LinearToSrgb(wSum[c] * 0.25f) : wSum[c] * 0.25f);
+						}
+					}
+					wDst[3] = ToUnorm8(wSum[3] * 0.25f);
+				}
+			}
+		});
+}
+
+void TextureCooker::EncodeLevel(const std::vector<unsigned char>& iPixels, int iWidth, int iHeight, GLenum iFormat,
+	unsigned char* oBlocks)
+{
+	const int wBlocksY = (iHeight + 3) / 4;
+
+	ThreadPool::GetInstance()->ParallelFor(static_cast<uint32_t>(wBlocksY),
+		[&](uint32_t iBegin, uint32_t iEnd, uint32_t)
+		{
+			EncodeBlockRows(iPixels.data(), iWidth, iHeight, iFormat, static_cast<int>(iBegin), static_cast<int>(iEnd), oBlocks);
+		});
+}
+
+void TextureCooker::EncodeBlocks(const unsigned char* iPixels, int iWidth, int iHeight, GLenum iFormat, unsigned char* oBlocks)
+{
+	EncodeBlockRows(iPixels, iWidth, iHeight, iFormat, 0, (iHeight + 3) / 4, oBlocks);
+}
+
+bool TextureCooker::ReadDDS(const std::string& iPath, Texture::EUsage iUsage, CookedTexture& oTexture)
+{
+	std::ifstream wFile(iPath, std::ios::binary);
+	if (!wFile)
+	{
+		return false;
+	}
+
+	uint32_t wMagic = 0;
+	DDSHeader wHeader;
+	DDSHeaderDX10 wHeaderDX10;
+	wFile.read(reinterpret_cast<char*>(&wMagic), sizeof(wMagic));
+	wFile.read(reinterpret_cast<char*>(&wHeader), sizeof(wHeader));
+	wFile.read(reinterpret_cast<char*>(&wHeaderDX10), sizeof(wHeaderDX10));
+	if (!wFile || wMagic != kDDSMagic || wHeader.Size != sizeof(DDSHeader) || wHeader.PixelFormat.FourCC != kDX10FourCC ||
+		wHeader.Reserved1[0] != kCookTag || wHeader.Reserved1[1] != kCookVersion ||
+		wHeader.Reserved1[2] != static_cast<uint32_t>(iUsage))
+	{
+		return false;
+	}
+
+	const BlockFormat* wFormat = nullptr;
+	for (const BlockFormat& wCandidate : kBlockFormats)
+	{
+		if (wCandidate.DXGIFormat == wHeaderDX10.DXGIFormat)
+		{
+			wFormat = &wCandidate;
+		}
+	}
+	if (!wFormat || wHeader.MipMapCount == 0 || wHeader.Width == 0 || wHeader.Height == 0)
+	{
+		return false;
+	}
+
+	oTexture.InternalFormat = wFormat->InternalFormat;
+	oTexture.BlockBytes = wFormat->BlockBytes;
+	oTexture.Channels = static_cast<int>(wHeader.Reserved1[3]);
+	oTexture.Levels.resize(wHeader.MipMapCount);
+	size_t wOffset = 0;
+	for (uint32_t i = 0; i < wHeader.MipMapCount; i++)
+	{
+		Level& wLevel = oTexture.Levels[i];
+		wLevel.Width = std::max(1, static_cast<int>(wHeader.Width >> i));
+		wLevel.Height = std::max(1, static_cast<int>(wHeader.Height >> i));
+		wLevel.Offset = wOffset;
+		wLevel.Size = static_cast<size_t>((wLevel.Width + 3) / 4) * ((wLevel.Height + 3) / 4) * oTexture.BlockBytes;
+		wOffset += wLevel.Size;
+	}
+
+	oTexture.Data.resize(wOffset);
+	wFile.read(reinterpret_cast<char*>(oTexture.Data.data()), wOffset);
+	return static_cast<bool>(wFile);
+}
+
+bool TextureCooker::WriteDDS(const std::string& iPath, Texture::EUsage iUsage, const CookedTexture& iTexture)
+{
+	std::ofstream wFile(iPath, std::ios::binary | std::ios::trunc);
+	if (!wFile || iTexture.Levels.empty())
+	{
+		return false;
+	}
+
+	DDSHeader wHeader;
+	memset(&wHeader, 0, sizeof(wHeader));
+	wHeader.Size = sizeof(DDSHeader);
+	wHeader.Flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;	// CAPS HEIGHT WIDTH PIXELFORMAT MIPMAPCOUNT LINEARSIZE
+	wHeader.Width = iTexture.Levels[0].Width;
+	wHeader.Height = iTexture.Levels[0].Height;
+	wHeader.PitchOrLinearSize = static_cast<uint32_t>(iTexture.Levels[0].Size);
+	wHeader.MipMapCount = static_cast<uint32_t>(iTexture.Levels.size());
+	wHeader.Reserved1[0] = kCookTag;
+	wHeader.Reserved1[1] = kCookVersion;
+	wHeader.Reserved1[2] = static_cast<uint32_t>(iUsage);
+	wHeader.Reserved1[3] = static_cast<uint32_t>(iTexture.Channels);
+	wHeader.PixelFormat.Size = sizeof(DDSPixelFormat);
+	wHeader.PixelFormat.Flags = 0x4;									// FOURCC
+	wHeader.PixelFormat.FourCC = kDX10FourCC;
+	wHeader.Caps = 0x1000 | 0x400000 | 0x8;								// TEXTURE MIPMAP COMPLEX
+
+	DDSHeaderDX10 wHeaderDX10;
+	wHeaderDX10.DXGIFormat = FindBlockFormat(iTexture.InternalFormat)->DXGIFormat;
+	wHeaderDX10.ResourceDimension = 3;									// TEXTURE2D
+	wHeaderDX10.MiscFlag = 0;
+	wHeaderDX10.ArraySize = 1;
+	wHeaderDX10.MiscFlags2 = 0;
+
+	wFile.write(reinterpret_cast<const char*>(&kDDSMagic), sizeof(kDDSMagic));
+	wFile.write(reinterpret_cast<const char*>(&wHeader), sizeof(wHeader));
+	wFile.write(reinterpret_cast<const char*>(&wHeaderDX10), sizeof(wHeaderDX10));
+	wFile.write(reinterpret_cast<const char*>(iTexture.Data.data()), iTexture.Data.size());
+	return static_cast<bool>(wFile);
+}
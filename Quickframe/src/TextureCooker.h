@@ -0,0 +1,108 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Texture.h"
+
+// EXT_texture_compression_s3tc, not core but exposed by every desktop driver
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+/**
+ * @brief : Offline texture processing, encodes a source image to BCn with its whole mip chain.
+ * Color maps become BC1 (BC3 when the alpha is used), normal maps BC5 with Z rebuilt in the
+ * shaders, single channel maps BC4. Mips are filtered in linear space for color maps and
+ * renormalized for normal maps.
+ * The result is cached as a .dds next to the source and reused while it is newer than the source.
+ * Rows are stored bottom up, ready for the GL upload, so the cache is only meant for this engine.
+*/
+class TextureCooker
+{
+public:
+	struct Level
+	{
+		int Width = 0;
+		int Height = 0;
+		size_t Offset = 0;			// In Data
+		size_t Size = 0;
+	};
+
+	struct CookedTexture
+	{
+		GLenum InternalFormat = 0;
+		uint32_t BlockBytes = 0;	// 8 for BC1/BC4, 16 for BC3/BC5
+		int Channels = 0;			// Of the source image
+		std::vector<Level> Levels;
+		std::vector<unsigned char> Data;
+	};
+
+	/**
+	 * @brief : Cooked version of a source image, read from the cache or cooked and written to it.
+	 * Blocking, meant for background jobs, the encoding is spread with ParallelFor.
+	*/
+	static bool GetCooked(const std::string& iSourcePath, Texture::EUsage iUsage, CookedTexture& oTexture);
+
+	/**
+	 * @param iPixels : RGBA8 pixels, bottom row first
+	 * @param iChannels : Channels of the source, decides whether the alpha is kept
+	*/
+	static void Cook(const unsigned char* iPixels, int iWidth, int iHeight, int iChannels, Texture::EUsage iUsage,
+		CookedTexture& oTexture);
+
+	static std::string GetCookedPath(const std::string& iSourcePath) { return iSourcePath + ".dds"; }
+
+	/**
+	 * @brief : Whether a cache file exists and was written after its source
+	*/
+	static bool IsUpToDate(const std::string& iCookedPath, const std::string& iSourcePath);
+
+	/**
+	 * @brief : Half resolution level, 2x2 box filter in the space matching the usage
+	*/
+	static void Downsample(const std::vector<unsigned char>& iSrc, int iWidth, int iHeight, Texture::EUsage iUsage,
+		std::vector<unsigned char>& oDst, int iDstWidth, int iDstHeight);
+
+	/**
+	 * @brief : Encode RGBA8 pixels on the calling thread, for callers that already run in parallel
+	 * @param iFormat : One of the formats picked by Cook
+	*/
+	static void EncodeBlocks(const unsigned char* iPixels, int iWidth, int iHeight, GLenum iFormat, unsigned char* oBlocks);
+
+private:
+	static bool ReadDDS(const std::string& iPath, Texture::EUsage iUsage, CookedTexture& oTexture);
+	static bool WriteDDS(const std::string& iPath, Texture::EUsage iUsage, const CookedTexture& iTexture);
+
+	static void EncodeLevel(const std::vector<unsigned char>& iPixels, int iWidth, int iHeight, GLenum iFormat,
+		unsigned char* oBlocks);
+};
@@ -22,7 +22,15 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <spdlog/spdlog.h>
+
 #include "TextureManager.h"
+#include "TextureArrayPool.h"
+
+using namespace std::chrono;
 
 TextureManager* TextureManager::mTextureManager = nullptr;
 
@@ -36,52 +44,362 @@ TextureManager* TextureManager::GetInstance()
 	return mTextureManager;
 }
 
-Texture* TextureManager::GetTexture(GLenum iTextureTarget, const std::string& iName)
+TextureManager::~TextureManager()
 {
-	auto wTextureIter = mTextureMap.find(iName);
-	if (wTextureIter != mTextureMap.end())
+	for (Shard& wShard : mShards)
 	{
-		return mTextureMap[iName];
+		for (auto& wEntry : wShard.Entries)
+		{
+			if (wEntry.second.Result.wait_for(seconds(0)) == std::future_status::ready)
+			{
+				delete wEntry.second.Result.get();
+			}
+		}
 	}
-	else
+}
+
+std::string TextureManager::NormalizePath(const std::string& iPath)
+{
+	std::string wPath = iPath;
+	std::replace(wPath.begin(), wPath.end(), '\\', '/');
+
+	std::vector<std::string> wSegments;
+	size_t wBegin = 0;
+	while (wBegin <= wPath.size())
 	{
-		Texture* wTexture = new Texture(iTextureTarget);
-		if (!wTexture->Load(iName))
+		size_t wEnd = wPath.find('/', wBegin);
+		if (wEnd == std::string::npos)
 		{
-			return nullptr;
+			wEnd = wPath.size();
+		}
+
+		const std::string wSegment = wPath.substr(wBegin, wEnd - wBegin);
+		if (wSegment == "..")
+		{
+			// Only resolved against a named directory, leading ".." stay
+			if (!wSegments.empty() && wSegments.back() != ".." && !wSegments.back().empty())
+			{
+				wSegments.pop_back();
+			}
+			else
+			{
+				wSegments.push_back(wSegment);
+			}
+		}
+		else if (wSegment != "." && (!wSegment.empty() || wBegin == 0))
+		{
+			// An empty first segment keeps absolute paths absolute
+			wSegments.push_back(wSegment);
+		}
+
+		wBegin = wEnd + 1;
+	}
+
+	std::string wNormalized;
+	for (size_t i = 0; i < wSegments.size(); i++)
+	{
+		if (i > 0)
+		{
+			wNormalized += '/';
+		}
+		wNormalized += wSegments[i];
+	}
+
+	return wNormalized;
+}
+
+template<typename F>
+Texture* TextureManager::Acquire(const std::string& iKey, F&& iCreate)
+{
+	Shard& wShard = GetShard(iKey);
+	std::promise<Texture*> wPromise;
+	std::shared_future<Texture*> wResult;
+	{
+		std::lock_guard<std::mutex> wLock(wShard.Mutex);
+		auto wInsert = wShard.Entries.emplace(iKey, Entry());
+		Entry& wEntry = wInsert.first->second;
+		wEntry.RefCount++;
+		if (wInsert.second)
+		{
+			wEntry.Result = wPromise.get_future().share();
 		}
 		else
 		{
-			mTextureMap[wTexture->GetPath()] = wTexture;
-			return mTextureMap[wTexture->GetPath()];
+			wResult = wEntry.Result;
+		}
+	}
+
+	if (wResult.valid())
+	{
+		mHitCount++;
+		if (wResult.wait_for(seconds(0)) != std::future_status::ready)
+		{
+			const auto wWaitStart = high_resolution_clock::now();
+			wResult.wait();
+			mWaitCount++;
+			mWaitTimeNs += duration_cast<nanoseconds>(high_resolution_clock::now() - wWaitStart).count();
 		}
+
+		// A failed load already removed the entry, along with the reference taken above
+		return wResult.get();
 	}
+
+	mMissCount++;
+	Texture* wTexture = iCreate();
+	if (!wTexture)
+	{
+		std::lock_guard<std::mutex> wLock(wShard.Mutex);
+		wShard.Entries.erase(iKey);
+	}
+
+	wPromise.set_value(wTexture);
+	return wTexture;
+}
+
+Texture* TextureManager::GetTexture(GLenum iTextureTarget, const std::string& iName, Texture::EUsage iUsage)
+{
+	const std::string wKey = NormalizePath(iName);
+	return Acquire(wKey, [this, iTextureTarget, &wKey, iUsage]()
+		{
+			if (iTextureTarget != GL_TEXTURE_2D)
+			{
+				return LoadTexture(iTextureTarget, wKey, iUsage);
+			}
+
+			return CreateStreamedTexture(iTextureTarget, wKey, iUsage);
+		});
 }
 
 Texture* TextureManager::GetTexture(GLenum iTextureTarget, const std::vector<std::string>& iName)
 {
-	auto wTextureIter = mTextureMap.find(iName[0]);
-	if (wTextureIter != mTextureMap.end())
+	std::vector<std::string> wPaths;
+	for (const std::string& wName : iName)
+	{
+		wPaths.push_back(NormalizePath(wName));
+	}
+
+	return Acquire(wPaths[0], [this, iTextureTarget, &wPaths]()
+		{
+			Texture* wTexture = new Texture(iTextureTarget);
+			if (!wTexture->LoadCubemap(wPaths))
+			{
+				delete wTexture;
+				return static_cast<Texture*>(nullptr);
+			}
+
+			OnTextureResident(wTexture);
+			return wTexture;
+		});
+}
+
+Texture* TextureManager::CreateStreamedTexture(GLenum iTextureTarget, const std::string& iPath, Texture::EUsage iUsage)
+{
+	// Missing files are reported now, decoding errors only leave the placeholder
+	if (!std::ifstream(iPath).good())
+	{
+		spdlog::critical("Failed to load texture {0:s} : can't open file", iPath);
+		return nullptr;
+	}
+
+	Texture* wPlaceholder = GetDefaultDiffuseTex();
+	if (!wPlaceholder)
+	{
+		return LoadTexture(iTextureTarget, iPath, iUsage);
+	}
+
+	Texture* wTexture = new Texture(iTextureTarget, iUsage);
+	wTexture->SetPlaceholder(iPath, *wPlaceholder);
+
+	std::lock_guard<std::mutex> wLock(mPendingMutex);
+	mStreamRequests.push_back({ wTexture, iPath, iUsage });
+	return wTexture;
+}
+
+Texture* TextureManager::LoadTexture(GLenum iTextureTarget, const std::string& iPath, Texture::EUsage iUsage)
+{
+	Texture* wTexture = new Texture(iTextureTarget, iUsage);
+	if (!wTexture->Load(iPath))
+	{
+		delete wTexture;
+		return nullptr;
+	}
+
+	OnTextureResident(wTexture);
+	return wTexture;
+}
+
+void TextureManager::ReleaseTexture(Texture* iTexture)
+{
+	if (!iTexture || iTexture == mDefaultDiffuseTex.load())
 	{
-		return mTextureMap[iName[0]];
+		return;
 	}
-	else
+
+	const std::string& wKey = iTexture->GetPath();
+	Shard& wShard = GetShard(wKey);
 	{
-		Texture* wTexture = new Texture(iTextureTarget);
-		if (!wTexture->LoadCubemap(iName))
+		std::lock_guard<std::mutex> wLock(wShard.Mutex);
+		auto wEntryIter = wShard.Entries.find(wKey);
+		if (wEntryIter == wShard.Entries.end() || wEntryIter->second.RefCount == 0 || --wEntryIter->second.RefCount > 0)
 		{
-			return nullptr;
+			return;
 		}
-		else
+	}
+
+	std::lock_guard<std::mutex> wLock(mPendingMutex);
+	mReleasedKeys.push_back(wKey);
+}
+
+Texture* TextureManager::GetDefaultDiffuseTex()
+{
+	// Placeholder of the streamed textures, can't be streamed itself
+	Texture* wDefaultTex = mDefaultDiffuseTex.load();
+	if (wDefaultTex)
+	{
+		return wDefaultTex;
+	}
+
+	static const std::string kDefaultDiffusePath = "resources/textures/pattern.png";
+	wDefaultTex = Acquire(kDefaultDiffusePath, [this]()
 		{
-			mTextureMap[wTexture->GetPath()] = wTexture;
-			return mTextureMap[wTexture->GetPath()];
+			return LoadTexture(GL_TEXTURE_2D, kDefaultDiffusePath, Texture::EUsage::eColor);
+		});
+	mDefaultDiffuseTex = wDefaultTex;
+	return wDefaultTex;
+}
+
+void TextureManager::Update()
+{
+	std::vector<StreamRequest> wStreamRequests;
+	{
+		std::lock_guard<std::mutex> wLock(mPendingMutex);
+		wStreamRequests.swap(mStreamRequests);
+	}
+
+	if (!wStreamRequests.empty() && !mStreamer)
+	{
+		mStreamer = std::make_unique<TextureStreamer>();
+	}
+
+	for (const StreamRequest& wRequest : wStreamRequests)
+	{
+		mStreamer->Request(wRequest.Target, wRequest.Path, wRequest.Usage);
+	}
+
+	EvictReleased();
+
+	if (mStreamer)
+	{
+		mStreamer->Update();
+
+		// Report once the streaming queue drains
+		const uint32_t wStreamsPending = mStreamer->GetPendingCount();
+		if (mStreamsPending > 0 && wStreamsPending == 0)
+		{
+			LogMemoryUsage();
+			LogCacheStats();
 		}
+		mStreamsPending = wStreamsPending;
 	}
 }
 
-Texture* TextureManager::GetDefaultDiffuseTex()
+void TextureManager::EvictReleased()
 {
-	return GetTexture(GL_TEXTURE_2D, "resources/textures/pattern.png");
+	std::vector<std::string> wReleasedKeys;
+	{
+		std::lock_guard<std::mutex> wLock(mPendingMutex);
+		wReleasedKeys.swap(mReleasedKeys);
+	}
+
+	std::vector<std::string> wDeferredKeys;
+	for (const std::string& wKey : wReleasedKeys)
+	{
+		Texture* wTexture = nullptr;
+		{
+			Shard& wShard = GetShard(wKey);
+			std::lock_guard<std::mutex> wLock(wShard.Mutex);
+			auto wEntryIter = wShard.Entries.find(wKey);
+			if (wEntryIter == wShard.Entries.end() || wEntryIter->second.RefCount > 0)
+			{
+				continue;
+			}
+
+			// The streamer still writes to textures it hasn't finished
+			wTexture = wEntryIter->second.Result.get();
+			if (mStreamer && mStreamer->IsStreaming(wTexture))
+			{
+				wDeferredKeys.push_back(wKey);
+				continue;
+			}
+
+			wShard.Entries.erase(wEntryIter);
+		}
+
+		const uint64_t wByteSize = wTexture->GetByteSize();
+		mMemoryUsage[static_cast<uint32_t>(GetCategory(wTexture))] -= wByteSize;
+		mTotalMemoryUsage -= wByteSize;
+		TextureArrayPool::GetInstance()->Remove(wTexture);
+		delete wTexture;
+	}
+
+	if (!wDeferredKeys.empty())
+	{
+		std::lock_guard<std::mutex> wLock(mPendingMutex);
+		mReleasedKeys.insert(mReleasedKeys.end(), wDeferredKeys.begin(), wDeferredKeys.end());
+	}
+}
+
+void TextureManager::OnTextureResident(Texture* iTexture)
+{
+	const uint64_t wByteSize = iTexture->GetByteSize();
+	mMemoryUsage[static_cast<uint32_t>(GetCategory(iTexture))] += wByteSize;
+	const uint64_t wTotal = mTotalMemoryUsage += wByteSize;
+
+	uint64_t wPeak = mPeakMemoryUsage.load();
+	while (wTotal > wPeak && !mPeakMemoryUsage.compare_exchange_weak(wPeak, wTotal))
+	{
+	}
+
+	// Material textures share arrays so draws with different materials don't rebind them
+	if (iTexture->GetTarget() == GL_TEXTURE_2D)
+	{
+		TextureArrayPool::GetInstance()->Add(iTexture);
+	}
+}
+
+void TextureManager::LogMemoryUsage() const
+{
+	const double kMB = 1024.0 * 1024.0;
+	spdlog::info("Texture memory : {0:.1f} MB (color {1:.1f} | normal {2:.1f} | scalar {3:.1f} | cubemap {4:.1f}), peak {5:.1f} MB",
+		GetTotalMemoryUsage() / kMB,
+		GetMemoryUsage(EMemoryCategory::eColor) / kMB,
+		GetMemoryUsage(EMemoryCategory::eNormal) / kMB,
+		GetMemoryUsage(EMemoryCategory::eScalar) / kMB,
+		GetMemoryUsage(EMemoryCategory::eCubemap) / kMB,
+		GetPeakMemoryUsage() / kMB);
+}
+
+void TextureManager::LogCacheStats() const
+{
+	spdlog::info("Texture cache : {0:d} hits, {1:d} misses, {2:d} waits on in-flight loads ({3:.2f} ms)",
+		GetHitCount(), GetMissCount(), GetWaitCount(), GetWaitTimeMs());
+}
+
+TextureManager::EMemoryCategory TextureManager::GetCategory(const Texture* iTexture)
+{
+	if (iTexture->GetTarget() == GL_TEXTURE_CUBE_MAP)
+	{
+		return EMemoryCategory::eCubemap;
+	}
+
+	switch (iTexture->GetUsage())
+	{
+	case Texture::EUsage::eNormal:
+		return EMemoryCategory::eNormal;
+	case Texture::EUsage::eScalar:
+		return EMemoryCategory::eScalar;
+	default:
+		return EMemoryCategory::eColor;
+	}
 }
 
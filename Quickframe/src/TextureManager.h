@@ -24,32 +24,180 @@ SOFTWARE.
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <unordered_map>
+#include <vector>
 #include "Texture.h"
+#include "TextureStreamer.h"
 
+/**
+ * @brief : Texture cache, safe to query from any thread.
+ * Entries are keyed by normalized path and spread over kShardCount independently locked maps.
+ * The first request of a path creates it while concurrent requests wait on the same shared future.
+ * Every successful GetTexture takes a reference, given back with ReleaseTexture, textures left
+ * without reference are deleted by Update.
+ * GL objects are only created on the main thread : streamed requests are handed to the streamer
+ * by Update, synchronous loads (cubemaps, the default texture) must be requested from the main thread.
+*/
 class TextureManager
 {
+	struct Entry
+	{
+		std::shared_future<Texture*> Result;		// nullptr once the load failed
+		uint32_t RefCount = 0;
+	};
+
+	struct Shard
+	{
+		std::mutex Mutex;
+		std::unordered_map<std::string, Entry> Entries;
+	};
+
+	struct StreamRequest
+	{
+		Texture* Target;
+		std::string Path;
+		Texture::EUsage Usage;
+	};
+
 public:
+	/**
+	 * @brief : Device memory is reported per category, 2D textures by usage
+	*/
+	enum class EMemoryCategory
+	{
+		eColor,
+		eNormal,
+		eScalar,
+		eCubemap,
+		eCount
+	};
+
+	static constexpr uint32_t kShardCount = 16;
+
+	TextureManager(TextureManager& iOther) = delete;
+	void operator=(const TextureManager&) = delete;
+
+	/**
+	 * @brief : The instance is created by the renderer initialization, before any worker queries it
+	*/
 	static TextureManager* GetInstance();
 
-	Texture* GetTexture(GLenum iTextureTarget, const std::string& iName);
+	/**
+	 * @brief : 2D textures are returned right away sampling the default texture, the file is cooked
+	 * or read from the cook cache in the background and swapped in once uploaded
+	 * @param iUsage : Picks the compressed format of streamed textures
+	 * @return nullptr if the file can't be opened
+	*/
+	Texture* GetTexture(GLenum iTextureTarget, const std::string& iName, Texture::EUsage iUsage = Texture::EUsage::eColor);
 
+	/**
+	 * @brief : Cubemap of 6 faces, cached under the path of the first face
+	*/
 	Texture* GetTexture(GLenum iTextureTarget, const std::vector<std::string>& iName);
 
+	/**
+	 * @brief : Give back the reference taken by GetTexture, the texture is deleted by the next Update if it was the last
+	*/
+	void ReleaseTexture(Texture* iTexture);
+
+	/**
+	 * @brief : Placeholder of the streamed textures, never evicted
+	*/
 	Texture* GetDefaultDiffuseTex();
 
+	/**
+	 * @brief : Progress the texture streaming and delete the unreferenced textures, once per frame on the main thread
+	*/
+	void Update();
+
+	/**
+	 * @brief : Account for the storage of a texture that just became resident and pack it in TextureArrayPool
+	*/
+	void OnTextureResident(Texture* iTexture);
+
+	uint64_t GetMemoryUsage(EMemoryCategory iCategory) const { return mMemoryUsage[static_cast<uint32_t>(iCategory)].load(); }
+	uint64_t GetTotalMemoryUsage() const { return mTotalMemoryUsage.load(); }
+
+	/**
+	 * @brief : Highest total reached since startup
+	*/
+	uint64_t GetPeakMemoryUsage() const { return mPeakMemoryUsage.load(); }
+
+	void LogMemoryUsage() const;
+
+	/**
+	 * @brief : Requests served from the cache, including the ones that waited for an in-flight load
+	*/
+	uint64_t GetHitCount() const { return mHitCount.load(); }
+	uint64_t GetMissCount() const { return mMissCount.load(); }
+
+	/**
+	 * @brief : Requests that blocked on a load started by another thread, and the total time they waited
+	*/
+	uint64_t GetWaitCount() const { return mWaitCount.load(); }
+	double GetWaitTimeMs() const { return mWaitTimeNs.load() / 1e6; }
+
+	void LogCacheStats() const;
+
+	/**
+	 * @brief : Forward slashes, no "." segment, ".." resolved where possible
+	*/
+	static std::string NormalizePath(const std::string& iPath);
+
 private:
+	TextureManager() {}
+	~TextureManager();
+
+	/**
+	 * @brief : Take a reference on the entry of iKey, created with iCreate by the first requester
+	*/
+	template<typename F>
+	Texture* Acquire(const std::string& iKey, F&& iCreate);
+
+	/**
+	 * @brief : Texture sampling the placeholder, streamed from the next Update
+	*/
+	Texture* CreateStreamedTexture(GLenum iTextureTarget, const std::string& iPath, Texture::EUsage iUsage);
+
+	/**
+	 * @brief : Load a texture synchronously
+	*/
+	Texture* LoadTexture(GLenum iTextureTarget, const std::string& iPath, Texture::EUsage iUsage);
+
+	/**
+	 * @brief : Delete the textures released down to 0 references, unless they were acquired again
+	*/
+	void EvictReleased();
+
+	Shard& GetShard(const std::string& iKey) { return mShards[std::hash<std::string>()(iKey) % kShardCount]; }
+
+	static EMemoryCategory GetCategory(const Texture* iTexture);
+
 	static TextureManager* mTextureManager;
 
-	std::unordered_map<std::string, Texture*> mTextureMap;
+	Shard mShards[kShardCount];
+	std::atomic<Texture*> mDefaultDiffuseTex{ nullptr };
 
-	TextureManager() {}
+	// Filled from any thread, drained by Update
+	std::mutex mPendingMutex;
+	std::vector<StreamRequest> mStreamRequests;
+	std::vector<std::string> mReleasedKeys;
 
-	~TextureManager() 
-	{
-		for (auto wTexture : mTextureMap)
-		{
-			delete wTexture.second;
-		}
-	}
-};
\ No newline at end of file
+	std::unique_ptr<TextureStreamer> mStreamer;
+	uint32_t mStreamsPending = 0;
+
+	std::atomic<uint64_t> mMemoryUsage[static_cast<uint32_t>(EMemoryCategory::eCount)] = {};
+	std::atomic<uint64_t> mTotalMemoryUsage{ 0 };
+	std::atomic<uint64_t> mPeakMemoryUsage{ 0 };
+
+	std::atomic<uint64_t> mHitCount{ 0 };
+	std::atomic<uint64_t> mMissCount{ 0 };
+	std::atomic<uint64_t> mWaitCount{ 0 };
+	std::atomic<uint64_t> mWaitTimeNs{ 0 };
+};
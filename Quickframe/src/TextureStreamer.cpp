@@ -0,0 +1,266 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <spdlog/spdlog.h>
+
+#include "TextureStreamer.h"
+#include "TextureManager.h"
+#include "Texture.h"
+#include "GLStateCache.h"
+#include "ThreadPool.h"
+
+using namespace std::chrono;
+
+TextureStreamer::TextureStreamer()
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	for (StagingBuffer& wStaging : mStagingBuffers)
+	{
+		glGenBuffers(1, &wStaging.Buffer);
+		wStateCache->BindBuffer(GL_PIXEL_UNPACK_BUFFER, wStaging.Buffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, kUploadBudget, nullptr, GL_STREAM_DRAW);
+	}
+
+	// Unpacks from client memory must not read from a buffer
+	wStateCache->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	for (StagingBuffer& wStaging : mStagingBuffers)
+	{
+		if (wStaging.Fence)
+		{
+			glDeleteSync(wStaging.Fence);
+		}
+		wStateCache->OnBufferDeleted(wStaging.Buffer);
+		glDeleteBuffers(1, &wStaging.Buffer);
+	}
+
+	for (Stream& wStream : mStreams)
+	{
+		if (wStream.Handle)
+		{
+			wStateCache->OnTextureDeleted(wStream.Handle);
+			glDeleteTextures(1, &wStream.Handle);
+		}
+	}
+}
+
+void TextureStreamer::Request(Texture* iTexture, const std::string& iPath, Texture::EUsage iUsage)
+{
+	if (mStreams.empty())
+	{
+		mStreamingStart = high_resolution_clock::now();
+		mStreamedCount = 0;
+		mStreamedBytes = 0;
+	}
+
+	Stream wStream;
+	wStream.Target = iTexture;
+	wStream.Path = iPath;
+	wStream.Cook = ThreadPool::GetInstance()->SubmitBackground([iPath, iUsage]()
+		{
+			TextureCooker::CookedTexture wImage;
+			if (!TextureCooker::GetCooked(iPath, iUsage, wImage))
+			{
+				wImage.Levels.clear();
+			}
+			return wImage;
+		});
+
+	mStreams.push_back(std::move(wStream));
+}
+
+bool TextureStreamer::IsStreaming(const Texture* iTexture) const
+{
+	return std::any_of(mStreams.begin(), mStreams.end(), [iTexture](const Stream& iStream) { return iStream.Target == iTexture; });
+}
+
+void TextureStreamer::Update()
+{
+	if (mStreams.empty())
+	{
+		return;
+	}
+
+	// Collect the finished cooks, failed files keep their placeholder
+	bool wHasDecoded = false;
+	for (auto wIt = mStreams.begin(); wIt != mStreams.end();)
+	{
+		if (!wIt->Decoded && wIt->Cook.wait_for(seconds(0)) == std::future_status::ready)
+		{
+			wIt->Image = wIt->Cook.get();
+			wIt->Decoded = true;
+			if (wIt->Image.Levels.empty())
+			{
+				wIt = mStreams.erase(wIt);
+				continue;
+			}
+		}
+
+		wHasDecoded |= wIt->Decoded;
+		++wIt;
+	}
+
+	if (!wHasDecoded)
+	{
+		return;
+	}
+
+	// The GPU may still be reading this buffer from kStagingBufferCount frames ago, never wait for it
+	StagingBuffer& wStaging = mStagingBuffers[mStagingHead];
+	if (wStaging.Fence)
+	{
+		if (glClientWaitSync(wStaging.Fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			return;
+		}
+		glDeleteSync(wStaging.Fence);
+		wStaging.Fence = nullptr;
+	}
+
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	wStateCache->BindBuffer(GL_PIXEL_UNPACK_BUFFER, wStaging.Buffer);
+	unsigned char* wMapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, kUploadBudget,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+	if (!wMapped)
+	{
+		wStateCache->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return;
+	}
+
+	// Oldest requests first, a large texture may span several frames
+	mPendingUploads.clear();
+	GLintptr wOffset = 0;
+	for (Stream& wStream : mStreams)
+	{
+		if (wStream.Decoded && !StageRows(wStream, wMapped, wOffset))
+		{
+			break;
+		}
+	}
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	// Bands are block aligned, only the last one of a level may be shorter than 4 texel rows
+	for (const PendingUpload& wUpload : mPendingUploads)
+	{
+		const TextureCooker::CookedTexture& wImage = wUpload.Source->Image;
+		const TextureCooker::Level& wLevel = wImage.Levels[wUpload.Level];
+		const int wY = wUpload.FirstRow * 4;
+		const int wHeight = std::min(wUpload.RowCount * 4, wLevel.Height - wY);
+		wStateCache->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, wUpload.Source->Handle);
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, wUpload.Level, 0, wY, wLevel.Width, wHeight, wImage.InternalFormat,
+			wUpload.Size, reinterpret_cast<const void*>(wUpload.Offset));
+	}
+
+	wStaging.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	mStagingHead = (mStagingHead + 1) % kStagingBufferCount;
+	wStateCache->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	for (auto wIt = mStreams.begin(); wIt != mStreams.end();)
+	{
+		if (wIt->Decoded && wIt->UploadedLevels == wIt->Image.Levels.size())
+		{
+			FinishStream(*wIt);
+			wIt = mStreams.erase(wIt);
+		}
+		else
+		{
+			++wIt;
+		}
+	}
+
+	if (mStreams.empty())
+	{
+		auto wDuration = duration_cast<milliseconds>(high_resolution_clock::now() - mStreamingStart);
+		spdlog::info("Streamed {0:d} textures ({1:.1f} MB) in {2:d} ms", mStreamedCount,
+			mStreamedBytes / (1024.0 * 1024.0), wDuration.count());
+	}
+}
+
+bool TextureStreamer::StageRows(Stream& ioStream, unsigned char* oStaging, GLintptr& ioOffset)
+{
+	const TextureCooker::CookedTexture& wImage = ioStream.Image;
+	if (!ioStream.Handle)
+	{
+		// Immutable storage, allocating with glCompressedTexImage2D would read from the bound unpack buffer
+		glGenTextures(1, &ioStream.Handle);
+		GLStateCache::GetInstance()->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, ioStream.Handle);
+		glTexStorage2D(GL_TEXTURE_2D, static_cast<GLsizei>(wImage.Levels.size()), wImage.InternalFormat,
+			wImage.Levels[0].Width, wImage.Levels[0].Height);
+	}
+
+	// Small levels share the staging buffer, large ones are split in bands of block rows
+	while (ioStream.UploadedLevels < wImage.Levels.size())
+	{
+		const TextureCooker::Level& wLevel = wImage.Levels[ioStream.UploadedLevels];
+		const GLsizeiptr wRowSize = static_cast<GLsizeiptr>((wLevel.Width + 3) / 4) * wImage.BlockBytes;
+		const int wLevelRows = (wLevel.Height + 3) / 4;
+		const int wRowCount = std::min<int>(wLevelRows - ioStream.UploadedRows, static_cast<int>((kUploadBudget - ioOffset) / wRowSize));
+		if (wRowCount <= 0)
+		{
+			return false;
+		}
+
+		const GLsizeiptr wSize = wRowSize * wRowCount;
+		memcpy(oStaging + ioOffset, wImage.Data.data() + wLevel.Offset + wRowSize * ioStream.UploadedRows, wSize);
+		mPendingUploads.push_back({ &ioStream, ioStream.UploadedLevels, ioStream.UploadedRows, wRowCount, ioOffset,
+			static_cast<GLsizei>(wSize) });
+
+		ioOffset += wSize;
+		ioStream.UploadedRows += wRowCount;
+		if (ioStream.UploadedRows == wLevelRows)
+		{
+			++ioStream.UploadedLevels;
+			ioStream.UploadedRows = 0;
+		}
+	}
+	return ioOffset < kUploadBudget;
+}
+
+void TextureStreamer::FinishStream(Stream& ioStream)
+{
+	// The mip chain comes from the cook, nothing is generated at runtime
+	GLStateCache::GetInstance()->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, ioStream.Handle);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	const TextureCooker::Level& wLevel0 = ioStream.Image.Levels[0];
+	ioStream.Target->MakeResident(ioStream.Handle, wLevel0.Width, wLevel0.Height, ioStream.Image.Channels,
+		ioStream.Image.InternalFormat, ioStream.Image.Data.size());
+	ioStream.Handle = 0;
+	TextureManager::GetInstance()->OnTextureResident(ioStream.Target);
+
+	++mStreamedCount;
+	mStreamedBytes += ioStream.Image.Data.size();
+
+	ioStream.Image.Data.clear();
+	ioStream.Image.Data.shrink_to_fit();
+}
@@ -0,0 +1,121 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <glad/glad.h>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "Texture.h"
+#include "TextureCooker.h"
+
+/**
+ * @brief : Streams 2D textures in the background.
+ * Files are cooked to BCn (or read from the cook cache) on the thread pool, the blocks are then
+ * copied to a ring of pixel unpack buffers and uploaded with glCompressedTexSubImage2D, a band of
+ * block rows at a time so a frame never uploads more than kUploadBudget bytes.
+ * Until its last level is uploaded a texture samples its placeholder.
+*/
+class TextureStreamer
+{
+	struct Stream
+	{
+		Texture* Target = nullptr;
+		std::string Path;
+		std::future<TextureCooker::CookedTexture> Cook;		// No level when the file couldn't be read
+		TextureCooker::CookedTexture Image;
+		bool Decoded = false;
+		GLuint Handle = 0;				// Created on the first upload, handed to Target once resident
+		uint32_t UploadedLevels = 0;
+		int UploadedRows = 0;			// Block rows of the level being uploaded
+	};
+
+	/**
+	 * @brief : Row band copied to a staging buffer, issued once the buffer is unmapped
+	*/
+	struct PendingUpload
+	{
+		const Stream* Source;
+		uint32_t Level;
+		int FirstRow;					// In blocks
+		int RowCount;
+		GLintptr Offset;
+		GLsizei Size;
+	};
+
+	struct StagingBuffer
+	{
+		GLuint Buffer = 0;
+		GLsync Fence = nullptr;			// Signaled once the uploads reading this buffer are done
+	};
+
+public:
+	// Each frame fills one staging buffer, it is reused kStagingBufferCount frames later
+	static constexpr uint32_t kStagingBufferCount = 3;
+	static constexpr GLsizeiptr kUploadBudget = 16 * 1024 * 1024;
+
+	TextureStreamer();
+	~TextureStreamer();
+
+	/**
+	 * @brief : Queue the cooking of a file, iTexture must already sample its placeholder
+	*/
+	void Request(Texture* iTexture, const std::string& iPath, Texture::EUsage iUsage);
+
+	/**
+	 * @brief : Collect the cooked files and upload up to kUploadBudget bytes, once per frame on the main thread
+	*/
+	void Update();
+
+	uint32_t GetPendingCount() const { return static_cast<uint32_t>(mStreams.size()); }
+
+	/**
+	 * @brief : Whether iTexture is still waiting for its cook or upload, it can't be deleted meanwhile
+	*/
+	bool IsStreaming(const Texture* iTexture) const;
+
+private:
+	/**
+	 * @brief : Copy as many block rows of a stream as fit in the staging buffer
+	 * @return false when the staging buffer is full
+	*/
+	bool StageRows(Stream& ioStream, unsigned char* oStaging, GLintptr& ioOffset);
+	void FinishStream(Stream& ioStream);
+
+	std::deque<Stream> mStreams;
+	std::vector<PendingUpload> mPendingUploads;
+
+	StagingBuffer mStagingBuffers[kStagingBufferCount];
+	uint32_t mStagingHead = 0;
+
+	// Reported when the queue drains
+	std::chrono::high_resolution_clock::time_point mStreamingStart;
+	uint32_t mStreamedCount = 0;
+	uint64_t mStreamedBytes = 0;
+};
@@ -0,0 +1,184 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+#include "ThreadPool.h"
+
+ThreadPool* ThreadPool::mThreadPool = nullptr;
+
+namespace
+{
+	thread_local bool tIsWorkerThread = false;
+}
+
+ThreadPool* ThreadPool::GetInstance()
+{
+	if (!mThreadPool)
+	{
+		// Keep one core for the main (GL) thread
+		uint32_t wCoreCount = std::thread::hardware_concurrency();
+		mThreadPool = new ThreadPool(wCoreCount > 1 ? wCoreCount - 1 : 1);
+	}
+
+	return mThreadPool;
+}
+
+ThreadPool::ThreadPool(uint32_t iWorkerCount)
+{
+	mWorkers.reserve(iWorkerCount);
+	for (uint32_t i = 0; i < iWorkerCount; i++)
+	{
+		mWorkers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+
+	spdlog::info("Thread pool started with {0:d} workers", iWorkerCount);
+}
+
+void ThreadPool::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> wLock(mMutex);
+		mStop = true;
+		mJobs.clear();
+		mBackgroundJobs.clear();
+	}
+	mCondition.notify_all();
+
+	for (std::thread& wWorker : mWorkers)
+	{
+		if (wWorker.joinable())
+		{
+			wWorker.join();
+		}
+	}
+	mWorkers.clear();
+}
+
+bool ThreadPool::IsWorkerThread()
+{
+	return tIsWorkerThread;
+}
+
+void ThreadPool::Enqueue(std::function<void()> iJob, bool iBackground)
+{
+	std::unique_lock<std::mutex> wLock(mMutex);
+	if (mStop)
+	{
+		// Pool shut down, run inline so callers waiting on the result don't hang
+		wLock.unlock();
+		iJob();
+		return;
+	}
+
+	(iBackground ? mBackgroundJobs : mJobs).push_back(std::move(iJob));
+	wLock.unlock();
+	mCondition.notify_one();
+}
+
+bool ThreadPool::ExecuteOneJob(bool iIncludeBackground)
+{
+	std::function<void()> wJob;
+	{
+		std::lock_guard<std::mutex> wLock(mMutex);
+		if (!mJobs.empty())
+		{
+			wJob = std::move(mJobs.front());
+			mJobs.pop_front();
+		}
+		else if (iIncludeBackground && !mBackgroundJobs.empty())
+		{
+			wJob = std::move(mBackgroundJobs.front());
+			mBackgroundJobs.pop_front();
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	wJob();
+	return true;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	tIsWorkerThread = true;
+
+	while (true)
+	{
+		std::function<void()> wJob;
+		{
+			std::unique_lock<std::mutex> wLock(mMutex);
+			mCondition.wait(wLock, [this]() { return mStop || !mJobs.empty() || !mBackgroundJobs.empty(); });
+
+			if (mStop)
+			{
+				return;
+			}
+
+			// Frame work first, background jobs fill the idle time
+			std::deque<std::function<void()>>& wQueue = mJobs.empty() ? mBackgroundJobs : mJobs;
+			wJob = std::move(wQueue.front());
+			wQueue.pop_front();
+		}
+
+		wJob();
+	}
+}
+
+void ThreadPool::ParallelFor(uint32_t iCount, const std::function<void(uint32_t, uint32_t, uint32_t)>& iFunc)
+{
+	if (iCount == 0)
+	{
+		return;
+	}
+
+	uint32_t wChunkCount = std::min(iCount, GetMaxChunkCount());
+	uint32_t wChunkSize = (iCount + wChunkCount - 1) / wChunkCount;
+
+	std::vector<std::future<void>> wFutures;
+	wFutures.reserve(wChunkCount);
+
+	for (uint32_t wChunk = 1; wChunk < wChunkCount; wChunk++)
+	{
+		uint32_t wBegin = wChunk * wChunkSize;
+		uint32_t wEnd = std::min(iCount, wBegin + wChunkSize);
+		if (wBegin >= wEnd)
+		{
+			break;
+		}
+		wFutures.push_back(Submit([&iFunc, wBegin, wEnd, wChunk]() { iFunc(wBegin, wEnd, wChunk); }));
+	}
+
+	// The calling thread takes the first chunk
+	iFunc(0, std::min(iCount, wChunkSize), 0);
+
+	for (std::future<void>& wFuture : wFutures)
+	{
+		Wait(wFuture);
+		wFuture.get();
+	}
+}
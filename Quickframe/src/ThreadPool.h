@@ -0,0 +1,136 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+/**
+ * @brief : Singleton owning the engine worker threads.
+ * Jobs must not touch the OpenGL context, it is only current on the main thread.
+*/
+class ThreadPool
+{
+public:
+	ThreadPool(ThreadPool& iOther) = delete;
+	void operator=(const ThreadPool&) = delete;
+
+	static ThreadPool* GetInstance();
+
+	/**
+	 * @brief : Join all the workers, pending jobs are discarded
+	*/
+	void Shutdown();
+
+	/**
+	 * @brief : Queue a job to be executed by a worker
+	 * @return a future holding the job result
+	*/
+	template<typename F>
+	auto Submit(F&& iJob) -> std::future<decltype(iJob())>
+	{
+		return SubmitTo(std::forward<F>(iJob), IsWorkerThread());
+	}
+
+	/**
+	 * @brief : Queue a long job (file decoding, cooking ...) that only workers execute.
+	 * The main thread never picks it up while waiting, so it can't stall a frame.
+	 * Jobs submitted from a worker thread always go to this queue.
+	*/
+	template<typename F>
+	auto SubmitBackground(F&& iJob) -> std::future<decltype(iJob())>
+	{
+		return SubmitTo(std::forward<F>(iJob), true);
+	}
+
+	/**
+	 * @brief : Split [0, iCount[ in contiguous chunks and run iFunc on each chunk in parallel.
+	 * The calling thread executes the first chunk and returns once all the chunks are done.
+	 * @param iFunc : void(uint32_t iBegin, uint32_t iEnd, uint32_t iChunkIndex)
+	*/
+	void ParallelFor(uint32_t iCount, const std::function<void(uint32_t, uint32_t, uint32_t)>& iFunc);
+
+	/**
+	 * @brief : Wait for a future, executing queued jobs in the meantime.
+	 * Makes waiting from a worker thread safe.
+	*/
+	template<typename T>
+	void Wait(std::future<T>& iFuture)
+	{
+		const bool wIsWorker = IsWorkerThread();
+		while (iFuture.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			if (!ExecuteOneJob(wIsWorker))
+			{
+				iFuture.wait_for(std::chrono::microseconds(100));
+			}
+		}
+	}
+
+	/**
+	 * @brief : Maximum number of chunks ParallelFor splits a range into (workers + calling thread)
+	*/
+	uint32_t GetMaxChunkCount() const { return static_cast<uint32_t>(mWorkers.size()) + 1; }
+	uint32_t GetWorkerCount() const { return static_cast<uint32_t>(mWorkers.size()); }
+
+private:
+	ThreadPool(uint32_t iWorkerCount);
+
+	template<typename F>
+	auto SubmitTo(F&& iJob, bool iBackground) -> std::future<decltype(iJob())>
+	{
+		using ResultType = decltype(iJob());
+		auto wTask = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(iJob));
+		std::future<ResultType> wFuture = wTask->get_future();
+		Enqueue([wTask]() { (*wTask)(); }, iBackground);
+		return wFuture;
+	}
+
+	static bool IsWorkerThread();
+
+	void Enqueue(std::function<void()> iJob, bool iBackground);
+
+	/**
+	 * @param iIncludeBackground : Also pick background jobs, only workers may
+	*/
+	bool ExecuteOneJob(bool iIncludeBackground);
+	void WorkerLoop();
+
+	static ThreadPool* mThreadPool;
+
+	std::vector<std::thread> mWorkers;
+	std::deque<std::function<void()>> mJobs;
+	std::deque<std::function<void()>> mBackgroundJobs;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	bool mStop = false;
+};
@@ -40,34 +40,40 @@ Transform::Transform(glm::vec3 iPos, glm::vec3 iRot, glm::vec3 iScale)
 void Transform::Translate(glm::vec3 iTranslation)
 {
 	mPos += iTranslation;
+	++mVersion;
 }
 
 void Transform::SetWorldPos(glm::vec3 iWorldPos)
 {
 	mPos = iWorldPos;
+	++mVersion;
 }
 
 void Transform::Rotate(glm::vec3 iRotation)
 {
 	mRotation += iRotation;
+	++mVersion;
 }
 
 void Transform::SetRotation(glm::vec3 iRotation)
 {
 	mRotation = iRotation;
+	++mVersion;
 }
 
 void Transform::Scale(glm::vec3 iScale)
 {
 	mScale *= iScale;
+	++mVersion;
 }
 
 void Transform::SetScale(glm::vec3 iScale)
 {
 	mScale = iScale;
+	++mVersion;
 }
 
-const glm::mat4 Transform::GetWorldMatrix()
+const glm::mat4 Transform::GetWorldMatrix() const
 {
 	glm::mat4 wTranslationMat = glm::mat4(1.f);
 	glm::mat4 wRotationMat = glm::mat4(1.f);
@@ -24,6 +24,7 @@ SOFTWARE.
 
 #pragma once
 
+#include <cstdint>
 #include <glm/vec3.hpp>
 #include <glm/mat4x4.hpp>
 
@@ -40,12 +41,24 @@ public:
 	void Scale(glm::vec3 iScale);
 	void SetScale(glm::vec3 iScale);
 
-	const glm::mat4 GetWorldMatrix();
+	const glm::mat4 GetWorldMatrix() const;
 	const glm::vec3& GetPos() const { return mPos; }
 	const glm::vec3& GetScale() const { return mScale; }
+
+	/**
+	 * @brief : Incremented on every change, observers keep the last version they saw to detect movement
+	*/
+	uint64_t GetVersion() const { return mVersion; }
+
+	/**
+	 * @brief : Bump the version without moving, when the geometry attached to the transform changed
+	*/
+	void Invalidate() { ++mVersion; }
 private:
 
 	glm::vec3 mScale{ 1.f, 1.f, 1.f };
 	glm::vec3 mRotation{0.f, 0.f, 0.f};
 	glm::vec3 mPos{0.f, 0.f, 0.f};
+
+	uint64_t mVersion = 0;
 };
\ No newline at end of file
@@ -25,6 +25,7 @@ SOFTWARE.
 #include "Engine.h"
 #include "UnlitPass.h"
 #include "Scene.h"
+#include "GLStateCache.h"
 
 UnlitPass::UnlitPass()
 {
@@ -40,8 +41,8 @@ void UnlitPass::Execute(Scene* iScene)
 {
 	uint32_t wWidth, wHeight;
 	Engine::GetInstance()->GetWindow()->GetSize(wWidth, wHeight);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glViewport(0, 0, wWidth, wHeight);
+	GLStateCache::GetInstance()->BindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLStateCache::GetInstance()->Viewport(0, 0, wWidth, wHeight);
 	mProgram->Bind();
 	for (uint32_t i = 0; i < iScene->GetPointLightCount(); i++)
 	{
@@ -54,11 +55,8 @@ void UnlitPass::Execute(Scene* iScene)
 		mProgram->SetUniformMatrix4f("uMVP", wTransform);
 		const SubMesh& wLightPointSubmesh = wPointLight->GetSubmesh();
 
-		glBindVertexArray(wLightPointSubmesh.VertexArrayHandle());
-		glEnableVertexAttribArray(SubMesh::EVertexAttrib::ePosition);
+		GLStateCache::GetInstance()->BindVertexArray(wLightPointSubmesh.VertexArrayHandle());
 		glDrawElements(GL_TRIANGLES, wLightPointSubmesh.IndexCount(), GL_UNSIGNED_INT, 0);
-		glDisableVertexAttribArray(SubMesh::EVertexAttrib::ePosition);
 	}
-	mProgram->Unbind();
 }
 
@@ -0,0 +1,561 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <spdlog/spdlog.h>
+
+#include "VirtualShadowMap.h"
+#include "Scene.h"
+#include "Camera.h"
+#include "Engine.h"
+#include "GLStateCache.h"
+#include "OrthographicFrustum.h"
+#include "Defines.h"
+
+VirtualShadowMap::VirtualShadowMap()
+	:mViewBatch(ShadowViewBatch::EDepthMode::eHardware),
+	mRequestBuffer(GL_SHADER_STORAGE_BUFFER),
+	mPageTableBuffer(GL_SHADER_STORAGE_BUFFER)
+{
+	Shader wMarkShader("shaders/VirtualShadowMarkCS.glsl", Shader::EShaderStage::eCompute);
+	std::vector<Shader> wMarkShaders{ wMarkShader };
+	mMarkProgram = std::make_unique<Program>(wMarkShaders);
+
+	const uint32_t wPageCount = LevelOffset(kLevelCount);
+	mPages.resize(wPageCount);
+	mPageTable.assign(wPageCount, 0);
+	mRequests.assign(wPageCount, 0);
+	mPhysicalPages.assign(kPoolPagesPerSide * kPoolPagesPerSide, -1);
+
+	const GLsizeiptr wTableSize = wPageCount * sizeof(uint32_t);
+	mRequestBuffer.Allocate(wTableSize);
+	mPageTableBuffer.Allocate(wTableSize, mPageTable.data());
+
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	for (Readback& wReadback : mReadbacks)
+	{
+		glGenBuffers(1, &wReadback.Buffer);
+		wStateCache->BindBuffer(GL_COPY_WRITE_BUFFER, wReadback.Buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, wTableSize, nullptr, GL_STREAM_READ);
+	}
+
+	// Physical page pool, sampled through sampler2DShadow like the regular shadow maps
+	glGenTextures(1, &mPoolTexture);
+	wStateCache->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, mPoolTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT16, kPoolSize, kPoolSize);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenFramebuffers(1, &mPoolFramebuffer);
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, mPoolFramebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, mPoolTexture, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		spdlog::critical("Error While Creating Framebuffer Virtual Shadow Map Pool !");
+	}
+
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+VirtualShadowMap::~VirtualShadowMap()
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	for (Readback& wReadback : mReadbacks)
+	{
+		if (wReadback.Fence)
+		{
+			glDeleteSync(wReadback.Fence);
+		}
+		wStateCache->OnBufferDeleted(wReadback.Buffer);
+		glDeleteBuffers(1, &wReadback.Buffer);
+	}
+
+	for (GLuint wTexture : { mPoolTexture, mDepthTexture })
+	{
+		if (wTexture)
+		{
+			wStateCache->OnTextureDeleted(wTexture);
+			glDeleteTextures(1, &wTexture);
+		}
+	}
+
+	for (GLuint wFramebuffer : { mPoolFramebuffer, mDepthFramebuffer })
+	{
+		if (wFramebuffer)
+		{
+			wStateCache->OnFramebufferDeleted(wFramebuffer);
+			glDeleteFramebuffers(1, &wFramebuffer);
+		}
+	}
+}
+
+uint32_t VirtualShadowMap::LevelOffset(uint32_t iLevel)
+{
+	uint32_t wOffset = 0;
+	for (uint32_t i = 0; i < iLevel; i++)
+	{
+		wOffset += PagesPerSide(i) * PagesPerSide(i);
+	}
+	return wOffset;
+}
+
+void VirtualShadowMap::Update(Scene* iScene, const DirectionalLight* iLight)
+{
+	++mFrame;
+	mPagesRenderedLastFrame = 0;
+
+	// The pages are crops of a single projection covering the whole virtual map
+	View* wLightView = iLight->GetView();
+	OrthographicFrustum* wFrustum = static_cast<OrthographicFrustum*>(wLightView->GetFrustum());
+	const glm::mat4 wLightViewProj = glm::ortho(-kHalfExtent, kHalfExtent, -kHalfExtent, kHalfExtent,
+		wFrustum->GetNearPlane(), wFrustum->GetFarPlane()) * wLightView->ViewMatrix();
+
+	if (wLightViewProj != mLightViewProj)
+	{
+		Reset();
+		mLightViewProj = wLightViewProj;
+	}
+
+	uint32_t wWidth, wHeight;
+	Engine::GetInstance()->GetWindow()->GetSize(wWidth, wHeight);
+	if (wHeight > 0)
+	{
+		mPixelAngle = 2.f * std::tan(glm::radians(iScene->GetCamera()->GetFOV()) * 0.5f) / static_cast<float>(wHeight);
+	}
+
+	UpdateCasters(iScene);
+	MarkPages();
+	ReadRequests();
+
+	// The coarsest level is always resident, it is the fallback of the pages not rendered yet
+	const uint32_t wCoarsestOffset = LevelOffset(kLevelCount - 1);
+	mPendingPages.clear();
+	for (uint32_t i = 0; i < static_cast<uint32_t>(mPages.size()); i++)
+	{
+		if (!mRequests[i] && i < wCoarsestOffset)
+		{
+			continue;
+		}
+
+		VirtualPage& wPage = mPages[i];
+		wPage.LastRequestedFrame = mFrame;
+		if (wPage.PhysicalPage < 0 || wPage.Dirty)
+		{
+			mPendingPages.push_back(i);
+		}
+	}
+
+	// Coarse levels first, they cover the most pixels, then the missing pages before the stale ones
+	std::sort(mPendingPages.begin(), mPendingPages.end(), [this](uint32_t iA, uint32_t iB)
+		{
+			bool wMissingA = mPages[iA].PhysicalPage < 0;
+			bool wMissingB = mPages[iB].PhysicalPage < 0;
+			if (LevelOf(iA) != LevelOf(iB))
+			{
+				return LevelOf(iA) > LevelOf(iB);
+			}
+			if (wMissingA != wMissingB)
+			{
+				return wMissingA;
+			}
+			return iA < iB;
+		});
+
+	if (mPendingPages.size() > kPageRenderBudget)
+	{
+		mPendingPages.resize(kPageRenderBudget);
+	}
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(mPendingPages.size()); i++)
+	{
+		VirtualPage& wPage = mPages[mPendingPages[i]];
+		if (wPage.PhysicalPage < 0)
+		{
+			wPage.PhysicalPage = AllocatePhysicalPage();
+			if (wPage.PhysicalPage < 0)
+			{
+				// Every physical page is in use this frame, the pages left keep their fallback
+				mPendingPages.resize(i);
+				break;
+			}
+			mPhysicalPages[wPage.PhysicalPage] = static_cast<int32_t>(mPendingPages[i]);
+			++mResidentPageCount;
+		}
+	}
+
+	if (!mPendingPages.empty())
+	{
+		RenderPages(mPendingPages);
+
+		for (uint32_t wPageIdx : mPendingPages)
+		{
+			VirtualPage& wPage = mPages[wPageIdx];
+			wPage.Dirty = false;
+			mPageTable[wPageIdx] = static_cast<uint32_t>(wPage.PhysicalPage) + 1;
+		}
+		mPagesRenderedLastFrame = static_cast<uint32_t>(mPendingPages.size());
+		mPageTableDirty = true;
+	}
+
+	if (mPageTableDirty)
+	{
+		mPageTableBuffer.Upload(mPageTable.data(), mPageTable.size() * sizeof(uint32_t));
+		mPageTableDirty = false;
+	}
+}
+
+void VirtualShadowMap::CaptureSceneDepth(Scene* iScene)
+{
+	uint32_t wWidth, wHeight;
+	Engine::GetInstance()->GetWindow()->GetSize(wWidth, wHeight);
+	if (wWidth == 0 || wHeight == 0)
+	{
+		return;
+	}
+
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	if (!mDepthTexture || mDepthWidth != wWidth || mDepthHeight != wHeight)
+	{
+		if (mDepthTexture)
+		{
+			wStateCache->OnTextureDeleted(mDepthTexture);
+			glDeleteTextures(1, &mDepthTexture);
+		}
+		if (!mDepthFramebuffer)
+		{
+			glGenFramebuffers(1, &mDepthFramebuffer);
+		}
+
+		// Same format as the default framebuffer depth, required to blit it
+		glGenTextures(1, &mDepthTexture);
+		wStateCache->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, mDepthTexture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, wWidth, wHeight);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		wStateCache->BindFramebuffer(GL_FRAMEBUFFER, mDepthFramebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, mDepthTexture, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			spdlog::critical("Error While Creating Framebuffer Virtual Shadow Map Depth !");
+		}
+
+		mDepthWidth = wWidth;
+		mDepthHeight = wHeight;
+	}
+
+	wStateCache->BindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	wStateCache->BindFramebuffer(GL_DRAW_FRAMEBUFFER, mDepthFramebuffer);
+	glBlitFramebuffer(0, 0, wWidth, wHeight, 0, 0, wWidth, wHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	Camera* wCamera = iScene->GetCamera();
+	mCapturedInvViewProj = glm::inverse(wCamera->VPMatrix());
+	mCapturedCameraPos = wCamera->WorldPos();
+	mCapturedPixelAngle = 2.f * std::tan(glm::radians(wCamera->GetFOV()) * 0.5f) / static_cast<float>(wHeight);
+	mDepthCaptured = true;
+}
+
+void VirtualShadowMap::BindResources(Program* iProgram)
+{
+	GLStateCache::GetInstance()->BindTexture(VIRTUAL_SHADOW_POOL_TEXTURE_UNIT, GL_TEXTURE_2D, mPoolTexture);
+	mPageTableBuffer.BindBase(VIRTUAL_SHADOW_PAGE_TABLE_SSBO_BINDING);
+
+	iProgram->SetUniformMatrix4f("uVirtualShadowViewProj", mLightViewProj);
+	iProgram->SetUniform2f("uVirtualShadowLevelParams", glm::vec2(2.f * kHalfExtent / kVirtualSize, mPixelAngle));
+}
+
+uint32_t VirtualShadowMap::LevelOf(uint32_t iPage)
+{
+	uint32_t wLevel = 0;
+	while (wLevel + 1 < kLevelCount && iPage >= LevelOffset(wLevel + 1))
+	{
+		++wLevel;
+	}
+	return wLevel;
+}
+
+void VirtualShadowMap::MarkPages()
+{
+	// Each captured depth is analysed once, and only when a readback slot is free
+	if (!mDepthCaptured || mReadbackPending == kReadbackLatency)
+	{
+		return;
+	}
+	mDepthCaptured = false;
+
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+
+	mRequestBuffer.Clear();
+	mRequestBuffer.BindBase(VIRTUAL_SHADOW_REQUESTS_SSBO_BINDING);
+
+	mMarkProgram->Bind();
+	mMarkProgram->SetUniform1i("uSceneDepth", 0);
+	mMarkProgram->SetUniformMatrix4f("uInvViewProj", mCapturedInvViewProj);
+	mMarkProgram->SetUniformMatrix4f("uLightViewProj", mLightViewProj);
+	mMarkProgram->SetUniform3f("uCameraWorldPos", mCapturedCameraPos);
+	mMarkProgram->SetUniform2f("uLevelParams", glm::vec2(2.f * kHalfExtent / kVirtualSize, mCapturedPixelAngle));
+	wStateCache->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, mDepthTexture);
+	glDispatchCompute((mDepthWidth + 7) / 8, (mDepthHeight + 7) / 8, 1);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	// Copied to a staging buffer and read a few frames later, once its fence is signaled
+	Readback& wReadback = mReadbacks[mReadbackHead];
+	wStateCache->BindBuffer(GL_COPY_READ_BUFFER, mRequestBuffer.GetHandle());
+	wStateCache->BindBuffer(GL_COPY_WRITE_BUFFER, wReadback.Buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, mRequests.size() * sizeof(uint32_t));
+	wReadback.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	mReadbackHead = (mReadbackHead + 1) % kReadbackLatency;
+	++mReadbackPending;
+}
+
+void VirtualShadowMap::ReadRequests()
+{
+	// Never waits, the requests of the latest completed analysis replace the previous ones
+	while (mReadbackPending > 0)
+	{
+		Readback& wReadback = mReadbacks[(mReadbackHead + kReadbackLatency - mReadbackPending) % kReadbackLatency];
+		GLenum wStatus = glClientWaitSync(wReadback.Fence, 0, 0);
+		if (wStatus != GL_ALREADY_SIGNALED && wStatus != GL_CONDITION_SATISFIED)
+		{
+			break;
+		}
+
+		glDeleteSync(wReadback.Fence);
+		wReadback.Fence = nullptr;
+
+		GLStateCache::GetInstance()->BindBuffer(GL_COPY_READ_BUFFER, wReadback.Buffer);
+		glGetBufferSubData(GL_COPY_READ_BUFFER, 0, mRequests.size() * sizeof(uint32_t), mRequests.data());
+		--mReadbackPending;
+	}
+}
+
+void VirtualShadowMap::UpdateCasters(Scene* iScene)
+{
+	mCasters.clear();
+	mCasterRects.clear();
+
+	for (const auto& wEntityMap : iScene->GetEntities())
+	{
+		Entity* wEntity = wEntityMap.second.get();
+		if (!wEntity->IsDrawable())
+		{
+			continue;
+		}
+
+		// Casters without bounds cover the whole map
+		glm::vec4 wRect(-1.f, -1.f, 1.f, 1.f);
+		glm::vec3 wCenter;
+		float wRadius;
+		if (wEntity->GetWorldBoundingSphere(wCenter, wRadius))
+		{
+			glm::vec4 wLightSpaceCenter = mLightViewProj * glm::vec4(wCenter, 1.f);
+			float wLightSpaceRadius = wRadius / kHalfExtent;
+			wRect = glm::vec4(glm::vec2(wLightSpaceCenter) - wLightSpaceRadius, glm::vec2(wLightSpaceCenter) + wLightSpaceRadius);
+		}
+
+		const uint64_t wVersion = wEntity->GetTransform()->GetVersion();
+		CasterState& wState = mCasterStates[wEntity];
+		if (wState.SeenFrame == 0)
+		{
+			InvalidateRect(wRect);
+		}
+		else if (wState.Version != wVersion)
+		{
+			// Both where the caster was and where it is now
+			InvalidateRect(wState.Rect);
+			InvalidateRect(wRect);
+		}
+		wState.Rect = wRect;
+		wState.Version = wVersion;
+		wState.SeenFrame = mFrame;
+
+		mCasters.push_back(wEntity);
+		mCasterRects.push_back(wRect);
+	}
+
+	// Removed casters leave their shadow behind
+	for (auto wIt = mCasterStates.begin(); wIt != mCasterStates.end();)
+	{
+		if (wIt->second.SeenFrame != mFrame)
+		{
+			InvalidateRect(wIt->second.Rect);
+			wIt = mCasterStates.erase(wIt);
+		}
+		else
+		{
+			++wIt;
+		}
+	}
+}
+
+void VirtualShadowMap::InvalidateRect(const glm::vec4& iRect)
+{
+	if (iRect.z < -1.f || iRect.w < -1.f || iRect.x > 1.f || iRect.y > 1.f)
+	{
+		return;
+	}
+
+	for (uint32_t wLevel = 0; wLevel < kLevelCount; wLevel++)
+	{
+		const uint32_t wPagesPerSide = PagesPerSide(wLevel);
+		const float wScale = 0.5f * static_cast<float>(wPagesPerSide);
+		const int32_t wMax = static_cast<int32_t>(wPagesPerSide) - 1;
+
+		const int32_t wMinX = glm::clamp(static_cast<int32_t>(std::floor((iRect.x + 1.f) * wScale)), 0, wMax);
+		const int32_t wMinY = glm::clamp(static_cast<int32_t>(std::floor((iRect.y + 1.f) * wScale)), 0, wMax);
+		const int32_t wMaxX = glm::clamp(static_cast<int32_t>(std::floor((iRect.z + 1.f) * wScale)), 0, wMax);
+		const int32_t wMaxY = glm::clamp(static_cast<int32_t>(std::floor((iRect.w + 1.f) * wScale)), 0, wMax);
+
+		const uint32_t wOffset = LevelOffset(wLevel);
+		for (int32_t y = wMinY; y <= wMaxY; y++)
+		{
+			for (int32_t x = wMinX; x <= wMaxX; x++)
+			{
+				VirtualPage& wPage = mPages[wOffset + y * wPagesPerSide + x];
+				if (wPage.PhysicalPage >= 0)
+				{
+					wPage.Dirty = true;
+				}
+			}
+		}
+	}
+}
+
+void VirtualShadowMap::Reset()
+{
+	std::fill(mPages.begin(), mPages.end(), VirtualPage());
+	std::fill(mPageTable.begin(), mPageTable.end(), 0);
+	std::fill(mPhysicalPages.begin(), mPhysicalPages.end(), -1);
+	mCasterStates.clear();
+	mResidentPageCount = 0;
+	mPageTableDirty = true;
+}
+
+int32_t VirtualShadowMap::AllocatePhysicalPage()
+{
+	// A free page, otherwise the least recently requested one that isn't needed this frame
+	int32_t wVictim = -1;
+	uint64_t wVictimFrame = mFrame;
+	for (int32_t i = 0; i < static_cast<int32_t>(mPhysicalPages.size()); i++)
+	{
+		if (mPhysicalPages[i] < 0)
+		{
+			return i;
+		}
+
+		uint64_t wLastRequested = mPages[mPhysicalPages[i]].LastRequestedFrame;
+		if (wLastRequested < wVictimFrame)
+		{
+			wVictim = i;
+			wVictimFrame = wLastRequested;
+		}
+	}
+
+	if (wVictim >= 0)
+	{
+		const uint32_t wEvicted = static_cast<uint32_t>(mPhysicalPages[wVictim]);
+		mPages[wEvicted].PhysicalPage = -1;
+		mPages[wEvicted].Dirty = false;
+		mPageTable[wEvicted] = 0;
+		mPhysicalPages[wVictim] = -1;
+		--mResidentPageCount;
+		mPageTableDirty = true;
+	}
+	return wVictim;
+}
+
+glm::vec4 VirtualShadowMap::PageRect(uint32_t iPage) const
+{
+	const uint32_t wLevel = LevelOf(iPage);
+	const uint32_t wPagesPerSide = PagesPerSide(wLevel);
+	const uint32_t wLocal = iPage - LevelOffset(wLevel);
+	const float wPageExtent = 2.f / static_cast<float>(wPagesPerSide);
+
+	const glm::vec2 wMin(-1.f + (wLocal % wPagesPerSide) * wPageExtent, -1.f + (wLocal / wPagesPerSide) * wPageExtent);
+	return glm::vec4(wMin, wMin + wPageExtent);
+}
+
+void VirtualShadowMap::RenderPages(const std::vector<uint32_t>& iPages)
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, mPoolFramebuffer);
+	wStateCache->SetDepthMask(true);
+	wStateCache->SetDepthTest(true);
+	wStateCache->SetDepthFunc(GL_LESS);
+
+	const float wClearDepth = 1.f;
+	for (size_t wFirst = 0; wFirst < iPages.size(); wFirst += ShadowViewBatch::kMaxViews)
+	{
+		const size_t wLast = std::min(iPages.size(), wFirst + ShadowViewBatch::kMaxViews);
+
+		mViewBatch.Reset();
+		mBatchRects.clear();
+		for (size_t i = wFirst; i < wLast; i++)
+		{
+			const uint32_t wPhysicalPage = static_cast<uint32_t>(mPages[iPages[i]].PhysicalPage);
+			const GLint wX = (wPhysicalPage % kPoolPagesPerSide) * kPageSize;
+			const GLint wY = (wPhysicalPage / kPoolPagesPerSide) * kPageSize;
+			glClearTexSubImage(mPoolTexture, 0, wX, wY, 0, kPageSize, kPageSize, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &wClearDepth);
+
+			// Crop of the virtual projection to the page rect
+			const glm::vec4 wRect = PageRect(iPages[i]);
+			const float wScale = 2.f / (wRect.z - wRect.x);
+			glm::mat4 wCrop(1.f);
+			wCrop[0][0] = wScale;
+			wCrop[1][1] = wScale;
+			wCrop[3][0] = -0.5f * (wRect.x + wRect.z) * wScale;
+			wCrop[3][1] = -0.5f * (wRect.y + wRect.w) * wScale;
+
+			mViewBatch.AddView(wCrop * mLightViewProj, 0, glm::ivec4(wX, wY, kPageSize, kPageSize), glm::vec3(0.f), 0.f);
+			mBatchRects.push_back(wRect);
+		}
+
+		// Pages are cleared through the texture, make the clears visible to the rasterizer
+		glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+
+		mViewBatch.Render(mCasters, [this](uint32_t iCaster, uint32_t iView)
+			{
+				const glm::vec4& wCaster = mCasterRects[iCaster];
+				const glm::vec4& wPage = mBatchRects[iView];
+				return wCaster.x <= wPage.z && wCaster.z >= wPage.x && wCaster.y <= wPage.w && wCaster.w >= wPage.y;
+			});
+	}
+
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,155 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "Program.h"
+#include "GPUBuffer.h"
+#include "ShadowViewBatch.h"
+
+class Scene;
+class Entity;
+class DirectionalLight;
+
+/**
+ * @brief : Virtual directional shadow map, 16k x 16k texels split into 128 x 128 pages with a
+ * mip chain of coarser virtual levels. The scene depth of the previous frame is analysed on the GPU
+ * to mark the pages (and levels) the visible pixels need, only those are backed by a page of the
+ * physical pool and rendered. Pages stay cached across frames and are re-rendered when a caster
+ * overlapping them moves.
+ * The page requests are read back asynchronously, a few frames late, the coarsest level is
+ * always resident so missing pages fall back to it.
+*/
+class VirtualShadowMap
+{
+	struct VirtualPage
+	{
+		int32_t PhysicalPage = -1;
+		uint64_t LastRequestedFrame = 0;
+		bool Dirty = false;
+	};
+
+	struct CasterState
+	{
+		glm::vec4 Rect{ 0.f };		// Light space NDC bounds : min x, min y, max x, max y
+		uint64_t Version = 0;
+		uint64_t SeenFrame = 0;
+	};
+
+	struct Readback
+	{
+		GLuint Buffer = 0;
+		GLsync Fence = nullptr;
+	};
+
+public:
+	static constexpr uint32_t kPageSize = 128;
+	static constexpr uint32_t kVirtualSize = 16384;
+	static constexpr uint32_t kLevelCount = 5;						// 16k down to 1k, 8 x 8 pages
+	static constexpr uint32_t kPoolSize = 4096;						// 32 x 32 physical pages
+	static constexpr uint32_t kPoolPagesPerSide = kPoolSize / kPageSize;
+	static constexpr uint32_t kPageRenderBudget = 64;				// Page renders per frame
+	static constexpr uint32_t kReadbackLatency = 3;
+	static constexpr float kHalfExtent = 128.f;						// Half width of the area covered by the map, in world units
+
+	VirtualShadowMap();
+	~VirtualShadowMap();
+
+	/**
+	 * @brief : Mark the pages needed by the last captured depth, allocate and render the pending pages
+	*/
+	void Update(Scene* iScene, const DirectionalLight* iLight);
+
+	/**
+	 * @brief : Keep the depth of the frame that was just rendered for the page analysis of the next one
+	*/
+	void CaptureSceneDepth(Scene* iScene);
+
+	/**
+	 * @brief : Bind the physical pool and the page table, set the lookup uniforms
+	*/
+	void BindResources(Program* iProgram);
+
+	uint32_t GetResidentPageCount() const { return mResidentPageCount; }
+	uint32_t GetPagesRenderedLastFrame() const { return mPagesRenderedLastFrame; }
+
+private:
+	static uint32_t PagesPerSide(uint32_t iLevel) { return (kVirtualSize / kPageSize) >> iLevel; }
+	static uint32_t LevelOffset(uint32_t iLevel);
+	static uint32_t LevelOf(uint32_t iPage);
+
+	void MarkPages();
+	void ReadRequests();
+	void UpdateCasters(Scene* iScene);
+	void InvalidateRect(const glm::vec4& iRect);
+	void Reset();
+
+	int32_t AllocatePhysicalPage();
+	void RenderPages(const std::vector<uint32_t>& iPages);
+	glm::vec4 PageRect(uint32_t iPage) const;
+
+	std::unique_ptr<Program> mMarkProgram;
+	ShadowViewBatch mViewBatch;
+
+	GLuint mPoolTexture = 0;
+	GLuint mPoolFramebuffer = 0;
+	GLuint mDepthTexture = 0;				// Copy of the scene depth
+	GLuint mDepthFramebuffer = 0;
+	uint32_t mDepthWidth = 0;
+	uint32_t mDepthHeight = 0;
+	bool mDepthCaptured = false;
+	glm::mat4 mCapturedInvViewProj{ 1.f };
+	glm::vec3 mCapturedCameraPos{ 0.f };
+	float mCapturedPixelAngle = 0.f;
+
+	GPUBuffer mRequestBuffer;
+	GPUBuffer mPageTableBuffer;
+	Readback mReadbacks[kReadbackLatency];
+	uint32_t mReadbackHead = 0;				// Next slot written
+	uint32_t mReadbackPending = 0;
+
+	glm::mat4 mLightViewProj{ 0.f };
+	std::vector<VirtualPage> mPages;		// Every level, see LevelOffset
+	std::vector<uint32_t> mPageTable;		// Physical page + 1, 0 when not resident
+	std::vector<uint32_t> mRequests;
+	std::vector<int32_t> mPhysicalPages;	// Virtual page of each physical page, -1 when free
+	std::vector<uint32_t> mPendingPages;
+	bool mPageTableDirty = true;
+	float mPixelAngle = 0.f;				// World size of a pixel at unit distance from the camera
+
+	std::unordered_map<const Entity*, CasterState> mCasterStates;
+	std::vector<Entity*> mCasters;
+	std::vector<glm::vec4> mCasterRects;	// Aligned with mCasters
+	std::vector<glm::vec4> mBatchRects;		// Light space rect of each page of the view batch
+
+	uint64_t mFrame = 0;
+	uint32_t mResidentPageCount = 0;
+	uint32_t mPagesRenderedLastFrame = 0;
+};
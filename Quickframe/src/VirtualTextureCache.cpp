@@ -0,0 +1,567 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <stb_image.h>
+#include <spdlog/spdlog.h>
+
+#include "VirtualTextureCache.h"
+#include "TextureCooker.h"
+#include "ThreadPool.h"
+#include "GLStateCache.h"
+#include "Defines.h"
+
+using namespace std::chrono;
+
+namespace
+{
+	constexpr uint32_t kTileFileMagic = 0x54564651;		// "QFVT"
+	constexpr uint32_t kTileFileVersion = 1;
+
+	/**
+	 * @brief : Followed by the tiles of every level, finest level first, rows of tiles bottom up
+	*/
+	struct TileFileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t LevelCount;
+		uint32_t TileBytes;
+	};
+}
+
+VirtualTextureCache* VirtualTextureCache::mVirtualTextureCache = nullptr;
+
+VirtualTextureCache* VirtualTextureCache::GetInstance()
+{
+	if (!mVirtualTextureCache)
+	{
+		mVirtualTextureCache = new VirtualTextureCache();
+	}
+
+	return mVirtualTextureCache;
+}
+
+uint32_t VirtualTextureCache::Register(const std::string& iPath)
+{
+	auto wIt = mTextureIds.find(iPath);
+	if (wIt != mTextureIds.end())
+	{
+		return wIt->second;
+	}
+
+	if (!std::ifstream(iPath).good())
+	{
+		spdlog::critical("Failed to load texture {0:s} : can't open file", iPath);
+		return kInvalidId;
+	}
+
+	const uint32_t wId = static_cast<uint32_t>(mTextures.size());
+	mTextures.emplace_back();
+	VirtualTexture& wTexture = mTextures.back();
+	wTexture.Path = iPath;
+	wTexture.Cook = ThreadPool::GetInstance()->SubmitBackground([iPath]()
+		{
+			return GetTileFile(iPath);
+		});
+
+	mTextureIds[iPath] = wId;
+	return wId;
+}
+
+void VirtualTextureCache::Update()
+{
+	if (mTextures.empty())
+	{
+		return;
+	}
+
+	if (!mCacheTexture)
+	{
+		CreateResources();
+	}
+
+	++mFrame;
+
+	// Cooked textures get their pages at the end of the page table
+	bool wLayoutChanged = false;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(mTextures.size()); i++)
+	{
+		VirtualTexture& wTexture = mTextures[i];
+		if (wTexture.Cook.valid() && wTexture.Cook.wait_for(seconds(0)) == std::future_status::ready)
+		{
+			wTexture.Info = wTexture.Cook.get();
+			if (wTexture.Info.LevelCount > 0)
+			{
+				AddPages(i);
+				wTexture.Ready = true;
+				wLayoutChanged = true;
+			}
+		}
+	}
+
+	if (wLayoutChanged)
+	{
+		ResizeBuffers();
+	}
+
+	ReadRequests();
+
+	// Pages requested by the last feedback that came back, the coarsest levels are always needed
+	mPendingPages.clear();
+	for (uint32_t i = 0; i < static_cast<uint32_t>(mPages.size()); i++)
+	{
+		VirtualPage& wPage = mPages[i];
+		if (!mRequests[i] && !wPage.Pinned)
+		{
+			continue;
+		}
+
+		wPage.LastRequestedFrame = mFrame;
+		if (wPage.Slot < 0)
+		{
+			mPendingPages.push_back(i);
+		}
+	}
+
+	// Coarse levels first, they are the fallback of every finer tile of their area
+	std::sort(mPendingPages.begin(), mPendingPages.end(), [this](uint32_t iA, uint32_t iB)
+		{
+			if (mPages[iA].Level != mPages[iB].Level)
+			{
+				return mPages[iA].Level > mPages[iB].Level;
+			}
+			return iA < iB;
+		});
+
+	StartTileLoads();
+	FinishTileLoads();
+
+	if (mPageTableDirty)
+	{
+		mPageTableBuffer->Upload(mPageTable.data(), mPageTable.size() * sizeof(uint32_t));
+		mPageTableDirty = false;
+	}
+}
+
+glm::ivec4 VirtualTextureCache::GetShaderParams(uint32_t iId) const
+{
+	if (iId >= mTextures.size() || !mTextures[iId].Ready)
+	{
+		return glm::ivec4(0);
+	}
+
+	const VirtualTexture& wTexture = mTextures[iId];
+	return glm::ivec4(wTexture.FirstPage, wTexture.Info.Width, wTexture.Info.Height, wTexture.Info.LevelCount);
+}
+
+void VirtualTextureCache::BindResources()
+{
+	if (!mCacheTexture)
+	{
+		return;
+	}
+
+	GLStateCache::GetInstance()->BindTexture(VIRTUAL_TEXTURE_CACHE_TEXTURE_UNIT, GL_TEXTURE_2D, mCacheTexture);
+	mPageTableBuffer->BindBase(VIRTUAL_TEXTURE_PAGE_TABLE_SSBO_BINDING);
+}
+
+bool VirtualTextureCache::BeginFeedback()
+{
+	if (mPages.empty() || mReadbackPending == kReadbackLatency)
+	{
+		return false;
+	}
+
+	mRequestBuffer->Clear();
+	mRequestBuffer->BindBase(VIRTUAL_TEXTURE_REQUESTS_SSBO_BINDING);
+	return true;
+}
+
+void VirtualTextureCache::EndFeedback()
+{
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	// Copied to a staging buffer and read a few frames later, once its fence is signaled
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	Readback& wReadback = mReadbacks[mReadbackHead];
+	wStateCache->BindBuffer(GL_COPY_READ_BUFFER, mRequestBuffer->GetHandle());
+	wStateCache->BindBuffer(GL_COPY_WRITE_BUFFER, wReadback.Buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, mRequests.size() * sizeof(uint32_t));
+	wReadback.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	mReadbackHead = (mReadbackHead + 1) % kReadbackLatency;
+	++mReadbackPending;
+}
+
+uint32_t VirtualTextureCache::TileCount(int iWidth, int iHeight, uint32_t iLevel)
+{
+	const uint32_t wLevelWidth = static_cast<uint32_t>(std::max(1, iWidth >> iLevel));
+	const uint32_t wLevelHeight = static_cast<uint32_t>(std::max(1, iHeight >> iLevel));
+	return ((wLevelWidth + kTileSize - 1) / kTileSize) * ((wLevelHeight + kTileSize - 1) / kTileSize);
+}
+
+VirtualTextureCache::TileFileInfo VirtualTextureCache::GetTileFile(const std::string& iSourcePath)
+{
+	const std::string wTilePath = GetTilePath(iSourcePath);
+
+	TileFileInfo wInfo;
+	if (TextureCooker::IsUpToDate(wTilePath, iSourcePath) && ReadTileFileInfo(wTilePath, wInfo))
+	{
+		return wInfo;
+	}
+	return CookTileFile(iSourcePath, wTilePath);
+}
+
+bool VirtualTextureCache::ReadTileFileInfo(const std::string& iPath, TileFileInfo& oInfo)
+{
+	std::ifstream wFile(iPath, std::ios::binary);
+	TileFileHeader wHeader;
+	if (!wFile.read(reinterpret_cast<char*>(&wHeader), sizeof(wHeader)) || wHeader.Magic != kTileFileMagic ||
+		wHeader.Version != kTileFileVersion || wHeader.TileBytes != kTileBytes || wHeader.Width == 0 || wHeader.Height == 0)
+	{
+		return false;
+	}
+
+	oInfo.Width = static_cast<int>(wHeader.Width);
+	oInfo.Height = static_cast<int>(wHeader.Height);
+	oInfo.LevelCount = wHeader.LevelCount;
+	return TileCount(oInfo.Width, oInfo.Height, oInfo.LevelCount - 1) == 1;
+}
+
+VirtualTextureCache::TileFileInfo VirtualTextureCache::CookTileFile(const std::string& iSourcePath, const std::string& iTilePath)
+{
+	auto wClockStart = high_resolution_clock::now();
+
+	// GL expects the bottom row first
+	stbi_set_flip_vertically_on_load_thread(1);
+	TileFileInfo wInfo;
+	int wChannels = 0;
+	unsigned char* wPixels = stbi_load(iSourcePath.c_str(), &wInfo.Width, &wInfo.Height, &wChannels, 4);
+	if (!wPixels)
+	{
+		spdlog::critical("Failed to load texture {0:s} : {1:s}", iSourcePath, stbi_failure_reason());
+		return TileFileInfo();
+	}
+
+	// Down to the first level that fits in a single tile
+	wInfo.LevelCount = 1;
+	while (TileCount(wInfo.Width, wInfo.Height, wInfo.LevelCount - 1) > 1)
+	{
+		++wInfo.LevelCount;
+	}
+
+	uint32_t wTileTotal = 0;
+	for (uint32_t i = 0; i < wInfo.LevelCount; i++)
+	{
+		wTileTotal += TileCount(wInfo.Width, wInfo.Height, i);
+	}
+	std::vector<unsigned char> wTiles(static_cast<size_t>(wTileTotal) * kTileBytes);
+
+	std::vector<unsigned char> wLevelPixels(wPixels, wPixels + static_cast<size_t>(wInfo.Width) * wInfo.Height * 4);
+	stbi_image_free(wPixels);
+
+	std::vector<unsigned char> wNextPixels;
+	uint32_t wFirstTile = 0;
+	for (uint32_t wLevel = 0; wLevel < wInfo.LevelCount; wLevel++)
+	{
+		const int wLevelWidth = std::max(1, wInfo.Width >> wLevel);
+		const int wLevelHeight = std::max(1, wInfo.Height >> wLevel);
+		const uint32_t wTilesX = (static_cast<uint32_t>(wLevelWidth) + kTileSize - 1) / kTileSize;
+		const uint32_t wLevelTiles = TileCount(wInfo.Width, wInfo.Height, wLevel);
+
+		ThreadPool::GetInstance()->ParallelFor(wLevelTiles,
+			[&](uint32_t iBegin, uint32_t iEnd, uint32_t)
+			{
+				std::vector<unsigned char> wTilePixels(kPaddedTileSize * kPaddedTileSize * 4);
+				for (uint32_t wTile = iBegin; wTile < iEnd; wTile++)
+				{
+					// Borders, and tiles past the edge of the level, wrap around like GL_REPEAT
+					const int wOriginX = static_cast<int>((wTile % wTilesX) * kTileSize) - static_cast<int>(kTileBorder);
+					const int wOriginY = static_cast<int>((wTile / wTilesX) * kTileSize) - static_cast<int>(kTileBorder);
+					for (int y = 0; y < static_cast<int>(kPaddedTileSize); y++)
+					{
+						const int wY = ((wOriginY + y) % wLevelHeight + wLevelHeight) % wLevelHeight;
+						for (int x = 0; x < static_cast<int>(kPaddedTileSize); x++)
+						{
+							const int wX = ((wOriginX + x) % wLevelWidth + wLevelWidth) % wLevelWidth;
+							std::copy_n(&wLevelPixels[(static_cast<size_t>(wY) * wLevelWidth + wX) * 4], 4,
+								&wTilePixels[(static_cast<size_t>(y) * kPaddedTileSize + x) * 4]);
+						}
+					}
+
+					TextureCooker::EncodeBlocks(wTilePixels.data(), kPaddedTileSize, kPaddedTileSize, GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+						&wTiles[static_cast<size_t>(wFirstTile + wTile) * kTileBytes]);
+				}
+			});
+
+		wFirstTile += wLevelTiles;
+		if (wLevel + 1 < wInfo.LevelCount)
+		{
+			TextureCooker::Downsample(wLevelPixels, wLevelWidth, wLevelHeight, Texture::EUsage::eColor, wNextPixels,
+				std::max(1, wInfo.Width >> (wLevel + 1)), std::max(1, wInfo.Height >> (wLevel + 1)));
+			wLevelPixels.swap(wNextPixels);
+		}
+	}
+
+	TileFileHeader wHeader = { kTileFileMagic, kTileFileVersion, static_cast<uint32_t>(wInfo.Width),
+		static_cast<uint32_t>(wInfo.Height), wInfo.LevelCount, kTileBytes };
+	std::ofstream wFile(iTilePath, std::ios::binary | std::ios::trunc);
+	wFile.write(reinterpret_cast<const char*>(&wHeader), sizeof(wHeader));
+	wFile.write(reinterpret_cast<const char*>(wTiles.data()), wTiles.size());
+	if (!wFile)
+	{
+		spdlog::info("Can't write the tiled texture {0:s}, it will be cooked again next run", iTilePath);
+	}
+
+	auto wDuration = duration_cast<milliseconds>(high_resolution_clock::now() - wClockStart);
+	spdlog::info("Virtual texture {0:s} cooked in {1:d} ms ({2:d} levels, {3:d} tiles)", iSourcePath, wDuration.count(),
+		wInfo.LevelCount, wTileTotal);
+	return wInfo;
+}
+
+std::vector<unsigned char> VirtualTextureCache::ReadTile(const std::string& iTilePath, uint32_t iTile)
+{
+	std::vector<unsigned char> wData(kTileBytes);
+	std::ifstream wFile(iTilePath, std::ios::binary);
+	wFile.seekg(sizeof(TileFileHeader) + static_cast<std::streamoff>(iTile) * kTileBytes);
+	if (!wFile.read(reinterpret_cast<char*>(wData.data()), kTileBytes))
+	{
+		wData.clear();
+	}
+	return wData;
+}
+
+void VirtualTextureCache::CreateResources()
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+
+	mPageTableBuffer = std::make_unique<GPUBuffer>(GL_SHADER_STORAGE_BUFFER);
+	mRequestBuffer = std::make_unique<GPUBuffer>(GL_SHADER_STORAGE_BUFFER);
+	for (Readback& wReadback : mReadbacks)
+	{
+		glGenBuffers(1, &wReadback.Buffer);
+	}
+
+	// Physical tiles side by side, sampled with bilinear filtering inside their border
+	glGenTextures(1, &mCacheTexture);
+	wStateCache->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, mCacheTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, kCacheSize, kCacheSize);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	mSlots.assign(kCacheTilesPerSide * kCacheTilesPerSide, -1);
+}
+
+void VirtualTextureCache::AddPages(uint32_t iTextureId)
+{
+	VirtualTexture& wTexture = mTextures[iTextureId];
+	wTexture.FirstPage = static_cast<uint32_t>(mPages.size());
+
+	uint32_t wTile = 0;
+	for (uint32_t wLevel = 0; wLevel < wTexture.Info.LevelCount; wLevel++)
+	{
+		const uint32_t wLevelTiles = TileCount(wTexture.Info.Width, wTexture.Info.Height, wLevel);
+		for (uint32_t i = 0; i < wLevelTiles; i++)
+		{
+			VirtualPage wPage;
+			wPage.Texture = iTextureId;
+			wPage.Level = wLevel;
+			wPage.Tile = wTile++;
+			wPage.Pinned = wLevel + 1 == wTexture.Info.LevelCount;
+			mPages.push_back(wPage);
+		}
+	}
+
+	mPageTable.resize(mPages.size(), 0);
+	mRequests.resize(mPages.size(), 0);
+}
+
+void VirtualTextureCache::ResizeBuffers()
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+
+	// The staging buffers are reallocated, the requests in flight are lost
+	for (Readback& wReadback : mReadbacks)
+	{
+		if (wReadback.Fence)
+		{
+			glDeleteSync(wReadback.Fence);
+			wReadback.Fence = nullptr;
+		}
+	}
+	mReadbackPending = 0;
+
+	const GLsizeiptr wTableSize = mPages.size() * sizeof(uint32_t);
+	mRequestBuffer->Allocate(wTableSize);
+	for (Readback& wReadback : mReadbacks)
+	{
+		wStateCache->BindBuffer(GL_COPY_WRITE_BUFFER, wReadback.Buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, wTableSize, nullptr, GL_STREAM_READ);
+	}
+
+	mPageTableDirty = true;
+}
+
+void VirtualTextureCache::ReadRequests()
+{
+	// Never waits, the requests of the latest completed feedback replace the previous ones
+	while (mReadbackPending > 0)
+	{
+		Readback& wReadback = mReadbacks[(mReadbackHead + kReadbackLatency - mReadbackPending) % kReadbackLatency];
+		GLenum wStatus = glClientWaitSync(wReadback.Fence, 0, 0);
+		if (wStatus != GL_ALREADY_SIGNALED && wStatus != GL_CONDITION_SATISFIED)
+		{
+			break;
+		}
+
+		glDeleteSync(wReadback.Fence);
+		wReadback.Fence = nullptr;
+
+		GLStateCache::GetInstance()->BindBuffer(GL_COPY_READ_BUFFER, wReadback.Buffer);
+		glGetBufferSubData(GL_COPY_READ_BUFFER, 0, mRequests.size() * sizeof(uint32_t), mRequests.data());
+		--mReadbackPending;
+	}
+}
+
+void VirtualTextureCache::StartTileLoads()
+{
+	ThreadPool* wThreadPool = ThreadPool::GetInstance();
+	for (uint32_t wPageIdx : mPendingPages)
+	{
+		if (mTileLoads.size() >= kMaxTileLoads)
+		{
+			break;
+		}
+
+		// The slot is reserved now so a full cache doesn't read tiles it has no room for
+		const int32_t wSlot = AllocateSlot();
+		if (wSlot < 0)
+		{
+			// Every tile of the cache is needed this frame, the pages left keep their fallback
+			break;
+		}
+
+		VirtualPage& wPage = mPages[wPageIdx];
+		wPage.Slot = wSlot;
+		wPage.Loading = true;
+		mSlots[wSlot] = static_cast<int32_t>(wPageIdx);
+
+		const std::string wTilePath = GetTilePath(mTextures[wPage.Texture].Path);
+		const uint32_t wTile = wPage.Tile;
+
+		TileLoad wLoad;
+		wLoad.Page = wPageIdx;
+		wLoad.Data = wThreadPool->SubmitBackground([wTilePath, wTile]()
+			{
+				return ReadTile(wTilePath, wTile);
+			});
+		mTileLoads.push_back(std::move(wLoad));
+	}
+}
+
+void VirtualTextureCache::FinishTileLoads()
+{
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+
+	uint32_t wUploadCount = 0;
+	for (auto wIt = mTileLoads.begin(); wIt != mTileLoads.end() && wUploadCount < kTileUploadBudget;)
+	{
+		if (wIt->Data.wait_for(seconds(0)) != std::future_status::ready)
+		{
+			++wIt;
+			continue;
+		}
+
+		VirtualPage& wPage = mPages[wIt->Page];
+		std::vector<unsigned char> wData = wIt->Data.get();
+		wPage.Loading = false;
+
+		if (wData.size() == kTileBytes)
+		{
+			if (wUploadCount == 0)
+			{
+				// Uploaded from client memory
+				wStateCache->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				wStateCache->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, mCacheTexture);
+			}
+
+			const GLint wX = static_cast<GLint>((wPage.Slot % kCacheTilesPerSide) * kPaddedTileSize);
+			const GLint wY = static_cast<GLint>((wPage.Slot / kCacheTilesPerSide) * kPaddedTileSize);
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, wX, wY, kPaddedTileSize, kPaddedTileSize, GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+				kTileBytes, wData.data());
+
+			mPageTable[wIt->Page] = static_cast<uint32_t>(wPage.Slot) + 1;
+			mPageTableDirty = true;
+			++mResidentTileCount;
+			++wUploadCount;
+		}
+		else
+		{
+			// Requested again while it is visible
+			mSlots[wPage.Slot] = -1;
+			wPage.Slot = -1;
+		}
+
+		wIt = mTileLoads.erase(wIt);
+	}
+}
+
+int32_t VirtualTextureCache::AllocateSlot()
+{
+	// A free slot, otherwise the least recently requested tile that isn't needed this frame
+	int32_t wVictim = -1;
+	uint64_t wVictimFrame = mFrame;
+	for (int32_t i = 0; i < static_cast<int32_t>(mSlots.size()); i++)
+	{
+		if (mSlots[i] < 0)
+		{
+			return i;
+		}
+
+		const VirtualPage& wPage = mPages[mSlots[i]];
+		if (!wPage.Loading && wPage.LastRequestedFrame < wVictimFrame)
+		{
+			wVictim = i;
+			wVictimFrame = wPage.LastRequestedFrame;
+		}
+	}
+
+	if (wVictim >= 0)
+	{
+		const uint32_t wEvicted = static_cast<uint32_t>(mSlots[wVictim]);
+		mPages[wEvicted].Slot = -1;
+		mPageTable[wEvicted] = 0;
+		mSlots[wVictim] = -1;
+		--mResidentTileCount;
+		mPageTableDirty = true;
+	}
+	return wVictim;
+}
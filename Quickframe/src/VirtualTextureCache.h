@@ -0,0 +1,197 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/vec4.hpp>
+
+#include "GPUBuffer.h"
+
+/**
+ * @brief : Sparse virtual texturing of the material color maps.
+ * Each source image is cooked once to a tiled file next to it (.qfvt) : 128 x 128 texel tiles with a
+ * 4 texel border, BC1 encoded, for every level down to the one that fits in a single tile.
+ * A low resolution render of the scene (VirtualTextureFeedbackPass) marks the tiles the visible pixels
+ * need, they are read from disk on the thread pool into a fixed physical tile cache, the least recently
+ * requested tiles are evicted. Shaders find the tiles through the page table, one entry per tile of every
+ * registered texture, and fall back to the closest coarser level resident. The coarsest level of each
+ * texture is never evicted so there is always something to sample.
+ * Color maps take the size of the cache in VRAM whatever the number and size of the textures.
+*/
+class VirtualTextureCache
+{
+	struct TileFileInfo
+	{
+		int Width = 0;
+		int Height = 0;
+		uint32_t LevelCount = 0;		// 0 when the file couldn't be cooked
+	};
+
+	struct VirtualTexture
+	{
+		std::string Path;
+		std::future<TileFileInfo> Cook;
+		TileFileInfo Info;
+		bool Ready = false;
+		uint32_t FirstPage = 0;			// In the page table
+	};
+
+	struct VirtualPage
+	{
+		uint32_t Texture = 0;
+		uint32_t Level = 0;
+		uint32_t Tile = 0;				// Index of the tile in the file
+		int32_t Slot = -1;				// Physical tile, reserved when the load starts
+		uint64_t LastRequestedFrame = 0;
+		bool Loading = false;
+		bool Pinned = false;			// Coarsest level
+	};
+
+	struct TileLoad
+	{
+		uint32_t Page = 0;
+		std::future<std::vector<unsigned char>> Data;		// Empty when the read failed
+	};
+
+	struct Readback
+	{
+		GLuint Buffer = 0;
+		GLsync Fence = nullptr;
+	};
+
+public:
+	static constexpr uint32_t kInvalidId = UINT32_MAX;
+	static constexpr uint32_t kTileSize = 128;
+	static constexpr uint32_t kTileBorder = 4;						// Bilinear filtering never reads a neighbour tile
+	static constexpr uint32_t kPaddedTileSize = kTileSize + 2 * kTileBorder;
+	static constexpr uint32_t kTileBytes = (kPaddedTileSize / 4) * (kPaddedTileSize / 4) * 8;	// BC1
+	static constexpr uint32_t kCacheTilesPerSide = 32;				// 1024 tiles, 9 MB
+	static constexpr uint32_t kCacheSize = kCacheTilesPerSide * kPaddedTileSize;
+	static constexpr uint32_t kMaxTileLoads = 64;					// Tiles read from disk at the same time
+	static constexpr uint32_t kTileUploadBudget = 32;				// Tiles uploaded per frame
+	static constexpr uint32_t kReadbackLatency = 3;
+
+	VirtualTextureCache(VirtualTextureCache& iOther) = delete;
+	void operator=(const VirtualTextureCache&) = delete;
+
+	static VirtualTextureCache* GetInstance();
+
+	/**
+	 * @brief : Materials loaded while enabled sample their color map through the cache
+	*/
+	void SetEnabled(bool iEnabled) { mEnabled = iEnabled; }
+	bool IsEnabled() const { return mEnabled; }
+
+	/**
+	 * @brief : Start cooking the tiles of a color map (or reading them from the cache) in the background
+	 * @return the id of the texture, kInvalidId if the file can't be opened
+	*/
+	uint32_t Register(const std::string& iPath);
+
+	/**
+	 * @brief : Read the tile requests, stream the tiles and update the page table, once per frame before the draws
+	*/
+	void Update();
+
+	/**
+	 * @brief : Page table offset, width, height and level count of a texture (uniform uVirtualTexture),
+	 * the level count is 0 until the tiles are cooked
+	*/
+	glm::ivec4 GetShaderParams(uint32_t iId) const;
+
+	/**
+	 * @brief : Bind the physical cache and the page table
+	*/
+	void BindResources();
+
+	/**
+	 * @brief : Clear and bind the request buffer, false when there is nothing to request or no readback slot is free
+	*/
+	bool BeginFeedback();
+
+	/**
+	 * @brief : Copy the requests to a staging buffer, read back a few frames later
+	*/
+	void EndFeedback();
+
+	uint32_t GetResidentTileCount() const { return mResidentTileCount; }
+
+private:
+	VirtualTextureCache() {}
+
+	static std::string GetTilePath(const std::string& iSourcePath) { return iSourcePath + ".qfvt"; }
+	static uint32_t TileCount(int iWidth, int iHeight, uint32_t iLevel);
+
+	/**
+	 * @brief : Tiled file of a source image, read from the cache or cooked and written to it. Runs on the thread pool.
+	*/
+	static TileFileInfo GetTileFile(const std::string& iSourcePath);
+	static bool ReadTileFileInfo(const std::string& iPath, TileFileInfo& oInfo);
+	static TileFileInfo CookTileFile(const std::string& iSourcePath, const std::string& iTilePath);
+	static std::vector<unsigned char> ReadTile(const std::string& iTilePath, uint32_t iTile);
+
+	/**
+	 * @brief : GL objects are created on the first update, textures can be registered before the renderer exists
+	*/
+	void CreateResources();
+	void AddPages(uint32_t iTextureId);
+	void ResizeBuffers();
+	void ReadRequests();
+	void StartTileLoads();
+	void FinishTileLoads();
+	int32_t AllocateSlot();
+
+	static VirtualTextureCache* mVirtualTextureCache;
+
+	bool mEnabled = false;
+
+	std::deque<VirtualTexture> mTextures;					// Indexed by id
+	std::unordered_map<std::string, uint32_t> mTextureIds;
+
+	std::vector<VirtualPage> mPages;
+	std::vector<uint32_t> mPageTable;						// Physical tile + 1, 0 when not resident
+	std::vector<uint32_t> mRequests;
+	std::vector<int32_t> mSlots;							// Page of each physical tile, -1 when free
+	std::vector<uint32_t> mPendingPages;
+	std::deque<TileLoad> mTileLoads;
+	bool mPageTableDirty = false;
+
+	GLuint mCacheTexture = 0;
+	std::unique_ptr<GPUBuffer> mPageTableBuffer;
+	std::unique_ptr<GPUBuffer> mRequestBuffer;
+	Readback mReadbacks[kReadbackLatency];
+	uint32_t mReadbackHead = 0;
+	uint32_t mReadbackPending = 0;
+
+	uint64_t mFrame = 0;
+	uint32_t mResidentTileCount = 0;
+};
@@ -0,0 +1,215 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+#include "Engine.h"
+#include "VirtualTextureFeedbackPass.h"
+#include "VirtualTextureCache.h"
+#include "Scene.h"
+#include "MeshNode.h"
+#include "GLStateCache.h"
+#include "ThreadPool.h"
+
+VirtualTextureFeedbackPass::VirtualTextureFeedbackPass()
+{
+	Shader wVertexShader("shaders/VirtualTextureFeedbackVS.glsl", Shader::EShaderStage::eVertex);
+	Shader wFragmentShader("shaders/VirtualTextureFeedbackFS.glsl", Shader::EShaderStage::eFragment);
+
+	std::vector<Shader> wShaders{ wVertexShader, wFragmentShader };
+	mProgram = std::make_unique<Program>(wShaders);
+
+	mMVPLocation = mProgram->FindUniformLocation("uMVP");
+	mVirtualTextureLocation = mProgram->FindUniformLocation("uVirtualTexture");
+
+	Shader wDepthVertexShader("shaders/DepthPrepassVS.glsl", Shader::EShaderStage::eVertex);
+	Shader wDepthFragmentShader("shaders/DepthPrepassFS.glsl", Shader::EShaderStage::eFragment);
+	std::vector<Shader> wDepthShaders{ wDepthVertexShader, wDepthFragmentShader };
+	mDepthProgram = std::make_unique<Program>(wDepthShaders);
+	mDepthMVPLocation = mDepthProgram->FindUniformLocation("uMVP");
+}
+
+VirtualTextureFeedbackPass::~VirtualTextureFeedbackPass()
+{
+	if (mDepthTexture)
+	{
+		GLStateCache::GetInstance()->OnTextureDeleted(mDepthTexture);
+		glDeleteTextures(1, &mDepthTexture);
+	}
+
+	if (mFramebuffer)
+	{
+		GLStateCache::GetInstance()->OnFramebufferDeleted(mFramebuffer);
+		glDeleteFramebuffers(1, &mFramebuffer);
+	}
+}
+
+void VirtualTextureFeedbackPass::Execute(Scene* iScene)
+{
+	uint32_t wWidth, wHeight;
+	Engine::GetInstance()->GetWindow()->GetSize(wWidth, wHeight);
+	if (wWidth == 0 || wHeight == 0)
+	{
+		return;
+	}
+
+	VirtualTextureCache* wVirtualTextures = VirtualTextureCache::GetInstance();
+	if (!wVirtualTextures->BeginFeedback())
+	{
+		return;
+	}
+
+	ResizeTarget(std::max(1u, wWidth / kResolutionDivisor), std::max(1u, wHeight / kResolutionDivisor));
+
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+	wStateCache->Viewport(0, 0, mWidth, mHeight);
+	wStateCache->SetDepthTest(true);
+	wStateCache->SetDepthMask(true);
+	wStateCache->SetDepthFunc(GL_LESS);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	mEntities.clear();
+	for (const auto& wEntityMap : iScene->GetEntities())
+	{
+		if (wEntityMap.second->IsDrawable())
+		{
+			mEntities.push_back(wEntityMap.second.get());
+		}
+	}
+
+	const glm::mat4 wViewProj = iScene->GetCamera()->VPMatrix();
+
+	// Early depth tests alone let surfaces drawn first request tiles before being covered,
+	// the requests are only written once the depth holds the closest surface
+	mDepthProgram->Bind();
+	DrawEntities(wViewProj, mDepthMVPLocation, true);
+
+	wStateCache->SetDepthMask(false);
+	wStateCache->SetDepthFunc(GL_LEQUAL);
+	mProgram->Bind();
+	DrawEntities(wViewProj, mMVPLocation, false);
+
+	wStateCache->SetDepthMask(true);
+	wStateCache->SetDepthFunc(GL_LESS);
+
+	wVirtualTextures->EndFeedback();
+
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, 0);
+	wStateCache->Viewport(0, 0, wWidth, wHeight);
+}
+
+void VirtualTextureFeedbackPass::DrawEntities(const glm::mat4& iViewProj, GLint iMVPLocation, bool iDepthOnly)
+{
+	ThreadPool* wThreadPool = ThreadPool::GetInstance();
+	mCommandBuffers.resize(wThreadPool->GetMaxChunkCount());
+	for (CommandBuffer& wCmdBuffer : mCommandBuffers)
+	{
+		wCmdBuffer.Reset();
+	}
+
+	wThreadPool->ParallelFor(static_cast<uint32_t>(mEntities.size()),
+		[&](uint32_t iBegin, uint32_t iEnd, uint32_t iChunk)
+		{
+			CommandBuffer& wCmdBuffer = mCommandBuffers[iChunk];
+			for (uint32_t i = iBegin; i < iEnd; i++)
+			{
+				Entity* wEntity = mEntities[i];
+				const MeshNode* wEntityRoot = wEntity->GetMesh()->GetRootNode();
+				if (wEntityRoot)
+				{
+					wCmdBuffer.SetUniformMatrix4f(iMVPLocation, iViewProj * wEntity->GetTransform()->GetWorldMatrix());
+					RecordMeshNode(*wEntityRoot, iDepthOnly, wCmdBuffer);
+				}
+			}
+		});
+
+	for (const CommandBuffer& wCmdBuffer : mCommandBuffers)
+	{
+		wCmdBuffer.Execute();
+	}
+}
+
+void VirtualTextureFeedbackPass::ResizeTarget(uint32_t iWidth, uint32_t iHeight)
+{
+	if (mDepthTexture && mWidth == iWidth && mHeight == iHeight)
+	{
+		return;
+	}
+
+	GLStateCache* wStateCache = GLStateCache::GetInstance();
+	if (mDepthTexture)
+	{
+		wStateCache->OnTextureDeleted(mDepthTexture);
+		glDeleteTextures(1, &mDepthTexture);
+	}
+	if (!mFramebuffer)
+	{
+		glGenFramebuffers(1, &mFramebuffer);
+	}
+
+	glGenTextures(1, &mDepthTexture);
+	wStateCache->BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, mDepthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, iWidth, iHeight);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	wStateCache->BindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, mDepthTexture, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		spdlog::critical("Error While Creating Framebuffer Virtual Texture Feedback !");
+	}
+
+	mWidth = iWidth;
+	mHeight = iHeight;
+}
+
+void VirtualTextureFeedbackPass::RecordMeshNode(const MeshNode& iMeshNode, bool iDepthOnly, CommandBuffer& oCmdBuffer) const
+{
+	const VirtualTextureCache* wVirtualTextures = VirtualTextureCache::GetInstance();
+	for (const auto& wSubMesh : iMeshNode.GetSubmeshes())
+	{
+		if (iDepthOnly)
+		{
+			oCmdBuffer.BindVertexArray(wSubMesh.PositionVertexArrayHandle());
+		}
+		else
+		{
+			// Surfaces without a virtual texture only occlude
+			oCmdBuffer.SetUniform4i(mVirtualTextureLocation, wVirtualTextures->GetShaderParams(wSubMesh.GetMaterial()->GetVirtualColorTex()));
+			oCmdBuffer.BindVertexArray(wSubMesh.VertexArrayHandle());
+		}
+		oCmdBuffer.DrawIndexed(wSubMesh.IndexCount());
+	}
+
+	for (auto& wChildren : iMeshNode.GetChildren())
+	{
+		RecordMeshNode(wChildren, iDepthOnly, oCmdBuffer);
+	}
+}
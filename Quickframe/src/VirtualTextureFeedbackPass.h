@@ -0,0 +1,73 @@
+/*
+MIT License
+
+Copyright (c) 2022 Amin O-M
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "Pass.h"
+#include "CommandBuffer.h"
+
+class Entity;
+class MeshNode;
+
+/**
+ * @brief : Renders the scene at a fraction of the screen resolution and marks, in the request buffer of
+ * VirtualTextureCache, the tile each visible pixel samples at the level the lit passes will pick.
+ * A depth only pass comes first so only the closest surface of each pixel requests tiles.
+ * Runs after the frame, the cache reads the requests back a few frames later.
+*/
+class VirtualTextureFeedbackPass : public Pass
+{
+public:
+	static constexpr uint32_t kResolutionDivisor = 8;
+
+	VirtualTextureFeedbackPass();
+	~VirtualTextureFeedbackPass();
+
+	void Execute(Scene* iScene) override;
+
+private:
+	void ResizeTarget(uint32_t iWidth, uint32_t iHeight);
+
+	/**
+	 * @brief : Draw every entity with the bound program, position only VAOs when iDepthOnly
+	*/
+	void DrawEntities(const glm::mat4& iViewProj, GLint iMVPLocation, bool iDepthOnly);
+	void RecordMeshNode(const MeshNode& iMeshNode, bool iDepthOnly, CommandBuffer& oCmdBuffer) const;
+
+	std::unique_ptr<Program> mDepthProgram;
+	GLint mDepthMVPLocation = -1;
+	GLint mMVPLocation = -1;
+	GLint mVirtualTextureLocation = -1;
+
+	// Depth only, the requests are written to a storage buffer
+	GLuint mDepthTexture = 0;
+	GLuint mFramebuffer = 0;
+	uint32_t mWidth = 0;
+	uint32_t mHeight = 0;
+
+	std::vector<CommandBuffer> mCommandBuffers;
+	std::vector<Entity*> mEntities;
+};